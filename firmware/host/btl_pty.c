@@ -0,0 +1,203 @@
+/*******************************************************************************
+  Bootloader on a Pseudo Terminal
+
+  File Name:
+    btl_pty.c
+
+  Summary:
+    Entry point of the host build of the bootloader.
+
+  Description:
+    Runs the protocol engine on the pseudo terminal of bootloader_pty.c, so
+    tools/btl_host.py can program it like a device on a serial port:
+
+        ./btl_pty -f flash.bin &
+        python3 ../../tools/btl_host.py -p /dev/pts/N -i app.bin -a 0x2000
+
+    The name of the terminal is printed on start, -p also writes it to a
+    file for scripts. The flash lives in the file given with -f and keeps
+    its contents over runs, -a programs an application at 0x2000 before
+    the start. -e flips received bytes at the given rate, seeded with -s,
+    to exercise the retries and FEC of the host. The run ends with the
+    reset or bank swap the host asks for.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "definitions.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define APP_START_ADDRESS       (0x2000UL)
+
+static double error_rate = 0.0;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Noisy Transport
+// *****************************************************************************
+// *****************************************************************************
+
+static bool noisy_receiver_is_ready(void)
+{
+    return bootloader_PtyTransport.receiverIsReady();
+}
+
+static size_t noisy_read(uint8_t *buffer, size_t size)
+{
+    size_t count = bootloader_PtyTransport.read(buffer, size);
+    size_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (drand48() < error_rate)
+        {
+            buffer[i] ^= (uint8_t)(1 + lrand48() % 255);
+        }
+    }
+
+    return count;
+}
+
+static void noisy_write(const uint8_t *buffer, size_t size)
+{
+    bootloader_PtyTransport.write(buffer, size);
+}
+
+static void noisy_flush(void)
+{
+    bootloader_PtyTransport.flush();
+}
+
+static bool noisy_link_setup(uint32_t bitRate)
+{
+    return bootloader_PtyTransport.linkSetup(bitRate);
+}
+
+const BOOTLOADER_TRANSPORT host_Transport =
+{
+    .receiverIsReady    = noisy_receiver_is_ready,
+    .read               = noisy_read,
+    .write              = noisy_write,
+    .flush              = noisy_flush,
+    .linkSetup          = noisy_link_setup,
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Main Entry Point
+// *****************************************************************************
+// *****************************************************************************
+
+static bool application_load(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    uint8_t *start = (uint8_t *)APP_START_ADDRESS;
+
+    if (file == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    fread(start, 1, HOST_FLASH_SIZE - APP_START_ADDRESS, file);
+    fclose(file);
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *flash_path  = NULL;
+    const char *app_path    = NULL;
+    const char *name_path   = NULL;
+    const char *name;
+    long seed = 1;
+    FILE *file;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:a:e:s:p:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f': flash_path = optarg; break;
+            case 'a': app_path   = optarg; break;
+            case 'e': error_rate = atof(optarg); break;
+            case 's': seed       = atol(optarg); break;
+            case 'p': name_path  = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-f flash.bin] [-a app.bin] [-e rate] [-s seed] [-p name.txt]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    srand48(seed);
+
+    if ((host_FlashOpen(flash_path) == false) ||
+        ((app_path != NULL) && (application_load(app_path) == false)))
+    {
+        return EXIT_FAILURE;
+    }
+
+    name = bootloader_PtyOpen();
+
+    if (name == NULL)
+    {
+        perror("pty");
+        return EXIT_FAILURE;
+    }
+
+    printf("%s\n", name);
+    fflush(stdout);
+
+    if (name_path != NULL)
+    {
+        file = fopen(name_path, "w");
+
+        if (file != NULL)
+        {
+            fprintf(file, "%s\n", name);
+            fclose(file);
+        }
+    }
+
+    bootloader_Tasks();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+/*******************************************************************************
+  Host Build Definitions Header
+
+  File Name:
+    definitions.h
+
+  Summary:
+    Stands in for the Harmony definitions.h when the bootloader is built
+    for a Linux host.
+
+  Description:
+    Declares the handful of peripheral library calls the protocol engine
+    makes, with the prototypes of the device PLIBs. host_device.c implements
+    them on a flash image mapped at address 0. The configuration.h of the
+    device build is used unchanged, feature flags are set on the command
+    line.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef DEFINITIONS_H
+#define DEFINITIONS_H
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+// *****************************************************************************
+// *****************************************************************************
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "configuration.h"
+#include "device.h"
+#include "bootloader/bootloader.h"
+#include "bootloader/bootloader_transport.h"
+
+/* Keep the buffers the device build leaves uninitialized in .bss */
+#define NO_INIT
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Peripheral Library Stand-ins
+// *****************************************************************************
+// *****************************************************************************
+
+typedef enum
+{
+    PAC_PERIPHERAL_DSU,
+} PAC_PERIPHERAL;
+
+typedef enum
+{
+    PAC_PROTECTION_CLEAR = 1,
+    PAC_PROTECTION_SET,
+} PAC_PROTECTION;
+
+void PAC_PeripheralProtectSetup( PAC_PERIPHERAL peripheral, PAC_PROTECTION operation );
+
+bool DSU_CRCCalculate( uint32_t startAddress, size_t length, uint32_t crcSeed, uint32_t *crc );
+bool DSU_CRCStart( uint32_t startAddress, size_t length, uint32_t crcSeed );
+bool DSU_CRCIsBusy( void );
+bool DSU_CRCResultGet( uint32_t *crc );
+
+#define NVMCTRL_FLASH_PAGESIZE          (512U)
+#define NVMCTRL_FLASH_BLOCKSIZE         (8192U)
+#define NVMCTRL_STATUS_AFIRST_Msk       (0x10U)
+
+void NVMCTRL_RegionUnlock( uint32_t address );
+bool NVMCTRL_BlockErase( uint32_t address );
+bool NVMCTRL_PageWrite( const uint32_t *data, uint32_t address );
+bool NVMCTRL_IsBusy( void );
+uint16_t NVMCTRL_StatusGet( void );
+void NVMCTRL_BankSwap( void );
+
+void NVIC_SystemReset( void );
+
+void SYSTICK_TimerStart( void );
+bool SYSTICK_TimerPeriodHasExpired( void );
+
+void TC0_TimerStart( void );
+uint32_t TC0_TimerFrequencyGet( void );
+uint32_t TC0_Timer32bitCounterGet( void );
+
+#if (BTL_SPI_SLAVE == 1)
+/* SERCOM1 SPI slave and its DMAC channels, test_spi.c is the master */
+typedef enum
+{
+    PORT_PIN_PA20 = 20U,
+} PORT_PIN;
+
+void PORT_PinSet( PORT_PIN pin );
+void PORT_PinClear( PORT_PIN pin );
+void PORT_PinOutputEnable( PORT_PIN pin );
+
+typedef enum
+{
+    DMAC_CHANNEL_0,
+    DMAC_CHANNEL_1,
+} DMAC_CHANNEL;
+
+bool DMAC_ChannelTransfer( DMAC_CHANNEL channel, const void *srcAddr, const void *destAddr, size_t blockSize );
+void DMAC_ChannelDisable( DMAC_CHANNEL channel );
+uint16_t DMAC_ChannelGetTransferredCount( DMAC_CHANNEL channel );
+
+volatile void *SERCOM1_SPI_DataAddressGet( void );
+bool SERCOM1_SPI_TransactionIsComplete( void );
+void SERCOM1_SPI_ReceiverFlush( void );
+void SERCOM1_SPI_Preload( uint8_t data );
+#endif
+
+#if (BTL_CAN_FD == 1)
+/* CAN0, test_can.c or bootloader_socketcan.c is the bus */
+#include "peripheral/can/plib_can0.h"
+#endif
+
+#if (BTL_ENCRYPTION == 1)
+/* AES, bootloader_aesmodel.c is the peripheral */
+#include "peripheral/aes/plib_aes.h"
+#endif
+
+#if (BTL_USB_DFU == 1) || (BTL_USB_MSC == 1)
+/* USB device endpoints, test_dfu.c is the host */
+#include "peripheral/usb/plib_usb.h"
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Host Device
+// *****************************************************************************
+// *****************************************************************************
+
+#define HOST_FLASH_SIZE                 (0x100000U)
+
+/* Maps the flash at address 0, backed by the file at path, created erased
+ * if it does not exist. NULL keeps it in memory. Returns false on failure,
+ * address 0 needs root or vm.mmap_min_addr=0. */
+bool host_FlashOpen( const char *path );
+
+/* Called by NVIC_SystemReset and NVMCTRL_BankSwap, the default reports the
+ * reason on stdout and exits */
+extern void (*host_ResetHandler)( const char *reason );
+
+/* Erases and page writes left before the power fails and
+ * host_ResetHandler is called with "power loss", negative for never */
+extern long host_PowerLossCountdown;
+
+/* The transport bootloader.c is built with, see BTL_TRANSPORT in Makefile */
+extern const BOOTLOADER_TRANSPORT host_Transport;
+
+#endif /* DEFINITIONS_H */
@@ -0,0 +1,90 @@
+/*******************************************************************************
+  Host Build Device Header
+
+  File Name:
+    device.h
+
+  Summary:
+    Stands in for the device pack header when the bootloader is built for
+    a Linux host.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include <stdint.h>
+
+#define __WEAK                  __attribute__((weak))
+
+static inline void __set_MSP(uint32_t topOfMainStack)
+{
+    (void)topOfMainStack;
+}
+
+#define FLASH_ADDR                      (0x00000000UL)
+#define FLASH_SIZE                      (0x00100000UL)
+#define HSRAM_ADDR                      (0x20000000UL)
+#define HSRAM_SIZE                      (0x00040000UL)
+
+/* Registers written directly rather than through a PLIB, plain memory in
+ * host_device.c. The host flash has no boot protection, so the commands
+ * lifting and restoring it have no effect. */
+typedef struct
+{
+    uint16_t NVMCTRL_CTRLB;
+} nvmctrl_registers_t;
+
+#define NVMCTRL_REGS                    (&host_NvmctrlRegisters)
+
+#define NVMCTRL_CTRLB_CMDEX_KEY         (0xA5U << 8)
+#define NVMCTRL_CTRLB_CMD_SBPDIS        (0x1AU)
+#define NVMCTRL_CTRLB_CMD_CBPDIS        (0x1BU)
+
+typedef struct
+{
+    uint32_t SUPC_INTFLAG;
+    uint32_t SUPC_STATUS;
+    uint32_t SUPC_BOD33;
+} supc_registers_t;
+
+#define SUPC_REGS                       (&host_SupcRegisters)
+
+#define SUPC_BOD33_ENABLE_Msk           (0x1U << 1)
+#define SUPC_BOD33_ACTION_Msk           (0x3U << 2)
+#define SUPC_BOD33_ACTION_NONE          (0x0U << 2)
+#define SUPC_STATUS_BOD33RDY_Msk        (0x1U << 0)
+#define SUPC_STATUS_BOD33DET_Msk        (0x1U << 1)
+
+/* BOD33 never trips on a host. The flag reads as clear, and clearing it,
+ * a write of one on the device, leaves the register at zero. */
+#define SUPC_INTFLAG_BOD33DET_Msk       (0x0U)
+
+extern nvmctrl_registers_t host_NvmctrlRegisters;
+extern supc_registers_t host_SupcRegisters;
+
+#endif /* DEVICE_H */
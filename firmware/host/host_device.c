@@ -0,0 +1,311 @@
+/*******************************************************************************
+  Host Build Device Source File
+
+  File Name:
+    host_device.c
+
+  Summary:
+    This file implements the peripheral library calls of the protocol
+    engine for a Linux host.
+
+  Description:
+    The 1 MB flash is mapped at address 0, so the absolute addresses the
+    bootloader works with are valid as they are. Backed by a file it keeps
+    its contents from one run to the next like the device does. Erase and
+    write go by the erase block and page sizes of the SAME51 and the DSU
+    CRC is computed with crc32() of bootloader.c. NVIC_SystemReset and
+    NVMCTRL_BankSwap end the run, a bank swap exchanges the two halves of
+    the flash first. TC0 counts at the 937.5 kHz of the device.
+
+    Tests cut the power after a given number of flash erases and writes
+    with host_PowerLossCountdown.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "definitions.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define TC0_FREQUENCY           937500U
+
+/* SysTick period of the device, in ms */
+#define SYSTICK_PERIOD_MS       100U
+
+static uint8_t *flash;
+
+static uint32_t dsu_address;
+static size_t   dsu_length;
+static uint32_t dsu_seed;
+
+static void host_reset(const char *reason);
+
+void (*host_ResetHandler)(const char *reason) = host_reset;
+
+long host_PowerLossCountdown = -1;
+
+nvmctrl_registers_t host_NvmctrlRegisters;
+
+/* BOD33 ready and the supply above its level */
+supc_registers_t host_SupcRegisters = { .SUPC_STATUS = SUPC_STATUS_BOD33RDY_Msk };
+
+unsigned long crc32(unsigned long inCrc32, const void *buf, size_t bufLen);
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Host Device Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static void host_reset(const char *reason)
+{
+    msync(flash, HOST_FLASH_SIZE, MS_SYNC);
+
+    printf("%s\n", reason);
+
+    exit(EXIT_SUCCESS);
+}
+
+/* Cuts the power before the erase or write which exhausts the countdown */
+static void host_power_check(void)
+{
+    if ((host_PowerLossCountdown >= 0) && (host_PowerLossCountdown-- == 0))
+    {
+        host_ResetHandler("power loss");
+    }
+}
+
+bool host_FlashOpen(const char *path)
+{
+    struct stat st;
+    int flags = MAP_FIXED | MAP_ANONYMOUS | MAP_PRIVATE;
+    int fd    = -1;
+    bool blank = true;
+
+    if (path != NULL)
+    {
+        fd = open(path, O_RDWR | O_CREAT, 0644);
+
+        if ((fd < 0) || (fstat(fd, &st) != 0))
+        {
+            perror(path);
+            return false;
+        }
+
+        blank = (st.st_size == 0);
+
+        if (ftruncate(fd, HOST_FLASH_SIZE) != 0)
+        {
+            perror(path);
+            return false;
+        }
+
+        flags = MAP_FIXED | MAP_SHARED;
+    }
+
+    flash = mmap(NULL, HOST_FLASH_SIZE, PROT_READ | PROT_WRITE, flags, fd, 0);
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    if (flash != NULL)
+    {
+        fprintf(stderr, "flash can not be mapped at address 0, run as root or "
+                        "with vm.mmap_min_addr=0\n");
+        return false;
+    }
+
+    if (blank == true)
+    {
+        memset(flash, 0xFF, HOST_FLASH_SIZE);
+    }
+
+    return true;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Peripheral Library Stand-ins
+// *****************************************************************************
+// *****************************************************************************
+
+void PAC_PeripheralProtectSetup(PAC_PERIPHERAL peripheral, PAC_PROTECTION operation)
+{
+    (void)peripheral;
+    (void)operation;
+}
+
+/* The DSU starts from the seed and leaves out the final inversion */
+bool DSU_CRCCalculate(uint32_t startAddress, size_t length, uint32_t crcSeed, uint32_t *crc)
+{
+    *crc = (uint32_t)crc32(~crcSeed, &flash[startAddress], length) ^ 0xFFFFFFFFUL;
+
+    return true;
+}
+
+bool DSU_CRCStart(uint32_t startAddress, size_t length, uint32_t crcSeed)
+{
+    dsu_address = startAddress;
+    dsu_length  = length;
+    dsu_seed    = crcSeed;
+
+    return true;
+}
+
+bool DSU_CRCIsBusy(void)
+{
+    return false;
+}
+
+bool DSU_CRCResultGet(uint32_t *crc)
+{
+    return DSU_CRCCalculate(dsu_address, dsu_length, dsu_seed, crc);
+}
+
+void NVMCTRL_RegionUnlock(uint32_t address)
+{
+    (void)address;
+}
+
+bool NVMCTRL_BlockErase(uint32_t address)
+{
+    host_power_check();
+
+    memset(&flash[address & ~(NVMCTRL_FLASH_BLOCKSIZE - 1U)], 0xFF, NVMCTRL_FLASH_BLOCKSIZE);
+
+    return true;
+}
+
+/* Like the NVM, a write only ever clears bits */
+bool NVMCTRL_PageWrite(const uint32_t *data, uint32_t address)
+{
+    uint8_t *page = &flash[address & ~(NVMCTRL_FLASH_PAGESIZE - 1U)];
+    const uint8_t *src = (const uint8_t *)data;
+    uint32_t i;
+
+    host_power_check();
+
+    for (i = 0; i < NVMCTRL_FLASH_PAGESIZE; i++)
+    {
+        page[i] &= src[i];
+    }
+
+    return true;
+}
+
+bool NVMCTRL_IsBusy(void)
+{
+    return false;
+}
+
+uint16_t NVMCTRL_StatusGet(void)
+{
+    return 0;
+}
+
+void NVMCTRL_BankSwap(void)
+{
+    static uint8_t bank[HOST_FLASH_SIZE / 2U];
+
+    memcpy(bank, flash, sizeof(bank));
+    memcpy(flash, &flash[sizeof(bank)], sizeof(bank));
+    memcpy(&flash[sizeof(bank)], bank, sizeof(bank));
+
+    host_ResetHandler("bankswap");
+}
+
+void NVIC_SystemReset(void)
+{
+    host_ResetHandler("reset");
+}
+
+void SYSTICK_TimerStart(void)
+{
+}
+
+bool SYSTICK_TimerPeriodHasExpired(void)
+{
+    static uint64_t period_end = 0;
+    struct timespec now;
+    uint64_t ms;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    ms = (uint64_t)now.tv_sec * 1000U + (uint64_t)now.tv_nsec / 1000000U;
+
+    if (period_end == 0U)
+    {
+        period_end = ms + SYSTICK_PERIOD_MS;
+    }
+
+    if (ms < period_end)
+    {
+        return false;
+    }
+
+    period_end += SYSTICK_PERIOD_MS;
+
+    return true;
+}
+
+void TC0_TimerStart(void)
+{
+}
+
+uint32_t TC0_TimerFrequencyGet(void)
+{
+    return TC0_FREQUENCY;
+}
+
+uint32_t TC0_Timer32bitCounterGet(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)((uint64_t)now.tv_sec * TC0_FREQUENCY +
+                      (uint64_t)now.tv_nsec * TC0_FREQUENCY / 1000000000U);
+}
@@ -0,0 +1,66 @@
+/*******************************************************************************
+  Host Test Header
+
+  File Name:
+    host_test.h
+
+  Summary:
+    Check macro shared by the host tests.
+
+  Description:
+    A failed check is reported with its file and line and the test goes
+    on; the test exits with host_TestResult(), non zero if a check failed.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int host_test_failures;
+
+#define CHECK(condition)    host_Check((condition), #condition, __FILE__, __LINE__)
+
+static inline void host_Check(int passed, const char *condition, const char *file, int line)
+{
+    if (passed == 0)
+    {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+        host_test_failures++;
+    }
+}
+
+static inline int host_TestResult(const char *name)
+{
+    printf("%s: %s\n", name, (host_test_failures == 0) ? "passed" : "FAILED");
+
+    return (host_test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* HOST_TEST_H */
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Test vectors made by the host tools for the host tests.
+
+The tests check the firmware against what the tools in ../../tools really
+send, so the vectors come from them rather than from a copy in C:
+
+    host_vectors.py aes test_aes.packets
+    host_vectors.py container test_container.vectors
+    host_vectors.py partition test_partition.vectors
+    host_vectors.py fec test_fec.vectors
+
+aes writes the ENC_DATA packets btl_host.py -k 000102030405060708090a0b0c0d0e0f
+sends for a two block image at 0x2000, back to back as they go on the wire.
+The image is the pattern test_aes.c builds. Needs the cryptography package
+and pyserial, which btl_host.py imports.
+
+container writes containers of mkcontainer.py, each as a record of five
+little endian words, the container size, the address and size of the
+region it programs and the address and size of its DELTA base, followed by
+the container, the region and the base.
+
+partition writes the table block mkpartitions.py builds for the partitions
+test_partition.c expects, followed by the contents recorded for its code
+partition.
+
+fec writes FEC_DATA payloads of rsfec.py with byte errors, from none to
+more than the parity corrects. Each is a record of two little endian words,
+the payload size and the parity, followed by the payload and then, for
+each codeword, a byte which is 1 if rsfec.py corrects it and the codeword
+as corrected, zeros if not.
+"""
+
+import argparse
+import os
+import random
+import struct
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "tools"))
+
+import mkcontainer
+import mkpartitions
+import rsfec
+from btl_protocol import BLOCK_SIZE, Encoder
+
+AES_KEY = bytes(range(16))
+AES_ADDRESS = 0x2000
+AES_BLOCKS = 2
+
+
+def aes(out):
+    import btl_cache
+    import btl_host
+    from cryptography.hazmat.primitives.ciphers.aead import AESGCM
+
+    image = bytes(((i * 7) ^ (i >> 11)) & 0xFF for i in range(AES_BLOCKS * BLOCK_SIZE))
+    prepared = btl_cache.prepare(image, AES_ADDRESS)
+    cipher = AESGCM(AES_KEY)
+    encoder = Encoder()
+    for n in range(prepared.count):
+        _, parts = btl_host.data_packet(encoder, prepared, n, cipher)
+        out.write(b"".join(bytes(p) for p in parts))
+
+
+def firmware(rng, size):
+    """Bytes with the mix of repeats, literals, zeros and strings of code."""
+    words = [bytes(rng.getrandbits(8) for _ in range(rng.randint(2, 12))) for _ in range(300)]
+    out = bytearray()
+    while len(out) < size:
+        kind = rng.random()
+        if kind < 0.6:
+            out += rng.choice(words)
+        elif kind < 0.8:
+            out += bytes(rng.getrandbits(8) for _ in range(rng.randint(1, 40)))
+        elif kind < 0.9:
+            out += bytes(rng.randint(4, 300))
+        else:
+            out += b"string table entry %d\0" % rng.randint(0, 99999)
+    return out[:size]
+
+
+def container_record(inputs, base=None, base_address=0):
+    """Record of the container mkcontainer.py builds of the (data, address)
+    inputs, laid out in the region like it does."""
+    begin = min(address for _, address in inputs) // BLOCK_SIZE * BLOCK_SIZE
+    end = max(address + len(data) for data, address in inputs)
+    end = (end + mkcontainer.PAGE_SIZE - 1) // mkcontainer.PAGE_SIZE * mkcontainer.PAGE_SIZE
+    region = bytearray(b"\xff" * (end - begin))
+    for data, address in inputs:
+        region[address - begin:address - begin + len(data)] = data
+    region = bytes(region)
+    segments, _ = mkcontainer.build(region, begin, end, base, base_address, 8)
+    packed = mkcontainer.container(region, begin, end, segments)
+    base = base or b""
+    return struct.pack("<5I", len(packed), begin, len(region), base_address, len(base)) + packed + region + base
+
+
+def container(out):
+    rng = random.Random(7)
+
+    # Code, an erased gap and a pattern, then random bytes further up: all
+    # of RAW, FILL and LZ
+    old = firmware(rng, 150000)
+    old[40000:60000] = b"\xff" * 20000
+    old[70000:90000] = b"\x55\xaa\x00\x11" * 5000
+    noise = bytes(rng.getrandbits(8) for _ in range(3 * BLOCK_SIZE))
+    out.write(container_record([(old, 0x2000), (noise, 0x40000)]))
+
+    # The next build for the other bank, DELTA against the running one
+    new = bytearray(old)
+    for _ in range(40):
+        at = rng.randrange(len(new) - 100)
+        new[at:at + rng.randint(1, 60)] = firmware(rng, rng.randint(1, 60))
+    new = new[:120000] + firmware(rng, 3000) + new[120000:]
+    out.write(container_record([(new, 0x82000)], bytes(old), 0x2000))
+
+
+def partition(out):
+    code = bytes(((i * 13) ^ (i >> 9)) & 0xFF for i in range(12000))
+    with tempfile.NamedTemporaryFile(suffix=".bin") as f:
+        f.write(code)
+        f.flush()
+        specs = ["1:app:app:0x2000:0x60000",
+                 "2:calib:data:0x62000:0x2000",
+                 "3:dsp:code:0x64000:0x8000:" + f.name,
+                 "7:assets01:data:0x6c000:0x10000"]
+        partitions = [mkpartitions.parse(spec) for spec in specs]
+    mkpartitions.check(partitions, mkpartitions.TABLE_OFFSET)
+    out.write(mkpartitions.table_block(partitions) + mkpartitions.pad_image(code))
+
+
+def fec_damage(rng, data, n, codewords, parity):
+    """Errors in the codewords of payload n: scattered ones every codeword
+    corrects, a burst across the interleave or too many for some."""
+    kind = n % 3
+    if kind == 0:
+        for i in range(codewords):
+            for _ in range(rng.randint(0, parity // 2)):
+                data[4 + i + codewords * rng.randrange((len(data) - 4) // codewords)] ^= rng.randint(1, 255)
+    elif kind == 1:
+        length = rng.randint(1, codewords * (parity // 2 + 1))
+        start = rng.randrange(4, len(data) - length)
+        for at in range(start, start + length):
+            data[at] ^= rng.randint(1, 255)
+    else:
+        for _ in range(rng.randint(1, len(data) // 8)):
+            data[rng.randrange(4, len(data))] ^= rng.randint(1, 255)
+
+
+def fec(out):
+    rng = random.Random(11)
+    for n in range(60):
+        # Up to BTL_FEC_PARITY_MAX of the default configuration
+        parity = rng.randrange(2, 33, 2)
+        block = bytes(rng.getrandbits(8) for _ in range(BLOCK_SIZE))
+        payload = bytearray(rsfec.encode(0x2000 + n * BLOCK_SIZE, block, parity))
+        codewords, _ = rsfec.layout(parity)
+        fec_damage(rng, payload, n, codewords, parity)
+        out.write(struct.pack("<II", len(payload), parity) + payload)
+        for i in range(codewords):
+            codeword = bytes(payload[4 + i::codewords])
+            corrected = rsfec.decode_codeword(codeword, parity)
+            out.write(b"\x01" + corrected if corrected is not None else bytes(1 + len(codeword)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("vectors", choices=("aes", "container", "partition", "fec"))
+    parser.add_argument("output")
+    args = parser.parse_args()
+    with open(args.output, "wb") as out:
+        globals()[args.vectors](out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,414 @@
+/*******************************************************************************
+  AES-GCM Host Test
+
+  File Name:
+    test_aes.c
+
+  Summary:
+    Decrypts the ENC_DATA packets of btl_host.py through the protocol engine
+    built with BTL_ENCRYPTION and the AES model.
+
+  Description:
+    host_vectors.py writes the packets btl_host.py sends with the key
+    000102...0f for a two block image, the engine decrypts them with
+    bootloader_aesmodel.c standing in for the AES peripheral. Every boot is
+    a child process playing the packets back on its transport, the flash is
+    a file. The test checks that
+
+      - the blocks are programmed as the plaintext and VERIFY passes,
+      - a block whose tag is wrong is not programmed and VERIFY fails,
+      - a block sent with another address is not programmed there, the
+        address being the additional authenticated data, and VERIFY fails.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "definitions.h"
+#include "bootloader_protocol.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+/* Written by host_vectors.py aes, see Makefile */
+#define PACKETS_PATH            "test_aes.packets"
+
+#define APP_START_ADDRESS       (0x2000UL)
+#define IMAGE_BLOCKS            2U
+#define IMAGE_SIZE              (IMAGE_BLOCKS * BTL_BLOCK_SIZE)
+#define PACKET_SIZE             (BTL_HEADER_SIZE + BTL_ENC_DATA_PAYLOAD_SIZE)
+
+/* What the flash holds before an update, to tell blocks left alone */
+#define OLD_CONTENT             0x5AU
+
+/* The end of the playback, taken as a stalled session after this many
+ * polls of the transport */
+#define IDLE_POLLS              100000UL
+
+/* How a boot ended, the exit status of its process */
+enum boot_result
+{
+    BOOT_RESET,
+    BOOT_IDLE,
+    BOOT_WRONG_RESPONSE,
+    BOOT_FAILED,
+};
+
+static char flash_path[64];
+
+static uint8_t image[IMAGE_SIZE];
+static uint32_t image_crc;
+
+/* The ENC_DATA payloads of btl_host.py, one per block */
+static struct btl_enc_data_payload packets[IMAGE_BLOCKS];
+
+/* Packets to play back and the response expected to each */
+static uint8_t  script[4U * PACKET_SIZE];
+static size_t   script_size;
+static size_t   script_ptr;
+static uint8_t  responses[16];
+static size_t   responses_size;
+static size_t   responses_ptr;
+static unsigned long idle_polls;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Playback Transport
+// *****************************************************************************
+// *****************************************************************************
+
+static bool script_receiver_is_ready(void)
+{
+    if (script_ptr < script_size)
+    {
+        return true;
+    }
+
+    if (++idle_polls > IDLE_POLLS)
+    {
+        _exit(BOOT_IDLE);
+    }
+
+    return false;
+}
+
+static size_t script_read(uint8_t *buffer, size_t size)
+{
+    if (size > (script_size - script_ptr))
+    {
+        size = script_size - script_ptr;
+    }
+
+    memcpy(buffer, &script[script_ptr], size);
+    script_ptr += size;
+
+    return size;
+}
+
+static void script_write(const uint8_t *buffer, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        if ((responses_ptr >= responses_size) || (buffer[i] != responses[responses_ptr++]))
+        {
+            _exit(BOOT_WRONG_RESPONSE);
+        }
+    }
+}
+
+static void script_flush(void)
+{
+}
+
+static bool script_link_setup(uint32_t bitRate)
+{
+    (void)bitRate;
+
+    return true;
+}
+
+const BOOTLOADER_TRANSPORT host_Transport =
+{
+    .receiverIsReady    = script_receiver_is_ready,
+    .read               = script_read,
+    .write              = script_write,
+    .flush              = script_flush,
+    .linkSetup          = script_link_setup,
+};
+
+static void script_packet(uint8_t command, const void *payload, uint32_t size, uint8_t response)
+{
+    struct btl_header header = { BTL_GUARD, size, command };
+
+    memcpy(&script[script_size], &header, BTL_HEADER_SIZE);
+    memcpy(&script[script_size + BTL_HEADER_SIZE], payload, size);
+    script_size += BTL_HEADER_SIZE + size;
+
+    responses[responses_size++] = response;
+}
+
+/* UNLOCK of blocks from the start of the application, the given ENC_DATA
+ * payloads, VERIFY of the image answered with verifyResponse and RESET */
+static void script_update(uint32_t blocks, const struct btl_enc_data_payload *data, size_t count, uint8_t verifyResponse)
+{
+    const struct btl_unlock_payload unlock = { APP_START_ADDRESS, blocks * BTL_BLOCK_SIZE };
+    const struct btl_verify_payload verify = { image_crc };
+    const struct btl_reset_payload reset = { 0 };
+    size_t i;
+
+    script_size     = 0;
+    responses_size  = 0;
+
+    script_packet(BL_CMD_UNLOCK, &unlock, sizeof(unlock), BL_RESP_OK);
+
+    for (i = 0; i < count; i++)
+    {
+        script_packet(BL_CMD_ENC_DATA, &data[i], BTL_ENC_DATA_PAYLOAD_SIZE, BL_RESP_OK);
+    }
+
+    script_packet(BL_CMD_VERIFY, &verify, sizeof(verify), verifyResponse);
+    script_packet(BL_CMD_RESET, &reset, sizeof(reset), BL_RESP_OK);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Boot Process
+// *****************************************************************************
+// *****************************************************************************
+
+static void boot_reset_handler(const char *reason)
+{
+    _exit((strcmp(reason, "reset") == 0) ? BOOT_RESET : BOOT_FAILED);
+}
+
+/* One boot playing the script back, as far as the RESET it ends with */
+static enum boot_result boot(void)
+{
+    pid_t pid = fork();
+    int status;
+
+    if (pid == 0)
+    {
+        if (host_FlashOpen(flash_path) == false)
+        {
+            _exit(BOOT_FAILED);
+        }
+
+        host_ResetHandler = boot_reset_handler;
+
+        AES_Initialize();
+
+        bootloader_Tasks();
+
+        _exit(BOOT_FAILED);
+    }
+
+    if ((pid < 0) || (waitpid(pid, &status, 0) != pid) || (WIFEXITED(status) == 0))
+    {
+        return BOOT_FAILED;
+    }
+
+    return (enum boot_result)WEXITSTATUS(status);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Flash File
+// *****************************************************************************
+// *****************************************************************************
+
+static bool flash_is(uint32_t address, const void *data, size_t size)
+{
+    static uint8_t buffer[IMAGE_SIZE];
+    int fd = open(flash_path, O_RDONLY);
+    bool equal;
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    equal = (pread(fd, buffer, size, address) == (ssize_t)size) && (memcmp(buffer, data, size) == 0);
+    close(fd);
+
+    return equal;
+}
+
+static bool flash_is_old(uint32_t address)
+{
+    static uint8_t old[BTL_BLOCK_SIZE];
+
+    memset(old, OLD_CONTENT, sizeof(old));
+
+    return flash_is(address, old, sizeof(old));
+}
+
+/* Old content in the blocks the tests write */
+static void flash_prepare(void)
+{
+    static uint8_t flash[HOST_FLASH_SIZE];
+    int fd;
+
+    memset(flash, 0xFF, sizeof(flash));
+    memset(&flash[APP_START_ADDRESS], OLD_CONTENT, (IMAGE_BLOCKS + 1U) * BTL_BLOCK_SIZE);
+
+    unlink(flash_path);
+    fd = open(flash_path, O_RDWR | O_CREAT, 0644);
+    CHECK((fd >= 0) && (write(fd, flash, sizeof(flash)) == (ssize_t)sizeof(flash)));
+    close(fd);
+}
+
+/* The image host_vectors.py encrypts and its ENC_DATA payloads */
+static bool packets_load(void)
+{
+    static uint8_t packet[PACKET_SIZE];
+    struct btl_header header;
+    int fd = open(PACKETS_PATH, O_RDONLY);
+    size_t i;
+    bool loaded = (fd >= 0);
+
+    for (i = 0; i < sizeof(image); i++)
+    {
+        image[i] = (uint8_t)((i * 7U) ^ (i >> 11));
+    }
+
+    image_crc = (uint32_t)crc32(0, image, sizeof(image)) ^ 0xFFFFFFFFUL;
+
+    for (i = 0; loaded && (i < IMAGE_BLOCKS); i++)
+    {
+        loaded = (read(fd, packet, sizeof(packet)) == (ssize_t)sizeof(packet));
+        memcpy(&header, packet, BTL_HEADER_SIZE);
+        memcpy(&packets[i], &packet[BTL_HEADER_SIZE], BTL_ENC_DATA_PAYLOAD_SIZE);
+
+        loaded = loaded && (header.guard == BTL_GUARD) && (header.command == BL_CMD_ENC_DATA) &&
+                 (header.size == BTL_ENC_DATA_PAYLOAD_SIZE) &&
+                 (packets[i].address == (APP_START_ADDRESS + (i * BTL_BLOCK_SIZE)));
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    return loaded;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+static void test_round_trip(void)
+{
+    flash_prepare();
+
+    script_update(IMAGE_BLOCKS, packets, IMAGE_BLOCKS, BL_RESP_CRC_OK);
+    CHECK(boot() == BOOT_RESET);
+
+    CHECK(flash_is(APP_START_ADDRESS, image, sizeof(image)));
+
+    /* The ciphertext is not the image */
+    CHECK(memcmp(packets[0].block, image, BTL_BLOCK_SIZE) != 0);
+}
+
+static void test_wrong_tag(void)
+{
+    static struct btl_enc_data_payload data[IMAGE_BLOCKS];
+
+    flash_prepare();
+
+    memcpy(data, packets, sizeof(data));
+    data[0].tag[3] ^= 0x80000000UL;
+
+    script_update(IMAGE_BLOCKS, data, IMAGE_BLOCKS, BL_RESP_CRC_FAIL);
+    CHECK(boot() == BOOT_RESET);
+
+    CHECK(flash_is_old(APP_START_ADDRESS));
+    CHECK(flash_is(APP_START_ADDRESS + BTL_BLOCK_SIZE, &image[BTL_BLOCK_SIZE], BTL_BLOCK_SIZE));
+}
+
+static void test_changed_address(void)
+{
+    static struct btl_enc_data_payload data[IMAGE_BLOCKS];
+    const uint32_t moved = APP_START_ADDRESS + (IMAGE_BLOCKS * BTL_BLOCK_SIZE);
+
+    flash_prepare();
+
+    /* Block 0 sent for the block after the image, which is unlocked */
+    memcpy(data, packets, sizeof(data));
+    data[0].address = moved;
+
+    script_update(IMAGE_BLOCKS + 1U, data, IMAGE_BLOCKS, BL_RESP_CRC_FAIL);
+    CHECK(boot() == BOOT_RESET);
+
+    CHECK(flash_is_old(moved));
+    CHECK(flash_is_old(APP_START_ADDRESS));
+    CHECK(flash_is(APP_START_ADDRESS + BTL_BLOCK_SIZE, &image[BTL_BLOCK_SIZE], BTL_BLOCK_SIZE));
+}
+
+int main(void)
+{
+    char directory[] = "/tmp/test_aes.XXXXXX";
+
+    if (packets_load() == false)
+    {
+        fprintf(stderr, "%s: missing or wrong, run make test_aes.packets\n", PACKETS_PATH);
+        return EXIT_FAILURE;
+    }
+
+    if (mkdtemp(directory) == NULL)
+    {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    snprintf(flash_path, sizeof(flash_path), "%s/flash.bin", directory);
+
+    test_round_trip();
+    test_wrong_tag();
+    test_changed_address();
+
+    unlink(flash_path);
+    rmdir(directory);
+
+    return host_TestResult("test_aes");
+}
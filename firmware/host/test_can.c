@@ -0,0 +1,727 @@
+/*******************************************************************************
+  CAN FD Transport Host Test
+
+  File Name:
+    test_can.c
+
+  Summary:
+    Programs an application through bootloader_can.c, over ISO-TP and as a
+    multicast session, on a simulated CAN FD bus.
+
+  Description:
+    The protocol engine runs in its own thread with the CAN transport. The
+    CAN0 functions are implemented here on an in-process bus which pads
+    frames to CAN FD lengths, applies the two ID filters and keeps the Rx
+    FIFO of the node. The test thread is the gateway:
+
+      - ISO-TP single frames with and without the length escape, first
+        frames with 12 and 32 bit lengths, flow control after every block
+        of consecutive frames without the Rx FIFO filling up, a frame out
+        of sequence dropping the message and an oversized message refused
+        with an overflow flow control,
+      - a multicast session where the first pass of every packet loses
+        segments: the status reply lists exactly those, only they are sent
+        again, and the response comes back with a later poll, up to the
+        RESET which the node answers before it resets.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include "definitions.h"
+#include "bootloader_protocol.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define APP_ADDRESS             ((uint32_t)BTL_BOOTLOADER_SIZE)
+#define APP_BLOCKS              2U
+
+#define REQUEST_ID              (0x600U + BTL_CAN_NODE_ID)
+#define RESPONSE_ID             (0x680U + BTL_CAN_NODE_ID)
+
+/* Consecutive frames the node takes between two flow control frames */
+#define NODE_BLOCK_SIZE         8U
+
+/* Holds a DATA packet multicast twice, the ISO-TP peak is checked apart */
+#define RX_FIFO_SIZE            512U
+
+#define TX_QUEUE_SIZE           16U
+
+#define SEGMENT_HEADER          8U
+#define SEGMENT_DATA            (CAN0_FRAME_SIZE - SEGMENT_HEADER)
+
+#define STATUS_ACTIVE           0x01U
+#define STATUS_COMPLETE         0x02U
+#define NO_RESPONSE             0xFFU
+
+/* How long the gateway waits for a frame of the node */
+#define FRAME_TIMEOUT_MS        2000U
+
+/* Status polls of one multicast packet before the node counts as lost */
+#define POLL_LIMIT              200U
+
+typedef struct
+{
+    uint16_t    id;
+    uint8_t     length;
+    uint8_t     data[CAN0_FRAME_SIZE];
+} CAN_FRAME;
+
+static pthread_mutex_t  bus_lock    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   bus_change  = PTHREAD_COND_INITIALIZER;
+
+/* Node side */
+static CAN_FRAME        rx_fifo[RX_FIFO_SIZE];
+static unsigned         rx_head     = 0;
+static unsigned         rx_count    = 0;
+static unsigned         rx_peak     = 0;
+static unsigned         rx_overflow = 0;
+static uint16_t         filter[2]   = { 0xFFFFU, 0xFFFFU };
+
+/* Gateway side */
+static CAN_FRAME        tx_queue[TX_QUEUE_SIZE];
+static unsigned         tx_head     = 0;
+static unsigned         tx_count    = 0;
+
+static bool             node_reset  = false;
+
+static unsigned         flow_controls;
+
+static uint8_t          image[APP_BLOCKS * BTL_BLOCK_SIZE];
+
+unsigned long crc32(unsigned long inCrc32, const void *buf, size_t bufLen);
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: CAN0 on the Simulated Bus
+// *****************************************************************************
+// *****************************************************************************
+
+/* CAN FD frames are 0 to 8, 12, 16, 20, 24, 32, 48 or 64 bytes long */
+static uint8_t frame_length(uint8_t length)
+{
+    static const uint8_t lengths[] = { 8, 12, 16, 20, 24, 32, 48, 64 };
+    size_t i;
+
+    for (i = 0; (length > lengths[i]) && (i < (sizeof(lengths) - 1U)); i++)
+    {
+    }
+
+    return (length <= 8U) ? length : lengths[i];
+}
+
+static void frame_build(CAN_FRAME *frame, uint16_t id, const uint8_t *data, uint8_t length)
+{
+    frame->id       = id;
+    frame->length   = frame_length(length);
+
+    memset(frame->data, CAN0_PADDING_BYTE, sizeof(frame->data));
+    memcpy(frame->data, data, length);
+}
+
+void CAN0_Initialize(uint16_t id0, uint16_t id1)
+{
+    pthread_mutex_lock(&bus_lock);
+
+    filter[0] = id0;
+    filter[1] = id1;
+
+    pthread_cond_broadcast(&bus_change);
+    pthread_mutex_unlock(&bus_lock);
+}
+
+bool CAN0_MessageTransmit(uint16_t id, const uint8_t *data, uint8_t length)
+{
+    bool queued = false;
+
+    pthread_mutex_lock(&bus_lock);
+
+    if ((length <= CAN0_FRAME_SIZE) && (tx_count < TX_QUEUE_SIZE))
+    {
+        frame_build(&tx_queue[(tx_head + tx_count) % TX_QUEUE_SIZE], id, data, length);
+        tx_count++;
+        queued = true;
+
+        pthread_cond_broadcast(&bus_change);
+    }
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return queued;
+}
+
+bool CAN0_MessageReceive(uint16_t *id, uint8_t *data, uint8_t *length)
+{
+    bool received = false;
+
+    pthread_mutex_lock(&bus_lock);
+
+    if (rx_count > 0U)
+    {
+        *id     = rx_fifo[rx_head].id;
+        *length = rx_fifo[rx_head].length;
+        memcpy(data, rx_fifo[rx_head].data, rx_fifo[rx_head].length);
+
+        rx_head = (rx_head + 1U) % RX_FIFO_SIZE;
+        rx_count--;
+        received = true;
+    }
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return received;
+}
+
+bool CAN0_TransmitIsComplete(void)
+{
+    return true;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Node Thread
+// *****************************************************************************
+// *****************************************************************************
+
+static void node_reset_handler(const char *reason)
+{
+    pthread_mutex_lock(&bus_lock);
+
+    node_reset = true;
+
+    pthread_cond_broadcast(&bus_change);
+    pthread_mutex_unlock(&bus_lock);
+
+    pthread_exit(NULL);
+}
+
+static void *node_thread(void *arg)
+{
+    bootloader_CanInitialize();
+
+    bootloader_Tasks();
+
+    return NULL;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Gateway
+// *****************************************************************************
+// *****************************************************************************
+
+/* A frame on the bus, taken by the node if it passes one of its filters */
+static void bus_send(uint16_t id, const uint8_t *data, uint8_t length)
+{
+    pthread_mutex_lock(&bus_lock);
+
+    if ((id == filter[0]) || (id == filter[1]))
+    {
+        if (rx_count == RX_FIFO_SIZE)
+        {
+            rx_overflow++;
+        }
+        else
+        {
+            frame_build(&rx_fifo[(rx_head + rx_count) % RX_FIFO_SIZE], id, data, length);
+            rx_count++;
+
+            if (rx_count > rx_peak)
+            {
+                rx_peak = rx_count;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&bus_lock);
+}
+
+static void deadline_get(struct timespec *deadline, unsigned ms)
+{
+    clock_gettime(CLOCK_REALTIME, deadline);
+
+    deadline->tv_nsec += (long)(ms % 1000U) * 1000000L;
+    deadline->tv_sec  += (time_t)(ms / 1000U) + (deadline->tv_nsec / 1000000000L);
+    deadline->tv_nsec %= 1000000000L;
+}
+
+/* Next frame of the node, false if none came within ms */
+static bool bus_receive(CAN_FRAME *frame, unsigned ms)
+{
+    struct timespec deadline;
+    bool received = true;
+
+    deadline_get(&deadline, ms);
+
+    pthread_mutex_lock(&bus_lock);
+
+    while ((tx_count == 0U) && (received == true))
+    {
+        received = (pthread_cond_timedwait(&bus_change, &bus_lock, &deadline) != ETIMEDOUT);
+    }
+
+    received = (tx_count > 0U);
+
+    if (received == true)
+    {
+        *frame  = tx_queue[tx_head];
+        tx_head = (tx_head + 1U) % TX_QUEUE_SIZE;
+        tx_count--;
+    }
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return received;
+}
+
+/* Frames sent before the node set its filters would be lost */
+static void filter_wait(void)
+{
+    pthread_mutex_lock(&bus_lock);
+
+    while (filter[0] != REQUEST_ID)
+    {
+        pthread_cond_wait(&bus_change, &bus_lock);
+    }
+
+    pthread_mutex_unlock(&bus_lock);
+}
+
+static bool reset_wait(void)
+{
+    struct timespec deadline;
+    bool passed = true;
+
+    deadline_get(&deadline, FRAME_TIMEOUT_MS);
+
+    pthread_mutex_lock(&bus_lock);
+
+    while ((node_reset == false) && (passed == true))
+    {
+        passed = (pthread_cond_timedwait(&bus_change, &bus_lock, &deadline) != ETIMEDOUT);
+    }
+
+    passed = node_reset;
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return passed;
+}
+
+static void put32_be(uint8_t *dest, uint32_t value)
+{
+    dest[0] = (uint8_t)(value >> 24);
+    dest[1] = (uint8_t)(value >> 16);
+    dest[2] = (uint8_t)(value >> 8);
+    dest[3] = (uint8_t)value;
+}
+
+static void put32_le(uint8_t *dest, uint32_t value)
+{
+    dest[0] = (uint8_t)value;
+    dest[1] = (uint8_t)(value >> 8);
+    dest[2] = (uint8_t)(value >> 16);
+    dest[3] = (uint8_t)(value >> 24);
+}
+
+static size_t packet_build(uint8_t *packet, uint8_t command, const void *payload, uint32_t size)
+{
+    uint32_t guard = BTL_GUARD;
+
+    memcpy(&packet[BTL_GUARD_OFFSET], &guard, sizeof(guard));
+    memcpy(&packet[BTL_SIZE_OFFSET], &size, sizeof(size));
+    packet[BTL_CMD_OFFSET] = command;
+    memcpy(&packet[BTL_HEADER_SIZE], payload, size);
+
+    return BTL_HEADER_SIZE + size;
+}
+
+/* Sends one ISO-TP message to the node. Returns the flow status the node
+ * stopped the transfer with, 0x30 once everything has been sent. */
+static int isotp_send(uint16_t id, const uint8_t *message, uint32_t size)
+{
+    uint8_t frame[CAN0_FRAME_SIZE];
+    CAN_FRAME reply;
+    uint32_t sent, count, offset;
+    unsigned block = 0;
+    uint8_t sequence = 1;
+
+    if (size <= 7U)
+    {
+        frame[0] = (uint8_t)size;
+        memcpy(&frame[1], message, size);
+        bus_send(id, frame, (uint8_t)(size + 1U));
+        return 0x30;
+    }
+
+    if (size <= 62U)
+    {
+        frame[0] = 0;
+        frame[1] = (uint8_t)size;
+        memcpy(&frame[2], message, size);
+        bus_send(id, frame, (uint8_t)(size + 2U));
+        return 0x30;
+    }
+
+    if (size <= 4095U)
+    {
+        frame[0] = (uint8_t)(0x10U | (size >> 8));
+        frame[1] = (uint8_t)size;
+        offset   = 2;
+    }
+    else
+    {
+        frame[0] = 0x10;
+        frame[1] = 0;
+        put32_be(&frame[2], size);
+        offset   = 6;
+    }
+
+    sent = CAN0_FRAME_SIZE - offset;
+    memcpy(&frame[offset], message, sent);
+    bus_send(id, frame, CAN0_FRAME_SIZE);
+
+    while (sent < size)
+    {
+        if (block == 0U)
+        {
+            if ((bus_receive(&reply, FRAME_TIMEOUT_MS) == false) || (reply.id != RESPONSE_ID))
+            {
+                return -1;
+            }
+
+            flow_controls++;
+
+            if (reply.data[0] != 0x30U)
+            {
+                return reply.data[0];
+            }
+
+            block = reply.data[1];
+        }
+
+        count = size - sent;
+
+        if (count > (CAN0_FRAME_SIZE - 1U))
+        {
+            count = CAN0_FRAME_SIZE - 1U;
+        }
+
+        frame[0] = (uint8_t)(0x20U | sequence);
+        memcpy(&frame[1], &message[sent], count);
+        bus_send(id, frame, (uint8_t)(count + 1U));
+
+        sequence = (sequence + 1U) & 0x0FU;
+        sent    += count;
+        block--;
+    }
+
+    return 0x30;
+}
+
+/* Response byte of a single frame reply, -1 if none came */
+static int response_get(unsigned ms)
+{
+    CAN_FRAME reply;
+
+    if ((bus_receive(&reply, ms) == false) || (reply.id != RESPONSE_ID) || (reply.data[0] != 0x01U))
+    {
+        return -1;
+    }
+
+    return reply.data[1];
+}
+
+static int unicast_command(uint8_t command, const void *payload, uint32_t size)
+{
+    static uint8_t packet[BTL_HEADER_SIZE + BTL_MAX_PAYLOAD_SIZE];
+    uint32_t length = packet_build(packet, command, payload, size);
+
+    if (isotp_send(REQUEST_ID, packet, length) != 0x30)
+    {
+        return -1;
+    }
+
+    return response_get(FRAME_TIMEOUT_MS);
+}
+
+/* Segments of a multicast message, those in skip are left out */
+static void segments_send(uint8_t sequence, const uint8_t *message, uint32_t size, const uint8_t *skip)
+{
+    uint8_t frame[CAN0_FRAME_SIZE];
+    uint32_t index, count;
+
+    for (index = 0; (index * SEGMENT_DATA) < size; index++)
+    {
+        if ((skip != NULL) && ((skip[index / 8U] & (1U << (index % 8U))) != 0U))
+        {
+            continue;
+        }
+
+        count = size - (index * SEGMENT_DATA);
+
+        if (count > SEGMENT_DATA)
+        {
+            count = SEGMENT_DATA;
+        }
+
+        frame[0] = 0x40;
+        frame[1] = sequence;
+        frame[2] = (uint8_t)index;
+        frame[3] = (uint8_t)(index >> 8);
+        put32_le(&frame[4], size);
+        memcpy(&frame[SEGMENT_HEADER], &message[index * SEGMENT_DATA], count);
+
+        bus_send(BTL_CAN_MULTICAST_ID, frame, (uint8_t)(SEGMENT_HEADER + count));
+    }
+}
+
+/* Streams a packet to all nodes with every lose-th segment lost on the
+ * first pass, then polls and repairs until the node has answered it.
+ * Returns the response, -1 if the node got lost. */
+static int multicast_command(uint8_t sequence, uint8_t command, const void *payload, uint32_t size, unsigned lose)
+{
+    static uint8_t packet[BTL_HEADER_SIZE + BTL_MAX_PAYLOAD_SIZE];
+    uint8_t lost[CAN0_FRAME_SIZE - SEGMENT_HEADER];
+    struct timespec pause = { 0, 1000000L };
+    uint32_t length = packet_build(packet, command, payload, size);
+    uint32_t segments = (length + SEGMENT_DATA - 1U) / SEGMENT_DATA;
+    uint32_t index, missing;
+    uint8_t poll = 0x50;
+    bool first = true;
+    CAN_FRAME reply;
+    unsigned polls;
+
+    memset(lost, 0, sizeof(lost));
+
+    for (index = 0, missing = 0; index < segments; index++)
+    {
+        if ((index % lose) == (lose - 1U))
+        {
+            lost[index / 8U] |= (uint8_t)(1U << (index % 8U));
+            missing++;
+        }
+    }
+
+    /* Heard twice, as when a gateway retries, counts once */
+    segments_send(sequence, packet, length, lost);
+    segments_send(sequence, packet, length, lost);
+
+    for (polls = 0; polls < POLL_LIMIT; polls++)
+    {
+        bus_send(REQUEST_ID, &poll, 1);
+
+        if ((bus_receive(&reply, FRAME_TIMEOUT_MS) == false) || (reply.id != RESPONSE_ID) ||
+            (reply.length != CAN0_FRAME_SIZE) || (reply.data[0] != 0x50U))
+        {
+            return -1;
+        }
+
+        CHECK(reply.data[1] == sequence);
+        CHECK((reply.data[2] & STATUS_ACTIVE) != 0U);
+        CHECK((reply.data[4] | (reply.data[5] << 8)) == segments);
+
+        /* The node lists exactly the segments lost on the way */
+        if (first == true)
+        {
+            CHECK((reply.data[6] | (reply.data[7] << 8)) == missing);
+            CHECK(memcmp(&reply.data[SEGMENT_HEADER], lost, (segments + 7U) / 8U) == 0);
+            CHECK(((reply.data[2] & STATUS_COMPLETE) != 0U) == (missing == 0U));
+            CHECK((missing == 0U) || (reply.data[3] == NO_RESPONSE));
+            first = false;
+        }
+
+        if ((reply.data[2] & STATUS_COMPLETE) == 0U)
+        {
+            /* Only what the node asks for goes out again */
+            memcpy(lost, &reply.data[SEGMENT_HEADER], sizeof(lost));
+
+            for (index = 0; index < sizeof(lost); index++)
+            {
+                lost[index] = (uint8_t)~lost[index];
+            }
+
+            segments_send(sequence, packet, length, lost);
+            continue;
+        }
+
+        if (reply.data[3] != NO_RESPONSE)
+        {
+            return reply.data[3];
+        }
+
+        nanosleep(&pause, NULL);
+    }
+
+    return -1;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+static void test_isotp(void)
+{
+    static struct btl_data_payload data;
+    static uint8_t packet[BTL_HEADER_SIZE + BTL_MAX_PAYLOAD_SIZE];
+    static uint8_t filler[100];
+    struct btl_unlock_payload unlock = { APP_ADDRESS, sizeof(image) };
+    struct btl_verify_payload verify;
+    uint8_t frame[CAN0_FRAME_SIZE];
+    CAN_FRAME reply;
+    uint32_t length;
+    unsigned n;
+
+    /* 17 bytes, a single frame with the CAN FD length escape */
+    CHECK(unicast_command(BL_CMD_UNLOCK, &unlock, sizeof(unlock)) == BL_RESP_OK);
+
+    /* Not for this node */
+    length = packet_build(packet, BL_CMD_UNLOCK, &unlock, sizeof(unlock));
+    CHECK(isotp_send(REQUEST_ID + 1U, packet, length) == 0x30);
+    CHECK(response_get(100) == -1);
+
+    /* A first frame with a 12 bit length */
+    flow_controls = 0;
+    memset(filler, 0x5A, sizeof(filler));
+    CHECK(unicast_command(0x7F, filler, sizeof(filler)) == BL_RESP_INVALID);
+    CHECK(flow_controls == 1U);
+
+    /* DATA needs the 32 bit length escape and 130 consecutive frames, one
+     * flow control for the first frame and after every 8 */
+    for (n = 0; n < sizeof(image); n++)
+    {
+        image[n] = (uint8_t)(n * 11U + (n >> 10));
+    }
+
+    for (n = 0; n < APP_BLOCKS; n++)
+    {
+        data.address = APP_ADDRESS + n * BTL_BLOCK_SIZE;
+        memcpy(data.block, &image[n * BTL_BLOCK_SIZE], BTL_BLOCK_SIZE);
+
+        flow_controls = 0;
+        rx_peak = 0;
+
+        CHECK(unicast_command(BL_CMD_DATA, &data, sizeof(data)) == BL_RESP_OK);
+        CHECK(flow_controls == 17U);
+        CHECK(rx_peak <= NODE_BLOCK_SIZE);
+    }
+
+    /* A consecutive frame out of sequence drops the message */
+    length = packet_build(packet, BL_CMD_VERIFY, filler, sizeof(filler));
+    frame[0] = (uint8_t)(0x10U | (length >> 8));
+    frame[1] = (uint8_t)length;
+    memcpy(&frame[2], packet, CAN0_FRAME_SIZE - 2U);
+    bus_send(REQUEST_ID, frame, CAN0_FRAME_SIZE);
+    CHECK(response_get(FRAME_TIMEOUT_MS) == -1);
+
+    frame[0] = 0x22;
+    memcpy(&frame[1], &packet[CAN0_FRAME_SIZE - 2U], length - (CAN0_FRAME_SIZE - 2U));
+    bus_send(REQUEST_ID, frame, (uint8_t)(length - (CAN0_FRAME_SIZE - 2U) + 1U));
+    CHECK(response_get(100) == -1);
+
+    /* More than the largest packet */
+    frame[0] = 0x10;
+    frame[1] = 0;
+    put32_be(&frame[2], BTL_HEADER_SIZE + BTL_MAX_PAYLOAD_SIZE + 1U);
+    bus_send(REQUEST_ID, frame, CAN0_FRAME_SIZE);
+    CHECK((bus_receive(&reply, FRAME_TIMEOUT_MS) == true) && (reply.data[0] == 0x32U));
+
+    /* The link is still in step, the image is in flash */
+    verify.crc = (uint32_t)crc32(0, image, sizeof(image)) ^ 0xFFFFFFFFUL;
+    CHECK(unicast_command(BL_CMD_VERIFY, &verify, sizeof(verify)) == BL_RESP_CRC_OK);
+    CHECK(memcmp((const void *)(uintptr_t)APP_ADDRESS, image, sizeof(image)) == 0);
+}
+
+static void test_multicast(void)
+{
+    static struct btl_data_payload data;
+    struct btl_unlock_payload unlock = { APP_ADDRESS, sizeof(image) };
+    struct btl_verify_payload verify;
+    struct btl_reset_payload reset = { 0 };
+    uint8_t sequence = 1;
+    unsigned n;
+
+    for (n = 0; n < sizeof(image); n++)
+    {
+        image[n] = (uint8_t)(n * 5U + (n >> 9) + 1U);
+    }
+
+    CHECK(multicast_command(sequence++, BL_CMD_UNLOCK, &unlock, sizeof(unlock), 1000) == BL_RESP_OK);
+
+    for (n = 0; n < APP_BLOCKS; n++)
+    {
+        data.address = APP_ADDRESS + n * BTL_BLOCK_SIZE;
+        memcpy(data.block, &image[n * BTL_BLOCK_SIZE], BTL_BLOCK_SIZE);
+
+        CHECK(multicast_command(sequence++, BL_CMD_DATA, &data, sizeof(data), 7U + n) == BL_RESP_OK);
+    }
+
+    verify.crc = (uint32_t)crc32(0, image, sizeof(image)) ^ 0xFFFFFFFFUL;
+    CHECK(multicast_command(sequence++, BL_CMD_VERIFY, &verify, sizeof(verify), 1000) == BL_RESP_CRC_OK);
+    CHECK(memcmp((const void *)(uintptr_t)APP_ADDRESS, image, sizeof(image)) == 0);
+
+    /* The node waits for the poll of its RESET response, then resets */
+    CHECK(multicast_command(sequence++, BL_CMD_RESET, &reset, sizeof(reset), 1000) == BL_RESP_OK);
+}
+
+int main(void)
+{
+    pthread_t node;
+
+    if (host_FlashOpen(NULL) == false)
+    {
+        return EXIT_FAILURE;
+    }
+
+    host_ResetHandler = node_reset_handler;
+
+    pthread_create(&node, NULL, node_thread, NULL);
+    filter_wait();
+
+    test_isotp();
+    test_multicast();
+
+    CHECK(reset_wait() == true);
+    CHECK(rx_overflow == 0U);
+
+    return host_TestResult("test_can");
+}
@@ -0,0 +1,300 @@
+/*******************************************************************************
+  Update Container Host Test
+
+  File Name:
+    test_container.c
+
+  Summary:
+    Decodes containers of mkcontainer.py with the streaming decoder, whole
+    and damaged.
+
+  Description:
+    host_vectors.py writes containers mkcontainer.py builds, with RAW, FILL,
+    LZ and DELTA segments, together with the region each one programs. The
+    test feeds them to bootloader_container.c in pieces of random size,
+    programs the blocks it returns into the host flash and checks that
+
+      - every container decodes to its region, however it is cut up,
+      - with a bit flipped anywhere or cut short it never ends in
+        BTL_CONTAINER_DONE, and no block is returned outside the region of
+        its manifest, whatever the damage.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "definitions.h"
+#include "bootloader_protocol.h"
+#include "bootloader_container.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+/* Written by host_vectors.py container, see Makefile */
+#define VECTORS_PATH            "test_container.vectors"
+#define VECTORS_MAX             4U
+
+/* Cuts of each container decoded whole and damaged copies of it */
+#define CUTS                    20U
+#define DAMAGED                 400U
+
+/* A container of host_vectors.py, see there */
+struct vector
+{
+    const uint8_t  *container;
+    uint32_t        size;
+    uint32_t        begin;
+    const uint8_t  *region;
+    uint32_t        region_size;
+    uint32_t        base_address;
+    const uint8_t  *base;
+    uint32_t        base_size;
+};
+
+static uint8_t vectors_data[1U << 20];
+static struct vector vectors[VECTORS_MAX];
+static size_t vector_count;
+
+static uint32_t block[BTL_BLOCK_SIZE / 4U];
+static uint8_t damaged[1U << 18];
+
+/* How a container was taken */
+struct decoding
+{
+    BTL_CONTAINER_RESULT result;
+    uint32_t blocks;
+    bool outside;
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Decoding
+// *****************************************************************************
+// *****************************************************************************
+
+static uint8_t *flash_at(uint32_t address)
+{
+    return (uint8_t *)(uintptr_t)address;
+}
+
+/* The region of the vector erased, with its DELTA base in place */
+static void flash_prepare(const struct vector *v)
+{
+    memset(flash_at(v->begin), 0xFF, (v->region_size + BTL_BLOCK_SIZE - 1U) & ~(BTL_BLOCK_SIZE - 1U));
+    memcpy(flash_at(v->base_address), v->base, v->base_size);
+}
+
+/* Next piece size, mostly large with a fair share of tiny ones */
+static uint32_t piece_size(void)
+{
+    return 1U + (uint32_t)rand() % (((rand() % 4) == 0) ? 8U : 9000U);
+}
+
+/* Feeds size bytes of data to the decoder in random pieces until it is
+ * done or fails, programming every block it returns */
+static struct decoding decode(const uint8_t *data, uint32_t size)
+{
+    struct decoding d = { BTL_CONTAINER_MORE, 0, false };
+    uint32_t pos = 0;
+
+    bootloader_ContainerInitialize(block);
+
+    while ((pos < size) && (d.result != BTL_CONTAINER_DONE) && (d.result != BTL_CONTAINER_ERROR))
+    {
+        uint32_t left = piece_size();
+        const uint8_t *piece = &data[pos];
+        uint32_t used;
+
+        if (left > (size - pos))
+        {
+            left = size - pos;
+        }
+
+        pos += left;
+
+        do
+        {
+            d.result = bootloader_ContainerWrite(piece, left, &used);
+            piece += used;
+            left  -= used;
+
+            if (d.result == BTL_CONTAINER_BLOCK)
+            {
+                const struct btl_container_manifest *m = bootloader_ContainerManifest();
+                uint32_t address = bootloader_ContainerBlockAddress();
+
+                if (((address % BTL_BLOCK_SIZE) != 0U) || (address < m->begin) || (address >= m->end) ||
+                    (m->end > HOST_FLASH_SIZE))
+                {
+                    d.outside = true;
+                    return d;
+                }
+
+                memcpy(flash_at(address), block, BTL_BLOCK_SIZE);
+                d.blocks++;
+            }
+        } while ((d.result == BTL_CONTAINER_BLOCK) || (d.result == BTL_CONTAINER_MANIFEST));
+    }
+
+    return d;
+}
+
+/* The containers and regions of host_vectors.py */
+static bool vectors_load(void)
+{
+    FILE *f = fopen(VECTORS_PATH, "rb");
+    size_t size = 0;
+    size_t pos = 0;
+    uint32_t words[5];
+
+    if (f != NULL)
+    {
+        size = fread(vectors_data, 1, sizeof(vectors_data), f);
+        fclose(f);
+    }
+
+    while (((pos + sizeof(words)) <= size) && (vector_count < VECTORS_MAX))
+    {
+        struct vector *v = &vectors[vector_count++];
+
+        memcpy(words, &vectors_data[pos], sizeof(words));
+        pos += sizeof(words);
+
+        v->size         = words[0];
+        v->begin        = words[1];
+        v->region_size  = words[2];
+        v->base_address = words[3];
+        v->base_size    = words[4];
+
+        if ((size - pos) < ((size_t)v->size + v->region_size + v->base_size))
+        {
+            return false;
+        }
+
+        v->container = &vectors_data[pos];
+        v->region    = v->container + v->size;
+        v->base      = v->region + v->region_size;
+        pos += (size_t)v->size + v->region_size + v->base_size;
+    }
+
+    return (vector_count > 0U) && (pos == size);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+static void test_decode(const struct vector *v)
+{
+    uint32_t cut;
+
+    for (cut = 0; cut < CUTS; cut++)
+    {
+        struct decoding d;
+
+        flash_prepare(v);
+        d = decode(v->container, v->size);
+
+        CHECK(d.result == BTL_CONTAINER_DONE);
+        CHECK(d.outside == false);
+        CHECK(d.blocks == ((v->region_size + BTL_BLOCK_SIZE - 1U) / BTL_BLOCK_SIZE));
+        CHECK(bootloader_ContainerPosition() == v->size);
+        CHECK(memcmp(flash_at(v->begin), v->region, v->region_size) == 0);
+    }
+}
+
+static void test_damaged(const struct vector *v)
+{
+    uint32_t n;
+    uint32_t done = 0;
+    uint32_t outside = 0;
+
+    CHECK(v->size <= sizeof(damaged));
+
+    for (n = 0; n < DAMAGED; n++)
+    {
+        uint32_t size = v->size;
+        struct decoding d;
+
+        memcpy(damaged, v->container, v->size);
+
+        if ((rand() % 5) != 0)
+        {
+            damaged[(uint32_t)rand() % size] ^= (uint8_t)(1U << (rand() % 8));
+        }
+        else
+        {
+            size = (uint32_t)rand() % size;
+        }
+
+        flash_prepare(v);
+        d = decode(damaged, size);
+
+        done    += (d.result == BTL_CONTAINER_DONE) ? 1U : 0U;
+        outside += (d.outside == true) ? 1U : 0U;
+    }
+
+    CHECK(done == 0U);
+    CHECK(outside == 0U);
+}
+
+int main(void)
+{
+    size_t i;
+
+    if (vectors_load() == false)
+    {
+        fprintf(stderr, "%s: missing or wrong, run make test_container.vectors\n", VECTORS_PATH);
+        return EXIT_FAILURE;
+    }
+
+    if (host_FlashOpen(NULL) == false)
+    {
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+
+    for (i = 0; i < vector_count; i++)
+    {
+        test_decode(&vectors[i]);
+        test_damaged(&vectors[i]);
+    }
+
+    return host_TestResult("test_container");
+}
@@ -0,0 +1,254 @@
+/*******************************************************************************
+  Image CRC Host Test
+
+  File Name:
+    test_crc.c
+
+  Summary:
+    Checks crc32_combine() and the boot time image CRC against a one pass
+    CRC-32.
+
+  Description:
+    The reference is a bitwise CRC-32 sharing nothing with the table and
+    the polynomial arithmetic of bootloader.c. crc32_combine() is checked
+    for every split of buffers of odd and even lengths. The image CRC,
+    static in bootloader.c which is included here for it, is checked with
+    the CPU share of BTL_CRC_CPU_PERCENT swept from 0 to 100, odd sizes,
+    the binary header at the start of the image, on the split and past it,
+    and images too small for the DSU to take a part.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+/* The split is computed from this at every call, so the test can sweep it */
+static unsigned int crc_cpu_percent;
+#define BTL_CRC_CPU_PERCENT     crc_cpu_percent
+
+#include "bootloader.c"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define BUFFER_SIZE             67U
+#define IMAGE_SIZE_MAX          (3U * ERASE_BLOCK_SIZE)
+#define LONG_SIZE               ((1UL << 22) - 1U)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Reference CRC
+// *****************************************************************************
+// *****************************************************************************
+
+/* One bit at a time, reflected, initial value and final XOR 0xFFFFFFFF */
+static uint32_t reference_update(uint32_t crc, const uint8_t *data, size_t size)
+{
+    size_t i;
+    int bit;
+
+    for (i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0U - (crc & 1U)));
+        }
+    }
+
+    return crc;
+}
+
+static uint32_t reference_crc(const uint8_t *data, size_t size)
+{
+    return reference_update(0xFFFFFFFFUL, data, size) ^ 0xFFFFFFFFUL;
+}
+
+/* The image the way btl_host.py checksums it, binary header left out */
+static uint32_t reference_image_crc(uint32_t header, uint32_t size)
+{
+    const uint8_t *image = (const uint8_t *)APP_START_ADDRESS;
+    uint32_t offset = header - APP_START_ADDRESS;
+    uint32_t after  = offset + sizeof(struct binary_header);
+    uint32_t crc;
+
+    crc = reference_update(0xFFFFFFFFUL, image, offset);
+    crc = reference_update(crc, &image[after], size - after);
+
+    return crc ^ 0xFFFFFFFFUL;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+static void test_reference(void)
+{
+    /* The check value of CRC-32 */
+    CHECK(reference_crc((const uint8_t *)"123456789", 9) == 0xCBF43926UL);
+    CHECK(crc32(0, "123456789", 9) == 0xCBF43926UL);
+}
+
+static void test_combine(void)
+{
+    uint8_t buffer[BUFFER_SIZE];
+    size_t size;
+    size_t split;
+    uint32_t crc1;
+    uint32_t crc2;
+    uint8_t *long_buffer;
+    size_t i;
+
+    for (size = 0; size < sizeof(buffer); size++)
+    {
+        buffer[size] = (uint8_t)((size * 151U) ^ 0x3CU);
+    }
+
+    for (size = 0; size <= sizeof(buffer); size++)
+    {
+        for (split = 0; split <= size; split++)
+        {
+            crc1 = (uint32_t)crc32(0, buffer, split);
+            crc2 = (uint32_t)crc32(0, &buffer[split], size - split);
+
+            CHECK(crc32_combine(crc1, crc2, size - split) == reference_crc(buffer, size));
+        }
+    }
+
+    /* A second part of every length bit up to 4 MB, well past the flash */
+    long_buffer = malloc(LONG_SIZE);
+    CHECK(long_buffer != NULL);
+
+    if (long_buffer != NULL)
+    {
+        for (i = 0; i < LONG_SIZE; i++)
+        {
+            long_buffer[i] = (uint8_t)((i * 7U) ^ (i >> 13));
+        }
+
+        crc1 = (uint32_t)crc32(0, buffer, sizeof(buffer));
+        crc2 = (uint32_t)crc32(0, long_buffer, LONG_SIZE);
+
+        CHECK(crc32_combine(crc1, crc2, LONG_SIZE) ==
+              (reference_update(reference_update(0xFFFFFFFFUL, buffer, sizeof(buffer)),
+                                long_buffer, LONG_SIZE) ^ 0xFFFFFFFFUL));
+
+        free(long_buffer);
+    }
+}
+
+/* The binary header at offset into an image of size bytes */
+static void check_image(uint32_t size, uint32_t offset)
+{
+    struct binary_header *hdr = (struct binary_header *)(uintptr_t)(APP_START_ADDRESS + offset);
+
+    if (((offset % sizeof(uint32_t)) != 0U) || ((offset + sizeof(*hdr)) > size))
+    {
+        return;
+    }
+
+    hdr->sig1       = SIGNATURE1;
+    hdr->sig2       = SIGNATURE2;
+    hdr->bin_size   = size;
+    hdr->crc32      = 0;
+
+    if (image_crc(hdr) != reference_image_crc((uint32_t)(uintptr_t)hdr, size))
+    {
+        fprintf(stderr, "size %u, header at 0x%x, %u%% on the CPU\n",
+                (unsigned int)size, (unsigned int)offset, crc_cpu_percent);
+        CHECK(false);
+    }
+}
+
+static void test_image(void)
+{
+    static const uint32_t sizes[] = { 16, 17, 19, 20, 23, 100, 1001, ERASE_BLOCK_SIZE - 1U,
+                                      ERASE_BLOCK_SIZE, ERASE_BLOCK_SIZE + 3U, 20001,
+                                      IMAGE_SIZE_MAX - 1U };
+    static const unsigned int percents[] = { 0, 1, 25, 50, 99, 100 };
+    uint8_t *image = (uint8_t *)APP_START_ADDRESS;
+    uint32_t split;
+    uint32_t offset;
+    size_t i;
+    size_t p;
+
+    for (i = 0; i < IMAGE_SIZE_MAX; i++)
+    {
+        image[i] = (uint8_t)((i * 29U) ^ (i >> 9));
+    }
+
+    for (p = 0; p < (sizeof(percents) / sizeof(percents[0])); p++)
+    {
+        crc_cpu_percent = percents[p];
+
+        for (i = 0; i < (sizeof(sizes) / sizeof(sizes[0])); i++)
+        {
+            /* Where image_crc() hands over to the DSU, header aside */
+            split = ((sizes[i] * crc_cpu_percent) / 100U + 3U) & ~3UL;
+
+            /* At the start, in the vector table, around the split and
+             * at the end of the image */
+            for (offset = 0; offset <= 8U; offset += 4U)
+            {
+                check_image(sizes[i], offset);
+            }
+
+            check_image(sizes[i], 0x400U);
+
+            for (offset = (split >= 20U) ? (split - 20U) : 0U; offset <= (split + 8U); offset += 4U)
+            {
+                check_image(sizes[i], offset);
+            }
+
+            check_image(sizes[i], (sizes[i] - sizeof(struct binary_header)) & ~3UL);
+        }
+    }
+}
+
+int main(void)
+{
+    if (host_FlashOpen(NULL) == false)
+    {
+        return EXIT_FAILURE;
+    }
+
+    test_reference();
+    test_combine();
+    test_image();
+
+    return host_TestResult("test_crc");
+}
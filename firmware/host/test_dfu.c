@@ -0,0 +1,612 @@
+/*******************************************************************************
+  USB DFU Transport Host Test
+
+  File Name:
+    test_dfu.c
+
+  Summary:
+    Programs an application through bootloader_usb_dfu.c, with a simulated
+    USB host on endpoint 0.
+
+  Description:
+    The protocol engine runs in its own thread with the DFU transport. The
+    endpoint 0 functions of plib_usb.h are implemented here; the test
+    thread plays the USB host and issues one control transfer at a time,
+    the way dfu-util does:
+
+      - the device, configuration, DFU functional and string descriptors,
+        SET_ADDRESS and the configuration requests,
+      - DNLOAD, UPLOAD and DNLOAD requests in the wrong state or for the
+        wrong block, each stalled with the DFU status it sets, and
+        CLRSTATUS back to dfuIDLE,
+      - a download of two full blocks and a short one, polled with
+        GETSTATUS through dfuDNBUSY to dfuDNLOAD-IDLE, then manifestation
+        through dfuMANIFEST back to dfuIDLE and a check of the flash,
+      - DETACH resetting the device.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include "definitions.h"
+#include "bootloader_protocol.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define APP_ADDRESS             ((uint32_t)BTL_BOOTLOADER_SIZE)
+
+/* Two full DNLOAD blocks and a short one */
+#define IMAGE_SIZE              (2U * BTL_BLOCK_SIZE + 3616U)
+
+/* How long the host waits for the device to answer a control transfer */
+#define ANSWER_TIMEOUT_S        2
+
+/* wDetachTimeOut of the functional descriptor */
+#define DETACH_TIMEOUT_MS       1000U
+
+/* GETSTATUS polls before a busy device counts as hung */
+#define POLL_LIMIT              2000U
+
+#define CONTROL_STALL           (-1)
+#define CONTROL_TIMEOUT         (-2)
+
+/* bmRequestType */
+#define STANDARD_IN             0x80U
+#define STANDARD_OUT            0x00U
+#define CLASS_IN                0xA1U
+#define CLASS_OUT               0x21U
+
+#define GET_DESCRIPTOR          0x06U
+#define SET_ADDRESS             0x05U
+#define GET_CONFIGURATION       0x08U
+#define SET_CONFIGURATION       0x09U
+
+#define DFU_DETACH              0x00U
+#define DFU_DNLOAD              0x01U
+#define DFU_UPLOAD              0x02U
+#define DFU_GETSTATUS           0x03U
+#define DFU_CLRSTATUS           0x04U
+#define DFU_GETSTATE            0x05U
+
+#define STATE_IDLE              2
+#define STATE_DNBUSY            4
+#define STATE_DNLOAD_IDLE       5
+#define STATE_MANIFEST          7
+#define STATE_ERROR             10
+
+#define STATUS_OK               0x00U
+#define STATUS_ERR_ADDRESS      0x08U
+#define STATUS_ERR_NOTDONE      0x09U
+#define STATUS_ERR_STALLEDPKT   0x0FU
+
+static pthread_mutex_t  bus_lock    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   bus_change  = PTHREAD_COND_INITIALIZER;
+
+/* Endpoint 0 as the device sees it */
+static USB_SETUP_PACKET ep0_setup;
+static bool             ep0_setup_pending   = false;
+static const uint8_t   *ep0_out             = NULL;
+static size_t           ep0_out_size        = 0;
+static size_t           ep0_out_count       = 0;
+static uint8_t          ep0_in[256];
+static size_t           ep0_in_size         = 0;
+static bool             ep0_in_complete     = false;
+static bool             ep0_answered        = false;
+static bool             ep0_stalled         = false;
+static int              device_address      = -1;
+static bool             device_reset        = false;
+
+static uint8_t          image[IMAGE_SIZE];
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Endpoint 0 on the Simulated Bus
+// *****************************************************************************
+// *****************************************************************************
+
+void USB_DEVICE_Initialize(void)
+{
+}
+
+bool USB_DEVICE_ResetIsDetected(void)
+{
+    return false;
+}
+
+bool USB_DEVICE_SetupRead(USB_SETUP_PACKET *setup)
+{
+    bool pending;
+
+    pthread_mutex_lock(&bus_lock);
+
+    pending = ep0_setup_pending;
+
+    if (pending == true)
+    {
+        *setup              = ep0_setup;
+        ep0_setup_pending   = false;
+    }
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return pending;
+}
+
+bool USB_DEVICE_ControlOutIsReady(void)
+{
+    bool ready;
+
+    pthread_mutex_lock(&bus_lock);
+
+    ready = (ep0_setup_pending == false) && (ep0_out_count < ep0_out_size);
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return ready;
+}
+
+/* One data stage packet at a time, as the OUT bank holds it */
+size_t USB_DEVICE_ControlRead(uint8_t *buffer, size_t size)
+{
+    size_t count;
+
+    pthread_mutex_lock(&bus_lock);
+
+    count = ep0_out_size - ep0_out_count;
+
+    if (count > USB_DEVICE_EP0_SIZE)
+    {
+        count = USB_DEVICE_EP0_SIZE;
+    }
+
+    if (count > size)
+    {
+        count = size;
+    }
+
+    memcpy(buffer, &ep0_out[ep0_out_count], count);
+    ep0_out_count += count;
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return count;
+}
+
+/* The host takes the whole IN data stage, or the zero length status stage
+ * of an OUT request, at once */
+void USB_DEVICE_ControlWrite(const uint8_t *buffer, size_t size)
+{
+    pthread_mutex_lock(&bus_lock);
+
+    if (size > sizeof(ep0_in))
+    {
+        size = sizeof(ep0_in);
+    }
+
+    if (size > 0U)
+    {
+        memcpy(ep0_in, buffer, size);
+    }
+
+    ep0_in_size     = size;
+    ep0_in_complete = true;
+    ep0_answered    = true;
+
+    pthread_cond_broadcast(&bus_change);
+    pthread_mutex_unlock(&bus_lock);
+}
+
+bool USB_DEVICE_ControlInIsComplete(void)
+{
+    bool complete;
+
+    pthread_mutex_lock(&bus_lock);
+
+    complete        = ep0_in_complete;
+    ep0_in_complete = false;
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return complete;
+}
+
+void USB_DEVICE_ControlStall(void)
+{
+    pthread_mutex_lock(&bus_lock);
+
+    ep0_stalled     = true;
+    ep0_answered    = true;
+
+    pthread_cond_broadcast(&bus_change);
+    pthread_mutex_unlock(&bus_lock);
+}
+
+void USB_DEVICE_AddressSet(uint8_t address)
+{
+    pthread_mutex_lock(&bus_lock);
+    device_address = address;
+    pthread_mutex_unlock(&bus_lock);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Device Thread
+// *****************************************************************************
+// *****************************************************************************
+
+static void device_reset_handler(const char *reason)
+{
+    pthread_mutex_lock(&bus_lock);
+
+    device_reset = true;
+
+    pthread_cond_broadcast(&bus_change);
+    pthread_mutex_unlock(&bus_lock);
+
+    pthread_exit(NULL);
+}
+
+static void *device_thread(void *arg)
+{
+    USB_DEVICE_Initialize();
+
+    bootloader_Tasks();
+
+    return NULL;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Simulated Host
+// *****************************************************************************
+// *****************************************************************************
+
+/* Waits until the device has answered or reset. Called with bus_lock held. */
+static bool answer_wait(const bool *event)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ANSWER_TIMEOUT_S;
+
+    while (*event == false)
+    {
+        if (pthread_cond_timedwait(&bus_change, &bus_lock, &deadline) == ETIMEDOUT)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* One control transfer. OUT requests send length bytes from out, IN
+ * requests read up to length bytes into in. Returns the length of the IN
+ * data stage, CONTROL_STALL or CONTROL_TIMEOUT. */
+static int control(uint8_t type, uint8_t request, uint16_t value, uint16_t length, const uint8_t *out, uint8_t *in)
+{
+    int result;
+
+    pthread_mutex_lock(&bus_lock);
+
+    ep0_setup.bmRequestType = type;
+    ep0_setup.bRequest      = request;
+    ep0_setup.wValue        = value;
+    ep0_setup.wIndex        = 0;
+    ep0_setup.wLength       = length;
+
+    ep0_out         = out;
+    ep0_out_size    = (out != NULL) ? length : 0U;
+    ep0_out_count   = 0;
+    ep0_answered    = false;
+    ep0_stalled     = false;
+
+    ep0_setup_pending = true;
+
+    if (answer_wait(&ep0_answered) == false)
+    {
+        result = CONTROL_TIMEOUT;
+    }
+    else if (ep0_stalled == true)
+    {
+        result = CONTROL_STALL;
+    }
+    else
+    {
+        result = (int)ep0_in_size;
+
+        if ((in != NULL) && (ep0_in_size <= length))
+        {
+            memcpy(in, ep0_in, ep0_in_size);
+        }
+    }
+
+    ep0_out_size = 0;
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return result;
+}
+
+static int descriptor_get(uint8_t type, uint8_t index, uint16_t length, uint8_t *in)
+{
+    return control(STANDARD_IN, GET_DESCRIPTOR, (uint16_t)((type << 8) | index), length, NULL, in);
+}
+
+/* Returns bState, or -1 if GETSTATUS failed */
+static int status_get(uint8_t *status, uint32_t *poll_timeout)
+{
+    uint8_t reply[6];
+
+    if (control(CLASS_IN, DFU_GETSTATUS, 0, sizeof(reply), NULL, reply) != (int)sizeof(reply))
+    {
+        return -1;
+    }
+
+    *status         = reply[0];
+    *poll_timeout   = reply[1] | ((uint32_t)reply[2] << 8) | ((uint32_t)reply[3] << 16);
+
+    return reply[4];
+}
+
+/* GETSTATUS until the device leaves busy, returns the state it settles in */
+static int status_poll(int busy, uint8_t *status)
+{
+    struct timespec pause = { 0, 1000000L };
+    uint32_t poll_timeout = 0;
+    unsigned polls;
+    int state = busy;
+
+    for (polls = 0; (state == busy) && (polls < POLL_LIMIT); polls++)
+    {
+        nanosleep(&pause, NULL);
+
+        state = status_get(status, &poll_timeout);
+    }
+
+    return state;
+}
+
+static int state_get(void)
+{
+    uint8_t state;
+
+    if (control(CLASS_IN, DFU_GETSTATE, 0, 1, NULL, &state) != 1)
+    {
+        return -1;
+    }
+
+    return state;
+}
+
+static bool reset_wait(void)
+{
+    bool passed;
+
+    pthread_mutex_lock(&bus_lock);
+
+    passed = answer_wait(&device_reset);
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return passed;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+static void test_enumeration(void)
+{
+    static const char product[] = "SAME51 DFU Bootloader";
+    uint8_t reply[255];
+    size_t i;
+
+    CHECK(descriptor_get(0x01, 0, 64, reply) == 18);
+    CHECK((reply[0] == 18) && (reply[1] == 0x01));
+    CHECK(reply[7] == USB_DEVICE_EP0_SIZE);
+    CHECK((reply[8] == (uint8_t)BTL_USB_VID) && (reply[9] == (uint8_t)(BTL_USB_VID >> 8)));
+    CHECK((reply[10] == (uint8_t)BTL_USB_PID) && (reply[11] == (uint8_t)(BTL_USB_PID >> 8)));
+
+    /* The host reads the first 9 bytes for wTotalLength, then the rest */
+    CHECK(descriptor_get(0x02, 0, 9, reply) == 9);
+    CHECK((reply[2] == 27) && (reply[3] == 0));
+
+    CHECK(descriptor_get(0x02, 0, sizeof(reply), reply) == 27);
+    CHECK((reply[9 + 5] == 0xFE) && (reply[9 + 6] == 0x01) && (reply[9 + 7] == 0x02));
+    CHECK((reply[18] == 9) && (reply[19] == 0x21));
+    CHECK(reply[20] == 0x05);
+    CHECK((reply[23] | (reply[24] << 8)) == BTL_BLOCK_SIZE);
+    CHECK((reply[25] == 0x10) && (reply[26] == 0x01));
+
+    CHECK(descriptor_get(0x21, 0, sizeof(reply), reply) == 9);
+    CHECK((reply[1] == 0x21) && ((reply[5] | (reply[6] << 8)) == BTL_BLOCK_SIZE));
+
+    CHECK(descriptor_get(0x03, 0, sizeof(reply), reply) == 4);
+    CHECK((reply[2] == 0x09) && (reply[3] == 0x04));
+
+    CHECK(descriptor_get(0x03, 2, sizeof(reply), reply) == (int)(2U + 2U * strlen(product)));
+
+    for (i = 0; i < strlen(product); i++)
+    {
+        CHECK((reply[2U + 2U * i] == (uint8_t)product[i]) && (reply[3U + 2U * i] == 0));
+    }
+
+    CHECK(descriptor_get(0x03, 3, sizeof(reply), reply) == CONTROL_STALL);
+    CHECK(descriptor_get(0x06, 0, sizeof(reply), reply) == CONTROL_STALL);
+
+    /* The address is taken once the status stage is through */
+    CHECK(control(STANDARD_OUT, SET_ADDRESS, 5, 0, NULL, NULL) == 0);
+    CHECK(control(STANDARD_OUT, SET_CONFIGURATION, 1, 0, NULL, NULL) == 0);
+    CHECK(device_address == 5);
+
+    CHECK(control(STANDARD_IN, GET_CONFIGURATION, 0, 1, NULL, reply) == 1);
+    CHECK(reply[0] == 1);
+}
+
+static void test_state_errors(void)
+{
+    uint32_t poll_timeout;
+    uint8_t status;
+
+    CHECK(state_get() == STATE_IDLE);
+
+    /* Nothing to manifest */
+    CHECK(control(CLASS_OUT, DFU_DNLOAD, 0, 0, NULL, NULL) == CONTROL_STALL);
+    CHECK(status_get(&status, &poll_timeout) == STATE_ERROR);
+    CHECK(status == STATUS_ERR_NOTDONE);
+
+    /* dfuERROR takes nothing but CLRSTATUS and the status requests */
+    CHECK(control(CLASS_OUT, DFU_DNLOAD, 0, 64, image, NULL) == CONTROL_STALL);
+    CHECK(state_get() == STATE_ERROR);
+
+    CHECK(control(CLASS_OUT, DFU_CLRSTATUS, 0, 0, NULL, NULL) == 0);
+    CHECK(status_get(&status, &poll_timeout) == STATE_IDLE);
+    CHECK(status == STATUS_OK);
+
+    CHECK(control(CLASS_IN, DFU_UPLOAD, 0, 64, NULL, image) == CONTROL_STALL);
+    CHECK(status_get(&status, &poll_timeout) == STATE_ERROR);
+    CHECK(status == STATUS_ERR_STALLEDPKT);
+    CHECK(control(CLASS_OUT, DFU_CLRSTATUS, 0, 0, NULL, NULL) == 0);
+
+    /* A session starts at block 0 and blocks are at most wTransferSize */
+    CHECK(control(CLASS_OUT, DFU_DNLOAD, 1, 64, image, NULL) == CONTROL_STALL);
+    CHECK(status_get(&status, &poll_timeout) == STATE_ERROR);
+    CHECK(status == STATUS_ERR_ADDRESS);
+    CHECK(control(CLASS_OUT, DFU_CLRSTATUS, 0, 0, NULL, NULL) == 0);
+
+    CHECK(control(CLASS_OUT, DFU_DNLOAD, 0, BTL_BLOCK_SIZE + 1U, NULL, NULL) == CONTROL_STALL);
+    CHECK(status_get(&status, &poll_timeout) == STATE_ERROR);
+    CHECK(status == STATUS_ERR_ADDRESS);
+    CHECK(control(CLASS_OUT, DFU_CLRSTATUS, 0, 0, NULL, NULL) == 0);
+
+    CHECK(state_get() == STATE_IDLE);
+}
+
+static void test_download(void)
+{
+    const uint8_t *flash = (const uint8_t *)(uintptr_t)APP_ADDRESS;
+    uint32_t poll_timeout = 0;
+    uint32_t offset;
+    uint16_t block;
+    uint16_t size;
+    uint8_t status = 0xFF;
+    int state;
+
+    for (offset = 0; offset < sizeof(image); offset++)
+    {
+        image[offset] = (uint8_t)(offset * 13U + (offset >> 9));
+    }
+
+    for (block = 0, offset = 0; offset < sizeof(image); block++, offset += size)
+    {
+        size = (uint16_t)(((sizeof(image) - offset) < BTL_BLOCK_SIZE) ? (sizeof(image) - offset) : BTL_BLOCK_SIZE);
+
+        CHECK(control(CLASS_OUT, DFU_DNLOAD, block, size, &image[offset], NULL) == 0);
+
+        /* dfuDNBUSY until the engine has written the block */
+        state = status_poll(STATE_DNBUSY, &status);
+        CHECK(state == STATE_DNLOAD_IDLE);
+        CHECK(status == STATUS_OK);
+    }
+
+    /* A block number out of sequence ends the session */
+    CHECK(control(CLASS_OUT, DFU_DNLOAD, (uint16_t)(block + 1U), 64, image, NULL) == CONTROL_STALL);
+    CHECK(status_get(&status, &poll_timeout) == STATE_ERROR);
+    CHECK(control(CLASS_OUT, DFU_CLRSTATUS, 0, 0, NULL, NULL) == 0);
+
+    /* Start over and manifest */
+    for (block = 0, offset = 0; offset < sizeof(image); block++, offset += size)
+    {
+        size = (uint16_t)(((sizeof(image) - offset) < BTL_BLOCK_SIZE) ? (sizeof(image) - offset) : BTL_BLOCK_SIZE);
+
+        CHECK(control(CLASS_OUT, DFU_DNLOAD, block, size, &image[offset], NULL) == 0);
+        CHECK(status_poll(STATE_DNBUSY, &status) == STATE_DNLOAD_IDLE);
+    }
+
+    CHECK(control(CLASS_OUT, DFU_DNLOAD, block, 0, NULL, NULL) == 0);
+
+    /* The first GETSTATUS starts manifestation, VERIFY runs behind it */
+    CHECK(status_get(&status, &poll_timeout) == STATE_MANIFEST);
+    CHECK(poll_timeout != 0U);
+
+    state = status_poll(STATE_MANIFEST, &status);
+    CHECK(state == STATE_IDLE);
+    CHECK(status == STATUS_OK);
+
+    CHECK(memcmp(flash, image, sizeof(image)) == 0);
+
+    for (offset = sizeof(image); offset < 3U * BTL_BLOCK_SIZE; offset++)
+    {
+        if (flash[offset] != 0xFFU)
+        {
+            break;
+        }
+    }
+
+    CHECK(offset == 3U * BTL_BLOCK_SIZE);
+
+    CHECK(control(CLASS_OUT, DFU_DETACH, DETACH_TIMEOUT_MS, 0, NULL, NULL) == 0);
+}
+
+int main(void)
+{
+    pthread_t device;
+
+    if (host_FlashOpen(NULL) == false)
+    {
+        return EXIT_FAILURE;
+    }
+
+    host_ResetHandler = device_reset_handler;
+
+    pthread_create(&device, NULL, device_thread, NULL);
+
+    test_enumeration();
+    test_state_errors();
+    test_download();
+
+    /* DETACH after a manifested download resets into the application */
+    CHECK(reset_wait() == true);
+
+    return host_TestResult("test_dfu");
+}
@@ -0,0 +1,254 @@
+/*******************************************************************************
+  ECDSA Model Host Test
+
+  File Name:
+    test_ecdsa.c
+
+  Summary:
+    Checks the software model of the ICM and PUKCC calls against known
+    answer vectors.
+
+  Description:
+    bootloader_ecdsamodel.c stands in for the peripherals in host builds
+    with BTL_SIGNATURE, so a signature it accepts is what the device is
+    expected to accept. The SHA-256 vectors are those of FIPS 180-2 and
+    messages around the 55 and 56 byte padding boundaries, the signatures
+    those of RFC 6979 A.2.5 for P-256 with SHA-256 and one over a digest
+    above the group order. Every valid signature is also checked to fail
+    with a bit changed in r, s or the digest and under another public key, and r and s
+    outside of [1, n - 1] to be refused.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "peripheral/icm/plib_icm.h"
+#include "peripheral/pukcc/plib_pukcc.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Known Answer Vectors
+// *****************************************************************************
+// *****************************************************************************
+
+/* Message bytes 0, 1, 2, ... up to length */
+struct sha256_vector
+{
+    const char *message;
+    size_t      length;
+    const char *digest;
+};
+
+struct ecdsa_vector
+{
+    const char *message;        /* Hashed by ICM_Sha256, or NULL */
+    const char *digest;         /* Used as is without a message */
+    const char *r;
+    const char *s;
+};
+
+static const struct sha256_vector sha256_vectors[] =
+{
+    { "", 0,
+      "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+    { "abc", 3,
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56,
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+    { NULL, 55,
+      "463eb28e72f82e0a96c0a4cc53690c571281131f672aa229e0d45ae59b598b59" },
+    { NULL, 56,
+      "da2ae4d6b36748f2a318f23e7ab1dfdf45acdc9d049bd80e59de82a60895f562" },
+    { NULL, 63,
+      "29af2686fd53374a36b0846694cc342177e428d1647515f078784d69cdb9e488" },
+    { NULL, 64,
+      "fdeab9acf3710362bd2658cdc9a29e8f9c757fcf9811603a8c447cd1d9151108" },
+    { NULL, 65,
+      "4bfd2c8b6f1eec7a2afeb48b934ee4b2694182027e6d0fc075074f2fabb31781" },
+    { NULL, 119,
+      "da18797ed7c3a777f0847f429724a2d8cd5138e6ed2895c3fa1a6d39d18f7ec6" },
+    { NULL, 120,
+      "f52b23db1fbb6ded89ef42a23ce0c8922c45f25c50b568a93bf1c075420bbb7c" },
+};
+
+/* One million times 'a' */
+static const char sha256_million_a[] =
+    "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+
+/* Public key of RFC 6979 A.2.5, X then Y */
+static const char ecdsa_public_key[] =
+    "60fed4ba255a9d31c961eb74c6356d68c049b8923b61fa6ce669622e60f29fb6"
+    "7903fe1008b8bc99a41ae9e95628bc64f2f1b20c2d7e9f5177a3c294d4462299";
+
+/* The generator point, the public key of private key 1. The model trusts
+ * a key to be on the curve the way the PUKCC does. */
+static const char ecdsa_other_key[] =
+    "6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296"
+    "4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5";
+
+static const struct ecdsa_vector ecdsa_vectors[] =
+{
+    { "sample", NULL,
+      "efd48b2aacb6a8fd1140dd9cd45e81d69d2c877b56aaf991c34d0ea84eaf3716",
+      "f7cb1c942d657c41d436c7a1b6e29f65f3e900dbb9aff4064dc4ab2f843acda8" },
+    { "test", NULL,
+      "f1abb023518351cd71d881567b1ea663ed3efcf6c5132b354f28d3b0b7d38367",
+      "019f4113742a2b14bd25926b49c649155f267e60d3814b4c0cc84250e46f0083" },
+    { NULL, "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+      "a264347d761067288369535b9d59cf9e474844d0113b2030e33a0671aa4fd4a1",
+      "49696e41e60e155f6903402b161d45777914ee6d4761c93c9f31b19c881ec7c5" },
+};
+
+/* The group order n */
+static const char ecdsa_order[] =
+    "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551";
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+static void hex_load(uint8_t *bytes, const char *hex, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        unsigned int value;
+
+        sscanf(&hex[2U * i], "%2x", &value);
+        bytes[i] = (uint8_t)value;
+    }
+}
+
+static void test_sha256(void)
+{
+    static uint8_t message[1000000];
+    uint8_t digest[ICM_SHA256_DIGEST_SIZE];
+    uint8_t expected[ICM_SHA256_DIGEST_SIZE];
+    size_t i, n;
+
+    for (n = 0; n < sizeof(sha256_vectors) / sizeof(sha256_vectors[0]); n++)
+    {
+        const struct sha256_vector *v = &sha256_vectors[n];
+
+        for (i = 0; i < v->length; i++)
+        {
+            message[i] = (v->message != NULL) ? (uint8_t)v->message[i] : (uint8_t)i;
+        }
+
+        hex_load(expected, v->digest, sizeof(expected));
+        ICM_Sha256(message, v->length, digest);
+        CHECK(memcmp(digest, expected, sizeof(digest)) == 0);
+    }
+
+    memset(message, 'a', sizeof(message));
+    hex_load(expected, sha256_million_a, sizeof(expected));
+    ICM_Sha256(message, sizeof(message), digest);
+    CHECK(memcmp(digest, expected, sizeof(digest)) == 0);
+}
+
+static void test_ecdsa(void)
+{
+    uint8_t key[PUKCC_P256_PUBLIC_KEY_SIZE];
+    uint8_t other_key[PUKCC_P256_PUBLIC_KEY_SIZE];
+    uint8_t digest[PUKCC_P256_SIZE];
+    uint8_t signature[PUKCC_P256_SIGNATURE_SIZE];
+    uint8_t changed[PUKCC_P256_SIGNATURE_SIZE];
+    size_t n;
+
+    hex_load(key, ecdsa_public_key, sizeof(key));
+    hex_load(other_key, ecdsa_other_key, sizeof(other_key));
+
+    PUKCC_Initialize();
+
+    for (n = 0; n < sizeof(ecdsa_vectors) / sizeof(ecdsa_vectors[0]); n++)
+    {
+        const struct ecdsa_vector *v = &ecdsa_vectors[n];
+
+        if (v->message != NULL)
+        {
+            ICM_Sha256(v->message, strlen(v->message), digest);
+        }
+        else
+        {
+            hex_load(digest, v->digest, sizeof(digest));
+        }
+
+        hex_load(&signature[0], v->r, PUKCC_P256_SIZE);
+        hex_load(&signature[PUKCC_P256_SIZE], v->s, PUKCC_P256_SIZE);
+
+        CHECK(PUKCC_EcdsaP256Verify(digest, signature, key) == true);
+
+        /* A bit changed in r, then in s */
+        memcpy(changed, signature, sizeof(changed));
+        changed[PUKCC_P256_SIZE - 1U] ^= 0x01U;
+        CHECK(PUKCC_EcdsaP256Verify(digest, changed, key) == false);
+
+        memcpy(changed, signature, sizeof(changed));
+        changed[PUKCC_P256_SIZE] ^= 0x10U;
+        CHECK(PUKCC_EcdsaP256Verify(digest, changed, key) == false);
+
+        digest[7] ^= 0x80U;
+        CHECK(PUKCC_EcdsaP256Verify(digest, signature, key) == false);
+        digest[7] ^= 0x80U;
+
+        CHECK(PUKCC_EcdsaP256Verify(digest, signature, other_key) == false);
+
+        /* r and s of 0 and of n */
+        memcpy(changed, signature, sizeof(changed));
+        memset(&changed[0], 0, PUKCC_P256_SIZE);
+        CHECK(PUKCC_EcdsaP256Verify(digest, changed, key) == false);
+        hex_load(&changed[0], ecdsa_order, PUKCC_P256_SIZE);
+        CHECK(PUKCC_EcdsaP256Verify(digest, changed, key) == false);
+
+        memcpy(changed, signature, sizeof(changed));
+        memset(&changed[PUKCC_P256_SIZE], 0, PUKCC_P256_SIZE);
+        CHECK(PUKCC_EcdsaP256Verify(digest, changed, key) == false);
+        hex_load(&changed[PUKCC_P256_SIZE], ecdsa_order, PUKCC_P256_SIZE);
+        CHECK(PUKCC_EcdsaP256Verify(digest, changed, key) == false);
+    }
+}
+
+int main(void)
+{
+    ICM_Initialize();
+
+    test_sha256();
+    test_ecdsa();
+
+    return host_TestResult("test_ecdsa");
+}
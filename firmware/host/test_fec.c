@@ -0,0 +1,156 @@
+/*******************************************************************************
+  Reed-Solomon Host Test
+
+  File Name:
+    test_fec.c
+
+  Summary:
+    Checks the FEC_DATA decoder of the bootloader against the one of
+    rsfec.py.
+
+  Description:
+    host_vectors.py writes 60 FEC_DATA payloads rsfec.py encoded, with
+    parity from 2 to BTL_FEC_PARITY_MAX and byte errors from none to more
+    than the parity corrects, and what rsfec.py makes of every codeword.
+    The test checks that bootloader_FecLayout finds the parity of each
+    payload from its size, and that bootloader_FecDecode corrects exactly
+    the codewords rsfec.py corrects, to the same bytes.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "definitions.h"
+#include "bootloader_protocol.h"
+#include "bootloader_fec.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+/* Written by host_vectors.py fec, see Makefile */
+#define VECTORS_PATH            "test_fec.vectors"
+#define PAYLOADS                60U
+
+static uint8_t payload[BTL_MAX_PAYLOAD_SIZE];
+static uint8_t expected[1U + BTL_FEC_CODEWORD_SIZE];
+static uint8_t codeword[BTL_FEC_CODEWORD_SIZE];
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+/* One payload of the vectors, false at their end or if they are cut short */
+static bool test_payload(FILE *f)
+{
+    struct btl_fec_layout layout;
+    uint32_t words[2];
+    uint32_t i;
+
+    if ((fread(words, sizeof(words[0]), 2, f) != 2) || (words[0] > sizeof(payload)) ||
+        (fread(payload, 1, words[0], f) != words[0]))
+    {
+        return false;
+    }
+
+    CHECK(words[0] == BTL_FEC_PAYLOAD_SIZE(words[1]));
+
+    if ((bootloader_FecLayout(words[0], &layout) == false) || (layout.parity != words[1]))
+    {
+        CHECK(false);
+        return false;
+    }
+
+    CHECK(layout.codewords == BTL_FEC_CODEWORDS(layout.parity));
+    CHECK(layout.length == (BTL_FEC_MESSAGE_BYTES(layout.parity) + layout.parity));
+
+    for (i = 0; i < layout.codewords; i++)
+    {
+        bool corrected;
+
+        if (fread(expected, 1, 1U + layout.length, f) != (1U + layout.length))
+        {
+            return false;
+        }
+
+        corrected = bootloader_FecDecode(&payload[4], &layout, i, codeword);
+
+        CHECK(corrected == (expected[0] == 1U));
+        CHECK((corrected == false) || (memcmp(codeword, &expected[1], layout.length) == 0));
+    }
+
+    return true;
+}
+
+static void test_layout(void)
+{
+    struct btl_fec_layout layout;
+    uint32_t parity;
+
+    for (parity = 2U; parity <= BTL_FEC_PARITY_MAX; parity += 2U)
+    {
+        CHECK((bootloader_FecLayout(BTL_FEC_PAYLOAD_SIZE(parity), &layout) == true) &&
+              (layout.parity == parity));
+    }
+
+    CHECK(bootloader_FecLayout(BTL_FEC_PAYLOAD_SIZE(2U) + 1U, &layout) == false);
+    CHECK(bootloader_FecLayout(BTL_DATA_PAYLOAD_SIZE, &layout) == false);
+}
+
+int main(void)
+{
+    FILE *f = fopen(VECTORS_PATH, "rb");
+    uint32_t n = 0;
+
+    if (f == NULL)
+    {
+        fprintf(stderr, "%s: missing, run make test_fec.vectors\n", VECTORS_PATH);
+        return EXIT_FAILURE;
+    }
+
+    test_layout();
+
+    while (test_payload(f) == true)
+    {
+        n++;
+    }
+
+    CHECK((n == PAYLOADS) && (feof(f) != 0));
+    fclose(f);
+
+    return host_TestResult("test_fec");
+}
@@ -0,0 +1,250 @@
+/*******************************************************************************
+  Emulated FAT Volume Host Test
+
+  File Name:
+    test_ghostfat.c
+
+  Summary:
+    Reads the BTL_USB_MSC volume of bootloader_ghostfat.c the way a FAT
+    driver mounting it does.
+
+  Description:
+    The layout is taken from the boot sector alone. The test checks the
+    boot sector, that both FAT copies agree and carry the media entry and
+    the cluster chain of INFO_UF2.TXT, the volume label and file entries of
+    the root directory, and reads the file back through its chain. Sectors
+    behind the file and behind the volume read as zeros.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <stdbool.h>
+#include <string.h>
+#include "configuration.h"
+#include "bootloader_ghostfat.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define DIR_ENTRY_SIZE          32U
+
+#define ATTR_READ_ONLY          0x01U
+#define ATTR_VOLUME_ID          0x08U
+
+/* Volume layout, as read from the boot sector */
+static uint32_t reserved_sectors;
+static uint32_t sectors_per_fat;
+static uint32_t num_fats;
+static uint32_t root_start;
+static uint32_t data_start;
+static uint32_t root_entries;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: FAT Reader
+// *****************************************************************************
+// *****************************************************************************
+
+static uint32_t get16(const uint8_t *src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *src)
+{
+    return get16(&src[0]) | (get16(&src[2]) << 16);
+}
+
+static bool sector_is_blank(const uint8_t *sector)
+{
+    uint32_t i;
+
+    for (i = 0; i < BTL_GHOSTFAT_SECTOR_SIZE; i++)
+    {
+        if (sector[i] != 0U)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Entry of a cluster in the given FAT copy */
+static uint32_t fat_entry(uint32_t copy, uint32_t cluster)
+{
+    uint8_t sector[BTL_GHOSTFAT_SECTOR_SIZE];
+    uint32_t offset = cluster * 2U;
+
+    bootloader_GhostFatRead(reserved_sectors + (copy * sectors_per_fat) + (offset / BTL_GHOSTFAT_SECTOR_SIZE), sector);
+
+    return get16(&sector[offset % BTL_GHOSTFAT_SECTOR_SIZE]);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+static void test_boot_sector(void)
+{
+    uint8_t sector[BTL_GHOSTFAT_SECTOR_SIZE];
+    uint32_t clusters;
+
+    bootloader_GhostFatRead(0, sector);
+
+    CHECK((sector[0] == 0xEB) && (sector[2] == 0x90));
+    CHECK((sector[510] == 0x55) && (sector[511] == 0xAA));
+    CHECK(get16(&sector[11]) == BTL_GHOSTFAT_SECTOR_SIZE);
+    CHECK(sector[13] == 1U);
+    CHECK(get16(&sector[19]) == BTL_GHOSTFAT_SECTORS);
+    CHECK(sector[21] == 0xF8);
+    CHECK(sector[38] == 0x29);
+    CHECK(memcmp(&sector[43], "SAME51BOOT ", 11) == 0);
+    CHECK(memcmp(&sector[54], "FAT16   ", 8) == 0);
+
+    reserved_sectors    = get16(&sector[14]);
+    num_fats            = sector[16];
+    root_entries        = get16(&sector[17]);
+    sectors_per_fat     = get16(&sector[22]);
+    root_start          = reserved_sectors + (num_fats * sectors_per_fat);
+    data_start          = root_start + ((root_entries * DIR_ENTRY_SIZE) / BTL_GHOSTFAT_SECTOR_SIZE);
+
+    CHECK(reserved_sectors >= 1U);
+    CHECK(num_fats == 2U);
+    CHECK((root_entries % (BTL_GHOSTFAT_SECTOR_SIZE / DIR_ENTRY_SIZE)) == 0U);
+
+    /* The cluster count alone makes a volume FAT16, and each FAT has to
+     * hold an entry for every cluster */
+    clusters = BTL_GHOSTFAT_SECTORS - data_start;
+    CHECK((clusters >= 4085U) && (clusters < 65525U));
+    CHECK((sectors_per_fat * BTL_GHOSTFAT_SECTOR_SIZE / 2U) >= (clusters + 2U));
+}
+
+static void test_fat(void)
+{
+    uint8_t first[BTL_GHOSTFAT_SECTOR_SIZE];
+    uint8_t second[BTL_GHOSTFAT_SECTOR_SIZE];
+    uint32_t i;
+
+    CHECK(fat_entry(0, 0) == 0xFFF8U);
+    CHECK(fat_entry(0, 1) == 0xFFFFU);
+
+    /* INFO_UF2.TXT takes one cluster, nothing else is allocated */
+    CHECK(fat_entry(0, 2) == 0xFFFFU);
+    CHECK(fat_entry(0, 3) == 0U);
+
+    for (i = 0; i < sectors_per_fat; i++)
+    {
+        bootloader_GhostFatRead(reserved_sectors + i, first);
+        bootloader_GhostFatRead(reserved_sectors + sectors_per_fat + i, second);
+
+        CHECK(memcmp(first, second, sizeof(first)) == 0);
+
+        if (i > 0U)
+        {
+            CHECK(sector_is_blank(first) == true);
+        }
+    }
+}
+
+static void test_root_directory(void)
+{
+    uint8_t sector[BTL_GHOSTFAT_SECTOR_SIZE];
+    uint8_t data[BTL_GHOSTFAT_SECTOR_SIZE];
+    const uint8_t *entry;
+    uint32_t cluster, size, offset, chunk;
+    char text[2U * BTL_GHOSTFAT_SECTOR_SIZE + 1U];
+
+    bootloader_GhostFatRead(root_start, sector);
+
+    /* The volume label comes first */
+    entry = &sector[0];
+    CHECK(memcmp(&entry[0], "SAME51BOOT ", 11) == 0);
+    CHECK(entry[11] == ATTR_VOLUME_ID);
+
+    entry = &sector[DIR_ENTRY_SIZE];
+    CHECK(memcmp(&entry[0], "INFO_UF2TXT", 11) == 0);
+    CHECK(entry[11] == ATTR_READ_ONLY);
+    CHECK(get16(&entry[24]) != 0U);
+
+    cluster = get16(&entry[26]);
+    size    = get32(&entry[28]);
+
+    CHECK(cluster == 2U);
+    CHECK((size > 0U) && (size < sizeof(text)));
+
+    /* End of the directory */
+    CHECK(sector[2U * DIR_ENTRY_SIZE] == 0U);
+
+    /* Read INFO_UF2.TXT through its cluster chain */
+    for (offset = 0; (offset < size) && (cluster >= 2U) && (cluster < 0xFFF8U); offset += chunk)
+    {
+        bootloader_GhostFatRead(data_start + (cluster - 2U), data);
+
+        chunk = ((size - offset) < BTL_GHOSTFAT_SECTOR_SIZE) ? (size - offset) : BTL_GHOSTFAT_SECTOR_SIZE;
+        memcpy(&text[offset], data, chunk);
+
+        cluster = fat_entry(0, cluster);
+    }
+
+    CHECK(offset == size);
+    CHECK(cluster >= 0xFFF8U);
+
+    text[(offset < sizeof(text)) ? offset : 0U] = '\0';
+    CHECK(strncmp(text, "UF2 Bootloader\r\n", 16) == 0);
+    CHECK(strstr(text, "Board-ID: ") != NULL);
+
+    /* The rest of the directory and the data area are empty */
+    bootloader_GhostFatRead(root_start + 1U, sector);
+    CHECK(sector_is_blank(sector) == true);
+
+    bootloader_GhostFatRead(data_start + 1U, sector);
+    CHECK(sector_is_blank(sector) == true);
+
+    bootloader_GhostFatRead(BTL_GHOSTFAT_SECTORS, sector);
+    CHECK(sector_is_blank(sector) == true);
+}
+
+int main(void)
+{
+    test_boot_sector();
+    test_fat();
+    test_root_directory();
+
+    return host_TestResult("test_ghostfat");
+}
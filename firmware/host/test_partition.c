@@ -0,0 +1,279 @@
+/*******************************************************************************
+  Partition Table Host Test
+
+  File Name:
+    test_partition.c
+
+  Summary:
+    Reads the partition table of mkpartitions.py with bootloader_partition.c.
+
+  Description:
+    host_vectors.py writes the table block mkpartitions.py builds for four
+    partitions, one of them code with its contents recorded. The test
+    programs it into the host flash at BTL_PARTITION_TABLE_OFFSET and checks
+    that
+
+      - the C structures read the entries the tool packed, the lookup by id
+        finds each partition and no other,
+      - the code partition passes at boot as recorded and fails once a byte
+        of it changes,
+      - a verified session appends a new version of the table recording the
+        partition it wrote, which is the one read from then on,
+      - a table with a wrong CRC is ignored like a bank without one.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "definitions.h"
+#include "bootloader_protocol.h"
+#include "bootloader_partition.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+/* Written by host_vectors.py partition, see Makefile */
+#define VECTORS_PATH            "test_partition.vectors"
+
+/* The partitions host_vectors.py passes to mkpartitions.py */
+#define CODE_OFFSET             (0x64000UL)
+#define CODE_LENGTH             (2U * BTL_BLOCK_SIZE)
+#define CALIB_OFFSET            (0x62000UL)
+
+static const struct btl_partition expected[] =
+{
+    { 1U, "app",      BTL_PARTITION_APP,  0x2000UL,    0x60000UL, 0U, 0U },
+    { 2U, "calib",    BTL_PARTITION_DATA, CALIB_OFFSET, 0x2000UL, 0U, 0U },
+    { 3U, "dsp",      BTL_PARTITION_CODE, CODE_OFFSET, 0x8000UL,  CODE_LENGTH, 0U },
+    { 7U, "assets01", BTL_PARTITION_DATA, 0x6C000UL,   0x10000UL, 0U, 0U },
+};
+
+#define PARTITION_COUNT         (sizeof(expected) / sizeof(expected[0]))
+
+static uint8_t table_block[BTL_BLOCK_SIZE];
+static uint8_t code[CODE_LENGTH];
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Flash
+// *****************************************************************************
+// *****************************************************************************
+
+static uint8_t *flash_at(uint32_t address)
+{
+    return (uint8_t *)(uintptr_t)address;
+}
+
+static const struct btl_partition_table *table_at(uint32_t record)
+{
+    return (const struct btl_partition_table *)(uintptr_t)(BTL_PARTITION_TABLE_OFFSET + (record * BTL_PARTITION_RECORD_SIZE));
+}
+
+/* The table block and the recorded code partition programmed into the
+ * running bank, everything else erased */
+static void flash_prepare(void)
+{
+    memset(flash_at(BTL_BLOCK_SIZE), 0xFF, (HOST_FLASH_SIZE / 2U) - BTL_BLOCK_SIZE);
+    memcpy(flash_at(BTL_PARTITION_TABLE_OFFSET), table_block, sizeof(table_block));
+    memcpy(flash_at(CODE_OFFSET), code, sizeof(code));
+}
+
+static bool vectors_load(void)
+{
+    FILE *f = fopen(VECTORS_PATH, "rb");
+    bool loaded;
+
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    loaded = (fread(table_block, 1, sizeof(table_block), f) == sizeof(table_block)) &&
+             (fread(code, 1, sizeof(code), f) == sizeof(code)) &&
+             (fgetc(f) == EOF);
+    fclose(f);
+
+    return loaded;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+static void test_layout(void)
+{
+    const struct btl_partition_table *table = table_at(0);
+    size_t i;
+
+    flash_prepare();
+
+    /* Packed like the tool packs it, one record per page */
+    CHECK(sizeof(struct btl_partition) == 32U);
+    CHECK(sizeof(struct btl_partition_table) <= BTL_PARTITION_RECORD_SIZE);
+
+    CHECK(table->magic == BTL_PARTITION_MAGIC);
+    CHECK(table->count == PARTITION_COUNT);
+    CHECK(table->table_crc == (uint32_t)crc32(0, table, offsetof(struct btl_partition_table, table_crc)));
+
+    for (i = 0; i < PARTITION_COUNT; i++)
+    {
+        const struct btl_partition *p = &table->partitions[i];
+
+        CHECK(p->id == expected[i].id);
+        CHECK(memcmp(p->name, expected[i].name, BTL_PARTITION_NAME_SIZE) == 0);
+        CHECK(p->type == expected[i].type);
+        CHECK(p->offset == expected[i].offset);
+        CHECK(p->size == expected[i].size);
+        CHECK(p->length == expected[i].length);
+    }
+
+    CHECK(table->partitions[2].crc32 == (uint32_t)crc32(0, code, sizeof(code)));
+    CHECK(table->partitions[PARTITION_COUNT].id == 0xFFFFFFFFUL);
+
+    /* The rest of the block is erased */
+    CHECK(*(const uint32_t *)table_at(1) == 0xFFFFFFFFUL);
+}
+
+static void test_find(void)
+{
+    uint32_t begin;
+    uint32_t size;
+    size_t i;
+
+    flash_prepare();
+
+    for (i = 0; i < PARTITION_COUNT; i++)
+    {
+        begin = 0;
+        size  = 0;
+
+        CHECK(bootloader_PartitionFind(expected[i].id, &begin, &size) == true);
+        CHECK(begin == expected[i].offset);
+        CHECK(size == expected[i].size);
+    }
+
+    CHECK(bootloader_PartitionFind(4U, &begin, &size) == false);
+    CHECK(bootloader_PartitionFind(0xFFFFFFFFUL, &begin, &size) == false);
+}
+
+static void test_verify(void)
+{
+    flash_prepare();
+
+    CHECK(bootloader_PartitionsVerify() == true);
+
+    flash_at(CODE_OFFSET + CODE_LENGTH - 1U)[0] ^= 0x01U;
+    CHECK(bootloader_PartitionsVerify() == false);
+
+    /* Data partitions are not checked */
+    flash_prepare();
+    flash_at(CALIB_OFFSET)[0] = 0x00U;
+    CHECK(bootloader_PartitionsVerify() == true);
+}
+
+static void test_update(void)
+{
+    const struct btl_partition_table *table;
+    uint32_t begin;
+    uint32_t size;
+
+    flash_prepare();
+
+    /* A session on calib which wrote half of it */
+    memset(flash_at(CALIB_OFFSET), 0x3C, BTL_BLOCK_SIZE / 2U);
+    bootloader_PartitionUpdate(CALIB_OFFSET, CALIB_OFFSET + (BTL_BLOCK_SIZE / 2U));
+
+    table = table_at(1);
+    CHECK(table->magic == BTL_PARTITION_MAGIC);
+    CHECK(table->partitions[1].length == (BTL_BLOCK_SIZE / 2U));
+    CHECK(table->partitions[1].crc32 == (uint32_t)crc32(0, flash_at(CALIB_OFFSET), BTL_BLOCK_SIZE / 2U));
+    CHECK(memcmp(&table->partitions[2], &table_at(0)->partitions[2], sizeof(struct btl_partition)) == 0);
+
+    /* The same again changes nothing */
+    bootloader_PartitionUpdate(CALIB_OFFSET, CALIB_OFFSET + (BTL_BLOCK_SIZE / 2U));
+    CHECK(*(const uint32_t *)table_at(2) == 0xFFFFFFFFUL);
+
+    /* A session rewriting the code partition, which only the newest
+     * version matches */
+    memset(flash_at(CODE_OFFSET), 0x77, BTL_BLOCK_SIZE);
+    CHECK(bootloader_PartitionsVerify() == false);
+    bootloader_PartitionUpdate(CODE_OFFSET, CODE_OFFSET + BTL_BLOCK_SIZE);
+    CHECK(table_at(2)->partitions[2].length == BTL_BLOCK_SIZE);
+    CHECK(bootloader_PartitionsVerify() == true);
+
+    /* Damaged, the version before it is read again */
+    flash_at(BTL_PARTITION_TABLE_OFFSET + (2U * BTL_PARTITION_RECORD_SIZE) + 8U)[0] ^= 0x01U;
+    CHECK(bootloader_PartitionsVerify() == false);
+    CHECK(bootloader_PartitionFind(2U, &begin, &size) == true);
+}
+
+static void test_wrong_crc(void)
+{
+    uint32_t begin;
+    uint32_t size;
+
+    flash_prepare();
+
+    flash_at(BTL_PARTITION_TABLE_OFFSET + offsetof(struct btl_partition_table, partitions[1].offset))[1] ^= 0x01U;
+    flash_at(CODE_OFFSET)[0] ^= 0x01U;
+
+    CHECK(bootloader_PartitionFind(2U, &begin, &size) == false);
+    CHECK(bootloader_PartitionsVerify() == true);
+}
+
+int main(void)
+{
+    if (vectors_load() == false)
+    {
+        fprintf(stderr, "%s: missing or wrong, run make test_partition.vectors\n", VECTORS_PATH);
+        return EXIT_FAILURE;
+    }
+
+    if (host_FlashOpen(NULL) == false)
+    {
+        return EXIT_FAILURE;
+    }
+
+    test_layout();
+    test_find();
+    test_verify();
+    test_update();
+    test_wrong_crc();
+
+    return host_TestResult("test_partition");
+}
@@ -0,0 +1,402 @@
+/*******************************************************************************
+  QSPI Staging Host Test
+
+  File Name:
+    test_qspi.c
+
+  Summary:
+    Installs updates staged in the file backed QSPI flash of
+    bootloader_qspiimage.c.
+
+  Description:
+    Every boot is a child process running what SYS_Initialize does with
+    BTL_QSPI_STAGING: bootloader_QspiInitialize() and, with an update
+    pending, bootloader_QspiInstall() until it resets. The host link of
+    BTL_TRANSPORT must not be served meanwhile.
+    Internal and QSPI flash are files, so they carry over from one boot to
+    the next. The test checks the installed image, the state word left in
+    the staging header and that nothing is staged after an install:
+
+      - an install into the running bank,
+      - the same with the power cut at every erase and write in turn,
+        the next boot starting over from the staged copy,
+      - an install into the inactive bank ending with a bank swap,
+      - a staged image with a wrong CRC, rejected before anything is
+        erased, and the boot after it.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "definitions.h"
+#include "bootloader_protocol.h"
+#include "bootloader_stage.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define APP_START_ADDRESS       (0x2000UL)
+#define BANK_SIZE               (0x80000UL)
+
+/* Three and a bit erase blocks, the last one padded by the install */
+#define IMAGE_SIZE              (3U * BTL_BLOCK_SIZE + 1000U)
+#define IMAGE_BLOCKS            4U
+
+#define HEADER_OFFSET           0x200U
+
+/* How a boot ended, the exit status of its process */
+enum boot_result
+{
+    BOOT_RESET,
+    BOOT_BANKSWAP,
+    BOOT_POWER_LOSS,
+    BOOT_NOTHING_STAGED,
+    BOOT_HOST_SERVED,
+    BOOT_FAILED,
+};
+
+static char flash_path[64];
+static char qspi_path[64];
+
+static uint8_t image[IMAGE_SIZE];
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Boot Process
+// *****************************************************************************
+// *****************************************************************************
+
+/* The UART of the device, the install is a step of its own */
+static bool host_receiver_is_ready(void)
+{
+    _exit(BOOT_HOST_SERVED);
+}
+
+static size_t host_read(uint8_t *buffer, size_t size)
+{
+    return 0;
+}
+
+static void host_write(const uint8_t *buffer, size_t size)
+{
+}
+
+static void host_flush(void)
+{
+}
+
+static bool host_link_setup(uint32_t bitRate)
+{
+    return true;
+}
+
+const BOOTLOADER_TRANSPORT host_Transport =
+{
+    .receiverIsReady    = host_receiver_is_ready,
+    .read               = host_read,
+    .write              = host_write,
+    .flush              = host_flush,
+    .linkSetup          = host_link_setup,
+};
+
+static void boot_reset_handler(const char *reason)
+{
+    if (strcmp(reason, "bankswap") == 0)
+    {
+        _exit(BOOT_BANKSWAP);
+    }
+
+    _exit((strcmp(reason, "reset") == 0) ? BOOT_RESET : BOOT_POWER_LOSS);
+}
+
+/* One boot with the power cut after powerLoss flash operations, negative
+ * for a boot which runs to its end */
+static enum boot_result boot(long powerLoss)
+{
+    pid_t pid = fork();
+    int status;
+
+    if (pid == 0)
+    {
+        if ((host_FlashOpen(flash_path) == false) || (bootloader_QspiImageOpen(qspi_path) == false))
+        {
+            _exit(BOOT_FAILED);
+        }
+
+        host_ResetHandler       = boot_reset_handler;
+        host_PowerLossCountdown = powerLoss;
+
+        if (bootloader_QspiInitialize() == false)
+        {
+            _exit(BOOT_NOTHING_STAGED);
+        }
+
+        bootloader_QspiInstall();
+
+        _exit(BOOT_FAILED);
+    }
+
+    if ((pid < 0) || (waitpid(pid, &status, 0) != pid) || (WIFEXITED(status) == 0))
+    {
+        return BOOT_FAILED;
+    }
+
+    return (enum boot_result)WEXITSTATUS(status);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Flash Files
+// *****************************************************************************
+// *****************************************************************************
+
+static bool file_write(const char *path, off_t offset, const void *data, size_t size)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    bool written;
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    written = (pwrite(fd, data, size, offset) == (ssize_t)size);
+    close(fd);
+
+    return written;
+}
+
+static bool file_read(const char *path, off_t offset, void *data, size_t size)
+{
+    int fd = open(path, O_RDONLY);
+    bool done;
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    done = (pread(fd, data, size, offset) == (ssize_t)size);
+    close(fd);
+
+    return done;
+}
+
+/* Blank internal flash with an old application at 0x2000 */
+static void flash_prepare(void)
+{
+    static uint8_t flash[HOST_FLASH_SIZE];
+
+    memset(flash, 0xFF, sizeof(flash));
+    memset(&flash[APP_START_ADDRESS], 0x5A, 2U * BTL_BLOCK_SIZE);
+
+    unlink(flash_path);
+    CHECK(file_write(flash_path, 0, flash, sizeof(flash)) == true);
+}
+
+/* What bin2stage.py writes, on an otherwise erased QSPI flash */
+static void stage(uint32_t address, uint32_t flags, uint32_t crc)
+{
+    struct stage_header header =
+    {
+        .magic      = BTL_STAGE_MAGIC,
+        .address    = address,
+        .size       = sizeof(image),
+        .crc32      = crc,
+        .flags      = flags,
+        .state      = BTL_STAGE_PENDING,
+    };
+
+    header.header_crc = (uint32_t)crc32(0, &header, offsetof(struct stage_header, header_crc));
+
+    unlink(qspi_path);
+    CHECK(file_write(qspi_path, BTL_QSPI_STAGE_OFFSET + BTL_STAGE_DATA_OFFSET, image, sizeof(image)) == true);
+    CHECK(file_write(qspi_path, BTL_QSPI_STAGE_OFFSET, &header, sizeof(header)) == true);
+}
+
+static uint32_t stage_state(void)
+{
+    uint32_t state = 0;
+
+    CHECK(file_read(qspi_path, BTL_QSPI_STAGE_OFFSET + offsetof(struct stage_header, state), &state, sizeof(state)) == true);
+
+    return state;
+}
+
+/* The image and the 0xFF padding of its last block at address */
+static bool image_is_installed(uint32_t address)
+{
+    static uint8_t flash[IMAGE_BLOCKS * BTL_BLOCK_SIZE];
+    size_t i;
+
+    if ((file_read(flash_path, address, flash, sizeof(flash)) == false) ||
+        (memcmp(flash, image, sizeof(image)) != 0))
+    {
+        return false;
+    }
+
+    for (i = sizeof(image); i < sizeof(flash); i++)
+    {
+        if (flash[i] != 0xFFU)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void image_build(void)
+{
+    struct binary_header header = { SIGNATURE1, SIGNATURE2, sizeof(image), 0 };
+    size_t i;
+
+    for (i = 0; i < sizeof(image); i++)
+    {
+        image[i] = (uint8_t)((i * 13U) ^ (i >> 9));
+    }
+
+    memcpy(&image[HEADER_OFFSET], &header, sizeof(header));
+
+    header.crc32 = (uint32_t)crc32(crc32(0, image, HEADER_OFFSET), &image[HEADER_OFFSET + sizeof(header)],
+                                   sizeof(image) - HEADER_OFFSET - sizeof(header));
+
+    memcpy(&image[HEADER_OFFSET], &header, sizeof(header));
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+static void test_install(void)
+{
+    flash_prepare();
+    stage(APP_START_ADDRESS, 0, (uint32_t)crc32(0, image, sizeof(image)));
+
+    CHECK(boot(-1) == BOOT_RESET);
+    CHECK(image_is_installed(APP_START_ADDRESS) == true);
+    CHECK(stage_state() == BTL_STAGE_INSTALLED);
+
+    CHECK(boot(-1) == BOOT_NOTHING_STAGED);
+}
+
+static void test_interrupted_install(void)
+{
+    /* An erase per block and a write per page with data in it */
+    const long operations = IMAGE_BLOCKS + (IMAGE_SIZE + NVMCTRL_FLASH_PAGESIZE - 1) / NVMCTRL_FLASH_PAGESIZE;
+    long cut;
+
+    for (cut = 0; cut < operations; cut++)
+    {
+        flash_prepare();
+        stage(APP_START_ADDRESS, 0, (uint32_t)crc32(0, image, sizeof(image)));
+
+        CHECK(boot(cut) == BOOT_POWER_LOSS);
+        CHECK(stage_state() == BTL_STAGE_PENDING);
+
+        CHECK(boot(-1) == BOOT_RESET);
+        CHECK(image_is_installed(APP_START_ADDRESS) == true);
+        CHECK(stage_state() == BTL_STAGE_INSTALLED);
+    }
+
+    /* Cut after the last write, before the state word is cleared */
+    flash_prepare();
+    stage(APP_START_ADDRESS, 0, (uint32_t)crc32(0, image, sizeof(image)));
+
+    CHECK(boot(operations) == BOOT_RESET);
+}
+
+static void test_swap_install(void)
+{
+    flash_prepare();
+    stage(BANK_SIZE + APP_START_ADDRESS, BTL_STAGE_FLAG_SWAP, (uint32_t)crc32(0, image, sizeof(image)));
+
+    CHECK(boot(-1) == BOOT_BANKSWAP);
+
+    /* The banks have been swapped, the new image runs from the lower one */
+    CHECK(image_is_installed(APP_START_ADDRESS) == true);
+    CHECK(stage_state() == BTL_STAGE_INSTALLED);
+}
+
+static void test_rejected(void)
+{
+    static uint8_t before[HOST_FLASH_SIZE];
+    static uint8_t after[HOST_FLASH_SIZE];
+
+    flash_prepare();
+    stage(APP_START_ADDRESS, 0, (uint32_t)crc32(0, image, sizeof(image)) ^ 1U);
+
+    CHECK(file_read(flash_path, 0, before, sizeof(before)) == true);
+
+    CHECK(boot(-1) == BOOT_RESET);
+    CHECK(stage_state() == BTL_STAGE_REJECTED);
+    CHECK(boot(-1) == BOOT_NOTHING_STAGED);
+
+    CHECK(file_read(flash_path, 0, after, sizeof(after)) == true);
+    CHECK(memcmp(before, after, sizeof(before)) == 0);
+}
+
+int main(void)
+{
+    char directory[] = "/tmp/test_qspi.XXXXXX";
+
+    if (mkdtemp(directory) == NULL)
+    {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    snprintf(flash_path, sizeof(flash_path), "%s/flash.bin", directory);
+    snprintf(qspi_path, sizeof(qspi_path), "%s/qspi.bin", directory);
+
+    image_build();
+
+    test_install();
+    test_interrupted_install();
+    test_swap_install();
+    test_rejected();
+
+    unlink(flash_path);
+    unlink(qspi_path);
+    rmdir(directory);
+
+    return host_TestResult("test_qspi");
+}
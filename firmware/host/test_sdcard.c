@@ -0,0 +1,632 @@
+/*******************************************************************************
+  SD Card Host Test
+
+  File Name:
+    test_sdcard.c
+
+  Summary:
+    Reads a FAT32 card image built here through bootloader_fat32.c and
+    programs the file on it through bootloader_sdcard.c.
+
+  Description:
+    The card image is a partitioned FAT32 volume with two sectors per
+    cluster, backed by bootloader_sdimage.c. The firmware file sits in a
+    subdirectory under a long name, behind a deleted copy of itself and a
+    longer name it is a prefix of, and its clusters are out of order. The
+    root directory spans two clusters which are not adjacent either.
+
+      - the reader finds the file by its path, in any case, and returns its
+        data as one run per fragment, or in smaller pieces on request,
+      - paths which do not lead to a file are not found,
+      - a boot programs the streamed file into the inactive bank and swaps
+        it in; without the file the transport stays silent.
+
+    Each boot is a child process, the internal flash a file.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "definitions.h"
+#include "bootloader_protocol.h"
+#include "bootloader_fat32.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define BANK_SIZE               (0x80000UL)
+#define APP_ADDRESS             (BTL_SDCARD_ADDRESS - BANK_SIZE)
+
+/* Three and a bit erase blocks, the last one padded by the update */
+#define IMAGE_SIZE              (3U * BTL_BLOCK_SIZE + 1000U)
+#define IMAGE_BLOCKS            4U
+
+#define HEADER_OFFSET           0x200U
+
+#define SECTOR_SIZE             BTL_FAT32_SECTOR_SIZE
+
+#define CARD_VOLUME_LBA         8U
+#define CARD_CLUSTER_SECTORS    2U
+#define CARD_CLUSTER_SIZE       (CARD_CLUSTER_SECTORS * SECTOR_SIZE)
+#define CARD_RESERVED_SECTORS   32U
+#define CARD_FATS               2U
+#define CARD_CLUSTERS           1024U
+#define CARD_FAT_SECTORS        (((CARD_CLUSTERS + 2U) * 4U + SECTOR_SIZE - 1U) / SECTOR_SIZE)
+#define CARD_DATA_LBA           (CARD_VOLUME_LBA + CARD_RESERVED_SECTORS + CARD_FATS * CARD_FAT_SECTORS)
+#define CARD_SECTORS            (CARD_DATA_LBA + CARD_CLUSTERS * CARD_CLUSTER_SECTORS)
+
+#define CARD_ENTRY_SIZE         32U
+#define CARD_DIR_ENTRIES        (CARD_CLUSTER_SIZE / CARD_ENTRY_SIZE)
+#define CARD_END_OF_CHAIN       0x0FFFFFFFUL
+
+#define ATTR_VOLUME_ID          0x08U
+#define ATTR_DIRECTORY          0x10U
+#define ATTR_ARCHIVE            0x20U
+
+/* How a boot ended, the exit status of its process */
+enum boot_result
+{
+    BOOT_RESET,
+    BOOT_BANKSWAP,
+    BOOT_POWER_LOSS,
+    BOOT_IDLE,
+    BOOT_FAILED,
+};
+
+/* A directory being filled, one cluster after the other */
+typedef struct
+{
+    const uint32_t  *clusters;
+    uint32_t        count;
+    uint32_t        entries;
+} CARD_DIR;
+
+static const uint32_t root_clusters[]       = { 2, 50 };
+static const uint32_t updates_clusters[]    = { 7 };
+
+/* The firmware file: six fragments, two of them in reverse order */
+static const uint32_t image_clusters[]      =
+{
+    100, 101, 102, 103, 104, 105,
+    60, 61, 62, 63,
+    200,
+    202,
+    201,
+    203, 204, 205, 206, 207, 208, 209, 210, 211, 212, 213, 214,
+};
+
+static const uint32_t image_runs[]          = { 12, 8, 2, 2, 2, 24 };
+
+static const uint32_t decoy_clusters[]      = { 300 };
+static const uint32_t deleted_clusters[]    = { 301 };
+static const uint32_t readme_clusters[]     = { 302 };
+
+static char flash_path[64];
+static char card_path[64];
+
+static uint8_t card[CARD_SECTORS * SECTOR_SIZE];
+
+static uint8_t image[IMAGE_SIZE];
+
+unsigned long crc32(unsigned long inCrc32, const void *buf, size_t bufLen);
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Card Image
+// *****************************************************************************
+// *****************************************************************************
+
+static void put16(uint8_t *dest, uint32_t value)
+{
+    dest[0] = (uint8_t)value;
+    dest[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t *dest, uint32_t value)
+{
+    put16(dest, value);
+    put16(&dest[2], value >> 16);
+}
+
+static uint8_t *cluster_data(uint32_t cluster)
+{
+    return &card[(CARD_DATA_LBA + (cluster - 2U) * CARD_CLUSTER_SECTORS) * SECTOR_SIZE];
+}
+
+static void fat_set(uint32_t cluster, uint32_t next)
+{
+    uint32_t fat;
+
+    for (fat = 0; fat < CARD_FATS; fat++)
+    {
+        put32(&card[(CARD_VOLUME_LBA + CARD_RESERVED_SECTORS + fat * CARD_FAT_SECTORS) * SECTOR_SIZE + cluster * 4U], next);
+    }
+}
+
+static void chain_set(const uint32_t *clusters, uint32_t count)
+{
+    uint32_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        fat_set(clusters[i], ((i + 1U) < count) ? clusters[i + 1U] : CARD_END_OF_CHAIN);
+    }
+}
+
+static uint8_t *dir_entry_next(CARD_DIR *dir)
+{
+    uint32_t index = dir->entries++;
+
+    if ((index / CARD_DIR_ENTRIES) >= dir->count)
+    {
+        fprintf(stderr, "directory full\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return cluster_data(dir->clusters[index / CARD_DIR_ENTRIES]) + (index % CARD_DIR_ENTRIES) * CARD_ENTRY_SIZE;
+}
+
+static uint8_t name_checksum(const char *shortName)
+{
+    uint8_t sum = 0;
+    uint32_t i;
+
+    for (i = 0; i < 11U; i++)
+    {
+        sum = (uint8_t)(((sum & 1U) << 7) + (sum >> 1) + (uint8_t)shortName[i]);
+    }
+
+    return sum;
+}
+
+/* What a PC writes: the long name entries, last part first, then the
+ * short entry. Returns the index of the first of them. */
+static uint32_t dir_entry_add(CARD_DIR *dir, const char *shortName, const char *longName,
+                              uint8_t attributes, uint32_t cluster, uint32_t size)
+{
+    static const uint8_t offsets[13] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+    uint32_t first = dir->entries;
+    uint32_t length, ordinal, position, i;
+    uint8_t *entry;
+
+    if (longName != NULL)
+    {
+        length = (uint32_t)strlen(longName);
+
+        for (ordinal = (length + 12U) / 13U; ordinal > 0U; ordinal--)
+        {
+            entry = dir_entry_next(dir);
+
+            entry[0]  = (uint8_t)ordinal | ((ordinal == ((length + 12U) / 13U)) ? 0x40U : 0U);
+            entry[11] = 0x0F;
+            entry[13] = name_checksum(shortName);
+
+            for (i = 0; i < 13U; i++)
+            {
+                position = (ordinal - 1U) * 13U + i;
+
+                put16(&entry[offsets[i]], (position < length) ? (uint8_t)longName[position] :
+                                          (position == length) ? 0x0000U : 0xFFFFU);
+            }
+        }
+    }
+
+    entry = dir_entry_next(dir);
+
+    memcpy(entry, shortName, 11);
+    entry[11] = attributes;
+    put16(&entry[20], cluster >> 16);
+    put16(&entry[26], cluster);
+    put32(&entry[28], size);
+
+    return first;
+}
+
+static void file_add(CARD_DIR *dir, const char *shortName, const char *longName,
+                     const uint8_t *data, uint32_t size, const uint32_t *clusters, uint32_t count)
+{
+    uint32_t i, n;
+
+    for (i = 0; (i * CARD_CLUSTER_SIZE) < size; i++)
+    {
+        n = size - i * CARD_CLUSTER_SIZE;
+        memcpy(cluster_data(clusters[i]), &data[i * CARD_CLUSTER_SIZE], (n < CARD_CLUSTER_SIZE) ? n : CARD_CLUSTER_SIZE);
+    }
+
+    chain_set(clusters, count);
+    dir_entry_add(dir, shortName, longName, ATTR_ARCHIVE, clusters[0], size);
+}
+
+static bool file_write(const char *path, const void *data, size_t size)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    bool written;
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    written = (write(fd, data, size) == (ssize_t)size);
+    close(fd);
+
+    return written;
+}
+
+static bool file_read(const char *path, off_t offset, void *data, size_t size)
+{
+    int fd = open(path, O_RDONLY);
+    bool done;
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    done = (pread(fd, data, size, offset) == (ssize_t)size);
+    close(fd);
+
+    return done;
+}
+
+/* A card as a PC leaves it, with the firmware file or without */
+static void card_build(bool withImage)
+{
+    static uint8_t other[IMAGE_SIZE];
+    CARD_DIR root = { root_clusters, 2, 0 };
+    CARD_DIR updates = { updates_clusters, 1, 0 };
+    char name[12];
+    uint8_t *boot = &card[CARD_VOLUME_LBA * SECTOR_SIZE];
+    uint32_t i, first, last;
+
+    memset(card, 0, sizeof(card));
+
+    /* MBR with one FAT32 LBA partition */
+    card[446 + 4] = 0x0C;
+    put32(&card[446 + 8], CARD_VOLUME_LBA);
+    put32(&card[446 + 12], CARD_SECTORS - CARD_VOLUME_LBA);
+    put16(&card[510], 0xAA55);
+
+    boot[0] = 0xEB;
+    boot[1] = 0x58;
+    boot[2] = 0x90;
+    memcpy(&boot[3], "MSWIN4.1", 8);
+    put16(&boot[11], SECTOR_SIZE);
+    boot[13] = CARD_CLUSTER_SECTORS;
+    put16(&boot[14], CARD_RESERVED_SECTORS);
+    boot[16] = CARD_FATS;
+    boot[21] = 0xF8;
+    put32(&boot[32], CARD_SECTORS - CARD_VOLUME_LBA);
+    put32(&boot[36], CARD_FAT_SECTORS);
+    put32(&boot[44], root_clusters[0]);
+    put16(&boot[510], 0xAA55);
+
+    fat_set(0, 0x0FFFFFF8UL);
+    fat_set(1, CARD_END_OF_CHAIN);
+
+    chain_set(root_clusters, 2);
+    chain_set(updates_clusters, 1);
+
+    dir_entry_add(&root, "DEPOTCARD  ", NULL, ATTR_VOLUME_ID, 0, 0);
+
+    memset(other, 'r', sizeof(other));
+    file_add(&root, "README  TXT", NULL, other, 100, readme_clusters, 1);
+
+    /* Enough empty files to push the subdirectory into the second cluster */
+    for (i = 0; i < (CARD_DIR_ENTRIES - 2U); i++)
+    {
+        snprintf(name, sizeof(name), "EMPTY%03uTXT", (unsigned)i);
+        dir_entry_add(&root, name, NULL, ATTR_ARCHIVE, 0, 0);
+    }
+
+    dir_entry_add(&root, "UPDATES    ", "Updates", ATTR_DIRECTORY, updates_clusters[0], 0);
+
+    dir_entry_add(&updates, ".          ", NULL, ATTR_DIRECTORY, updates_clusters[0], 0);
+    dir_entry_add(&updates, "..         ", NULL, ATTR_DIRECTORY, 0, 0);
+
+    /* The long name of the firmware file is the start of this one */
+    memset(other, 'd', sizeof(other));
+    file_add(&updates, "DEPOT-~1OLD", "depot-firmware-2.1.bin.old", other, 500, decoy_clusters, 1);
+
+    /* An earlier copy under the same name, deleted */
+    memset(other, 'x', sizeof(other));
+    first = updates.entries;
+    file_add(&updates, "DEPOT-~2BIN", "depot-firmware-2.1.bin", other, 600, deleted_clusters, 1);
+    last  = updates.entries;
+
+    for (i = first; i < last; i++)
+    {
+        cluster_data(updates_clusters[0])[i * CARD_ENTRY_SIZE] = 0xE5;
+    }
+
+    if (withImage == true)
+    {
+        file_add(&updates, "DEPOT-~3BIN", "depot-firmware-2.1.bin", image, sizeof(image),
+                 image_clusters, sizeof(image_clusters) / sizeof(image_clusters[0]));
+    }
+
+    CHECK(file_write(card_path, card, sizeof(card)) == true);
+}
+
+static void image_build(void)
+{
+    struct binary_header header = { SIGNATURE1, SIGNATURE2, sizeof(image), 0 };
+    size_t i;
+
+    for (i = 0; i < sizeof(image); i++)
+    {
+        image[i] = (uint8_t)((i * 7U) ^ (i >> 10));
+    }
+
+    memcpy(&image[HEADER_OFFSET], &header, sizeof(header));
+
+    header.crc32 = (uint32_t)crc32(crc32(0, image, HEADER_OFFSET), &image[HEADER_OFFSET + sizeof(header)],
+                                   sizeof(image) - HEADER_OFFSET - sizeof(header));
+
+    memcpy(&image[HEADER_OFFSET], &header, sizeof(header));
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Boot Process
+// *****************************************************************************
+// *****************************************************************************
+
+static void boot_reset_handler(const char *reason)
+{
+    if (strcmp(reason, "bankswap") == 0)
+    {
+        _exit(BOOT_BANKSWAP);
+    }
+
+    _exit((strcmp(reason, "reset") == 0) ? BOOT_RESET : BOOT_POWER_LOSS);
+}
+
+/* What SYS_Initialize and the main loop do with BTL_SDCARD */
+static enum boot_result boot(void)
+{
+    pid_t pid = fork();
+    int status;
+    unsigned polls;
+
+    if (pid == 0)
+    {
+        if ((host_FlashOpen(flash_path) == false) || (bootloader_SdImageOpen(card_path) == false))
+        {
+            _exit(BOOT_FAILED);
+        }
+
+        host_ResetHandler = boot_reset_handler;
+
+        bootloader_SdCardInitialize();
+
+        /* A file takes two polls to its first packet, one to start the
+         * read and one to see it complete */
+        for (polls = 0; bootloader_SdCardTransport.receiverIsReady() == false; polls++)
+        {
+            if (polls == 1000U)
+            {
+                _exit(BOOT_IDLE);
+            }
+        }
+
+        bootloader_Tasks();
+
+        _exit(BOOT_FAILED);
+    }
+
+    if ((pid < 0) || (waitpid(pid, &status, 0) != pid) || (WIFEXITED(status) == 0))
+    {
+        return BOOT_FAILED;
+    }
+
+    return (enum boot_result)WEXITSTATUS(status);
+}
+
+/* Blank internal flash with an old application */
+static void flash_prepare(void)
+{
+    static uint8_t flash[HOST_FLASH_SIZE];
+
+    memset(flash, 0xFF, sizeof(flash));
+    memset(&flash[APP_ADDRESS], 0x5A, 2U * BTL_BLOCK_SIZE);
+
+    CHECK(file_write(flash_path, flash, sizeof(flash)) == true);
+}
+
+/* The image and the 0xFF padding of its last block at address */
+static bool image_is_installed(uint32_t address)
+{
+    static uint8_t flash[IMAGE_BLOCKS * BTL_BLOCK_SIZE];
+    size_t i;
+
+    if ((file_read(flash_path, address, flash, sizeof(flash)) == false) ||
+        (memcmp(flash, image, sizeof(image)) != 0))
+    {
+        return false;
+    }
+
+    for (i = sizeof(image); i < sizeof(flash); i++)
+    {
+        if (flash[i] != 0xFFU)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+/* Reads the open file through the reader in runs of at most max sectors */
+static uint32_t file_runs(uint8_t *data, uint32_t size, uint32_t max, uint32_t *runs, uint32_t maxRuns)
+{
+    uint32_t count = 0;
+    uint32_t offset = 0;
+    uint32_t lba, n;
+
+    while ((n = bootloader_Fat32Run(&lba, max)) != 0U)
+    {
+        CHECK(n <= max);
+
+        if ((offset + n * SECTOR_SIZE) <= size)
+        {
+            memcpy(&data[offset], &card[lba * SECTOR_SIZE], n * SECTOR_SIZE);
+        }
+
+        if (count < maxRuns)
+        {
+            runs[count] = n;
+        }
+
+        offset += n * SECTOR_SIZE;
+        count++;
+    }
+
+    CHECK(offset == (sizeof(image_clusters) / sizeof(image_clusters[0])) * CARD_CLUSTER_SIZE);
+
+    return count;
+}
+
+static void test_reader(void)
+{
+    static uint8_t data[sizeof(image_clusters) / sizeof(image_clusters[0]) * CARD_CLUSTER_SIZE];
+    uint32_t runs[8];
+    uint32_t size = 0;
+
+    card_build(true);
+
+    CHECK(bootloader_SdImageOpen(card_path) == true);
+    CHECK(bootloader_Fat32Mount() == true);
+
+    /* Long names in any case, a short name in the root */
+    CHECK(bootloader_Fat32Open("README.TXT", &size) == true);
+    CHECK(size == 100U);
+    CHECK(bootloader_Fat32Open("/Updates/DEPOT-FIRMWARE-2.1.BIN.OLD", &size) == true);
+    CHECK(size == 500U);
+    CHECK(bootloader_Fat32Open("updates/DEPOT-~3.BIN", &size) == true);
+    CHECK(size == sizeof(image));
+
+    /* One run per fragment, the data in file order */
+    CHECK(bootloader_Fat32Open(BTL_SDCARD_FILE, &size) == true);
+    CHECK(size == sizeof(image));
+    memset(data, 0, sizeof(data));
+    CHECK(file_runs(data, sizeof(data), 0xFFFFU, runs, 8) == (sizeof(image_runs) / sizeof(image_runs[0])));
+    CHECK(memcmp(runs, image_runs, sizeof(image_runs)) == 0);
+    CHECK(memcmp(data, image, sizeof(image)) == 0);
+
+    /* Runs smaller than a cluster pick up in the middle of it */
+    CHECK(bootloader_Fat32Open(BTL_SDCARD_FILE, &size) == true);
+    memset(data, 0, sizeof(data));
+    CHECK(file_runs(data, sizeof(data), 3U, runs, 8) > 16U);
+    CHECK(memcmp(data, image, sizeof(image)) == 0);
+
+    /* Nothing there, or not a file */
+    CHECK(bootloader_Fat32Open("updates/depot-firmware-2.1", &size) == false);
+    CHECK(bootloader_Fat32Open("updates/depot-firmware-2.1.bin.old.bak", &size) == false);
+    CHECK(bootloader_Fat32Open("depot-firmware-2.1.bin", &size) == false);
+    CHECK(bootloader_Fat32Open("firmware/depot-firmware-2.1.bin", &size) == false);
+    CHECK(bootloader_Fat32Open("README.TXT/depot-firmware-2.1.bin", &size) == false);
+    CHECK(bootloader_Fat32Open("updates", &size) == false);
+    CHECK(bootloader_Fat32Open("FIRMWARE.BIN", &size) == false);
+
+    /* The deleted copy is not found */
+    card_build(false);
+
+    CHECK(bootloader_SdImageOpen(card_path) == true);
+    CHECK(bootloader_Fat32Mount() == true);
+    CHECK(bootloader_Fat32Open(BTL_SDCARD_FILE, &size) == false);
+}
+
+static void test_update(void)
+{
+    flash_prepare();
+    card_build(true);
+
+    /* Programmed into the inactive bank, which is then swapped in */
+    CHECK(boot() == BOOT_BANKSWAP);
+    CHECK(image_is_installed(APP_ADDRESS) == true);
+}
+
+static void test_no_file(void)
+{
+    static uint8_t before[HOST_FLASH_SIZE];
+    static uint8_t after[HOST_FLASH_SIZE];
+
+    flash_prepare();
+    card_build(false);
+
+    CHECK(file_read(flash_path, 0, before, sizeof(before)) == true);
+
+    CHECK(boot() == BOOT_IDLE);
+
+    CHECK(file_read(flash_path, 0, after, sizeof(after)) == true);
+    CHECK(memcmp(before, after, sizeof(before)) == 0);
+}
+
+int main(void)
+{
+    char directory[] = "/tmp/test_sdcard.XXXXXX";
+
+    if (mkdtemp(directory) == NULL)
+    {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    snprintf(flash_path, sizeof(flash_path), "%s/flash.bin", directory);
+    snprintf(card_path, sizeof(card_path), "%s/card.img", directory);
+
+    image_build();
+
+    test_reader();
+    test_update();
+    test_no_file();
+
+    unlink(flash_path);
+    unlink(card_path);
+    rmdir(directory);
+
+    return host_TestResult("test_sdcard");
+}
@@ -0,0 +1,457 @@
+/*******************************************************************************
+  Self-Update Host Test
+
+  File Name:
+    test_selfupdate.c
+
+  Summary:
+    Replaces the bootloader through the protocol engine, with the power cut
+    at every flash operation of the update in turn.
+
+  Description:
+    Every boot is a child process doing what SYS_Initialize does with
+    BTL_SELF_UPDATE, bootloader_SelfUpdateSync(), then running the protocol
+    engine on a transport which plays back the packets btl_host.py sends
+    for --self-update and checks the responses. The flash is a file, so it
+    carries over from one boot to the next. The test checks that
+
+      - an update ends with the new bootloader and the application in the
+        bank swapped in, and the next boot copies the bootloader to the
+        other bank,
+      - a power loss at any erase or page write of the session leaves the
+        running bootloader and application alone, the next boot puts the
+        inactive bank's block 0 back and the update sent again succeeds,
+      - a staged copy with a wrong CRC or outside of the running bank is
+        refused with nothing written.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "definitions.h"
+#include "bootloader_protocol.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define APP_START_ADDRESS       (0x2000UL)
+#define BANK_SIZE               (HOST_FLASH_SIZE / 2U)
+#define APP_SIZE                (BANK_SIZE - APP_START_ADDRESS)
+
+/* Where btl_host.py stages a bootloader by default */
+#define STAGE_ADDRESS           (0x7A000UL)
+
+/* The end of the playback, taken as a stalled session after this many
+ * polls of the transport */
+#define IDLE_POLLS              100000UL
+
+/* How a boot ended, the exit status of its process */
+enum boot_result
+{
+    BOOT_RESET,
+    BOOT_BANKSWAP,
+    BOOT_POWER_LOSS,
+    BOOT_IDLE,
+    BOOT_WRONG_RESPONSE,
+    BOOT_FAILED,
+};
+
+static char flash_path[64];
+
+static uint8_t old_bootloader[BTL_BLOCK_SIZE];
+static uint8_t new_bootloader[BTL_BLOCK_SIZE];
+static uint8_t application[APP_SIZE];
+static uint32_t new_crc;
+
+/* Packets to play back and the response expected to each */
+static uint8_t  script[4U * BTL_BLOCK_SIZE];
+static size_t   script_size;
+static size_t   script_ptr;
+static uint8_t  responses[16];
+static size_t   responses_size;
+static size_t   responses_ptr;
+static unsigned long idle_polls;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Playback Transport
+// *****************************************************************************
+// *****************************************************************************
+
+static bool script_receiver_is_ready(void)
+{
+    if (script_ptr < script_size)
+    {
+        return true;
+    }
+
+    if (++idle_polls > IDLE_POLLS)
+    {
+        _exit(BOOT_IDLE);
+    }
+
+    return false;
+}
+
+static size_t script_read(uint8_t *buffer, size_t size)
+{
+    if (size > (script_size - script_ptr))
+    {
+        size = script_size - script_ptr;
+    }
+
+    memcpy(buffer, &script[script_ptr], size);
+    script_ptr += size;
+
+    return size;
+}
+
+static void script_write(const uint8_t *buffer, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        if ((responses_ptr >= responses_size) || (buffer[i] != responses[responses_ptr++]))
+        {
+            _exit(BOOT_WRONG_RESPONSE);
+        }
+    }
+}
+
+static void script_flush(void)
+{
+}
+
+static bool script_link_setup(uint32_t bitRate)
+{
+    (void)bitRate;
+
+    return true;
+}
+
+const BOOTLOADER_TRANSPORT host_Transport =
+{
+    .receiverIsReady    = script_receiver_is_ready,
+    .read               = script_read,
+    .write              = script_write,
+    .flush              = script_flush,
+    .linkSetup          = script_link_setup,
+};
+
+static void script_packet(uint8_t command, const void *payload, uint32_t size, uint8_t response)
+{
+    struct btl_header header = { BTL_GUARD, size, command };
+
+    memcpy(&script[script_size], &header, BTL_HEADER_SIZE);
+    memcpy(&script[script_size + BTL_HEADER_SIZE], payload, size);
+    script_size += BTL_HEADER_SIZE + size;
+
+    responses[responses_size++] = response;
+}
+
+static void script_clear(void)
+{
+    script_size     = 0;
+    responses_size  = 0;
+}
+
+/* What btl_host.py --self-update sends, with the address and CRC given to
+ * SELF_UPDATE and the response expected to it */
+static void script_self_update(uint32_t address, uint32_t crc, uint8_t response)
+{
+    const struct btl_unlock_payload unlock = { STAGE_ADDRESS, BTL_BLOCK_SIZE };
+    const struct btl_verify_payload verify = { new_crc };
+    const struct btl_self_update_payload update = { address, crc };
+    const struct btl_bkswap_reset_payload swap = { 0 };
+    static struct btl_data_payload data;
+
+    data.address = STAGE_ADDRESS;
+    memcpy(data.block, new_bootloader, sizeof(data.block));
+
+    script_clear();
+    script_packet(BL_CMD_UNLOCK, &unlock, sizeof(unlock), BL_RESP_OK);
+    script_packet(BL_CMD_DATA, &data, sizeof(data), BL_RESP_OK);
+    script_packet(BL_CMD_VERIFY, &verify, sizeof(verify), BL_RESP_CRC_OK);
+    script_packet(BL_CMD_SELF_UPDATE, &update, sizeof(update), response);
+
+    if (response == BL_RESP_CRC_OK)
+    {
+        script_packet(BL_CMD_BKSWAP_RESET, &swap, sizeof(swap), BL_RESP_OK);
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Boot Process
+// *****************************************************************************
+// *****************************************************************************
+
+static void boot_reset_handler(const char *reason)
+{
+    if (strcmp(reason, "bankswap") == 0)
+    {
+        _exit(BOOT_BANKSWAP);
+    }
+
+    _exit((strcmp(reason, "reset") == 0) ? BOOT_RESET : BOOT_POWER_LOSS);
+}
+
+/* One boot with the power cut after powerLoss flash operations, negative
+ * for never. The script is played back if there is one, else the boot
+ * ends where the application would be started. */
+static enum boot_result boot(long powerLoss)
+{
+    pid_t pid = fork();
+    int status;
+
+    if (pid == 0)
+    {
+        if (host_FlashOpen(flash_path) == false)
+        {
+            _exit(BOOT_FAILED);
+        }
+
+        host_ResetHandler       = boot_reset_handler;
+        host_PowerLossCountdown = powerLoss;
+
+        bootloader_SelfUpdateSync();
+
+        if (script_size == 0U)
+        {
+            _exit(BOOT_RESET);
+        }
+
+        bootloader_Tasks();
+
+        _exit(BOOT_FAILED);
+    }
+
+    if ((pid < 0) || (waitpid(pid, &status, 0) != pid) || (WIFEXITED(status) == 0))
+    {
+        return BOOT_FAILED;
+    }
+
+    return (enum boot_result)WEXITSTATUS(status);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Flash File
+// *****************************************************************************
+// *****************************************************************************
+
+static bool flash_is(uint32_t address, const void *data, size_t size)
+{
+    static uint8_t buffer[APP_SIZE];
+    int fd = open(flash_path, O_RDONLY);
+    bool equal;
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    equal = (pread(fd, buffer, size, address) == (ssize_t)size) && (memcmp(buffer, data, size) == 0);
+    close(fd);
+
+    return equal;
+}
+
+/* The old bootloader and the application in both banks. The inactive bank
+ * holds an older build which differs in a few blocks. */
+static void flash_prepare(void)
+{
+    static uint8_t flash[HOST_FLASH_SIZE];
+    int fd;
+
+    memset(flash, 0xFF, sizeof(flash));
+    memcpy(&flash[0], old_bootloader, sizeof(old_bootloader));
+    memcpy(&flash[APP_START_ADDRESS], application, sizeof(application));
+    memcpy(&flash[BANK_SIZE], old_bootloader, sizeof(old_bootloader));
+    memcpy(&flash[BANK_SIZE + APP_START_ADDRESS], application, sizeof(application));
+    memset(&flash[BANK_SIZE + 0x4000U], 0x11, 100);
+    memset(&flash[BANK_SIZE + 0x20000U], 0x22, BTL_BLOCK_SIZE);
+
+    unlink(flash_path);
+    fd = open(flash_path, O_RDWR | O_CREAT, 0644);
+    CHECK((fd >= 0) && (write(fd, flash, sizeof(flash)) == (ssize_t)sizeof(flash)));
+    close(fd);
+}
+
+static void images_build(void)
+{
+    uint32_t vectors[2] = { HSRAM_ADDR + HSRAM_SIZE, 0x0141U };
+    size_t i;
+
+    for (i = 0; i < sizeof(application); i++)
+    {
+        application[i] = (uint8_t)((i * 7U) ^ (i >> 11));
+    }
+
+    /* Staged copies go here, which has to be free of application code */
+    memset(&application[STAGE_ADDRESS - APP_START_ADDRESS], 0xFF, BANK_SIZE - STAGE_ADDRESS);
+
+    for (i = 0; i < sizeof(new_bootloader); i++)
+    {
+        old_bootloader[i] = (uint8_t)(i ^ 0x5AU);
+        new_bootloader[i] = (uint8_t)((i * 3U) ^ 0xA5U);
+    }
+
+    memcpy(old_bootloader, vectors, sizeof(vectors));
+    vectors[1] = 0x0181U;
+    memcpy(new_bootloader, vectors, sizeof(vectors));
+
+    new_crc = (uint32_t)crc32(0, new_bootloader, sizeof(new_bootloader)) ^ 0xFFFFFFFFUL;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+/* The new bootloader swapped in, with the application it has to start */
+static void check_updated(void)
+{
+    CHECK(flash_is(0, new_bootloader, sizeof(new_bootloader)));
+    CHECK(flash_is(APP_START_ADDRESS, application, STAGE_ADDRESS - APP_START_ADDRESS));
+    CHECK(flash_is(STAGE_ADDRESS, new_bootloader, sizeof(new_bootloader)));
+
+    /* The next boot brings the other bank in line */
+    script_clear();
+    CHECK(boot(-1) == BOOT_RESET);
+    CHECK(flash_is(BANK_SIZE, new_bootloader, sizeof(new_bootloader)));
+}
+
+static void test_update(void)
+{
+    flash_prepare();
+
+    script_self_update(STAGE_ADDRESS, new_crc, BL_RESP_CRC_OK);
+    CHECK(boot(-1) == BOOT_BANKSWAP);
+
+    check_updated();
+}
+
+static void test_power_loss(void)
+{
+    long cut;
+    enum boot_result result = BOOT_POWER_LOSS;
+
+    for (cut = 0; result == BOOT_POWER_LOSS; cut++)
+    {
+        flash_prepare();
+
+        script_self_update(STAGE_ADDRESS, new_crc, BL_RESP_CRC_OK);
+        result = boot(cut);
+
+        if (result != BOOT_POWER_LOSS)
+        {
+            CHECK(result == BOOT_BANKSWAP);
+            break;
+        }
+
+        /* Still the old bootloader and application, and after the next
+         * boot the old bootloader in the other bank as well */
+        script_clear();
+        CHECK(boot(-1) == BOOT_RESET);
+        CHECK(flash_is(0, old_bootloader, sizeof(old_bootloader)));
+        CHECK(flash_is(APP_START_ADDRESS, application, STAGE_ADDRESS - APP_START_ADDRESS));
+        CHECK(flash_is(BANK_SIZE, old_bootloader, sizeof(old_bootloader)));
+
+        script_self_update(STAGE_ADDRESS, new_crc, BL_RESP_CRC_OK);
+        CHECK(boot(-1) == BOOT_BANKSWAP);
+
+        check_updated();
+    }
+
+    /* The block staged by DATA, then in the other bank the two blocks of
+     * the application which differ, the staged block and block 0, an erase
+     * and 16 page writes each */
+    CHECK(cut == (5L * (1L + (BTL_BLOCK_SIZE / NVMCTRL_FLASH_PAGESIZE))));
+
+    check_updated();
+}
+
+static void test_refused(void)
+{
+    static uint8_t before[HOST_FLASH_SIZE];
+    int fd;
+
+    flash_prepare();
+
+    /* The staged block is written by DATA, nothing after it */
+    script_self_update(STAGE_ADDRESS, new_crc ^ 1U, BL_RESP_ERROR);
+    CHECK(boot(-1) == BOOT_IDLE);
+
+    fd = open(flash_path, O_RDONLY);
+    CHECK((fd >= 0) && (read(fd, before, sizeof(before)) == (ssize_t)sizeof(before)));
+    close(fd);
+
+    script_self_update(BANK_SIZE + STAGE_ADDRESS, new_crc, BL_RESP_ERROR);
+    CHECK(boot(-1) == BOOT_IDLE);
+
+    CHECK(flash_is(0, before, sizeof(before)));
+    CHECK(flash_is(0, old_bootloader, sizeof(old_bootloader)));
+}
+
+int main(void)
+{
+    char directory[] = "/tmp/test_selfupdate.XXXXXX";
+
+    if (mkdtemp(directory) == NULL)
+    {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    snprintf(flash_path, sizeof(flash_path), "%s/flash.bin", directory);
+
+    images_build();
+
+    test_update();
+    test_power_loss();
+    test_refused();
+
+    unlink(flash_path);
+    rmdir(directory);
+
+    return host_TestResult("test_selfupdate");
+}
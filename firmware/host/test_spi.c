@@ -0,0 +1,464 @@
+/*******************************************************************************
+  SPI Slave Transport Host Test
+
+  File Name:
+    test_spi.c
+
+  Summary:
+    Programs an application through bootloader_spi.c, with a simulated SPI
+    master on the other end.
+
+  Description:
+    The protocol engine runs in its own thread with the SPI transport. The
+    SERCOM1, DMAC and PORT calls of the backend are implemented here on a
+    simulated bus, and the test thread is the master the way btl_host.py
+    drives a real one: a packet per slave select transaction, a one byte
+    transaction to clock out its response, and a wait for the rising edge
+    of the ready line after each of them.
+
+    Besides the upload it checks that a transaction whose length does not
+    match its header is dropped and answered with 0xFF, that 0xFF is
+    shifted out when no response is pending, and that a packet larger than
+    the frame buffer does not overrun it.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include "definitions.h"
+#include "bootloader_protocol.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define APP_ADDRESS             (0x2000UL)
+#define APP_BLOCKS              3U
+
+#define NO_RESPONSE             0xFFU
+
+/* How long the master waits for the ready line */
+#define READY_TIMEOUT_S         2
+
+/* Largest packet the slave takes, as in bootloader_spi.c */
+#define FRAME_SIZE              (BTL_HEADER_SIZE + BTL_MAX_PAYLOAD_SIZE)
+
+typedef struct
+{
+    const uint8_t  *source;
+    uint8_t        *destination;
+    size_t          size;
+    size_t          count;
+    bool            enabled;
+} DMA_CHANNEL_SIM;
+
+static pthread_mutex_t  bus_lock    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   bus_change  = PTHREAD_COND_INITIALIZER;
+
+static DMA_CHANNEL_SIM  rx_channel;
+static DMA_CHANNEL_SIM  tx_channel;
+static uint8_t          preload     = NO_RESPONSE;
+static bool             preloaded   = false;
+static bool             ss_released = false;
+static bool             ready       = false;
+static unsigned         ready_rises = 0;
+static bool             slave_reset = false;
+
+static uint8_t          spi_data_register;
+
+static uint8_t          image[APP_BLOCKS * BTL_BLOCK_SIZE];
+
+unsigned long crc32(unsigned long inCrc32, const void *buf, size_t bufLen);
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: SERCOM1, DMAC and PORT on the Simulated Bus
+// *****************************************************************************
+// *****************************************************************************
+
+void PORT_PinSet(PORT_PIN pin)
+{
+    pthread_mutex_lock(&bus_lock);
+
+    if (ready == false)
+    {
+        ready_rises++;
+    }
+
+    ready = true;
+
+    pthread_cond_broadcast(&bus_change);
+    pthread_mutex_unlock(&bus_lock);
+}
+
+void PORT_PinClear(PORT_PIN pin)
+{
+    pthread_mutex_lock(&bus_lock);
+    ready = false;
+    pthread_mutex_unlock(&bus_lock);
+}
+
+void PORT_PinOutputEnable(PORT_PIN pin)
+{
+}
+
+bool DMAC_ChannelTransfer(DMAC_CHANNEL channel, const void *srcAddr, const void *destAddr, size_t blockSize)
+{
+    DMA_CHANNEL_SIM *dma = (channel == DMAC_CHANNEL_0) ? &rx_channel : &tx_channel;
+
+    pthread_mutex_lock(&bus_lock);
+
+    dma->source         = srcAddr;
+    dma->destination    = (uint8_t *)destAddr;
+    dma->size           = blockSize;
+    dma->count          = 0;
+    dma->enabled        = true;
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return true;
+}
+
+void DMAC_ChannelDisable(DMAC_CHANNEL channel)
+{
+    pthread_mutex_lock(&bus_lock);
+
+    ((channel == DMAC_CHANNEL_0) ? &rx_channel : &tx_channel)->enabled = false;
+
+    pthread_mutex_unlock(&bus_lock);
+}
+
+uint16_t DMAC_ChannelGetTransferredCount(DMAC_CHANNEL channel)
+{
+    uint16_t count;
+
+    pthread_mutex_lock(&bus_lock);
+
+    count = (uint16_t)((channel == DMAC_CHANNEL_0) ? rx_channel.count : tx_channel.count);
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return count;
+}
+
+volatile void *SERCOM1_SPI_DataAddressGet(void)
+{
+    return &spi_data_register;
+}
+
+bool SERCOM1_SPI_TransactionIsComplete(void)
+{
+    bool complete;
+
+    pthread_mutex_lock(&bus_lock);
+
+    complete    = ss_released;
+    ss_released = false;
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return complete;
+}
+
+void SERCOM1_SPI_ReceiverFlush(void)
+{
+}
+
+void SERCOM1_SPI_Preload(uint8_t data)
+{
+    pthread_mutex_lock(&bus_lock);
+
+    preload     = data;
+    preloaded   = true;
+
+    pthread_mutex_unlock(&bus_lock);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Slave Thread
+// *****************************************************************************
+// *****************************************************************************
+
+static void slave_reset_handler(const char *reason)
+{
+    pthread_mutex_lock(&bus_lock);
+
+    slave_reset = true;
+
+    pthread_cond_broadcast(&bus_change);
+    pthread_mutex_unlock(&bus_lock);
+
+    pthread_exit(NULL);
+}
+
+static void *slave_thread(void *arg)
+{
+    bootloader_SpiInitialize();
+
+    bootloader_Tasks();
+
+    return NULL;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Simulated Master
+// *****************************************************************************
+// *****************************************************************************
+
+/* Waits until the ready line has risen more than rises times, or is high
+ * when rises is 0. Called with bus_lock held. */
+static bool ready_wait(unsigned rises)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += READY_TIMEOUT_S;
+
+    while ((rises == 0U) ? (ready == false) : (ready_rises <= rises))
+    {
+        if (pthread_cond_timedwait(&bus_change, &bus_lock, &deadline) == ETIMEDOUT)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool reset_wait(void)
+{
+    struct timespec deadline;
+    bool passed = true;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += READY_TIMEOUT_S;
+
+    pthread_mutex_lock(&bus_lock);
+
+    while ((slave_reset == false) && (passed == true))
+    {
+        passed = (pthread_cond_timedwait(&bus_change, &bus_lock, &deadline) != ETIMEDOUT);
+    }
+
+    passed = slave_reset;
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return passed;
+}
+
+/* One slave select transaction: shifts size bytes out and as many in,
+ * then waits for the slave to be ready again */
+static bool master_transfer(const uint8_t *mosi, uint8_t *miso, size_t size)
+{
+    unsigned rises;
+    size_t i;
+    bool passed;
+
+    pthread_mutex_lock(&bus_lock);
+
+    passed = ready_wait(0);
+
+    for (i = 0; (passed == true) && (i < size); i++)
+    {
+        /* The slave shifts out what the DMAC has put into DATA, else the
+         * preloaded byte once */
+        if (tx_channel.enabled && (tx_channel.count < tx_channel.size))
+        {
+            miso[i] = tx_channel.source[tx_channel.count++];
+        }
+        else if (preloaded == true)
+        {
+            miso[i]   = preload;
+            preloaded = false;
+        }
+        else
+        {
+            miso[i] = NO_RESPONSE;
+        }
+
+        if (rx_channel.enabled && (rx_channel.count < rx_channel.size))
+        {
+            rx_channel.destination[rx_channel.count++] = mosi[i];
+        }
+    }
+
+    rises       = ready_rises;
+    ss_released = true;
+
+    passed = passed && ready_wait(rises);
+
+    pthread_mutex_unlock(&bus_lock);
+
+    return passed;
+}
+
+static size_t packet_build(uint8_t *packet, uint8_t command, const void *payload, uint32_t size)
+{
+    uint32_t guard = BTL_GUARD;
+
+    memcpy(&packet[BTL_GUARD_OFFSET], &guard, sizeof(guard));
+    memcpy(&packet[BTL_SIZE_OFFSET], &size, sizeof(size));
+    packet[BTL_CMD_OFFSET] = command;
+    memcpy(&packet[BTL_HEADER_SIZE], payload, size);
+
+    return BTL_HEADER_SIZE + size;
+}
+
+/* Sends a packet of length bytes and returns the response byte, or -1 if
+ * the slave stopped answering */
+static int master_send(const uint8_t *packet, size_t length)
+{
+    static uint8_t miso[FRAME_SIZE + 64U];
+    uint8_t dummy = 0;
+    uint8_t response;
+
+    if (master_transfer(packet, miso, length) == false)
+    {
+        return -1;
+    }
+
+    if (master_transfer(&dummy, &response, 1) == false)
+    {
+        return -1;
+    }
+
+    return response;
+}
+
+static int master_command(uint8_t command, const void *payload, uint32_t size)
+{
+    static uint8_t packet[FRAME_SIZE + 64U];
+
+    return master_send(packet, packet_build(packet, command, payload, size));
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+static void test_framing(void)
+{
+    static uint8_t packet[FRAME_SIZE + 64U];
+    static uint8_t filler[FRAME_SIZE + 64U - BTL_HEADER_SIZE];
+    struct btl_unlock_payload unlock = { APP_ADDRESS, sizeof(image) };
+    uint8_t dummy = 0;
+    uint8_t response = 0;
+    size_t length;
+
+    /* Nothing pending */
+    CHECK(master_transfer(&dummy, &response, 1) == true);
+    CHECK(response == NO_RESPONSE);
+
+    /* A byte short of its header size */
+    length = packet_build(packet, BL_CMD_UNLOCK, &unlock, sizeof(unlock));
+    CHECK(master_send(packet, length - 1U) == NO_RESPONSE);
+
+    /* Trailing garbage after the packet */
+    packet[length] = 0x55;
+    CHECK(master_send(packet, length + 1U) == NO_RESPONSE);
+
+    /* Longer than the frame buffer, the size field claims all of it */
+    memset(filler, 0xA5, sizeof(filler));
+    length = packet_build(packet, BL_CMD_DATA, filler, sizeof(filler));
+    CHECK(master_send(packet, length) == NO_RESPONSE);
+
+    /* The link is still in step */
+    CHECK(master_command(BL_CMD_UNLOCK, &unlock, sizeof(unlock)) == BL_RESP_OK);
+}
+
+static void test_upload(void)
+{
+    static struct btl_data_payload data;
+    struct btl_unlock_payload unlock = { APP_ADDRESS, sizeof(image) };
+    struct btl_verify_payload verify;
+    struct btl_reset_payload reset = { 0 };
+    uint32_t n;
+
+    for (n = 0; n < sizeof(image); n++)
+    {
+        image[n] = (uint8_t)(n * 7U + (n >> 8));
+    }
+
+    CHECK(master_command(BL_CMD_UNLOCK, &unlock, sizeof(unlock)) == BL_RESP_OK);
+
+    for (n = 0; n < APP_BLOCKS; n++)
+    {
+        data.address = APP_ADDRESS + n * BTL_BLOCK_SIZE;
+        memcpy(data.block, &image[n * BTL_BLOCK_SIZE], BTL_BLOCK_SIZE);
+
+        CHECK(master_command(BL_CMD_DATA, &data, sizeof(data)) == BL_RESP_OK);
+    }
+
+    /* The DSU leaves out the final inversion */
+    verify.crc = (uint32_t)crc32(0, image, sizeof(image)) ^ 0xFFFFFFFFUL ^ 1U;
+    CHECK(master_command(BL_CMD_VERIFY, &verify, sizeof(verify)) == BL_RESP_CRC_FAIL);
+
+    verify.crc ^= 1U;
+    CHECK(master_command(BL_CMD_VERIFY, &verify, sizeof(verify)) == BL_RESP_CRC_OK);
+
+    CHECK(memcmp((const void *)APP_ADDRESS, image, sizeof(image)) == 0);
+
+    CHECK(master_command(BL_CMD_RESET, &reset, sizeof(reset)) == BL_RESP_OK);
+}
+
+int main(void)
+{
+    pthread_t slave;
+
+    if (host_FlashOpen(NULL) == false)
+    {
+        return EXIT_FAILURE;
+    }
+
+    host_ResetHandler = slave_reset_handler;
+
+    pthread_create(&slave, NULL, slave_thread, NULL);
+
+    test_framing();
+    test_upload();
+
+    /* A slave which missed the reset is left running */
+    CHECK(reset_wait() == true);
+
+    return host_TestResult("test_spi");
+}
@@ -0,0 +1,405 @@
+/*******************************************************************************
+  UF2 Reassembly Host Test
+
+  File Name:
+    test_uf2.c
+
+  Summary:
+    Feeds UF2 sectors to bootloader_uf2.c the way a host copying a file
+    onto the BTL_USB_MSC volume writes them.
+
+  Description:
+    Committed erase blocks are programmed into a simulated flash the way
+    bootloader_usb_msc.c does, slots of an earlier partial commit taken
+    from the flash. The test checks the flash against the file and when the
+    module reports the file complete:
+
+      - blocks arriving out of order,
+      - blocks written twice, before and after their erase block was
+        committed,
+      - a file ending in a partial erase block,
+      - more erase blocks in flight than there are buffers, which commits
+        blocks early and completes them with a second commit,
+      - sectors that are no UF2 blocks or are meant for other targets.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "configuration.h"
+#include "bootloader_protocol.h"
+#include "bootloader_uf2.h"
+#include "host_test.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define APP_ADDRESS             (0x4000UL)
+
+/* Erase blocks of the simulated flash behind APP_ADDRESS */
+#define FLASH_BLOCKS            8U
+#define FLASH_SIZE              (FLASH_BLOCKS * BTL_BLOCK_SIZE)
+
+#define SLOTS                   (BTL_BLOCK_SIZE / BTL_UF2_PAYLOAD_SIZE)
+
+#define UF2_MAGIC_START0        0x0A324655UL
+#define UF2_MAGIC_START1        0x9E5D5157UL
+#define UF2_MAGIC_END           0x0AB16F30UL
+
+#define UF2_FLAG_NOT_MAIN_FLASH 0x00000001UL
+#define UF2_FLAG_FAMILY_ID      0x00002000UL
+
+static uint8_t  flash[FLASH_SIZE];
+static unsigned commits;
+
+/* keep bitmap of every commit, per erase block */
+static uint32_t kept[FLASH_BLOCKS];
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Simulated Host and Flash
+// *****************************************************************************
+// *****************************************************************************
+
+static void put32(uint8_t *dest, uint32_t value)
+{
+    dest[0] = (uint8_t)value;
+    dest[1] = (uint8_t)(value >> 8);
+    dest[2] = (uint8_t)(value >> 16);
+    dest[3] = (uint8_t)(value >> 24);
+}
+
+/* Content of the file at a flash address, seed tells two versions apart */
+static uint8_t file_byte(uint32_t address, uint8_t seed)
+{
+    return (uint8_t)(((address * 31U) >> 3) ^ seed);
+}
+
+/* UF2 block n of a file of count blocks, starting at APP_ADDRESS */
+static void block_build(uint8_t *sector, uint32_t n, uint32_t count, uint8_t seed)
+{
+    uint32_t address = APP_ADDRESS + (n * BTL_UF2_PAYLOAD_SIZE);
+    uint32_t i;
+
+    memset(sector, 0, BTL_UF2_BLOCK_SIZE);
+
+    put32(&sector[0], UF2_MAGIC_START0);
+    put32(&sector[4], UF2_MAGIC_START1);
+    put32(&sector[8], UF2_FLAG_FAMILY_ID);
+    put32(&sector[12], address);
+    put32(&sector[16], BTL_UF2_PAYLOAD_SIZE);
+    put32(&sector[20], n);
+    put32(&sector[24], count);
+    put32(&sector[28], BTL_UF2_FAMILY_ID);
+    put32(&sector[508], UF2_MAGIC_END);
+
+    for (i = 0; i < BTL_UF2_PAYLOAD_SIZE; i++)
+    {
+        sector[32U + i] = file_byte(address + i, seed);
+    }
+}
+
+/* Erases and writes every queued erase block, as msc_commit_task does */
+static void commits_drain(void)
+{
+    const uint8_t *data;
+    uint32_t address, keep, offset, slot;
+
+    while ((data = bootloader_Uf2CommitGet(&address, &keep)) != NULL)
+    {
+        offset = address - APP_ADDRESS;
+
+        if ((address >= APP_ADDRESS) && (offset < FLASH_SIZE) && ((offset % BTL_BLOCK_SIZE) == 0U))
+        {
+            for (slot = 0; slot < SLOTS; slot++)
+            {
+                /* Slots kept from the flash are left erased in the buffer */
+                if ((keep & (1UL << slot)) != 0U)
+                {
+                    CHECK(data[slot * BTL_UF2_PAYLOAD_SIZE] == 0xFFU);
+                }
+                else
+                {
+                    memcpy(&flash[offset + slot * BTL_UF2_PAYLOAD_SIZE], &data[slot * BTL_UF2_PAYLOAD_SIZE], BTL_UF2_PAYLOAD_SIZE);
+                }
+            }
+
+            kept[offset / BTL_BLOCK_SIZE] |= keep;
+        }
+        else
+        {
+            CHECK(false);
+        }
+
+        commits++;
+
+        bootloader_Uf2CommitDone();
+    }
+}
+
+/* Writes one sector, committing blocks while the module is out of buffers */
+static BTL_UF2_RESULT sector_write(const uint8_t *sector)
+{
+    BTL_UF2_RESULT result;
+    unsigned tries;
+
+    for (tries = 0; tries < BTL_UF2_CACHE_BLOCKS + 1U; tries++)
+    {
+        result = bootloader_Uf2SectorWrite(sector);
+
+        if (result != BTL_UF2_BUSY)
+        {
+            return result;
+        }
+
+        commits_drain();
+    }
+
+    return BTL_UF2_BUSY;
+}
+
+static void session_start(void)
+{
+    memset(flash, 0xFF, sizeof(flash));
+    memset(kept, 0, sizeof(kept));
+    commits = 0;
+
+    bootloader_Uf2Initialize(APP_ADDRESS, 0x80000UL);
+}
+
+/* The first count payloads of the file with the given seed are in flash */
+static bool flash_check(uint32_t count, uint8_t seed)
+{
+    uint32_t i;
+
+    for (i = 0; i < FLASH_SIZE; i++)
+    {
+        if (flash[i] != ((i < count * BTL_UF2_PAYLOAD_SIZE) ? file_byte(APP_ADDRESS + i, seed) : 0xFFU))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Tests
+// *****************************************************************************
+// *****************************************************************************
+
+static void test_out_of_order(void)
+{
+    uint8_t sector[BTL_UF2_BLOCK_SIZE];
+    uint32_t count = 2U * SLOTS;
+    uint32_t i;
+
+    session_start();
+
+    /* 37 is coprime to 64, every block once in a scrambled order */
+    for (i = 0; i < count; i++)
+    {
+        block_build(sector, (i * 37U) % count, count, 0);
+
+        CHECK(bootloader_Uf2IsComplete() == false);
+        CHECK(sector_write(sector) == BTL_UF2_ACCEPTED);
+
+        commits_drain();
+    }
+
+    CHECK(bootloader_Uf2IsComplete() == true);
+    CHECK(commits == 2U);
+    CHECK((kept[0] | kept[1]) == 0U);
+    CHECK(flash_check(count, 0) == true);
+}
+
+static void test_duplicates(void)
+{
+    uint8_t sector[BTL_UF2_BLOCK_SIZE];
+    uint32_t count = 2U * SLOTS;
+    uint32_t i;
+
+    session_start();
+
+    for (i = 0; i < SLOTS; i++)
+    {
+        block_build(sector, i, count, 0);
+        CHECK(sector_write(sector) == BTL_UF2_ACCEPTED);
+    }
+
+    commits_drain();
+    CHECK(commits == 1U);
+
+    /* The first erase block is programmed, a rewrite of it is dropped */
+    block_build(sector, 5, count, 0x5A);
+    CHECK(sector_write(sector) == BTL_UF2_ACCEPTED);
+    commits_drain();
+    CHECK(commits == 1U);
+
+    /* In a buffer still being filled the last copy wins */
+    block_build(sector, SLOTS + 3U, count, 0x5A);
+    CHECK(sector_write(sector) == BTL_UF2_ACCEPTED);
+    block_build(sector, SLOTS + 3U, count, 0);
+    CHECK(sector_write(sector) == BTL_UF2_ACCEPTED);
+
+    /* Duplicates do not count towards the file, one block is still missing */
+    for (i = SLOTS; i < count - 1U; i++)
+    {
+        block_build(sector, i, count, 0);
+        CHECK(sector_write(sector) == BTL_UF2_ACCEPTED);
+        CHECK(sector_write(sector) == BTL_UF2_ACCEPTED);
+    }
+
+    commits_drain();
+    CHECK(bootloader_Uf2IsComplete() == false);
+    CHECK(commits == 1U);
+
+    block_build(sector, count - 1U, count, 0);
+    CHECK(sector_write(sector) == BTL_UF2_ACCEPTED);
+    commits_drain();
+
+    CHECK(bootloader_Uf2IsComplete() == true);
+    CHECK(commits == 2U);
+    CHECK(flash_check(count, 0) == true);
+}
+
+static void test_short_file(void)
+{
+    uint8_t sector[BTL_UF2_BLOCK_SIZE];
+    uint32_t count = SLOTS + 8U;
+    uint32_t i;
+
+    session_start();
+
+    for (i = 0; i < count; i++)
+    {
+        block_build(sector, i, count, 0);
+        CHECK(sector_write(sector) == BTL_UF2_ACCEPTED);
+    }
+
+    /* The last erase block is committed with the file's last block */
+    CHECK(bootloader_Uf2IsComplete() == false);
+    commits_drain();
+
+    CHECK(bootloader_Uf2IsComplete() == true);
+    CHECK(commits == 2U);
+    CHECK(flash_check(count, 0) == true);
+}
+
+static void test_early_commit(void)
+{
+    uint8_t sector[BTL_UF2_BLOCK_SIZE];
+    uint32_t blocks = BTL_UF2_CACHE_BLOCKS + 2U;
+    uint32_t count = blocks * SLOTS;
+    uint32_t i;
+
+    session_start();
+
+    /* One payload per erase block, the buffers run out */
+    for (i = 0; i < BTL_UF2_CACHE_BLOCKS; i++)
+    {
+        block_build(sector, i * SLOTS, count, 0);
+        CHECK(bootloader_Uf2SectorWrite(sector) == BTL_UF2_ACCEPTED);
+    }
+
+    block_build(sector, BTL_UF2_CACHE_BLOCKS * SLOTS, count, 0);
+    CHECK(bootloader_Uf2SectorWrite(sector) == BTL_UF2_BUSY);
+
+    /* The oldest one is committed with its single payload */
+    commits_drain();
+    CHECK(commits == 1U);
+    CHECK(bootloader_Uf2SectorWrite(sector) == BTL_UF2_ACCEPTED);
+
+    /* The rest of the file, erase blocks interleaved */
+    for (i = 0; i < count; i++)
+    {
+        block_build(sector, (i % blocks) * SLOTS + (i / blocks), count, 0);
+        CHECK(sector_write(sector) == BTL_UF2_ACCEPTED);
+    }
+
+    commits_drain();
+
+    CHECK(bootloader_Uf2IsComplete() == true);
+    CHECK(commits > blocks);
+    CHECK((kept[0] & 1U) != 0U);
+    CHECK(flash_check(count, 0) == true);
+}
+
+static void test_foreign_sectors(void)
+{
+    uint8_t sector[BTL_UF2_BLOCK_SIZE];
+
+    session_start();
+
+    /* File system metadata */
+    memset(sector, 0, sizeof(sector));
+    CHECK(bootloader_Uf2SectorWrite(sector) == BTL_UF2_IGNORED);
+
+    block_build(sector, 0, 1, 0);
+    put32(&sector[508], 0);
+    CHECK(bootloader_Uf2SectorWrite(sector) == BTL_UF2_IGNORED);
+
+    /* Another chip family */
+    block_build(sector, 0, 1, 0);
+    put32(&sector[28], 0x68ED2B88UL);
+    CHECK(bootloader_Uf2SectorWrite(sector) == BTL_UF2_ACCEPTED);
+
+    /* Not for the main flash */
+    block_build(sector, 0, 1, 0);
+    put32(&sector[8], UF2_FLAG_NOT_MAIN_FLASH);
+    CHECK(bootloader_Uf2SectorWrite(sector) == BTL_UF2_ACCEPTED);
+
+    /* Into the bootloader */
+    block_build(sector, 0, 1, 0);
+    put32(&sector[12], 0);
+    CHECK(bootloader_Uf2SectorWrite(sector) == BTL_UF2_ACCEPTED);
+
+    commits_drain();
+    CHECK(commits == 0U);
+    CHECK(bootloader_Uf2IsComplete() == false);
+    CHECK(flash_check(0, 0) == true);
+}
+
+int main(void)
+{
+    test_out_of_order();
+    test_duplicates();
+    test_short_file();
+    test_early_commit();
+    test_foreign_sectors();
+
+    return host_TestResult("test_uf2");
+}
@@ -46,6 +46,11 @@
 
 #include "definitions.h"
 #include <device.h>
+#include "bootloader_transport.h"
+#include "bootloader_protocol.h"
+#include "bootloader_container.h"
+#include "bootloader_partition.h"
+#include "bootloader_fec.h"
 
 // *****************************************************************************
 // *****************************************************************************
@@ -59,79 +64,107 @@
 #define ERASE_BLOCK_SIZE        (8192UL)
 #define PAGES_IN_ERASE_BLOCK    (ERASE_BLOCK_SIZE / PAGE_SIZE)
 
-#define BOOTLOADER_SIZE         8192
+#define BOOTLOADER_SIZE         BTL_BOOTLOADER_SIZE
 
-#define APP_START_ADDRESS       (0x2000UL)
+#define APP_START_ADDRESS       ((uint32_t)BTL_BOOTLOADER_SIZE)
 
-#define GUARD_OFFSET            0
-#define CMD_OFFSET              2
-#define ADDR_OFFSET             0
-#define SIZE_OFFSET             1
-#define DATA_OFFSET             1
-#define CRC_OFFSET              0
-
-#define CMD_SIZE                1
-#define GUARD_SIZE              4
-#define SIZE_SIZE               4
-#define OFFSET_SIZE             4
-#define CRC_SIZE                4
-#define HEADER_SIZE             (GUARD_SIZE + SIZE_SIZE + CMD_SIZE)
 #define DATA_SIZE               ERASE_BLOCK_SIZE
 
 #define WORDS(x)                ((int)((x) / sizeof(uint32_t)))
 
+#define PACKET_SIZE             BTL_MAX_PAYLOAD_SIZE
+
+/* Decrypted between two polls of the links */
+#define DECRYPT_CHUNK_SIZE      64U
+
 #define OFFSET_ALIGN_MASK       (~ERASE_BLOCK_SIZE + 1)
 #define SIZE_ALIGN_MASK         (~PAGE_SIZE + 1)
 
-#define BTL_GUARD               (0x5048434DUL)
-
-#define SIGNATURE1              (0xAA55FADE)
-#define SIGNATURE2              (0x55AAC0DE)
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
 
-enum
-{
-    BL_CMD_UNLOCK       = 0xa0,
-    BL_CMD_DATA         = 0xa1,
-    BL_CMD_VERIFY       = 0xa2,
-    BL_CMD_RESET        = 0xa3,
-    BL_CMD_BKSWAP_RESET = 0xa4,
+/* Receive state of one host link. Every link owns its packet buffer so
+ * blocks striped across several links are received in parallel. */
+struct input_link {
+        const BOOTLOADER_TRANSPORT *transport;
+        uint32_t *buffer;
+        uint32_t ptr;
+        uint32_t size;
+        uint32_t length;
+        uint32_t byte_time;
+        uint32_t packet_time;
+        uint8_t  command;
+        bool     header_received;
+        bool     packet_received;
 };
 
-enum
-{
-    BL_RESP_OK          = 0x50,
-    BL_RESP_ERROR       = 0x51,
-    BL_RESP_INVALID     = 0x52,
-    BL_RESP_CRC_OK      = 0x53,
-    BL_RESP_CRC_FAIL    = 0x54,
-};
+#if (BTL_DUAL_UART == 1)
+#define INPUT_LINKS             2
+#else
+#define INPUT_LINKS             1
+#endif
+
+/* Packets are always received in full before they are read, so the
+ * buffers are left out of the startup initialisation */
+static uint32_t input_buffers[INPUT_LINKS][WORDS(PACKET_SIZE)] NO_INIT;
 
-struct binary_header {
-        uint32_t sig1;
-        uint32_t sig2;
-        uint32_t bin_size;
-        uint32_t crc32;
+static struct input_link input_links[INPUT_LINKS] = {
+    { .transport = &BTL_TRANSPORT, .buffer = input_buffers[0] },
+#if (BTL_DUAL_UART == 1)
+    { .transport = &bootloader_Uart2Transport, .buffer = input_buffers[1] },
+#endif
 };
 
-// *****************************************************************************
-// *****************************************************************************
-// Section: Global objects
-// *****************************************************************************
-// *****************************************************************************
+/* Links served, only the first one while bootloader_InstallTasks runs */
+static uint32_t input_link_count = INPUT_LINKS;
 
-static uint32_t input_buffer[WORDS(OFFSET_SIZE + DATA_SIZE)];
+static uint32_t flash_data[WORDS(DATA_SIZE)] NO_INIT;
 
-static uint32_t flash_data[WORDS(DATA_SIZE)];
+/* Receive timeouts of the session in TC0 ticks, 0 for none */
+struct timeouts {
+        uint32_t byte;
+        uint32_t packet;
+        uint32_t session;
+};
+
+static struct timeouts timeouts;
+static uint32_t session_time        = 0;
+static bool     session_active      = false;
 static uint32_t flash_addr          = 0;
 
 static uint32_t unlock_begin        = 0;
 static uint32_t unlock_end          = 0;
 
-static uint8_t  input_command       = 0;
-
-static bool     packet_received     = false;
 static bool     flash_data_ready    = false;
 
+#if (BTL_ENCRYPTION == 1)
+static const uint32_t aes_key[WORDS(AES_KEY_SIZE)] = BTL_ENCRYPTION_KEY;
+
+static uint32_t flash_nonce[WORDS(BTL_NONCE_SIZE)];
+static uint32_t flash_tag[WORDS(BTL_TAG_SIZE)];
+
+static bool     flash_encrypted     = false;
+
+/* Set when a block failed authentication since the last UNLOCK */
+static bool     auth_failed         = false;
+#endif
+
+#if (BTL_CONTAINER == 1)
+/* Set from the manifest of a container until its last segment is in, and
+ * for good once it turned out malformed */
+static bool     stream_failed       = false;
+#endif
+
+#if (BTL_MANIFEST == 1)
+/* Set once BEGIN accepted an image, until the session ends; only a range
+ * starting at its address can be unlocked */
+static bool     manifest_accepted   = false;
+static uint32_t manifest_address    = 0;
+#endif
+
 // *****************************************************************************
 // *****************************************************************************
 // Section: Bootloader Local Functions
@@ -154,148 +187,522 @@ static uint32_t crc_generate(void)
     return crc;
 }
 
-/* Function to receive application firmware via UART/USART */
-static void input_task(void)
+/* Function to open the flash range [begin, end) for programming */
+static bool unlock_range(uint32_t begin, uint32_t end)
 {
-    static uint32_t ptr             = 0;
-    static uint32_t size            = 0;
-    static bool     header_received = false;
-    uint8_t         *byte_buf       = (uint8_t *)&input_buffer[0];
-    uint8_t         input_data      = 0;
+    bool valid = (end > begin && end <= (FLASH_START + FLASH_LENGTH));
+
+#if (BTL_MANIFEST == 1)
+    valid = valid && manifest_accepted && (begin == manifest_address);
+#endif
+
+#if (BTL_SIGNATURE == 1)
+    valid = valid && bootloader_SignatureRangeCheck(begin, end);
+#endif
 
-    if (packet_received == true)
+    if (valid)
     {
-        return;
+        unlock_begin = begin;
+        unlock_end = end;
+#if (BTL_ENCRYPTION == 1)
+        auth_failed = false;
+#endif
+#if (BTL_CONTAINER == 1)
+        stream_failed = false;
+#endif
+    }
+    else
+    {
+        unlock_begin = 0;
+        unlock_end = 0;
+    }
+
+    return valid;
+}
+
+/* Function to compute the crc32 of an image from its start to bin_size,
+ * leaving out the binary header. The DSU takes the word aligned end of the
+ * image while the CPU computes the start, BTL_CRC_CPU_PERCENT of it, and
+ * the leftover bytes; the two parts are joined with crc32_combine(). */
+static uint32_t image_crc(const struct binary_header *hdr)
+{
+    uint32_t start      = APP_START_ADDRESS;
+    uint32_t header     = (uint32_t)(uintptr_t)hdr;
+    uint32_t after      = header + sizeof(struct binary_header);
+    uint32_t end        = start + hdr->bin_size;
+    uint32_t tail       = end & ~3UL;
+    uint32_t split      = (start + ((hdr->bin_size * BTL_CRC_CPU_PERCENT) / 100U) + 3U) & ~3UL;
+    uint32_t dsu_crc    = 0;
+    uint32_t checksum   = 0;
+    bool     dsu        = false;
+
+    if (split < after)
+        split = after;
+
+    if (split < tail)
+    {
+        PAC_PeripheralProtectSetup (PAC_PERIPHERAL_DSU, PAC_PROTECTION_CLEAR);
+
+        dsu = DSU_CRCStart (split, tail - split, 0xffffffff);
+    }
+
+    if (dsu == false)
+    {
+        split = end;
+        tail = end;
     }
 
-    if (SERCOM0_USART_ReceiverIsReady() == false)
+    checksum = crc32(checksum, (const void *)(uintptr_t)start, header - start);
+    checksum = crc32(checksum, (const void *)(uintptr_t)after, split - after);
+
+    if (dsu)
+    {
+        /* The DSU leaves out the final inversion of crc32() */
+        if (DSU_CRCResultGet (&dsu_crc))
+            checksum = crc32_combine(checksum, dsu_crc ^ 0xFFFFFFFFUL, tail - split);
+        else
+            checksum = crc32(checksum, (const void *)(uintptr_t)split, tail - split);
+
+        PAC_PeripheralProtectSetup (PAC_PERIPHERAL_DSU, PAC_PROTECTION_SET);
+    }
+
+    return crc32(checksum, (const void *)(uintptr_t)tail, end - tail);
+}
+
+#if (BTL_MANIFEST == 1)
+/* Function to decide on the manifest of BEGIN from the binary header of
+ * the installed application. Nothing is written to flash. */
+static uint8_t manifest_check(const struct btl_begin_payload *manifest)
+{
+    const struct binary_header *hdr = NULL;
+    const struct binary_header_info *info = NULL;
+    uint32_t hardware   = BTL_HARDWARE_ID;
+    bool     intact     = false;
+
+    manifest_accepted = false;
+
+    if (*(uint32_t *)(APP_START_ADDRESS) != 0xffffffffU)
+        hdr = find_binary_header();
+
+    if (hdr != NULL)
+    {
+        intact = (hdr->bin_size <= (FLASH_LENGTH - APP_START_ADDRESS)) && (image_crc(hdr) == hdr->crc32);
+        info = (const struct binary_header_info *)(hdr + 1);
+
+        if (info->magic != IMAGE_INFO_MAGIC)
+            info = NULL;
+    }
+
+    if ((hardware == 0U) && intact && (info != NULL))
+        hardware = info->hardware;
+
+    if ((hardware != 0U) && (manifest->hardware != hardware))
+        return BL_RESP_INCOMPATIBLE;
+
+    /* The same image is already there and boots */
+    if (intact && (manifest->address == APP_START_ADDRESS) &&
+        (manifest->size == hdr->bin_size) && (manifest->crc == hdr->crc32) &&
+        ((info == NULL) || (manifest->version == info->version)))
+        return BL_RESP_INSTALLED;
+
+    manifest_accepted = true;
+    manifest_address = manifest->address;
+
+    return BL_RESP_OK;
+}
+#endif
+
+/* Function to send a one byte response on the link the command came from */
+static void send_response(struct input_link *link, uint8_t response)
+{
+    link->transport->write(&response, 1);
+}
+
+static uint32_t timeout_ticks(uint32_t us)
+{
+    uint32_t per_ms = TC0_TimerFrequencyGet() / 1000U;
+
+    return ((us / 1000U) * per_ms) + (((us % 1000U) * per_ms) / 1000U);
+}
+
+static bool timeout_is_valid(uint32_t us)
+{
+    return ((us == 0U) || (us >= BTL_TIMEOUT_MIN_US));
+}
+
+static void timeouts_set(uint32_t byte_us, uint32_t packet_us, uint32_t session_us)
+{
+    timeouts.byte       = timeout_ticks(byte_us);
+    timeouts.packet     = timeout_ticks(packet_us);
+    timeouts.session    = timeout_ticks(session_us);
+}
+
+static bool timeout_has_expired(uint32_t now, uint32_t since, uint32_t timeout)
+{
+    return ((timeout != 0U) && ((now - since) >= timeout));
+}
+
+/* Function to drop partially received packets of links which stalled, and
+ * to end a session which stayed idle */
+static void timeout_task(uint32_t now)
+{
+    uint32_t i;
+
+    for (i = 0; i < input_link_count; i++)
+    {
+        struct input_link *link = &input_links[i];
+
+        if ((link->header_received == false) && (link->ptr == 0U))
+        {
+            continue;
+        }
+
+        if (timeout_has_expired(now, link->byte_time, timeouts.byte) ||
+            timeout_has_expired(now, link->packet_time, timeouts.packet))
+        {
+            link->header_received = false;
+            link->ptr = 0;
+        }
+    }
+
+    if (session_active && timeout_has_expired(now, session_time, timeouts.session))
+    {
+        unlock_begin    = 0;
+        unlock_end      = 0;
+        session_active  = false;
+#if (BTL_MANIFEST == 1)
+        manifest_accepted = false;
+#endif
+
+        timeouts_set(BTL_BYTE_TIMEOUT_US, BTL_PACKET_TIMEOUT_US, BTL_SESSION_TIMEOUT_US);
+    }
+}
+
+/* Function to receive application firmware on one link */
+static void link_input_task(struct input_link *link, uint32_t now)
+{
+    uint8_t *byte_buf = (uint8_t *)&link->buffer[0];
+    const struct btl_header *header = (const struct btl_header *)link->buffer;
+
+    if (link->packet_received == true)
     {
         return;
     }
 
-    input_data = SERCOM0_USART_ReadByte();
+    if (link->transport->receiverIsReady() == false)
+    {
+        return;
+    }
 
-    /* Check if 100 ms have elapsed */
-    if (SYSTICK_TimerPeriodHasExpired())
+    if ((link->header_received == false) && (link->ptr == 0U))
     {
-        header_received = false;
+        link->packet_time = now;
     }
 
-    if (header_received == false)
+    link->byte_time = now;
+
+    if (link->header_received == false)
     {
-        byte_buf[ptr++] = input_data;
+        link->ptr += link->transport->read(&byte_buf[link->ptr], BTL_HEADER_SIZE - link->ptr);
 
-        if (ptr == HEADER_SIZE)
+        if (link->ptr == BTL_HEADER_SIZE)
         {
-            if (input_buffer[GUARD_OFFSET] != BTL_GUARD)
+            if (header->guard != BTL_GUARD ||
+                header->size > sizeof(input_buffers[0]))
             {
-                SERCOM0_USART_WriteByte(BL_RESP_ERROR);
+                send_response(link, BL_RESP_ERROR);
             }
             else
             {
-                size            = input_buffer[SIZE_OFFSET];
-                input_command   = (uint8_t)input_buffer[CMD_OFFSET];
-                header_received = true;
+                link->size            = header->size;
+                link->command         = header->command;
+                link->header_received = true;
             }
 
-            ptr = 0;
+            link->ptr = 0;
         }
     }
-    else if (header_received == true)
+    else if (link->ptr < link->size)
     {
-        if (ptr < size)
-        {
-            byte_buf[ptr++] = input_data;
-        }
+        link->ptr += link->transport->read(&byte_buf[link->ptr], link->size - link->ptr);
+    }
 
-        if (ptr == size)
-        {
-            ptr = 0;
-            size = 0;
-            packet_received = true;
-            header_received = false;
-        }
+    if (link->header_received == true && link->ptr == link->size)
+    {
+        link->ptr = 0;
+        link->length = link->size;
+        link->size = 0;
+        link->packet_received = true;
+        link->header_received = false;
+
+        session_time = now;
+        session_active = true;
+    }
+}
+
+/* Function to receive application firmware via the selected transports */
+static void input_task(void)
+{
+    uint32_t now = TC0_Timer32bitCounterGet();
+    uint32_t i;
+
+    for (i = 0; i < input_link_count; i++)
+    {
+        link_input_task(&input_links[i], now);
     }
 
-    SYSTICK_TimerRestart();
+    timeout_task(now);
 }
 
-/* Function to process the received command */
-static void command_task(void)
+#if (BTL_CONTAINER == 1)
+static uint8_t stream_task(const struct btl_stream_payload *payload, uint32_t size);
+#endif
+
+#if (BTL_FEC == 1)
+static uint8_t fec_task(const struct btl_fec_data_payload *payload, uint32_t size);
+#endif
+
+/* Function to process the command received on a link */
+static void command_task(struct input_link *link)
 {
+    uint32_t *input_buffer = link->buffer;
+    uint8_t  input_command = link->command;
     uint32_t i;
 
     if (BL_CMD_UNLOCK == input_command)
     {
-        uint32_t begin  = (input_buffer[ADDR_OFFSET] & OFFSET_ALIGN_MASK);
+        const struct btl_unlock_payload *unlock = (const struct btl_unlock_payload *)input_buffer;
+
+        uint32_t begin  = (unlock->address & OFFSET_ALIGN_MASK);
 
-        uint32_t end    = begin + (input_buffer[SIZE_OFFSET] & SIZE_ALIGN_MASK);
+        uint32_t end    = begin + (unlock->size & SIZE_ALIGN_MASK);
 
-        if (end > begin && end <= (FLASH_START + FLASH_LENGTH))
+        if (unlock_range(begin, end))
+            send_response(link, BL_RESP_OK);
+        else
+            send_response(link, BL_RESP_ERROR);
+    }
+    else if (BL_CMD_DATA == input_command)
+    {
+        const struct btl_data_payload *data = (const struct btl_data_payload *)input_buffer;
+
+        flash_addr = (data->address & OFFSET_ALIGN_MASK);
+
+        if (unlock_begin <= flash_addr && flash_addr < unlock_end)
         {
-            unlock_begin = begin;
-            unlock_end = end;
-            SERCOM0_USART_WriteByte(BL_RESP_OK);
+            for (i = 0; i < WORDS(DATA_SIZE); i++)
+                flash_data[i] = data->block[i];
+
+            flash_data_ready = true;
+
+            send_response(link, BL_RESP_OK);
         }
         else
         {
-            unlock_begin = 0;
-            unlock_end = 0;
-            SERCOM0_USART_WriteByte(BL_RESP_ERROR);
+            send_response(link, BL_RESP_ERROR);
         }
     }
-    else if (BL_CMD_DATA == input_command)
+#if (BTL_ENCRYPTION == 1)
+    else if (BL_CMD_ENC_DATA == input_command)
     {
-        flash_addr = (input_buffer[ADDR_OFFSET] & OFFSET_ALIGN_MASK);
+        const struct btl_enc_data_payload *data = (const struct btl_enc_data_payload *)input_buffer;
+
+        flash_addr = (data->address & OFFSET_ALIGN_MASK);
 
         if (unlock_begin <= flash_addr && flash_addr < unlock_end)
         {
+            for (i = 0; i < WORDS(BTL_NONCE_SIZE); i++)
+                flash_nonce[i] = data->nonce[i];
+
+            for (i = 0; i < WORDS(BTL_TAG_SIZE); i++)
+                flash_tag[i] = data->tag[i];
+
             for (i = 0; i < WORDS(DATA_SIZE); i++)
-                flash_data[i] = input_buffer[i + DATA_OFFSET];
+                flash_data[i] = data->block[i];
 
+            /* Decrypted by flash_task, so the next block is already
+             * received meanwhile */
+            flash_encrypted = true;
             flash_data_ready = true;
 
-            SERCOM0_USART_WriteByte(BL_RESP_OK);
+            send_response(link, BL_RESP_OK);
         }
         else
         {
-            SERCOM0_USART_WriteByte(BL_RESP_ERROR);
+            send_response(link, BL_RESP_ERROR);
+        }
+    }
+#endif
+#if (BTL_CONTAINER == 1)
+    else if (BL_CMD_STREAM == input_command)
+    {
+        send_response(link, stream_task((const struct btl_stream_payload *)input_buffer, link->length));
+    }
+#endif
+#if (BTL_FEC == 1)
+    else if (BL_CMD_FEC_DATA == input_command)
+    {
+        send_response(link, fec_task((const struct btl_fec_data_payload *)input_buffer, link->length));
+    }
+#endif
+#if (BTL_PARTITIONS == 1)
+    else if (BL_CMD_PARTITION == input_command)
+    {
+        const struct btl_partition_payload *partition = (const struct btl_partition_payload *)input_buffer;
+        uint32_t begin  = 0;
+        uint32_t size   = 0;
+        uint32_t length = (partition->size & SIZE_ALIGN_MASK);
+        bool     valid  = bootloader_PartitionFind(partition->id, &begin, &size);
+
+        /* A session inside the partition, from its start */
+        valid = valid && (length <= size) && unlock_range(begin, begin + length);
+
+        if (valid)
+            send_response(link, BL_RESP_OK);
+        else
+            send_response(link, BL_RESP_ERROR);
+    }
+#endif
+#if (BTL_MANIFEST == 1)
+    else if (BL_CMD_BEGIN == input_command)
+    {
+        if (link->length == BTL_BEGIN_PAYLOAD_SIZE)
+            send_response(link, manifest_check((const struct btl_begin_payload *)input_buffer));
+        else
+            send_response(link, BL_RESP_ERROR);
+    }
+#endif
+#if (BTL_SELF_UPDATE == 1)
+    else if (BL_CMD_SELF_UPDATE == input_command)
+    {
+        const struct btl_self_update_payload *update = (const struct btl_self_update_payload *)input_buffer;
+
+        if ((link->length != BTL_SELF_UPDATE_PAYLOAD_SIZE) ||
+            (bootloader_SelfUpdateCheck(update->address, update->crc) == false))
+            send_response(link, BL_RESP_ERROR);
+        else if (bootloader_SelfUpdate(update->address, update->crc))
+            send_response(link, BL_RESP_CRC_OK);
+        else
+            send_response(link, BL_RESP_CRC_FAIL);
+    }
+#endif
+    else if (BL_CMD_TIMEOUTS == input_command)
+    {
+        const struct btl_timeouts_payload *timeouts = (const struct btl_timeouts_payload *)input_buffer;
+
+        if ((link->length == BTL_TIMEOUTS_PAYLOAD_SIZE) && timeout_is_valid(timeouts->byte_us) &&
+            timeout_is_valid(timeouts->packet_us) && timeout_is_valid(timeouts->session_us))
+        {
+            timeouts_set(timeouts->byte_us, timeouts->packet_us, timeouts->session_us);
+
+            send_response(link, BL_RESP_OK);
+        }
+        else
+        {
+            send_response(link, BL_RESP_ERROR);
         }
     }
     else if (BL_CMD_VERIFY == input_command)
     {
-        uint32_t crc        = input_buffer[CRC_OFFSET];
+        uint32_t crc        = ((const struct btl_verify_payload *)input_buffer)->crc;
         uint32_t crc_gen    = 0;
+        bool     crc_ok;
 
         crc_gen = crc_generate();
+        crc_ok  = (crc == crc_gen);
+
+#if (BTL_ENCRYPTION == 1)
+        /* A block which failed authentication was never programmed */
+        crc_ok  = crc_ok && (auth_failed == false);
+#endif
+
+#if (BTL_CONTAINER == 1)
+        /* Also fails for a container still missing segments */
+        crc_ok  = crc_ok && (stream_failed == false);
+#endif
 
-        if (crc == crc_gen)
-            SERCOM0_USART_WriteByte(BL_RESP_CRC_OK);
+#if (BTL_PARTITIONS == 1)
+        /* The table records what the session left in its partitions */
+        if (crc_ok)
+            bootloader_PartitionUpdate(unlock_begin, unlock_end);
+#endif
+
+        if (crc_ok)
+            send_response(link, BL_RESP_CRC_OK);
         else
-            SERCOM0_USART_WriteByte(BL_RESP_CRC_FAIL);
+            send_response(link, BL_RESP_CRC_FAIL);
+    }
+    else if (BL_CMD_BIT_RATE == input_command)
+    {
+        if (link->length == BTL_BIT_RATE_PAYLOAD_SIZE)
+        {
+            /* Answered at the old rate, linkSetup waits for it to leave */
+            send_response(link, BL_RESP_OK);
+
+            link->transport->linkSetup(((const struct btl_bit_rate_payload *)input_buffer)->bit_rate);
+        }
+        else
+        {
+            send_response(link, BL_RESP_ERROR);
+        }
     }
     else if (BL_CMD_BKSWAP_RESET == input_command)
     {
-        SERCOM0_USART_WriteByte(BL_RESP_OK);
+        send_response(link, BL_RESP_OK);
 
-        while(SERCOM0_USART_TransmitComplete() == false);
+        link->transport->flush();
 
         NVMCTRL_BankSwap();
     }
     else if (BL_CMD_RESET == input_command)
     {
-        SERCOM0_USART_WriteByte(BL_RESP_OK);
+        send_response(link, BL_RESP_OK);
 
-        while(SERCOM0_USART_TransmitComplete() == false);
+        link->transport->flush();
 
         NVIC_SystemReset();
     }
     else
     {
-        SERCOM0_USART_WriteByte(BL_RESP_INVALID);
+        send_response(link, BL_RESP_INVALID);
     }
 
-    packet_received = false;
+    link->packet_received = false;
+}
+
+#if (BTL_ENCRYPTION == 1)
+/* Function to decrypt an encrypted block in place and check its tag, the
+ * links are served between chunks */
+static bool decrypt_task(void)
+{
+    uint32_t i;
+
+    AES_GcmStart(aes_key, flash_nonce, &flash_addr, sizeof(flash_addr));
+
+    for (i = 0; i < WORDS(DATA_SIZE); i += WORDS(DECRYPT_CHUNK_SIZE))
+    {
+        AES_GcmDecrypt(&flash_data[i], DECRYPT_CHUNK_SIZE);
+
+        input_task();
+    }
+
+    flash_encrypted = false;
+
+    return AES_GcmTagCheck(flash_tag);
+}
+#endif
+
+static bool page_is_blank(const uint32_t *page)
+{
+    uint32_t i;
+
+    for (i = 0; i < WORDS(PAGE_SIZE); i++)
+    {
+        if (page[i] != 0xFFFFFFFFUL)
+            return false;
+    }
+
+    return true;
 }
 
 /* Function to program received application firmware data into internal flash */
@@ -305,6 +712,21 @@ static void flash_task(void)
     uint32_t page       = 0;
     uint32_t write_idx  = 0;
 
+#if (BTL_ENCRYPTION == 1)
+    /* Nothing is erased for a block which fails authentication */
+    if ((flash_encrypted == true) && (decrypt_task() == false))
+    {
+        auth_failed = true;
+        flash_data_ready = false;
+        return;
+    }
+#endif
+
+#if (BTL_SIGNATURE == 1)
+    /* The bank has to be verified again */
+    bootloader_SignatureInvalidate(addr);
+#endif
+
     // Lock region size is always bigger than the row size
     NVMCTRL_RegionUnlock(addr);
 
@@ -320,10 +742,14 @@ static void flash_task(void)
 
     for (page = 0; page < PAGES_IN_ERASE_BLOCK; page++)
     {
-        NVMCTRL_PageWrite(&flash_data[write_idx], addr);
+        /* The erase already left blank pages, e.g. padding, as they are */
+        if (page_is_blank(&flash_data[write_idx]) == false)
+        {
+            NVMCTRL_PageWrite(&flash_data[write_idx], addr);
 
-        while(NVMCTRL_IsBusy() == true)
-            input_task();
+            while(NVMCTRL_IsBusy() == true)
+                input_task();
+        }
 
         addr += PAGE_SIZE;
         write_idx += WORDS(PAGE_SIZE);
@@ -332,6 +758,125 @@ static void flash_task(void)
     flash_data_ready = false;
 }
 
+#if (BTL_CONTAINER == 1)
+/* Function to decode a piece of an update container. Every erase block is
+ * programmed as soon as it is complete, so a piece of compressed data can
+ * fill several. */
+static uint8_t stream_task(const struct btl_stream_payload *payload, uint32_t size)
+{
+    const uint8_t *data = payload->piece;
+    uint32_t offset     = payload->offset;
+    uint32_t used       = 0;
+    BTL_CONTAINER_RESULT result;
+
+    if (size < sizeof(*payload))
+        return BL_RESP_ERROR;
+
+    size -= sizeof(*payload);
+
+    if (offset == 0U)
+    {
+        bootloader_ContainerInitialize(flash_data);
+    }
+    else if ((offset + size) <= bootloader_ContainerPosition())
+    {
+        /* Sent again, the response got lost */
+        return BL_RESP_OK;
+    }
+    else if (offset != bootloader_ContainerPosition())
+    {
+        return BL_RESP_ERROR;
+    }
+
+    do
+    {
+        result = bootloader_ContainerWrite(data, size, &used);
+
+        data += used;
+        size -= used;
+
+        if (result == BTL_CONTAINER_MANIFEST)
+        {
+            const struct btl_container_manifest *manifest = bootloader_ContainerManifest();
+
+            if (unlock_range(manifest->begin, manifest->end) == false)
+                result = BTL_CONTAINER_ERROR;
+
+            stream_failed = true;
+        }
+        else if (result == BTL_CONTAINER_BLOCK)
+        {
+            flash_addr = bootloader_ContainerBlockAddress();
+            flash_data_ready = true;
+
+            flash_task();
+        }
+        else if (result == BTL_CONTAINER_DONE)
+        {
+            stream_failed = false;
+        }
+    } while ((result == BTL_CONTAINER_MANIFEST) || (result == BTL_CONTAINER_BLOCK));
+
+    if (result == BTL_CONTAINER_ERROR)
+    {
+        stream_failed = true;
+        return BL_RESP_ERROR;
+    }
+
+    return BL_RESP_OK;
+}
+#endif
+
+#if (BTL_FEC == 1)
+/* Function to correct a block received as Reed-Solomon codewords and hand
+ * it to flash_task. The links are served between codewords. */
+static uint8_t fec_task(const struct btl_fec_data_payload *payload, uint32_t size)
+{
+    const uint8_t *data = payload->codewords;
+    uint8_t  *block     = (uint8_t *)flash_data;
+    uint8_t  codeword[BTL_FEC_CODEWORD_SIZE];
+    uint32_t address    = 0;
+    uint32_t message    = 0;
+    struct btl_fec_layout layout;
+    uint32_t i;
+    uint32_t j;
+
+    if (bootloader_FecLayout(size, &layout) == false)
+        return BL_RESP_ERROR;
+
+    for (i = 0; i < layout.codewords; i++)
+    {
+        if (bootloader_FecDecode(data, &layout, i, codeword) == false)
+            return BL_RESP_FEC_FAIL;
+
+        for (j = 0; j < (layout.length - layout.parity); j++, message++)
+        {
+            if (message < sizeof(address))
+                address |= (uint32_t)codeword[j] << (8U * message);
+            else if (message < BTL_FEC_MESSAGE_SIZE)
+                block[message - sizeof(address)] = codeword[j];
+            else if (codeword[j] != 0U)
+                return BL_RESP_FEC_FAIL;
+        }
+
+        input_task();
+    }
+
+    /* The address in clear has to match the corrected one */
+    if (address != payload->address)
+        return BL_RESP_FEC_FAIL;
+
+    flash_addr = (address & OFFSET_ALIGN_MASK);
+
+    if ((flash_addr < unlock_begin) || (flash_addr >= unlock_end))
+        return BL_RESP_ERROR;
+
+    flash_data_ready = true;
+
+    return BL_RESP_OK;
+}
+#endif
+
 unsigned long crc32(unsigned long inCrc32, const void *buf, size_t bufLen) {
         static const unsigned long crcTable[256] = {
          0x00000000,0x77073096,0xEE0E612C,0x990951BA,0x076DC419,0x706AF48F,0xE963A535,
@@ -385,6 +930,49 @@ unsigned long crc32(unsigned long inCrc32, const void *buf, size_t bufLen) {
         return crc32 ^ 0xFFFFFFFF;
 }
 
+/* x^(2^n) modulo the CRC-32 polynomial, bit reversed like the CRC */
+static const uint32_t crc32_x2n[32] = {
+    0x40000000, 0x20000000, 0x08000000, 0x00800000, 0x00008000, 0xEDB88320,
+    0xB1E6B092, 0xA06A2517, 0xED627DAE, 0x88D14467, 0xD7BBFE6A, 0xEC447F11,
+    0x8E7EA170, 0x6427800E, 0x4D47BAE0, 0x09FE548F, 0x83852D0F, 0x30362F1A,
+    0x7B5A9CC3, 0x31FEC169, 0x9FEC022A, 0x6C8DEDC4, 0x15D6874D, 0x5FDE7A4E,
+    0xBAD90E37, 0x2E4E5EEF, 0x4EABA214, 0xA8A472C0, 0x429A969E, 0x148D302A,
+    0xC40BA6D0, 0xC4E22C3C
+};
+
+/* Product of two polynomials modulo the CRC-32 polynomial, in GF(2) */
+static uint32_t crc32_multiply(uint32_t a, uint32_t b)
+{
+    uint32_t m = 0x80000000UL;
+    uint32_t p = 0;
+
+    while (m != 0U)
+    {
+        if ((a & m) != 0U)
+            p ^= b;
+
+        m >>= 1;
+        b = ((b & 1U) != 0U) ? ((b >> 1) ^ 0xEDB88320UL) : (b >> 1);
+    }
+
+    return p;
+}
+
+unsigned long crc32_combine(unsigned long crc1, unsigned long crc2, size_t len2)
+{
+    uint32_t shift = 0x80000000UL;
+    uint32_t n;
+
+    /* crc1 moved past len2 zero bytes: multiplied by x^(8 len2) */
+    for (n = 3; len2 != 0U; len2 >>= 1, n++)
+    {
+        if ((len2 & 1U) != 0U)
+            shift = crc32_multiply(crc32_x2n[n & 31U], shift);
+    }
+
+    return crc32_multiply(shift, (uint32_t)crc1) ^ (uint32_t)crc2;
+}
+
 /* binary header must be located somewhere within the first 8k of application
  * firmware */
 struct binary_header *find_binary_header(void)
@@ -443,12 +1031,10 @@ void run_Application(void)
     uint32_t msp            = *(uint32_t *)(APP_START_ADDRESS);
     uint32_t reset_vector   = *(uint32_t *)(APP_START_ADDRESS + 4);
 
-    uint8_t *start;
-    uint8_t *end;
     struct binary_header *hdr;
-    uint8_t *tmp;
     uint32_t checksum = 0;
     uint16_t nvm_status;
+    bool valid;
 
     if (msp == 0xffffffff)
     {
@@ -462,15 +1048,9 @@ void run_Application(void)
     if (!(hdr = find_binary_header())) {
         return;
     }
-    start = (uint8_t *)(APP_START_ADDRESS);
-    end = start + hdr->bin_size;
-    tmp = (uint8_t *)hdr;
-    
-    /* compute the initial checksum, skip the header and continue computing the 
-     * checksum until we are done with the entire firmware. */
-    checksum = crc32(checksum, start, (size_t)(tmp - start));
-    tmp = tmp + sizeof(struct binary_header);
-    checksum = crc32(checksum, tmp, (size_t)(end - tmp));
+
+    /* compute the checksum of the entire firmware, skipping the header */
+    checksum = image_crc(hdr);
    
 #if 0
     static char const checksum_computed[] = "computed checksum is: ";
@@ -490,9 +1070,26 @@ void run_Application(void)
     }
 #endif
 
+    valid = (checksum == hdr->crc32);
+
+#if (BTL_SIGNATURE == 1)
+    /* only the first boot of a new image checks its signature */
+    valid = valid && bootloader_SignatureVerify(hdr->bin_size, checksum);
+#endif
+
+#if (BTL_PARTITIONS == 1)
+    /* code partitions besides the application have to match the table */
+    valid = valid && bootloader_PartitionsVerify();
+#endif
+
+#if (BTL_QSPI_XIP == 1)
+    /* the part executing from QSPI flash has to come with this image */
+    valid = valid && bootloader_XipInitialize(checksum);
+#endif
+
     /* now we compare if checksums match. if they do, continue with the 
      * rest of normal bootup process. */
-    if (checksum != hdr->crc32) {
+    if (valid == false) {
         /* if they don't match, then we see if we can bootup failsafe firmware. 
          * if we are booting from copy A (BankA), then switch to copy B (BankB)
          */
@@ -514,9 +1111,87 @@ void run_Application(void)
     }
     
     __set_MSP(msp);
+#if defined(__unix__)
+    /* A host build never starts the application */
+    (void)reset_vector;
+#else
     asm("bx %0"::"r" (reset_vector));
+#endif
 }
 
+#if (BTL_LOW_POWER == 1)
+/* Function to sleep until the next byte when every link waits for a new
+ * packet. The receive interrupts only serve as wake-up events: they are
+ * enabled with interrupts disabled and cleared again before interrupts
+ * are restored, so no handler ever runs. */
+static void idle_task(void)
+{
+    uint32_t i;
+    bool state;
+
+    /* Partial packets and idle sessions rely on timeout_task, which does
+     * not run while the core sleeps */
+    if (session_active && (timeouts.session != 0U))
+    {
+        return;
+    }
+
+    for (i = 0; i < input_link_count; i++)
+    {
+        const struct input_link *link = &input_links[i];
+
+        if ((link->transport->wakeSetup == NULL) ||
+            (link->packet_received == true) ||
+            (link->header_received == true) || (link->ptr != 0U) ||
+            (link->transport->receiverIsReady() == true))
+        {
+            return;
+        }
+    }
+
+    state = NVIC_INT_Disable();
+
+    for (i = 0; i < input_link_count; i++)
+    {
+        input_links[i].transport->wakeSetup(true);
+    }
+
+#if (BTL_LOW_POWER_CPUDIV > 1U)
+    MCLK_REGS->MCLK_INTFLAG = MCLK_INTFLAG_CKRDY_Msk;
+    MCLK_REGS->MCLK_CPUDIV = MCLK_CPUDIV_DIV(BTL_LOW_POWER_CPUDIV);
+#endif
+
+#ifdef BTL_LOW_POWER_PIN
+    PORT_PinWrite(BTL_LOW_POWER_PIN, true);
+#endif
+
+    /* A byte received since the check above leaves the interrupt pending
+     * and WFI returns at once */
+    PM_IdleModeEnter();
+
+#ifdef BTL_LOW_POWER_PIN
+    PORT_PinWrite(BTL_LOW_POWER_PIN, false);
+#endif
+
+#if (BTL_LOW_POWER_CPUDIV > 1U)
+    MCLK_REGS->MCLK_INTFLAG = MCLK_INTFLAG_CKRDY_Msk;
+    MCLK_REGS->MCLK_CPUDIV = MCLK_CPUDIV_DIV(0x01);
+
+    while ((MCLK_REGS->MCLK_INTFLAG & MCLK_INTFLAG_CKRDY_Msk) != MCLK_INTFLAG_CKRDY_Msk)
+    {
+        /* Wait for the main clock to be ready */
+    }
+#endif
+
+    for (i = 0; i < input_link_count; i++)
+    {
+        input_links[i].transport->wakeSetup(false);
+    }
+
+    NVIC_INT_Restore(state);
+}
+#endif
+
 /* bootloading algorithm:
  * 
  * the bootloader first checks if there is an actual firmware to load in offset
@@ -553,13 +1228,49 @@ bool __WEAK bootloader_Trigger(void)
 
 void bootloader_Tasks(void)
 {
+    uint32_t link = 0;
+
+    /* SysTick is left to the transports */
+    SYSTICK_TimerStart();
+
+    TC0_TimerStart();
+
+    timeouts_set(BTL_BYTE_TIMEOUT_US, BTL_PACKET_TIMEOUT_US, BTL_SESSION_TIMEOUT_US);
+
+#ifdef BTL_LOW_POWER_PIN
+    PORT_PinGPIOConfig(BTL_LOW_POWER_PIN);
+    PORT_PinWrite(BTL_LOW_POWER_PIN, false);
+    PORT_PinOutputEnable(BTL_LOW_POWER_PIN);
+#endif
+
     while (1)
     {
         input_task();
 
         if (flash_data_ready)
+        {
             flash_task();
-        else if (packet_received)
-            command_task();
+        }
+        else
+        {
+            /* Serve the links round robin so a busy link can not starve
+             * the other one */
+            link = (link + 1) % input_link_count;
+
+            if (input_links[link].packet_received)
+                command_task(&input_links[link]);
+#if (BTL_LOW_POWER == 1)
+            else
+                idle_task();
+#endif
+        }
     }
 }
+
+void bootloader_InstallTasks(const BOOTLOADER_TRANSPORT *transport)
+{
+    input_links[0].transport    = transport;
+    input_link_count            = 1;
+
+    bootloader_Tasks();
+}
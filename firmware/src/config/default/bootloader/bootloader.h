@@ -41,6 +41,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 
 #define BTL_TRIGGER_RAM_START   0x20000000
@@ -50,6 +51,37 @@
 #define TRIGGER_SIGNATURE0      0x7fa5a57f
 #define TRIGGER_SIGNATURE1      ~(TRIGGER_SIGNATURE0)
 
+/* Image header, placed on a word boundary in the first erase block of the
+ * application. crc32 covers the image from its start to bin_size without
+ * the header itself. */
+#define SIGNATURE1              (0xAA55FADE)
+#define SIGNATURE2              (0x55AAC0DE)
+
+struct binary_header {
+        uint32_t sig1;
+        uint32_t sig2;
+        uint32_t bin_size;
+        uint32_t crc32;
+};
+
+/* Optional image information, directly after the binary header and
+ * covered by its crc32. BEGIN compares the manifest of a new image with
+ * it, see BTL_MANIFEST. */
+#define IMAGE_INFO_MAGIC        (0x4F464E49)
+
+struct binary_header_info {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t hardware;
+};
+
+/* Signed images, BTL_SIGNATURE: ECDSA P-256 over the SHA-256 digest of the
+ * bin_size bytes of the image, header included, stored as r then s, big
+ * endian, on the first word boundary past them. */
+#define BTL_SIGNATURE_SIZE      64U
+
+#define BTL_SIGNATURE_OFFSET(bin_size)  (((bin_size) + 3U) & ~3U)
+
 
 // *****************************************************************************
 /* Function:
@@ -197,4 +229,153 @@ void run_Application( void );
 */
 void bootloader_Tasks( void );
 
+// *****************************************************************************
+/* Function:
+    unsigned long crc32( unsigned long inCrc32, const void *buf, size_t bufLen );
+
+ Summary:
+    Accumulates the standard (zlib) CRC-32 of a buffer.
+
+ Description:
+    Pass 0 for the first buffer and the previous result for the following
+    ones. The result XORed with 0xFFFFFFFF is what the DSU computes over the
+    same bytes with a 0xFFFFFFFF seed.
+*/
+unsigned long crc32( unsigned long inCrc32, const void *buf, size_t bufLen );
+
+// *****************************************************************************
+/* Function:
+    unsigned long crc32_combine( unsigned long crc1, unsigned long crc2, size_t len2 );
+
+ Summary:
+    Joins the crc32() of two consecutive buffers.
+
+ Description:
+    crc1 is the crc32() of the first buffer, crc2 the one of the second
+    buffer of len2 bytes, each started from 0. Returns the crc32() of both
+    buffers back to back, in time logarithmic in len2, so two engines can
+    checksum the parts of an image at the same time.
+*/
+unsigned long crc32_combine( unsigned long crc1, unsigned long crc2, size_t len2 );
+
+// *****************************************************************************
+/* Function:
+    struct binary_header *find_binary_header( void );
+
+ Summary:
+    Finds the binary header of the application.
+
+ Description:
+    Searches the first erase block of the application for the header
+    signatures on word boundaries. Returns NULL if there is none.
+*/
+struct binary_header *find_binary_header( void );
+
+// *****************************************************************************
+/* Function:
+    bool bootloader_XipInitialize( uint32_t app_crc32 );
+
+ Summary:
+    Prepares the part of the application executing from QSPI flash.
+
+ Description:
+    Checks the header of the external part against the crc32 of the internal
+    image's binary header, then leaves the QSPI mapped for execution in place
+    and the CMCC enabled. Returns false, with the QSPI released, if the
+    external part is missing or belongs to another image. Only built with
+    BTL_QSPI_XIP, see bootloader_xip.h.
+*/
+bool bootloader_XipInitialize( uint32_t app_crc32 );
+
+// *****************************************************************************
+/* Function:
+    bool bootloader_SignatureVerify( uint32_t bin_size, uint32_t app_crc32 );
+
+ Summary:
+    Checks the signature of the application image.
+
+ Description:
+    Called once the image passed its CRC check. The first boot of a new
+    image computes its digest and verifies the signature following it; the
+    result is remembered with the image's size and crc32 so later boots
+    return at once. Returns false for an unsigned image, one signed with
+    another key or one too large to leave room for the signature. Only
+    built with BTL_SIGNATURE.
+*/
+bool bootloader_SignatureVerify( uint32_t bin_size, uint32_t app_crc32 );
+
+// *****************************************************************************
+/* Function:
+    void bootloader_SignatureInvalidate( uint32_t address );
+
+ Summary:
+    Forgets the verified image of the bank containing address.
+
+ Description:
+    Called before any erase block is programmed, so a changed image is
+    verified again. Only built with BTL_SIGNATURE.
+*/
+void bootloader_SignatureInvalidate( uint32_t address );
+
+// *****************************************************************************
+/* Function:
+    bool bootloader_SignatureRangeCheck( uint32_t begin, uint32_t end );
+
+ Summary:
+    Tells if a flash range may be unlocked for programming.
+
+ Description:
+    Returns false if the range covers the record of the verified image of
+    either bank, which only the bootloader itself writes. Only built with
+    BTL_SIGNATURE.
+*/
+bool bootloader_SignatureRangeCheck( uint32_t begin, uint32_t end );
+
+// *****************************************************************************
+/* Function:
+    bool bootloader_SelfUpdateCheck( uint32_t address, uint32_t crc );
+
+ Summary:
+    Checks a bootloader staged in the application area.
+
+ Description:
+    Returns true if address is an erase block of the application area of
+    the running bank whose vector table points into RAM and the boot block,
+    and whose CRC as the DSU computes it is crc. Only built with BTL_SELF_UPDATE.
+*/
+bool bootloader_SelfUpdateCheck( uint32_t address, uint32_t crc );
+
+// *****************************************************************************
+/* Function:
+    bool bootloader_SelfUpdate( uint32_t address, uint32_t crc );
+
+ Summary:
+    Writes the staged bootloader to the inactive bank.
+
+ Description:
+    Call after bootloader_SelfUpdateCheck passed. Copies the application
+    area of the running bank and the staged bootloader into the inactive
+    bank, in up to BTL_SELF_UPDATE_TRIES tries each waiting out a brown-out
+    first, and returns true once its block 0 has the CRC crc and its
+    application area that of the running one. The running bank is not
+    written; the new bootloader starts with the next bank swap. Only built
+    with BTL_SELF_UPDATE.
+*/
+bool bootloader_SelfUpdate( uint32_t address, uint32_t crc );
+
+// *****************************************************************************
+/* Function:
+    void bootloader_SelfUpdateSync( void );
+
+ Summary:
+    Copies the running bootloader to block 0 of the inactive bank.
+
+ Description:
+    Called at boot. Does nothing when the block already holds the running
+    bootloader, else rewrites it, so a bank swap never starts an older
+    bootloader and an update cut off before its swap is undone. Only built
+    with BTL_SELF_UPDATE.
+*/
+void bootloader_SelfUpdateSync( void );
+
 #endif
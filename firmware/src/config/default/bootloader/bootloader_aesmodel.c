@@ -0,0 +1,331 @@
+/*******************************************************************************
+  AES Software Model Source File
+
+  File Name:
+    bootloader_aesmodel.c
+
+  Summary:
+    This file contains a software implementation of the AES peripheral
+    library calls used for encrypted DATA blocks.
+
+  Description:
+    This backend is only used when the protocol engine is built for a Linux
+    host with BTL_ENCRYPTION. It is a plain byte oriented AES-128 and GHASH
+    following FIPS 197 and NIST SP 800-38D, written for clarity rather than
+    speed, and gives the same results as the peripheral for the same calls.
+    Blocks encrypted by tools/btl_host.py are decrypted and authenticated
+    with it end to end.
+
+    It is not part of the MPLAB X project.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#if defined(__unix__)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "peripheral/aes/plib_aes.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define AESMODEL_ROUNDS         10U
+
+static const uint8_t aesmodel_sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+/* Expanded key, one 16 byte round key per round and the initial one */
+static uint8_t  aesmodel_keys[(AESMODEL_ROUNDS + 1U) * AES_BLOCK_SIZE];
+
+static uint8_t  aesmodel_h[AES_BLOCK_SIZE];
+static uint8_t  aesmodel_ghash[AES_BLOCK_SIZE];
+static uint8_t  aesmodel_j0[AES_BLOCK_SIZE];
+static uint8_t  aesmodel_counter[AES_BLOCK_SIZE];
+
+static uint64_t aesmodel_aad_bits;
+static uint64_t aesmodel_data_bits;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static uint8_t aesmodel_xtime(uint8_t x)
+{
+    return (uint8_t)((x << 1) ^ (((x >> 7) & 1U) * 0x1bU));
+}
+
+static void aesmodel_key_expand(const uint8_t *key)
+{
+    uint8_t rcon = 0x01U;
+    uint8_t t[4];
+    uint32_t i;
+
+    memcpy(aesmodel_keys, key, AES_KEY_SIZE);
+
+    for (i = AES_KEY_SIZE; i < sizeof(aesmodel_keys); i += 4U)
+    {
+        memcpy(t, &aesmodel_keys[i - 4U], 4U);
+
+        if ((i % AES_KEY_SIZE) == 0U)
+        {
+            uint8_t first = t[0];
+
+            t[0] = (uint8_t)(aesmodel_sbox[t[1]] ^ rcon);
+            t[1] = aesmodel_sbox[t[2]];
+            t[2] = aesmodel_sbox[t[3]];
+            t[3] = aesmodel_sbox[first];
+
+            rcon = aesmodel_xtime(rcon);
+        }
+
+        aesmodel_keys[i + 0U] = aesmodel_keys[i - AES_KEY_SIZE + 0U] ^ t[0];
+        aesmodel_keys[i + 1U] = aesmodel_keys[i - AES_KEY_SIZE + 1U] ^ t[1];
+        aesmodel_keys[i + 2U] = aesmodel_keys[i - AES_KEY_SIZE + 2U] ^ t[2];
+        aesmodel_keys[i + 3U] = aesmodel_keys[i - AES_KEY_SIZE + 3U] ^ t[3];
+    }
+}
+
+/* The state is kept column by column, like the input bytes */
+static void aesmodel_encrypt(const uint8_t *in, uint8_t *out)
+{
+    uint8_t s[AES_BLOCK_SIZE];
+    uint8_t t[AES_BLOCK_SIZE];
+    uint32_t round;
+    uint32_t c;
+    uint32_t i;
+
+    for (i = 0; i < AES_BLOCK_SIZE; i++)
+    {
+        s[i] = in[i] ^ aesmodel_keys[i];
+    }
+
+    for (round = 1; round <= AESMODEL_ROUNDS; round++)
+    {
+        /* SubBytes and ShiftRows, row r moves r columns to the left */
+        for (i = 0; i < AES_BLOCK_SIZE; i++)
+        {
+            t[i] = aesmodel_sbox[s[(i + 4U * (i % 4U)) % AES_BLOCK_SIZE]];
+        }
+
+        /* MixColumns, skipped in the last round */
+        for (c = 0; (c < AES_BLOCK_SIZE) && (round != AESMODEL_ROUNDS); c += 4U)
+        {
+            uint8_t a0 = t[c], a1 = t[c + 1U], a2 = t[c + 2U], a3 = t[c + 3U];
+            uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+
+            t[c + 0U] = a0 ^ all ^ aesmodel_xtime(a0 ^ a1);
+            t[c + 1U] = a1 ^ all ^ aesmodel_xtime(a1 ^ a2);
+            t[c + 2U] = a2 ^ all ^ aesmodel_xtime(a2 ^ a3);
+            t[c + 3U] = a3 ^ all ^ aesmodel_xtime(a3 ^ a0);
+        }
+
+        for (i = 0; i < AES_BLOCK_SIZE; i++)
+        {
+            s[i] = t[i] ^ aesmodel_keys[(round * AES_BLOCK_SIZE) + i];
+        }
+    }
+
+    memcpy(out, s, AES_BLOCK_SIZE);
+}
+
+/* ghash = (ghash ^ in) * H in GF(2^128), bit 0 being the most significant
+ * bit of byte 0 */
+static void aesmodel_ghash_update(const uint8_t *in)
+{
+    uint8_t x[AES_BLOCK_SIZE];
+    uint8_t v[AES_BLOCK_SIZE];
+    uint8_t z[AES_BLOCK_SIZE] = { 0 };
+    uint32_t i;
+    uint32_t j;
+
+    for (i = 0; i < AES_BLOCK_SIZE; i++)
+    {
+        x[i] = aesmodel_ghash[i] ^ in[i];
+    }
+
+    memcpy(v, aesmodel_h, AES_BLOCK_SIZE);
+
+    for (i = 0; i < 128U; i++)
+    {
+        uint8_t lsb = v[AES_BLOCK_SIZE - 1U] & 1U;
+
+        if ((x[i / 8U] >> (7U - (i % 8U))) & 1U)
+        {
+            for (j = 0; j < AES_BLOCK_SIZE; j++)
+            {
+                z[j] ^= v[j];
+            }
+        }
+
+        for (j = AES_BLOCK_SIZE - 1U; j > 0U; j--)
+        {
+            v[j] = (uint8_t)((v[j] >> 1) | (v[j - 1U] << 7));
+        }
+
+        v[0] >>= 1;
+
+        if (lsb != 0U)
+        {
+            v[0] ^= 0xe1U;
+        }
+    }
+
+    memcpy(aesmodel_ghash, z, AES_BLOCK_SIZE);
+}
+
+static void aesmodel_put64(uint8_t *p, uint64_t v)
+{
+    uint32_t i;
+
+    for (i = 0; i < 8U; i++)
+    {
+        p[i] = (uint8_t)(v >> (56U - (8U * i)));
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: AES Library Functions
+// *****************************************************************************
+// *****************************************************************************
+
+void AES_Initialize( void )
+{
+    memset(aesmodel_keys, 0, sizeof(aesmodel_keys));
+}
+
+void AES_GcmStart( const uint32_t *key, const uint32_t *nonce, const uint32_t *aad, size_t aad_size )
+{
+    uint8_t block[AES_BLOCK_SIZE] = { 0 };
+
+    aesmodel_key_expand((const uint8_t *)key);
+
+    aesmodel_encrypt(block, aesmodel_h);
+
+    memset(aesmodel_ghash, 0, sizeof(aesmodel_ghash));
+
+    if (aad_size > AES_BLOCK_SIZE)
+    {
+        aad_size = AES_BLOCK_SIZE;
+    }
+
+    if (aad_size != 0U)
+    {
+        memcpy(block, aad, aad_size);
+
+        aesmodel_ghash_update(block);
+    }
+
+    aesmodel_aad_bits   = (uint64_t)aad_size * 8U;
+    aesmodel_data_bits  = 0;
+
+    memcpy(aesmodel_j0, nonce, AES_GCM_NONCE_SIZE);
+    memset(&aesmodel_j0[AES_GCM_NONCE_SIZE], 0, AES_BLOCK_SIZE - AES_GCM_NONCE_SIZE);
+    aesmodel_j0[AES_BLOCK_SIZE - 1U] = 1U;
+
+    memcpy(aesmodel_counter, aesmodel_j0, AES_BLOCK_SIZE);
+}
+
+void AES_GcmDecrypt( uint32_t *data, size_t size )
+{
+    uint8_t *bytes = (uint8_t *)data;
+    uint8_t stream[AES_BLOCK_SIZE];
+    size_t offset;
+    uint32_t i;
+
+    for (offset = 0; offset < size; offset += AES_BLOCK_SIZE)
+    {
+        /* inc32 of the counter block */
+        for (i = AES_BLOCK_SIZE - 1U; i >= AES_GCM_NONCE_SIZE; i--)
+        {
+            if (++aesmodel_counter[i] != 0U)
+            {
+                break;
+            }
+        }
+
+        aesmodel_ghash_update(&bytes[offset]);
+
+        aesmodel_encrypt(aesmodel_counter, stream);
+
+        for (i = 0; i < AES_BLOCK_SIZE; i++)
+        {
+            bytes[offset + i] ^= stream[i];
+        }
+    }
+
+    aesmodel_data_bits += (uint64_t)size * 8U;
+}
+
+bool AES_GcmTagCheck( const uint32_t *tag )
+{
+    uint8_t block[AES_BLOCK_SIZE];
+    uint8_t diff = 0;
+    uint32_t i;
+
+    aesmodel_put64(&block[0], aesmodel_aad_bits);
+    aesmodel_put64(&block[8], aesmodel_data_bits);
+
+    aesmodel_ghash_update(block);
+
+    aesmodel_encrypt(aesmodel_j0, block);
+
+    for (i = 0; i < AES_GCM_TAG_SIZE; i++)
+    {
+        diff |= (uint8_t)(block[i] ^ aesmodel_ghash[i] ^ ((const uint8_t *)tag)[i]);
+    }
+
+    return (diff == 0U);
+}
+
+#endif
@@ -0,0 +1,542 @@
+/*******************************************************************************
+  CAN FD Bootloader Transport Source File
+
+  File Name:
+    bootloader_can.c
+
+  Summary:
+    This file contains the CAN FD backend of the bootloader transport.
+
+  Description:
+    Every node listens on its own request identifier and on one multicast
+    identifier shared by all nodes. A protocol packet travels as one message.
+
+    Unicast messages use ISO-TP (ISO 15765-2) with CAN FD framing: single
+    frames up to 62 bytes, otherwise a first frame with the 32 bit length
+    escape, consecutive frames of 63 bytes and a flow control frame from the
+    node after every CAN_BLOCK_SIZE consecutive frames, so the Rx FIFO never
+    overflows while the node is busy. The one byte response goes back as a
+    single frame on the response identifier.
+
+    In multicast mode a gateway streams every packet once to all nodes as
+    numbered segments:
+
+        [0] 0x40  [1] message sequence  [2..3] segment index
+        [4..7] message length  [8..63] 56 data bytes
+
+    There is no flow control, a node that was busy programming flash simply
+    misses segments. The gateway then polls each node with a status request
+    (one byte, 0x50) on its request identifier and the node answers with
+
+        [0] 0x50  [1] message sequence  [2] flags  [3] response
+        [4..5] segment count  [6..7] missing count  [8..63] missing bitmap
+
+    The gateway sends the missing segments again, once for all nodes, until
+    every node holds the message and has answered it. The response of the
+    protocol engine to a multicast packet is kept for the status reply.
+    A node follows either its unicast channel or the multicast stream; a
+    frame of the other kind drops the message in progress.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "definitions.h"
+#include "bootloader_transport.h"
+#include "bootloader_protocol.h"
+
+#if (BTL_CAN_FD == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define CAN_REQUEST_ID          (0x600U + BTL_CAN_NODE_ID)
+#define CAN_RESPONSE_ID         (0x680U + BTL_CAN_NODE_ID)
+
+/* Protocol control information, high nibble of the first byte */
+#define CAN_PCI_MASK            0xF0U
+#define CAN_PCI_SINGLE          0x00U
+#define CAN_PCI_FIRST           0x10U
+#define CAN_PCI_CONSECUTIVE     0x20U
+#define CAN_PCI_FLOW_CONTROL    0x30U
+#define CAN_PCI_SEGMENT         0x40U
+#define CAN_PCI_STATUS          0x50U
+
+#define CAN_FC_CONTINUE         0x30U
+#define CAN_FC_OVERFLOW         0x32U
+
+/* Consecutive frames between two flow control frames, half the Rx FIFO */
+#define CAN_BLOCK_SIZE          8U
+
+/* Largest packet is a DATA command */
+#define CAN_MESSAGE_SIZE        (BTL_HEADER_SIZE + BTL_MAX_PAYLOAD_SIZE)
+
+#define CAN_SEGMENT_HEADER      8U
+#define CAN_SEGMENT_DATA        (CAN0_FRAME_SIZE - CAN_SEGMENT_HEADER)
+#define CAN_SEGMENTS            ((CAN_MESSAGE_SIZE + CAN_SEGMENT_DATA - 1U) / CAN_SEGMENT_DATA)
+#define CAN_SEGMENT_MAP_SIZE    ((CAN_SEGMENTS + 7U) / 8U)
+
+/* Status reply flags */
+#define CAN_STATUS_ACTIVE       0x01U
+#define CAN_STATUS_COMPLETE     0x02U
+
+#define CAN_NO_RESPONSE         0xFFU
+
+/* SysTick periods (100 ms) a multicast RESET waits for the gateway to poll */
+#define CAN_RESET_POLL_PERIODS  10U
+
+enum can_mode
+{
+    CAN_MODE_IDLE,
+    CAN_MODE_UNICAST,
+    CAN_MODE_MULTICAST,
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static uint8_t  can_message[CAN_MESSAGE_SIZE] NO_INIT;
+static uint8_t  can_frame[CAN0_FRAME_SIZE];
+
+static enum can_mode can_mode       = CAN_MODE_IDLE;
+
+static uint32_t can_message_size    = 0;
+static uint32_t can_message_ptr     = 0;
+static size_t   can_read_ptr        = 0;
+static bool     can_message_ready   = false;
+
+/* Unicast reassembly */
+static uint8_t  can_sequence        = 0;
+static uint8_t  can_block_count     = 0;
+
+/* Multicast reassembly */
+static uint8_t  can_segment_map[CAN_SEGMENT_MAP_SIZE];
+static uint8_t  can_mc_sequence     = 0;
+static uint16_t can_mc_segments     = 0;
+static uint16_t can_mc_count        = 0;
+static uint8_t  can_mc_response     = CAN_NO_RESPONSE;
+static bool     can_mc_reported     = false;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: CAN Transport Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static uint32_t can_get32_be(const uint8_t *src)
+{
+    return ((uint32_t)src[0] << 24) | ((uint32_t)src[1] << 16) |
+           ((uint32_t)src[2] << 8) | (uint32_t)src[3];
+}
+
+static uint32_t can_get32_le(const uint8_t *src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) |
+           ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static void can_send(const uint8_t *data, uint8_t length)
+{
+    while (CAN0_MessageTransmit(CAN_RESPONSE_ID, data, length) == false);
+}
+
+static void can_flow_control_send(uint8_t status)
+{
+    uint8_t frame[3] = { status, CAN_BLOCK_SIZE, 0 };
+
+    can_send(frame, sizeof(frame));
+}
+
+/* Hands the complete message to the protocol engine */
+static void can_message_deliver(void)
+{
+    can_read_ptr        = 0;
+    can_message_ready   = true;
+}
+
+static void can_single_frame_receive(const uint8_t *frame, uint8_t length)
+{
+    uint32_t size   = frame[0] & 0x0FU;
+    uint32_t offset = 1;
+
+    /* CAN FD escape: length in the second byte */
+    if (size == 0U)
+    {
+        size   = frame[1];
+        offset = 2;
+    }
+
+    can_mode = CAN_MODE_IDLE;
+
+    if ((size == 0U) || ((size + offset) > length))
+    {
+        return;
+    }
+
+    memcpy(can_message, &frame[offset], size);
+
+    can_mode            = CAN_MODE_UNICAST;
+    can_message_size    = size;
+
+    can_message_deliver();
+}
+
+static void can_first_frame_receive(const uint8_t *frame, uint8_t length)
+{
+    uint32_t size   = ((uint32_t)(frame[0] & 0x0FU) << 8) | frame[1];
+    uint32_t offset = 2;
+
+    /* Messages above 4095 bytes carry a 32 bit length */
+    if (size == 0U)
+    {
+        size   = can_get32_be(&frame[2]);
+        offset = 6;
+    }
+
+    can_mode = CAN_MODE_IDLE;
+
+    if (size > CAN_MESSAGE_SIZE)
+    {
+        can_flow_control_send(CAN_FC_OVERFLOW);
+        return;
+    }
+
+    /* A message this short has to be a single frame */
+    if (size <= (uint32_t)(length - offset))
+    {
+        return;
+    }
+
+    memcpy(can_message, &frame[offset], length - offset);
+
+    can_mode            = CAN_MODE_UNICAST;
+    can_message_size    = size;
+    can_message_ptr     = length - offset;
+    can_sequence        = 1;
+    can_block_count     = CAN_BLOCK_SIZE;
+
+    can_flow_control_send(CAN_FC_CONTINUE);
+}
+
+static void can_consecutive_frame_receive(const uint8_t *frame, uint8_t length)
+{
+    uint32_t count = can_message_size - can_message_ptr;
+
+    if ((can_mode != CAN_MODE_UNICAST) || ((frame[0] & 0x0FU) != can_sequence))
+    {
+        can_mode = CAN_MODE_IDLE;
+        return;
+    }
+
+    if (count > (uint32_t)(length - 1U))
+    {
+        count = length - 1U;
+    }
+
+    memcpy(&can_message[can_message_ptr], &frame[1], count);
+
+    can_message_ptr += count;
+    can_sequence     = (can_sequence + 1U) & 0x0FU;
+
+    if (can_message_ptr == can_message_size)
+    {
+        can_mode = CAN_MODE_IDLE;
+
+        can_message_deliver();
+    }
+    else if (--can_block_count == 0U)
+    {
+        can_block_count = CAN_BLOCK_SIZE;
+
+        can_flow_control_send(CAN_FC_CONTINUE);
+    }
+}
+
+/* A segment with a new sequence number starts the next multicast message */
+static void can_segment_receive(const uint8_t *frame, uint8_t length)
+{
+    uint8_t  sequence   = frame[1];
+    uint32_t index      = (uint32_t)frame[2] | ((uint32_t)frame[3] << 8);
+    uint32_t size       = can_get32_le(&frame[4]);
+    uint32_t offset     = index * CAN_SEGMENT_DATA;
+    uint32_t count;
+
+    if ((can_mode != CAN_MODE_MULTICAST) || (sequence != can_mc_sequence))
+    {
+        if ((size < BTL_HEADER_SIZE) || (size > CAN_MESSAGE_SIZE))
+        {
+            return;
+        }
+
+        memset(can_segment_map, 0, sizeof(can_segment_map));
+
+        can_mode            = CAN_MODE_MULTICAST;
+        can_message_size    = size;
+        can_mc_sequence     = sequence;
+        can_mc_segments     = (uint16_t)((size + CAN_SEGMENT_DATA - 1U) / CAN_SEGMENT_DATA);
+        can_mc_count        = 0;
+        can_mc_response     = CAN_NO_RESPONSE;
+        can_mc_reported     = false;
+    }
+
+    if ((size != can_message_size) || (index >= can_mc_segments) ||
+        ((can_segment_map[index / 8U] & (1U << (index % 8U))) != 0U))
+    {
+        return;
+    }
+
+    count = size - offset;
+
+    if (count > CAN_SEGMENT_DATA)
+    {
+        count = CAN_SEGMENT_DATA;
+    }
+
+    if ((count + CAN_SEGMENT_HEADER) > length)
+    {
+        return;
+    }
+
+    memcpy(&can_message[offset], &frame[CAN_SEGMENT_HEADER], count);
+
+    can_segment_map[index / 8U] |= (uint8_t)(1U << (index % 8U));
+
+    if (++can_mc_count == can_mc_segments)
+    {
+        can_message_deliver();
+    }
+}
+
+/* The missing bitmap of a full DATA packet fits into one status reply */
+static void can_status_send(void)
+{
+    uint8_t  frame[CAN0_FRAME_SIZE];
+    uint32_t missing = 0;
+    uint32_t i;
+
+    memset(frame, 0, sizeof(frame));
+
+    frame[0] = CAN_PCI_STATUS;
+
+    if (can_mode == CAN_MODE_MULTICAST)
+    {
+        for (i = 0; i < can_mc_segments; i++)
+        {
+            if ((can_segment_map[i / 8U] & (1U << (i % 8U))) == 0U)
+            {
+                frame[CAN_SEGMENT_HEADER + (i / 8U)] |= (uint8_t)(1U << (i % 8U));
+                missing++;
+            }
+        }
+
+        frame[1] = can_mc_sequence;
+        frame[2] = CAN_STATUS_ACTIVE;
+        frame[4] = (uint8_t)can_mc_segments;
+        frame[5] = (uint8_t)(can_mc_segments >> 8);
+        frame[6] = (uint8_t)missing;
+        frame[7] = (uint8_t)(missing >> 8);
+
+        if (missing == 0U)
+        {
+            frame[2] |= CAN_STATUS_COMPLETE;
+        }
+    }
+
+    frame[3] = can_mc_response;
+
+    can_send(frame, CAN0_FRAME_SIZE);
+
+    if (can_mc_response != CAN_NO_RESPONSE)
+    {
+        can_mc_reported = true;
+    }
+}
+
+/* Consumes received frames while no message waits for the protocol engine */
+static void can_task(void)
+{
+    uint16_t id;
+    uint8_t  length;
+
+    while ((can_message_ready == false) && (CAN0_MessageReceive(&id, can_frame, &length) == true))
+    {
+        if (length == 0U)
+        {
+            continue;
+        }
+
+        if (id == BTL_CAN_MULTICAST_ID)
+        {
+            if ((length > CAN_SEGMENT_HEADER) && (can_frame[0] == CAN_PCI_SEGMENT))
+            {
+                can_segment_receive(can_frame, length);
+            }
+            continue;
+        }
+
+        switch (can_frame[0] & CAN_PCI_MASK)
+        {
+            case CAN_PCI_SINGLE:
+                can_single_frame_receive(can_frame, length);
+                break;
+
+            case CAN_PCI_FIRST:
+                if (length > 6U)
+                {
+                    can_first_frame_receive(can_frame, length);
+                }
+                break;
+
+            case CAN_PCI_CONSECUTIVE:
+                can_consecutive_frame_receive(can_frame, length);
+                break;
+
+            case CAN_PCI_STATUS:
+                can_status_send();
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+static bool can_receiver_is_ready(void)
+{
+    can_task();
+
+    return (can_message_ready == true);
+}
+
+static size_t can_read(uint8_t *buffer, size_t size)
+{
+    size_t count = can_message_size - can_read_ptr;
+
+    if (can_message_ready == false)
+    {
+        return 0;
+    }
+
+    if (count > size)
+    {
+        count = size;
+    }
+
+    memcpy(buffer, &can_message[can_read_ptr], count);
+
+    can_read_ptr += count;
+
+    if (can_read_ptr == can_message_size)
+    {
+        can_message_ready = false;
+    }
+
+    return count;
+}
+
+/* Unicast responses go out as a single frame, multicast ones wait for the
+ * gateway to poll */
+static void can_write(const uint8_t *buffer, size_t size)
+{
+    uint8_t frame[8];
+
+    if (size > (sizeof(frame) - 1U))
+    {
+        size = sizeof(frame) - 1U;
+    }
+
+    if (can_mode == CAN_MODE_MULTICAST)
+    {
+        can_mc_response = buffer[0];
+        can_mc_reported = false;
+        return;
+    }
+
+    frame[0] = (uint8_t)(CAN_PCI_SINGLE | size);
+
+    memcpy(&frame[1], buffer, size);
+
+    can_send(frame, (uint8_t)(size + 1U));
+}
+
+/* Before a reset the response has to reach the gateway. For a multicast
+ * packet that means answering one status poll, bounded so that a node whose
+ * gateway went away still starts the application. */
+static void can_flush(void)
+{
+    uint32_t periods = 0;
+
+    if (can_mode == CAN_MODE_MULTICAST)
+    {
+        while ((can_mc_reported == false) && (periods < CAN_RESET_POLL_PERIODS))
+        {
+            can_task();
+
+            if (SYSTICK_TimerPeriodHasExpired() == true)
+            {
+                periods++;
+            }
+        }
+    }
+
+    while (CAN0_TransmitIsComplete() == false);
+}
+
+/* Bit timing is fixed by the CAN0 peripheral library */
+static bool can_link_setup(uint32_t bitRate)
+{
+    (void)bitRate;
+
+    return true;
+}
+
+void bootloader_CanInitialize(void)
+{
+    CAN0_Initialize(CAN_REQUEST_ID, BTL_CAN_MULTICAST_ID);
+}
+
+const BOOTLOADER_TRANSPORT bootloader_CanTransport =
+{
+    .receiverIsReady    = can_receiver_is_ready,
+    .read               = can_read,
+    .write              = can_write,
+    .flush              = can_flush,
+    .linkSetup          = can_link_setup,
+};
+
+#endif
@@ -0,0 +1,224 @@
+/*******************************************************************************
+  Bootloader Protocol Commands Header File
+
+  File Name:
+    bootloader_commands.h
+
+  Summary:
+    This file contains the packet layouts of the bootloader protocol.
+
+  Description:
+    Generated by tools/btlgen.py from tools/btl_protocol.json, do not edit.
+    Every payload struct is laid over the word aligned receive buffer of a
+    link, so the engine reads the fields in place. Fields are aligned to
+    their size and need no packing; a variable length tail is a flexible
+    array member and sizeof() of its struct is the size of the fields in
+    front of it.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef BOOTLOADER_COMMANDS_H
+#define BOOTLOADER_COMMANDS_H
+
+#include <stdint.h>
+
+#define BTL_GUARD               (0x5048434DUL)
+
+/* Header: guard (4), size (4), command (1). It is not padded on the wire, so
+ * sizeof(struct btl_header) is more than BTL_HEADER_SIZE. */
+#define BTL_HEADER_SIZE         9U
+#define BTL_GUARD_OFFSET        0U
+#define BTL_SIZE_OFFSET         4U
+#define BTL_CMD_OFFSET          8U
+
+struct btl_header
+{
+    uint32_t guard;
+    uint32_t size;
+    uint8_t command;
+};
+
+/* Erase block, the unit of DATA */
+#define BTL_BLOCK_SIZE          8192U
+/* AES-128-GCM nonce of ENC_DATA */
+#define BTL_NONCE_SIZE          12U
+/* AES-128-GCM tag of ENC_DATA */
+#define BTL_TAG_SIZE            16U
+
+/* Payload of UNLOCK: opens a session programming size bytes from address */
+struct btl_unlock_payload
+{
+    uint32_t address;
+    uint32_t size;
+};
+#define BTL_UNLOCK_PAYLOAD_SIZE     8U
+
+/* Payload of DATA: block address followed by one erase block */
+struct btl_data_payload
+{
+    uint32_t address;
+    uint32_t block[BTL_BLOCK_SIZE / 4U];
+};
+#define BTL_DATA_PAYLOAD_SIZE       (4U + BTL_BLOCK_SIZE)
+
+/* Payload of VERIFY: CRC of the unlocked range as the DSU computes it */
+struct btl_verify_payload
+{
+    uint32_t crc;
+};
+#define BTL_VERIFY_PAYLOAD_SIZE     4U
+
+/* Payload of RESET */
+struct btl_reset_payload
+{
+    uint32_t reserved;
+};
+#define BTL_RESET_PAYLOAD_SIZE      4U
+
+/* Payload of BKSWAP_RESET */
+struct btl_bkswap_reset_payload
+{
+    uint32_t reserved;
+};
+#define BTL_BKSWAP_RESET_PAYLOAD_SIZE 4U
+
+/* Payload of ENC_DATA: block address, GCM nonce and GCM tag, followed by the
+ * erase block encrypted with AES-128-GCM. The block address is the additional
+ * authenticated data. */
+struct btl_enc_data_payload
+{
+    uint32_t address;
+    uint32_t nonce[BTL_NONCE_SIZE / 4U];
+    uint32_t tag[BTL_TAG_SIZE / 4U];
+    uint32_t block[BTL_BLOCK_SIZE / 4U];
+};
+#define BTL_ENC_DATA_PAYLOAD_SIZE   (4U + BTL_NONCE_SIZE + BTL_TAG_SIZE + BTL_BLOCK_SIZE)
+
+/* Payload of STREAM: offset of the piece in the update container, followed by
+ * up to one erase block of it. Offset 0 starts a new container. */
+struct btl_stream_payload
+{
+    uint32_t offset;
+    uint8_t piece[];
+};
+#define BTL_STREAM_PAYLOAD_SIZE     (4U + BTL_BLOCK_SIZE)
+
+/* Payload of PARTITION: partition ID and the number of bytes the session is
+ * going to program from its start, which replaces UNLOCK */
+struct btl_partition_payload
+{
+    uint32_t id;
+    uint32_t size;
+};
+#define BTL_PARTITION_PAYLOAD_SIZE  8U
+
+/* Payload of FEC_DATA: block address, followed by the block address and the
+ * erase block again as interleaved Reed-Solomon codewords, see
+ * bootloader_fec.h */
+struct btl_fec_data_payload
+{
+    uint32_t address;
+    uint8_t codewords[];
+};
+
+/* Payload of TIMEOUTS: inter-byte, per-packet and session idle timeouts in
+ * microseconds, 0 for none. They hold until the session times out or the
+ * device resets. */
+struct btl_timeouts_payload
+{
+    uint32_t byte_us;
+    uint32_t packet_us;
+    uint32_t session_us;
+};
+#define BTL_TIMEOUTS_PAYLOAD_SIZE   12U
+
+/* Payload of BEGIN: manifest of the image a session is about to program:
+ * where it goes, bin_size and crc32 of its binary header, its version and the
+ * hardware it is built for. Answered INSTALLED, INCOMPATIBLE or OK. */
+struct btl_begin_payload
+{
+    uint32_t address;
+    uint32_t size;
+    uint32_t crc;
+    uint32_t version;
+    uint32_t hardware;
+};
+#define BTL_BEGIN_PAYLOAD_SIZE      20U
+
+/* Payload of SELF_UPDATE: writes the bootloader staged in the erase block at
+ * address, whose CRC as the DSU computes it is crc, to block 0 of the
+ * inactive bank together with the application area of the running bank.
+ * Answered CRC_OK once the inactive bank holds both, then BKSWAP_RESET starts
+ * the new bootloader; CRC_FAIL when every try failed, the running bank is
+ * untouched either way. */
+struct btl_self_update_payload
+{
+    uint32_t address;
+    uint32_t crc;
+};
+#define BTL_SELF_UPDATE_PAYLOAD_SIZE 8U
+
+/* Payload of BIT_RATE: bit rate the link the command came on switches to.
+ * Answered OK at the current rate, the device switches once the answer has
+ * left. A rate the link can not do leaves it at the current one, the host
+ * then gets no answer at the new rate. */
+struct btl_bit_rate_payload
+{
+    uint32_t bit_rate;
+};
+#define BTL_BIT_RATE_PAYLOAD_SIZE   4U
+
+enum
+{
+    BL_CMD_UNLOCK       = 0xa0,
+    BL_CMD_DATA         = 0xa1,
+    BL_CMD_VERIFY       = 0xa2,
+    BL_CMD_RESET        = 0xa3,
+    BL_CMD_BKSWAP_RESET = 0xa4,
+    BL_CMD_ENC_DATA     = 0xa5,
+    BL_CMD_STREAM       = 0xa6,
+    BL_CMD_PARTITION    = 0xa7,
+    BL_CMD_FEC_DATA     = 0xa8,
+    BL_CMD_TIMEOUTS     = 0xa9,
+    BL_CMD_BEGIN        = 0xaa,
+    BL_CMD_SELF_UPDATE  = 0xab,
+    BL_CMD_BIT_RATE     = 0xac,
+};
+
+enum
+{
+    BL_RESP_OK           = 0x50,
+    BL_RESP_ERROR        = 0x51,
+    BL_RESP_INVALID      = 0x52,
+    BL_RESP_CRC_OK       = 0x53,
+    BL_RESP_CRC_FAIL     = 0x54,
+    BL_RESP_FEC_FAIL     = 0x55,
+    BL_RESP_INSTALLED    = 0x56,
+    BL_RESP_INCOMPATIBLE = 0x57,
+};
+
+#endif
@@ -0,0 +1,621 @@
+/*******************************************************************************
+  Bootloader Update Container Source File
+
+  File Name:
+    bootloader_container.c
+
+  Summary:
+    This file contains the streaming decoder of the update container.
+
+  Description:
+    The decoder is a state machine fed with whatever piece of the container
+    the transport delivered. Headers are collected in a fixed buffer, data
+    is decoded straight into the erase block buffer of the flash engine:
+
+      - RAW segments are copied, FILL segments need no input at all,
+      - LZ and DELTA tokens are decoded as they arrive; a token cut in two
+        by the end of a piece continues with the next one,
+      - a match reaching back past the current erase block reads the bytes
+        from the flash it was programmed to, a DELTA base copy reads the old
+        image, so the window costs no RAM.
+
+    The crc32 of a segment is accumulated block by block and checked before
+    its last block is handed out.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <stddef.h>
+#include <string.h>
+#include "configuration.h"
+#include "bootloader.h"
+#include "bootloader_protocol.h"
+#include "bootloader_container.h"
+
+#if (BTL_CONTAINER == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define CONTAINER_FLASH_SIZE        (0x100000UL)
+
+#define CONTAINER_MANIFEST_SIZE     ((uint32_t)sizeof(struct btl_container_manifest))
+#define CONTAINER_SEGMENT_SIZE      ((uint32_t)sizeof(struct btl_container_segment))
+#define CONTAINER_MANIFEST_CRC_SIZE ((uint32_t)offsetof(struct btl_container_manifest, manifest_crc))
+#define CONTAINER_SEGMENT_CRC_SIZE  ((uint32_t)offsetof(struct btl_container_segment, header_crc))
+
+/* LEB128 numbers longer than this do not fit 32 bits */
+#define CONTAINER_LEB128_SHIFT_MAX  28U
+
+typedef enum
+{
+    CONTAINER_MANIFEST,
+    CONTAINER_HEADER,
+    CONTAINER_DATA,
+    CONTAINER_DONE,
+    CONTAINER_ERROR,
+} CONTAINER_STATE;
+
+/* Where a token of an LZ or DELTA segment stands */
+typedef enum
+{
+    CONTAINER_TOKEN,
+    CONTAINER_LENGTH,
+    CONTAINER_ARGUMENT,
+    CONTAINER_COPY,
+} CONTAINER_TOKEN_STATE;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static struct btl_container_manifest container_manifest;
+static struct btl_container_segment  container_segment;
+
+static CONTAINER_STATE container_state  = CONTAINER_ERROR;
+
+/* Manifest or segment header being collected */
+static uint8_t  container_header[CONTAINER_SEGMENT_SIZE];
+static uint32_t container_header_size   = 0;
+
+static uint32_t container_position      = 0;
+static uint32_t container_segments      = 0;
+
+/* Lowest address the next segment may load to */
+static uint32_t container_next          = 0;
+
+/* Erase block being decoded */
+static uint8_t *container_block         = NULL;
+static uint32_t container_block_address = 0;
+static uint32_t container_block_fill    = 0;
+static bool     container_block_out     = false;
+
+/* Progress in the current segment */
+static uint32_t container_produced      = 0;
+static uint32_t container_consumed      = 0;
+static uint32_t container_crc           = 0;
+
+/* Current token */
+static CONTAINER_TOKEN_STATE container_token = CONTAINER_TOKEN;
+static uint32_t container_op            = 0;
+static uint32_t container_count         = 0;
+static uint32_t container_number        = 0;
+static uint32_t container_shift         = 0;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Container Local Functions
+// *****************************************************************************
+// *****************************************************************************
+
+/* Collects size header bytes, returns true once all are in */
+static bool container_collect(const uint8_t **data, uint32_t *left, uint32_t size)
+{
+    uint32_t n = size - container_header_size;
+
+    if (n > *left)
+    {
+        n = *left;
+    }
+
+    memcpy(&container_header[container_header_size], *data, n);
+
+    container_header_size += n;
+    *data += n;
+    *left -= n;
+
+    if (container_header_size < size)
+    {
+        return false;
+    }
+
+    container_header_size = 0;
+
+    return true;
+}
+
+static bool container_manifest_check(void)
+{
+    const struct btl_container_manifest *m = &container_manifest;
+
+    memcpy(&container_manifest, container_header, CONTAINER_MANIFEST_SIZE);
+
+    return ((m->magic == BTL_CONTAINER_MAGIC) &&
+            (m->version == BTL_CONTAINER_VERSION) &&
+            (m->segments > 0U) &&
+            ((m->begin % BTL_BLOCK_SIZE) == 0U) &&
+            (m->begin < m->end) && (m->end <= CONTAINER_FLASH_SIZE) &&
+            (m->size > CONTAINER_MANIFEST_SIZE) &&
+            (m->manifest_crc == (uint32_t)crc32(0, m, CONTAINER_MANIFEST_CRC_SIZE)));
+}
+
+static bool container_segment_check(void)
+{
+    const struct btl_container_segment *s = &container_segment;
+
+    memcpy(&container_segment, container_header, CONTAINER_SEGMENT_SIZE);
+
+    if ((s->header_crc != (uint32_t)crc32(0, s, CONTAINER_SEGMENT_CRC_SIZE)) ||
+        ((s->address % BTL_BLOCK_SIZE) != 0U) ||
+        (s->address < container_next) || (s->length == 0U) ||
+        (s->length > (container_manifest.end - s->address)))
+    {
+        return false;
+    }
+
+    switch (s->encoding)
+    {
+        case BTL_CONTAINER_RAW:
+            return (s->encoded == s->length);
+
+        case BTL_CONTAINER_FILL:
+            return (s->encoded == 0U);
+
+        case BTL_CONTAINER_LZ:
+        case BTL_CONTAINER_DELTA:
+            return (s->encoded > 0U);
+
+        default:
+            return false;
+    }
+}
+
+static void container_segment_start(void)
+{
+    container_block_address = container_segment.address;
+    container_block_fill    = 0;
+
+    container_produced      = 0;
+    container_consumed      = 0;
+    container_crc           = 0;
+
+    container_token         = CONTAINER_TOKEN;
+
+    memset(container_block, 0xFF, BTL_BLOCK_SIZE);
+}
+
+/* Called once the block handed out has been programmed */
+static void container_block_next(void)
+{
+    container_block_out = false;
+
+    if (container_produced < container_segment.length)
+    {
+        container_block_address += BTL_BLOCK_SIZE;
+        container_block_fill    = 0;
+
+        memset(container_block, 0xFF, BTL_BLOCK_SIZE);
+    }
+    else
+    {
+        container_next  = container_block_address + BTL_BLOCK_SIZE;
+        container_state = (--container_segments > 0U) ? CONTAINER_HEADER : CONTAINER_DONE;
+    }
+}
+
+/* A base copy has to stay inside the flash and out of the region */
+static bool container_base_check(uint32_t offset, uint32_t count)
+{
+    uint32_t begin = container_segment.value + offset;
+    uint32_t end   = begin + count;
+
+    return ((begin >= container_segment.value) && (begin < end) &&
+            (end <= CONTAINER_FLASH_SIZE) &&
+            ((end <= container_manifest.begin) || (begin >= container_manifest.end)));
+}
+
+/* Token byte and the optional length extension. Returns false on a
+ * malformed token. */
+static bool container_token_byte(uint8_t byte)
+{
+    if (container_token == CONTAINER_TOKEN)
+    {
+        container_op     = (uint32_t)byte >> 6;
+        container_count  = ((uint32_t)byte & BTL_CONTAINER_LENGTH_MASK) + 1U;
+        container_number = 0;
+        container_shift  = 0;
+
+        if ((container_op == BTL_CONTAINER_OP_BASE) &&
+            (container_segment.encoding != BTL_CONTAINER_DELTA))
+        {
+            return false;
+        }
+
+        if (((uint32_t)byte & BTL_CONTAINER_LENGTH_MASK) == BTL_CONTAINER_LENGTH_MASK)
+        {
+            container_token = CONTAINER_LENGTH;
+            return true;
+        }
+    }
+    else if (container_token == CONTAINER_LENGTH)
+    {
+        container_number |= ((uint32_t)byte & 0x7FU) << container_shift;
+        container_shift  += 7U;
+
+        if ((byte & 0x80U) != 0U)
+        {
+            return (container_shift <= CONTAINER_LEB128_SHIFT_MAX);
+        }
+
+        container_count  += container_number;
+        container_number = 0;
+        container_shift  = 0;
+    }
+    else
+    {
+        /* CONTAINER_ARGUMENT */
+        if (container_op == BTL_CONTAINER_OP_RUN)
+        {
+            container_number = byte;
+            container_token  = CONTAINER_COPY;
+            return true;
+        }
+
+        container_number |= ((uint32_t)byte & 0x7FU) << container_shift;
+        container_shift  += 7U;
+
+        if ((byte & 0x80U) != 0U)
+        {
+            return (container_shift <= CONTAINER_LEB128_SHIFT_MAX);
+        }
+
+        container_token = CONTAINER_COPY;
+
+        if (container_op == BTL_CONTAINER_OP_MATCH)
+        {
+            return ((container_number > 0U) && (container_number <= container_produced));
+        }
+
+        return container_base_check(container_number, container_count);
+    }
+
+    /* The length is known */
+    if ((container_count == 0U) || (container_count > (container_segment.length - container_produced)))
+    {
+        return false;
+    }
+
+    container_token = (container_op == BTL_CONTAINER_OP_LITERAL) ? CONTAINER_COPY : CONTAINER_ARGUMENT;
+
+    return true;
+}
+
+/* Output of the current token, at most space bytes */
+static uint32_t container_token_copy(const uint8_t *data, uint32_t left, uint32_t space)
+{
+    uint8_t *out = &container_block[container_block_fill];
+    uint32_t n = (container_count < space) ? container_count : space;
+    uint32_t i;
+
+    switch (container_op)
+    {
+        case BTL_CONTAINER_OP_LITERAL:
+            n = (n < left) ? n : left;
+            memcpy(out, data, n);
+            break;
+
+        case BTL_CONTAINER_OP_MATCH:
+            for (i = 0; i < n; i++)
+            {
+                uint32_t src = container_segment.address + container_produced + i - container_number;
+
+                if (src >= container_block_address)
+                {
+                    out[i] = container_block[src - container_block_address];
+                }
+                else
+                {
+                    out[i] = *(const uint8_t *)(uintptr_t)src;
+                }
+            }
+            break;
+
+        case BTL_CONTAINER_OP_BASE:
+            memcpy(out, (const uint8_t *)(uintptr_t)(container_segment.value + container_number), n);
+            container_number += n;
+            break;
+
+        default:
+            memset(out, (int)container_number, n);
+            break;
+    }
+
+    container_count -= n;
+
+    if (container_count == 0U)
+    {
+        container_token = CONTAINER_TOKEN;
+    }
+
+    return n;
+}
+
+/* Decodes segment data into the block until the input or the space runs
+ * out. Returns the input bytes taken, or left + 1 on a malformed token. */
+static uint32_t container_decode(const uint8_t *data, uint32_t left, uint32_t space)
+{
+    uint32_t taken = 0;
+    uint32_t n;
+
+    switch (container_segment.encoding)
+    {
+        case BTL_CONTAINER_RAW:
+            n = (left < space) ? left : space;
+            memcpy(&container_block[container_block_fill], data, n);
+            container_block_fill += n;
+            container_produced   += n;
+            return n;
+
+        case BTL_CONTAINER_FILL:
+            for (n = 0; n < space; n++)
+            {
+                container_block[container_block_fill + n] = (uint8_t)(container_segment.value >> (8U * ((container_produced + n) % 4U)));
+            }
+            container_block_fill += space;
+            container_produced   += space;
+            return 0;
+
+        default:
+            break;
+    }
+
+    while (space > 0U)
+    {
+        if (container_token == CONTAINER_COPY)
+        {
+            n = container_token_copy(&data[taken], left - taken, space);
+
+            if (container_op == BTL_CONTAINER_OP_LITERAL)
+            {
+                taken += n;
+            }
+
+            container_block_fill += n;
+            container_produced   += n;
+            space                -= n;
+        }
+        else if (taken < left)
+        {
+            if (container_token_byte(data[taken++]) == false)
+            {
+                return left + 1U;
+            }
+        }
+
+        if ((taken == left) && ((container_token != CONTAINER_COPY) ||
+                                (container_op == BTL_CONTAINER_OP_LITERAL)))
+        {
+            break;
+        }
+    }
+
+    return taken;
+}
+
+/* Hands out the block once it is full or the segment is complete */
+static bool container_block_done(void)
+{
+    if ((container_block_fill < BTL_BLOCK_SIZE) && (container_produced < container_segment.length))
+    {
+        return false;
+    }
+
+    container_crc = (uint32_t)crc32(container_crc, container_block, container_block_fill);
+
+    return true;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Container Global Functions
+// *****************************************************************************
+// *****************************************************************************
+
+void bootloader_ContainerInitialize(uint32_t *block)
+{
+    container_block         = (uint8_t *)block;
+    container_state         = CONTAINER_MANIFEST;
+    container_header_size   = 0;
+    container_position      = 0;
+    container_next          = 0;
+    container_block_out     = false;
+}
+
+BTL_CONTAINER_RESULT bootloader_ContainerWrite(const uint8_t *data, uint32_t size, uint32_t *used)
+{
+    const uint8_t *start = data;
+    uint32_t left = size;
+    BTL_CONTAINER_RESULT result = BTL_CONTAINER_MORE;
+    bool running = true;
+
+    if (container_block_out == true)
+    {
+        container_block_next();
+    }
+
+    while (running == true)
+    {
+        switch (container_state)
+        {
+            case CONTAINER_MANIFEST:
+                if (container_collect(&data, &left, CONTAINER_MANIFEST_SIZE) == false)
+                {
+                    running = false;
+                }
+                else if (container_manifest_check() == false)
+                {
+                    container_state = CONTAINER_ERROR;
+                }
+                else
+                {
+                    container_segments = container_manifest.segments;
+                    container_next     = container_manifest.begin;
+                    container_state    = CONTAINER_HEADER;
+                    result             = BTL_CONTAINER_MANIFEST;
+                    running            = false;
+                }
+                break;
+
+            case CONTAINER_HEADER:
+                if (container_collect(&data, &left, CONTAINER_SEGMENT_SIZE) == false)
+                {
+                    running = false;
+                }
+                else if (container_segment_check() == false)
+                {
+                    container_state = CONTAINER_ERROR;
+                }
+                else
+                {
+                    container_segment_start();
+                    container_state = CONTAINER_DATA;
+                }
+                break;
+
+            case CONTAINER_DATA:
+            {
+                uint32_t avail = container_segment.encoded - container_consumed;
+                uint32_t space = BTL_BLOCK_SIZE - container_block_fill;
+                uint32_t rest  = container_segment.length - container_produced;
+                uint32_t n;
+
+                avail = (avail < left) ? avail : left;
+                space = (space < rest) ? space : rest;
+
+                n = container_decode(data, avail, space);
+
+                if (n > avail)
+                {
+                    container_state = CONTAINER_ERROR;
+                    break;
+                }
+
+                data               += n;
+                left               -= n;
+                container_consumed += n;
+
+                if (container_block_done() == true)
+                {
+                    /* The last block of a segment only goes out if the
+                     * whole segment is right */
+                    if ((container_produced == container_segment.length) &&
+                        ((container_consumed != container_segment.encoded) ||
+                         (container_token != CONTAINER_TOKEN) ||
+                         (container_crc != container_segment.crc32)))
+                    {
+                        container_state = CONTAINER_ERROR;
+                        break;
+                    }
+
+                    container_block_out = true;
+                    result  = BTL_CONTAINER_BLOCK;
+                    running = false;
+                }
+                else if (container_consumed == container_segment.encoded)
+                {
+                    /* The data ended before the segment did */
+                    container_state = CONTAINER_ERROR;
+                }
+                else
+                {
+                    /* Out of input */
+                    running = false;
+                }
+                break;
+            }
+
+            case CONTAINER_DONE:
+                result  = ((left == 0U) && ((container_position + (size - left)) == container_manifest.size)) ?
+                          BTL_CONTAINER_DONE : BTL_CONTAINER_ERROR;
+                running = false;
+                break;
+
+            default:
+                result  = BTL_CONTAINER_ERROR;
+                running = false;
+                break;
+        }
+    }
+
+    *used = (uint32_t)(data - start);
+    container_position += *used;
+
+    if ((container_state != CONTAINER_MANIFEST) && (container_position > container_manifest.size))
+    {
+        container_state = CONTAINER_ERROR;
+        result = BTL_CONTAINER_ERROR;
+    }
+
+    return result;
+}
+
+const struct btl_container_manifest *bootloader_ContainerManifest(void)
+{
+    return &container_manifest;
+}
+
+uint32_t bootloader_ContainerBlockAddress(void)
+{
+    return container_block_address;
+}
+
+uint32_t bootloader_ContainerPosition(void)
+{
+    return container_position;
+}
+
+#endif
@@ -0,0 +1,212 @@
+/*******************************************************************************
+  Bootloader Update Container Header File
+
+  File Name:
+    bootloader_container.h
+
+  Summary:
+    This file describes the update container and the interface of its
+    streaming decoder.
+
+  Description:
+    A container is the single artefact a host sends for an update. It starts
+    with a manifest naming the flash region it rewrites, followed by the
+    segments making up that region, each with its load address, the way it
+    is encoded and the crc32 of its decoded bytes:
+
+      - manifest,
+      - segment header, encoded data,
+      - segment header, encoded data, ...
+
+    The decoder takes the container in pieces of any size, in one pass and
+    with a fixed amount of state, and writes the decoded segments into the
+    erase block buffer of the flash engine. It has no hardware dependency
+    beyond reading the flash so it can be built and exercised on a host.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef BOOTLOADER_CONTAINER_H
+#define BOOTLOADER_CONTAINER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* "BTLC" */
+#define BTL_CONTAINER_MAGIC         0x434C5442UL
+#define BTL_CONTAINER_VERSION       1U
+
+// *****************************************************************************
+/* Manifest
+
+  Description:
+    - magic         : BTL_CONTAINER_MAGIC
+    - version       : BTL_CONTAINER_VERSION
+    - segments      : number of segments following
+    - begin, end    : flash region the container rewrites, like UNLOCK;
+                      begin is erase block aligned
+    - region_crc    : CRC of the region once programmed, as the DSU computes
+                      it, i.e. what the host passes to VERIFY
+    - size          : container bytes, manifest included
+    - manifest_crc  : crc32() of the words above
+
+    All words are little endian.
+*/
+struct btl_container_manifest {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t segments;
+        uint32_t begin;
+        uint32_t end;
+        uint32_t region_crc;
+        uint32_t size;
+        uint32_t manifest_crc;
+};
+
+/* Encodings of a segment */
+#define BTL_CONTAINER_RAW           0U      /* length bytes as they are */
+#define BTL_CONTAINER_FILL          1U      /* the word in value repeated, nothing follows */
+#define BTL_CONTAINER_LZ            2U      /* token stream, see below */
+#define BTL_CONTAINER_DELTA         3U      /* token stream copying from the flash at value */
+
+// *****************************************************************************
+/* Segment Header
+
+  Description:
+    - address       : load address, erase block aligned, inside the region
+                      and past the end of the segment before
+    - length        : decoded bytes; the rest of the last erase block is
+                      programmed 0xFF
+    - encoded       : bytes following the header
+    - encoding      : one of the encodings above
+    - value         : fill word, or address of the DELTA base. The base has
+                      to lie outside the region so it stays intact.
+    - crc32         : crc32() of the decoded bytes
+    - header_crc    : crc32() of the words above
+
+  Remarks:
+    LZ and DELTA data is a sequence of tokens. The top two bits of the token
+    byte are the operation, the low six bits the length minus one; 63 means
+    a LEB128 number follows and is added to it:
+
+      - 0 literal : length bytes follow
+      - 1 match   : LEB128 distance back into the decoded segment follows
+      - 2 base    : LEB128 offset from the DELTA base follows, DELTA only
+      - 3 run     : one byte follows, repeated length times
+*/
+struct btl_container_segment {
+        uint32_t address;
+        uint32_t length;
+        uint32_t encoded;
+        uint32_t encoding;
+        uint32_t value;
+        uint32_t crc32;
+        uint32_t header_crc;
+};
+
+#define BTL_CONTAINER_OP_LITERAL    0U
+#define BTL_CONTAINER_OP_MATCH      1U
+#define BTL_CONTAINER_OP_BASE       2U
+#define BTL_CONTAINER_OP_RUN        3U
+
+#define BTL_CONTAINER_LENGTH_MASK   0x3FU
+
+typedef enum
+{
+    /* All of the input was taken, pass the next piece */
+    BTL_CONTAINER_MORE,
+
+    /* The manifest was taken, the region is known */
+    BTL_CONTAINER_MANIFEST,
+
+    /* An erase block is decoded, program it and call again with the rest */
+    BTL_CONTAINER_BLOCK,
+
+    /* Every segment was decoded and matched its crc32 */
+    BTL_CONTAINER_DONE,
+
+    /* Malformed container or crc32 mismatch, the session is over */
+    BTL_CONTAINER_ERROR,
+
+} BTL_CONTAINER_RESULT;
+
+// *****************************************************************************
+/* Function:
+    void bootloader_ContainerInitialize( uint32_t *block );
+
+ Summary:
+    Starts decoding a new container into the given erase block buffer.
+
+ Remarks:
+    The buffer holds BTL_BLOCK_SIZE bytes and is owned by the decoder while
+    a block is being decoded.
+*/
+void bootloader_ContainerInitialize( uint32_t *block );
+
+// *****************************************************************************
+/* Function:
+    BTL_CONTAINER_RESULT bootloader_ContainerWrite( const uint8_t *data, uint32_t size, uint32_t *used );
+
+ Summary:
+    Decodes the next piece of the container.
+
+ Description:
+    Takes bytes until the input runs out, the manifest is complete or the
+    block buffer is full, and sets used to the number of bytes taken. After
+    BTL_CONTAINER_MANIFEST and BTL_CONTAINER_BLOCK call it again with the
+    rest of the input, even if nothing is left: a match or run may still
+    be producing output.
+*/
+BTL_CONTAINER_RESULT bootloader_ContainerWrite( const uint8_t *data, uint32_t size, uint32_t *used );
+
+// *****************************************************************************
+/* Function:
+    const struct btl_container_manifest *bootloader_ContainerManifest( void );
+
+ Summary:
+    Returns the manifest once BTL_CONTAINER_MANIFEST was returned.
+*/
+const struct btl_container_manifest *bootloader_ContainerManifest( void );
+
+// *****************************************************************************
+/* Function:
+    uint32_t bootloader_ContainerBlockAddress( void );
+
+ Summary:
+    Returns the flash address of the block BTL_CONTAINER_BLOCK reported.
+*/
+uint32_t bootloader_ContainerBlockAddress( void );
+
+// *****************************************************************************
+/* Function:
+    uint32_t bootloader_ContainerPosition( void );
+
+ Summary:
+    Returns the number of container bytes taken so far.
+*/
+uint32_t bootloader_ContainerPosition( void );
+
+#endif
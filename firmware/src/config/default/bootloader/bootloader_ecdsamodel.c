@@ -0,0 +1,519 @@
+/*******************************************************************************
+  ECDSA Software Model Source File
+
+  File Name:
+    bootloader_ecdsamodel.c
+
+  Summary:
+    This file contains a software implementation of the ICM and PUKCC
+    peripheral library calls used for signed images.
+
+  Description:
+    This backend is only used when the bootloader is built for a Linux host
+    with BTL_SIGNATURE. SHA-256 follows FIPS 180-4; ECDSA P-256 follows FIPS
+    186-4 with Jacobian coordinates and modular arithmetic by shift and add,
+    written for clarity rather than speed. It accepts and rejects the same
+    signatures as the peripherals, so images signed by tools/imgsign.py can
+    be checked end to end, including known answer vectors.
+
+    It is not part of the MPLAB X project.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#if defined(__unix__)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "peripheral/icm/plib_icm.h"
+#include "peripheral/pukcc/plib_pukcc.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+#define ECDSAMODEL_WORDS        8U
+
+/* Numbers of 256 bits, least significant word first */
+typedef uint32_t ecdsamodel_num[ECDSAMODEL_WORDS];
+
+/* Jacobian coordinates, Z = 0 is the point at infinity */
+struct ecdsamodel_point {
+    ecdsamodel_num x;
+    ecdsamodel_num y;
+    ecdsamodel_num z;
+};
+
+static const uint32_t ecdsamodel_sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const ecdsamodel_num ecdsamodel_p = {
+    0xffffffff, 0xffffffff, 0xffffffff, 0x00000000, 0x00000000, 0x00000000, 0x00000001, 0xffffffff
+};
+
+static const ecdsamodel_num ecdsamodel_n = {
+    0xfc632551, 0xf3b9cac2, 0xa7179e84, 0xbce6faad, 0xffffffff, 0xffffffff, 0x00000000, 0xffffffff
+};
+
+static const struct ecdsamodel_point ecdsamodel_g = {
+    { 0xd898c296, 0xf4a13945, 0x2deb33a0, 0x77037d81, 0x63a440f2, 0xf8bce6e5, 0xe12c4247, 0x6b17d1f2 },
+    { 0x37bf51f5, 0xcbb64068, 0x6b315ece, 0x2bce3357, 0x7c0f9e16, 0x8ee7eb4a, 0xfe1a7f9b, 0x4fe342e2 },
+    { 1, 0, 0, 0, 0, 0, 0, 0 }
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: SHA-256
+// *****************************************************************************
+// *****************************************************************************
+
+static uint32_t ecdsamodel_ror(uint32_t x, uint32_t n)
+{
+    return (x >> n) | (x << (32U - n));
+}
+
+static void ecdsamodel_sha256_block(uint32_t *h, const uint8_t *block)
+{
+    uint32_t w[64];
+    uint32_t v[8];
+    uint32_t i;
+
+    for (i = 0; i < 16U; i++)
+    {
+        w[i] = ((uint32_t)block[4U * i] << 24) | ((uint32_t)block[(4U * i) + 1U] << 16) |
+               ((uint32_t)block[(4U * i) + 2U] << 8) | block[(4U * i) + 3U];
+    }
+
+    for (i = 16; i < 64U; i++)
+    {
+        uint32_t s0 = ecdsamodel_ror(w[i - 15U], 7) ^ ecdsamodel_ror(w[i - 15U], 18) ^ (w[i - 15U] >> 3);
+        uint32_t s1 = ecdsamodel_ror(w[i - 2U], 17) ^ ecdsamodel_ror(w[i - 2U], 19) ^ (w[i - 2U] >> 10);
+
+        w[i] = w[i - 16U] + s0 + w[i - 7U] + s1;
+    }
+
+    (void)memcpy(v, h, sizeof(v));
+
+    for (i = 0; i < 64U; i++)
+    {
+        uint32_t s1 = ecdsamodel_ror(v[4], 6) ^ ecdsamodel_ror(v[4], 11) ^ ecdsamodel_ror(v[4], 25);
+        uint32_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        uint32_t t1 = v[7] + s1 + ch + ecdsamodel_sha256_k[i] + w[i];
+        uint32_t s0 = ecdsamodel_ror(v[0], 2) ^ ecdsamodel_ror(v[0], 13) ^ ecdsamodel_ror(v[0], 22);
+        uint32_t mj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+
+        (void)memmove(&v[1], &v[0], 7U * sizeof(uint32_t));
+
+        v[4] += t1;
+        v[0]  = t1 + s0 + mj;
+    }
+
+    for (i = 0; i < 8U; i++)
+    {
+        h[i] += v[i];
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: P-256 arithmetic
+// *****************************************************************************
+// *****************************************************************************
+
+static int ecdsamodel_cmp(const ecdsamodel_num a, const ecdsamodel_num b)
+{
+    uint32_t i = ECDSAMODEL_WORDS;
+
+    while (i-- > 0U)
+    {
+        if (a[i] != b[i])
+        {
+            return (a[i] > b[i]) ? 1 : -1;
+        }
+    }
+
+    return 0;
+}
+
+static bool ecdsamodel_is_zero(const ecdsamodel_num a)
+{
+    static const ecdsamodel_num zero = { 0 };
+
+    return (ecdsamodel_cmp(a, zero) == 0);
+}
+
+static uint32_t ecdsamodel_add(ecdsamodel_num r, const ecdsamodel_num a, const ecdsamodel_num b)
+{
+    uint64_t carry = 0;
+    uint32_t i;
+
+    for (i = 0; i < ECDSAMODEL_WORDS; i++)
+    {
+        carry += (uint64_t)a[i] + b[i];
+        r[i]   = (uint32_t)carry;
+        carry >>= 32;
+    }
+
+    return (uint32_t)carry;
+}
+
+static uint32_t ecdsamodel_sub(ecdsamodel_num r, const ecdsamodel_num a, const ecdsamodel_num b)
+{
+    uint64_t borrow = 0;
+    uint32_t i;
+
+    for (i = 0; i < ECDSAMODEL_WORDS; i++)
+    {
+        uint64_t d = (uint64_t)a[i] - b[i] - borrow;
+
+        r[i]   = (uint32_t)d;
+        borrow = (d >> 63);
+    }
+
+    return (uint32_t)borrow;
+}
+
+/* All modular operations take operands below m */
+static void ecdsamodel_mod_add(ecdsamodel_num r, const ecdsamodel_num a, const ecdsamodel_num b, const ecdsamodel_num m)
+{
+    if ((ecdsamodel_add(r, a, b) != 0U) || (ecdsamodel_cmp(r, m) >= 0))
+    {
+        (void)ecdsamodel_sub(r, r, m);
+    }
+}
+
+static void ecdsamodel_mod_sub(ecdsamodel_num r, const ecdsamodel_num a, const ecdsamodel_num b, const ecdsamodel_num m)
+{
+    if (ecdsamodel_sub(r, a, b) != 0U)
+    {
+        (void)ecdsamodel_add(r, r, m);
+    }
+}
+
+static void ecdsamodel_mod_mul(ecdsamodel_num r, const ecdsamodel_num a, const ecdsamodel_num b, const ecdsamodel_num m)
+{
+    ecdsamodel_num acc = { 0 };
+    uint32_t i = 256;
+
+    while (i-- > 0U)
+    {
+        ecdsamodel_mod_add(acc, acc, acc, m);
+
+        if (((b[i / 32U] >> (i % 32U)) & 1U) != 0U)
+        {
+            ecdsamodel_mod_add(acc, acc, a, m);
+        }
+    }
+
+    (void)memcpy(r, acc, sizeof(acc));
+}
+
+/* a^(m - 2), m prime */
+static void ecdsamodel_mod_inv(ecdsamodel_num r, const ecdsamodel_num a, const ecdsamodel_num m)
+{
+    static const ecdsamodel_num two = { 2 };
+    ecdsamodel_num e;
+    ecdsamodel_num acc = { 1 };
+    uint32_t i = 256;
+
+    (void)ecdsamodel_sub(e, m, two);
+
+    while (i-- > 0U)
+    {
+        ecdsamodel_mod_mul(acc, acc, acc, m);
+
+        if (((e[i / 32U] >> (i % 32U)) & 1U) != 0U)
+        {
+            ecdsamodel_mod_mul(acc, acc, a, m);
+        }
+    }
+
+    (void)memcpy(r, acc, sizeof(acc));
+}
+
+static void ecdsamodel_point_double(struct ecdsamodel_point *r, const struct ecdsamodel_point *a)
+{
+    const uint32_t *p = ecdsamodel_p;
+    ecdsamodel_num delta, gamma, beta, alpha, t1, t2;
+
+    if (ecdsamodel_is_zero(a->z))
+    {
+        *r = *a;
+        return;
+    }
+
+    /* dbl-2001-b, a = -3 */
+    ecdsamodel_mod_mul(delta, a->z, a->z, p);
+    ecdsamodel_mod_mul(gamma, a->y, a->y, p);
+    ecdsamodel_mod_mul(beta, a->x, gamma, p);
+
+    ecdsamodel_mod_sub(t1, a->x, delta, p);
+    ecdsamodel_mod_add(t2, a->x, delta, p);
+    ecdsamodel_mod_mul(t1, t1, t2, p);
+    ecdsamodel_mod_add(alpha, t1, t1, p);
+    ecdsamodel_mod_add(alpha, alpha, t1, p);
+
+    ecdsamodel_mod_add(t1, a->y, a->z, p);
+    ecdsamodel_mod_mul(t1, t1, t1, p);
+    ecdsamodel_mod_sub(t1, t1, gamma, p);
+    ecdsamodel_mod_sub(r->z, t1, delta, p);
+
+    ecdsamodel_mod_add(beta, beta, beta, p);
+    ecdsamodel_mod_add(beta, beta, beta, p);
+    ecdsamodel_mod_mul(t1, alpha, alpha, p);
+    ecdsamodel_mod_add(t2, beta, beta, p);
+    ecdsamodel_mod_sub(r->x, t1, t2, p);
+
+    ecdsamodel_mod_sub(t1, beta, r->x, p);
+    ecdsamodel_mod_mul(t1, alpha, t1, p);
+    ecdsamodel_mod_mul(gamma, gamma, gamma, p);
+    ecdsamodel_mod_add(gamma, gamma, gamma, p);
+    ecdsamodel_mod_add(gamma, gamma, gamma, p);
+    ecdsamodel_mod_add(gamma, gamma, gamma, p);
+    ecdsamodel_mod_sub(r->y, t1, gamma, p);
+}
+
+static void ecdsamodel_point_add(struct ecdsamodel_point *r, const struct ecdsamodel_point *a, const struct ecdsamodel_point *b)
+{
+    const uint32_t *p = ecdsamodel_p;
+    ecdsamodel_num z1z1, z2z2, u1, u2, s1, s2, h, i, j, rr, v, t;
+
+    if (ecdsamodel_is_zero(a->z))
+    {
+        *r = *b;
+        return;
+    }
+
+    if (ecdsamodel_is_zero(b->z))
+    {
+        *r = *a;
+        return;
+    }
+
+    /* add-2007-bl */
+    ecdsamodel_mod_mul(z1z1, a->z, a->z, p);
+    ecdsamodel_mod_mul(z2z2, b->z, b->z, p);
+    ecdsamodel_mod_mul(u1, a->x, z2z2, p);
+    ecdsamodel_mod_mul(u2, b->x, z1z1, p);
+    ecdsamodel_mod_mul(s1, a->y, b->z, p);
+    ecdsamodel_mod_mul(s1, s1, z2z2, p);
+    ecdsamodel_mod_mul(s2, b->y, a->z, p);
+    ecdsamodel_mod_mul(s2, s2, z1z1, p);
+
+    ecdsamodel_mod_sub(h, u2, u1, p);
+    ecdsamodel_mod_sub(rr, s2, s1, p);
+
+    if (ecdsamodel_is_zero(h))
+    {
+        if (ecdsamodel_is_zero(rr))
+        {
+            ecdsamodel_point_double(r, a);
+        }
+        else
+        {
+            (void)memset(r, 0, sizeof(*r));
+        }
+
+        return;
+    }
+
+    ecdsamodel_mod_add(i, h, h, p);
+    ecdsamodel_mod_mul(i, i, i, p);
+    ecdsamodel_mod_mul(j, h, i, p);
+    ecdsamodel_mod_add(rr, rr, rr, p);
+    ecdsamodel_mod_mul(v, u1, i, p);
+
+    ecdsamodel_mod_add(t, a->z, b->z, p);
+    ecdsamodel_mod_mul(t, t, t, p);
+    ecdsamodel_mod_sub(t, t, z1z1, p);
+    ecdsamodel_mod_sub(t, t, z2z2, p);
+    ecdsamodel_mod_mul(r->z, t, h, p);
+
+    ecdsamodel_mod_mul(t, rr, rr, p);
+    ecdsamodel_mod_sub(t, t, j, p);
+    ecdsamodel_mod_sub(t, t, v, p);
+    ecdsamodel_mod_sub(r->x, t, v, p);
+
+    ecdsamodel_mod_sub(t, v, r->x, p);
+    ecdsamodel_mod_mul(t, rr, t, p);
+    ecdsamodel_mod_mul(s1, s1, j, p);
+    ecdsamodel_mod_add(s1, s1, s1, p);
+    ecdsamodel_mod_sub(r->y, t, s1, p);
+}
+
+static void ecdsamodel_load(ecdsamodel_num r, const uint8_t *bytes)
+{
+    uint32_t i;
+
+    for (i = 0; i < ECDSAMODEL_WORDS; i++)
+    {
+        const uint8_t *w = &bytes[PUKCC_P256_SIZE - (4U * (i + 1U))];
+
+        r[i] = ((uint32_t)w[0] << 24) | ((uint32_t)w[1] << 16) | ((uint32_t)w[2] << 8) | w[3];
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Peripheral Library Calls
+// *****************************************************************************
+// *****************************************************************************
+
+void ICM_Initialize( void )
+{
+}
+
+void ICM_Sha256( const void *data, size_t size, uint8_t *digest )
+{
+    uint32_t h[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    const uint8_t *bytes = data;
+    uint8_t  tail[128] = { 0 };
+    size_t   rest = size % 64U;
+    size_t   length = ((rest + 9U) > 64U) ? 128U : 64U;
+    uint64_t bits = (uint64_t)size * 8U;
+    size_t   i;
+
+    for (i = 0; (i + 64U) <= size; i += 64U)
+    {
+        ecdsamodel_sha256_block(h, &bytes[i]);
+    }
+
+    (void)memcpy(tail, &bytes[i], rest);
+    tail[rest] = 0x80U;
+
+    for (i = 0; i < 8U; i++)
+    {
+        tail[length - 1U - i] = (uint8_t)(bits >> (8U * i));
+    }
+
+    for (i = 0; i < length; i += 64U)
+    {
+        ecdsamodel_sha256_block(h, &tail[i]);
+    }
+
+    for (i = 0; i < ICM_SHA256_DIGEST_SIZE; i++)
+    {
+        digest[i] = (uint8_t)(h[i / 4U] >> (24U - (8U * (i % 4U))));
+    }
+}
+
+void PUKCC_Initialize( void )
+{
+}
+
+bool PUKCC_EcdsaP256Verify( const uint8_t *digest, const uint8_t *signature, const uint8_t *public_key )
+{
+    const uint32_t *n = ecdsamodel_n;
+    struct ecdsamodel_point q;
+    struct ecdsamodel_point gq;
+    struct ecdsamodel_point acc;
+    ecdsamodel_num e, r, s, w, u1, u2, zz;
+    uint32_t i = 256;
+
+    ecdsamodel_load(e, digest);
+    ecdsamodel_load(r, &signature[0]);
+    ecdsamodel_load(s, &signature[PUKCC_P256_SIZE]);
+    ecdsamodel_load(q.x, &public_key[0]);
+    ecdsamodel_load(q.y, &public_key[PUKCC_P256_SIZE]);
+    (void)memset(q.z, 0, sizeof(q.z));
+    q.z[0] = 1U;
+
+    if (ecdsamodel_is_zero(r) || ecdsamodel_is_zero(s) ||
+        (ecdsamodel_cmp(r, n) >= 0) || (ecdsamodel_cmp(s, n) >= 0))
+    {
+        return false;
+    }
+
+    if (ecdsamodel_cmp(e, n) >= 0)
+    {
+        (void)ecdsamodel_sub(e, e, n);
+    }
+
+    ecdsamodel_mod_inv(w, s, n);
+    ecdsamodel_mod_mul(u1, e, w, n);
+    ecdsamodel_mod_mul(u2, r, w, n);
+
+    /* u1 G + u2 Q in one pass */
+    ecdsamodel_point_add(&gq, &ecdsamodel_g, &q);
+    (void)memset(&acc, 0, sizeof(acc));
+
+    while (i-- > 0U)
+    {
+        uint32_t b1 = (u1[i / 32U] >> (i % 32U)) & 1U;
+        uint32_t b2 = (u2[i / 32U] >> (i % 32U)) & 1U;
+
+        ecdsamodel_point_double(&acc, &acc);
+
+        if ((b1 != 0U) && (b2 != 0U))
+        {
+            ecdsamodel_point_add(&acc, &acc, &gq);
+        }
+        else if (b1 != 0U)
+        {
+            ecdsamodel_point_add(&acc, &acc, &ecdsamodel_g);
+        }
+        else if (b2 != 0U)
+        {
+            ecdsamodel_point_add(&acc, &acc, &q);
+        }
+    }
+
+    if (ecdsamodel_is_zero(acc.z))
+    {
+        return false;
+    }
+
+    /* x = X / Z^2, compared mod n */
+    ecdsamodel_mod_mul(zz, acc.z, acc.z, ecdsamodel_p);
+    ecdsamodel_mod_inv(zz, zz, ecdsamodel_p);
+    ecdsamodel_mod_mul(acc.x, acc.x, zz, ecdsamodel_p);
+
+    if (ecdsamodel_cmp(acc.x, n) >= 0)
+    {
+        (void)ecdsamodel_sub(acc.x, acc.x, n);
+    }
+
+    return (ecdsamodel_cmp(acc.x, r) == 0);
+}
+
+#endif
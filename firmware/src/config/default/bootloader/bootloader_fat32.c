@@ -0,0 +1,498 @@
+/*******************************************************************************
+  Bootloader FAT32 Reader Source File
+
+  File Name:
+    bootloader_fat32.c
+
+  Summary:
+    This file contains a minimal read-only FAT32 reader.
+
+  Description:
+    Only what is needed to stream one file off an SD card: the volume is
+    located through the MBR, the file is looked up by its path, matching
+    long or short names, and its cluster chain is walked one FAT sector at
+    a time. A single sector buffer serves as cache for FAT and directory
+    sectors. Nothing is ever written to the card.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "configuration.h"
+#include "peripheral/sdhc/plib_sdhc0.h"
+#include "bootloader_fat32.h"
+
+#if (BTL_SDCARD == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define FAT32_NO_SECTOR             0xFFFFFFFFUL
+
+#define FAT32_SIGNATURE_OFFSET      510U
+#define FAT32_SIGNATURE             0xAA55U
+
+/* First MBR partition entry */
+#define FAT32_PARTITION_OFFSET      446U
+#define FAT32_PARTITION_TYPE        4U
+#define FAT32_PARTITION_LBA         8U
+#define FAT32_TYPE_CHS              0x0BU
+#define FAT32_TYPE_LBA              0x0CU
+
+/* BIOS parameter block */
+#define FAT32_BPB_BYTES_PER_SECTOR  11U
+#define FAT32_BPB_SECTORS_PER_CLUS  13U
+#define FAT32_BPB_RESERVED_SECTORS  14U
+#define FAT32_BPB_NUM_FATS          16U
+#define FAT32_BPB_FAT_SIZE_16       22U
+#define FAT32_BPB_TOTAL_SECTORS     32U
+#define FAT32_BPB_FAT_SIZE          36U
+#define FAT32_BPB_ROOT_CLUSTER      44U
+
+/* Directory entries */
+#define FAT32_DIR_ENTRY_SIZE        32U
+#define FAT32_DIR_NAME_SIZE         11U
+#define FAT32_DIR_ATTRIBUTES        11U
+#define FAT32_DIR_CLUSTER_HIGH      20U
+#define FAT32_DIR_CLUSTER_LOW       26U
+#define FAT32_DIR_FILE_SIZE         28U
+
+#define FAT32_DIR_END               0x00U
+#define FAT32_DIR_DELETED           0xE5U
+
+/* Also set in every long name entry */
+#define FAT32_ATTR_VOLUME_ID        0x08U
+#define FAT32_ATTR_DIRECTORY        0x10U
+
+/* Long name entries precede the short entry, the last part of the name
+ * first, each with 13 UCS-2 characters and the short name checksum */
+#define FAT32_ATTR_LONG_NAME        0x0FU
+#define FAT32_LFN_LAST              0x40U
+#define FAT32_LFN_ORDINAL_Msk       0x1FU
+#define FAT32_LFN_CHECKSUM          13U
+#define FAT32_LFN_CHARS             13U
+
+#define FAT32_FIRST_CLUSTER         2U
+#define FAT32_CLUSTER_MASK          0x0FFFFFFFUL
+#define FAT32_ENTRIES_PER_SECTOR    (BTL_FAT32_SECTOR_SIZE / 4U)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static uint32_t fat32_sector[BTL_FAT32_SECTOR_SIZE / 4U];
+static uint8_t  *const fat32_bytes  = (uint8_t *)fat32_sector;
+static uint32_t fat32_cached        = FAT32_NO_SECTOR;
+
+static uint32_t fat32_fat_start     = 0;
+static uint32_t fat32_data_start    = 0;
+static uint32_t fat32_cluster_size  = 0;
+static uint32_t fat32_clusters      = 0;
+static uint32_t fat32_root_cluster  = 0;
+
+/* Read position: cluster and sector within it */
+static uint32_t fat32_cluster       = 0;
+static uint32_t fat32_offset        = 0;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: FAT32 Reader Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static uint32_t fat32_get16(const uint8_t *src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8);
+}
+
+static uint32_t fat32_get32(const uint8_t *src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) |
+           ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+/* Returns the sector through the cache, or NULL on a card error */
+static const uint8_t *fat32_sector_read(uint32_t lba)
+{
+    SDHC0_XFER_STATUS status;
+
+    if (lba == fat32_cached)
+    {
+        return fat32_bytes;
+    }
+
+    fat32_cached = FAT32_NO_SECTOR;
+
+    if (SDHC0_ReadStart(lba, fat32_sector, 1U) == false)
+    {
+        return NULL;
+    }
+
+    do
+    {
+        status = SDHC0_ReadStatusGet();
+    } while (status == SDHC0_XFER_BUSY);
+
+    if (status != SDHC0_XFER_DONE)
+    {
+        return NULL;
+    }
+
+    fat32_cached = lba;
+
+    return fat32_bytes;
+}
+
+static bool fat32_cluster_is_valid(uint32_t cluster)
+{
+    return (cluster >= FAT32_FIRST_CLUSTER) && (cluster < (fat32_clusters + FAT32_FIRST_CLUSTER));
+}
+
+/* Returns 0, which is no valid cluster, if the FAT can not be read */
+static uint32_t fat32_cluster_next(uint32_t cluster)
+{
+    const uint8_t *sector = fat32_sector_read(fat32_fat_start + (cluster / FAT32_ENTRIES_PER_SECTOR));
+
+    if (sector == NULL)
+    {
+        return 0;
+    }
+
+    return fat32_get32(&sector[(cluster % FAT32_ENTRIES_PER_SECTOR) * 4U]) & FAT32_CLUSTER_MASK;
+}
+
+static bool fat32_is_volume(const uint8_t *sector)
+{
+    uint32_t cluster_size = sector[FAT32_BPB_SECTORS_PER_CLUS];
+
+    return (fat32_get16(&sector[FAT32_SIGNATURE_OFFSET]) == FAT32_SIGNATURE) &&
+           (fat32_get16(&sector[FAT32_BPB_BYTES_PER_SECTOR]) == BTL_FAT32_SECTOR_SIZE) &&
+           (cluster_size != 0U) && ((cluster_size & (cluster_size - 1U)) == 0U) &&
+           (sector[FAT32_BPB_NUM_FATS] != 0U) &&
+           (fat32_get16(&sector[FAT32_BPB_FAT_SIZE_16]) == 0U) &&
+           (fat32_get32(&sector[FAT32_BPB_FAT_SIZE]) != 0U);
+}
+
+static uint32_t fat32_upper(uint32_t c)
+{
+    return ((c >= 'a') && (c <= 'z')) ? (c - 'a' + 'A') : c;
+}
+
+/* Space padded upper case 8.3 name as stored in a directory entry */
+static void fat32_name_pack(const char *name, uint32_t length, uint8_t *packed)
+{
+    uint32_t i = 0;
+    uint32_t limit = 8U;
+    uint32_t n;
+
+    memset(packed, ' ', FAT32_DIR_NAME_SIZE);
+
+    for (n = 0; n < length; n++)
+    {
+        if (name[n] == '.')
+        {
+            i       = 8U;
+            limit   = FAT32_DIR_NAME_SIZE;
+        }
+        else if (i < limit)
+        {
+            packed[i++] = (uint8_t)fat32_upper((uint8_t)name[n]);
+        }
+        else
+        {
+            /* Longer than 8.3, cut off */
+        }
+    }
+}
+
+static uint8_t fat32_name_checksum(const uint8_t *entry)
+{
+    uint8_t sum = 0;
+    uint32_t i;
+
+    for (i = 0; i < FAT32_DIR_NAME_SIZE; i++)
+    {
+        sum = (uint8_t)(((sum & 1U) << 7) + (sum >> 1) + entry[i]);
+    }
+
+    return sum;
+}
+
+/* Compares the characters of one long name entry with the part of the name
+ * they hold. The name ends where the entry has its terminating zero. */
+static bool fat32_lfn_matches(const uint8_t *entry, const char *name, uint32_t length)
+{
+    static const uint8_t offsets[FAT32_LFN_CHARS] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+    uint32_t position = ((entry[0] & FAT32_LFN_ORDINAL_Msk) - 1U) * FAT32_LFN_CHARS;
+    uint32_t i, c;
+
+    for (i = 0; i < FAT32_LFN_CHARS; i++, position++)
+    {
+        c = fat32_get16(&entry[offsets[i]]);
+
+        if (position == length)
+        {
+            return (c == 0U);
+        }
+
+        if ((c >= 0x80U) || (fat32_upper(c) != fat32_upper((uint8_t)name[position])))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Searches the directory at the read position for one part of a path. On
+ * a match the reader is positioned at the start of the entry's data. */
+static bool fat32_entry_find(const char *name, uint32_t length, bool directory, uint32_t *size)
+{
+    uint8_t packed[FAT32_DIR_NAME_SIZE];
+    const uint8_t *sector;
+    const uint8_t *entry;
+    uint32_t lba, i, cluster;
+    uint32_t expected = 0;
+    uint8_t checksum = 0;
+    bool matched = false;
+    bool found;
+
+    fat32_name_pack(name, length, packed);
+
+    while (bootloader_Fat32Run(&lba, 1U) == 1U)
+    {
+        sector = fat32_sector_read(lba);
+
+        if (sector == NULL)
+        {
+            return false;
+        }
+
+        for (i = 0; i < BTL_FAT32_SECTOR_SIZE; i += FAT32_DIR_ENTRY_SIZE)
+        {
+            entry = &sector[i];
+
+            if (entry[0] == FAT32_DIR_END)
+            {
+                return false;
+            }
+
+            if (entry[0] == FAT32_DIR_DELETED)
+            {
+                expected = 0;
+                continue;
+            }
+
+            /* A long name is only taken when all of its entries came in
+             * order and belong to the short entry behind them */
+            if (entry[FAT32_DIR_ATTRIBUTES] == FAT32_ATTR_LONG_NAME)
+            {
+                if ((entry[0] & FAT32_LFN_LAST) != 0U)
+                {
+                    expected = entry[0] & FAT32_LFN_ORDINAL_Msk;
+                    checksum = entry[FAT32_LFN_CHECKSUM];
+                    matched  = (length <= (expected * FAT32_LFN_CHARS));
+                }
+
+                if ((expected == 0U) || ((entry[0] & FAT32_LFN_ORDINAL_Msk) != expected) ||
+                    (entry[FAT32_LFN_CHECKSUM] != checksum))
+                {
+                    expected = 0;
+                    matched  = false;
+                }
+                else
+                {
+                    matched = matched && fat32_lfn_matches(entry, name, length);
+                    expected--;
+                }
+
+                continue;
+            }
+
+            found = (matched == true) && (expected == 0U) && (fat32_name_checksum(entry) == checksum);
+            found = found || (memcmp(entry, packed, FAT32_DIR_NAME_SIZE) == 0);
+
+            expected = 0;
+            matched  = false;
+
+            if ((found == false) || ((entry[FAT32_DIR_ATTRIBUTES] & FAT32_ATTR_VOLUME_ID) != 0U) ||
+                (((entry[FAT32_DIR_ATTRIBUTES] & FAT32_ATTR_DIRECTORY) != 0U) != directory))
+            {
+                continue;
+            }
+
+            *size   = fat32_get32(&entry[FAT32_DIR_FILE_SIZE]);
+            cluster = (fat32_get16(&entry[FAT32_DIR_CLUSTER_HIGH]) << 16) | fat32_get16(&entry[FAT32_DIR_CLUSTER_LOW]);
+
+            /* ".." of a directory below the root */
+            if ((directory == true) && (cluster == 0U))
+            {
+                cluster = fat32_root_cluster;
+            }
+
+            fat32_cluster = cluster;
+            fat32_offset  = 0;
+
+            return ((directory == false) && (*size == 0U)) || fat32_cluster_is_valid(cluster);
+        }
+    }
+
+    return false;
+}
+
+bool bootloader_Fat32Mount(void)
+{
+    const uint8_t *sector = fat32_sector_read(0);
+    uint32_t volume = 0;
+    uint8_t type;
+
+    if (sector == NULL)
+    {
+        return false;
+    }
+
+    /* Cards are normally partitioned, but a volume may also start at 0 */
+    if (fat32_is_volume(sector) == false)
+    {
+        type = sector[FAT32_PARTITION_OFFSET + FAT32_PARTITION_TYPE];
+
+        if ((fat32_get16(&sector[FAT32_SIGNATURE_OFFSET]) != FAT32_SIGNATURE) ||
+            ((type != FAT32_TYPE_CHS) && (type != FAT32_TYPE_LBA)))
+        {
+            return false;
+        }
+
+        volume = fat32_get32(&sector[FAT32_PARTITION_OFFSET + FAT32_PARTITION_LBA]);
+        sector = fat32_sector_read(volume);
+
+        if ((sector == NULL) || (fat32_is_volume(sector) == false))
+        {
+            return false;
+        }
+    }
+
+    fat32_cluster_size  = sector[FAT32_BPB_SECTORS_PER_CLUS];
+    fat32_fat_start     = volume + fat32_get16(&sector[FAT32_BPB_RESERVED_SECTORS]);
+    fat32_data_start    = fat32_fat_start + (sector[FAT32_BPB_NUM_FATS] * fat32_get32(&sector[FAT32_BPB_FAT_SIZE]));
+    fat32_root_cluster  = fat32_get32(&sector[FAT32_BPB_ROOT_CLUSTER]);
+    fat32_clusters      = (fat32_get32(&sector[FAT32_BPB_TOTAL_SECTORS]) - (fat32_data_start - volume)) / fat32_cluster_size;
+
+    return fat32_cluster_is_valid(fat32_root_cluster);
+}
+
+bool bootloader_Fat32Open(const char *path, uint32_t *size)
+{
+    uint32_t length;
+    bool directory;
+
+    fat32_cluster = fat32_root_cluster;
+    fat32_offset  = 0;
+
+    while (*path == '/')
+    {
+        path++;
+    }
+
+    for ( ; ; )
+    {
+        for (length = 0; (path[length] != '\0') && (path[length] != '/'); length++)
+        {
+        }
+
+        directory = (path[length] == '/');
+
+        if (fat32_entry_find(path, length, directory, size) == false)
+        {
+            return false;
+        }
+
+        if (directory == false)
+        {
+            return true;
+        }
+
+        path += length + 1U;
+    }
+}
+
+uint32_t bootloader_Fat32Run(uint32_t *lba, uint32_t max)
+{
+    uint32_t count = 0;
+    uint32_t next, n;
+    bool contiguous;
+
+    if (fat32_cluster_is_valid(fat32_cluster) == false)
+    {
+        return 0;
+    }
+
+    *lba = fat32_data_start + ((fat32_cluster - FAT32_FIRST_CLUSTER) * fat32_cluster_size) + fat32_offset;
+
+    while (count < max)
+    {
+        n = fat32_cluster_size - fat32_offset;
+
+        if (n > (max - count))
+        {
+            n = max - count;
+        }
+
+        count        += n;
+        fat32_offset += n;
+
+        if (fat32_offset < fat32_cluster_size)
+        {
+            break;
+        }
+
+        next       = fat32_cluster_next(fat32_cluster);
+        contiguous = (next == (fat32_cluster + 1U));
+
+        fat32_cluster = next;
+        fat32_offset  = 0;
+
+        /* A run ends where the chain jumps, or where it ends */
+        if ((contiguous == false) || (fat32_cluster_is_valid(next) == false))
+        {
+            break;
+        }
+    }
+
+    return count;
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*******************************************************************************
+  Bootloader FAT32 Reader Header File
+
+  File Name:
+    bootloader_fat32.h
+
+  Summary:
+    This file contains the interface of the read-only FAT32 reader.
+
+  Description:
+    Finds one file by its path on a FAT32 volume on the SD card and returns its data as runs of consecutive sectors, so the caller can move
+    each run with a single multi-block read. Sectors are read through the
+    SDHC0 library calls; a host build backs those with a disk image file.
+ *******************************************************************************/
+
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef BOOTLOADER_FAT32_H
+#define BOOTLOADER_FAT32_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BTL_FAT32_SECTOR_SIZE       512U
+
+// *****************************************************************************
+/* Function:
+    bool bootloader_Fat32Mount( void );
+
+ Summary:
+    Finds the FAT32 volume, either in the first primary partition or on a
+    card without partition table.
+*/
+bool bootloader_Fat32Mount( void );
+
+// *****************************************************************************
+/* Function:
+    bool bootloader_Fat32Open( const char *path, uint32_t *size );
+
+ Summary:
+    Looks up a file, e.g. "FIRMWARE.BIN" or "updates/Firmware 2.1.bin", and
+    positions the reader at the start of the file.
+
+ Remarks:
+    Directories are separated by '/'. Each part of the path is matched
+    against the long name of an entry, or else its 8.3 short name. The
+    comparison is case insensitive; long names match in ASCII only.
+*/
+bool bootloader_Fat32Open( const char *path, uint32_t *size );
+
+// *****************************************************************************
+/* Function:
+    uint32_t bootloader_Fat32Run( uint32_t *lba, uint32_t max );
+
+ Summary:
+    Returns how many of the next sectors of the open file follow each other
+    on the card, at most max, and the first of them in lba.
+
+ Description:
+    The reader advances past the returned sectors. Consecutive clusters are
+    merged into one run. Returns 0 at the end of the cluster chain or if a
+    FAT sector can not be read.
+
+ Remarks:
+    FAT sectors are read synchronously; no other read may be in progress.
+*/
+uint32_t bootloader_Fat32Run( uint32_t *lba, uint32_t max );
+
+#endif
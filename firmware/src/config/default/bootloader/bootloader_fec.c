@@ -0,0 +1,352 @@
+/*******************************************************************************
+  Bootloader Forward Error Correction Source File
+
+  File Name:
+    bootloader_fec.c
+
+  Summary:
+    This file contains the Reed-Solomon decoder of FEC_DATA packets.
+
+  Description:
+    Each codeword is decoded on its own, errors only:
+
+      - syndromes, all zero for a codeword received intact,
+      - error locator by Berlekamp-Massey,
+      - error positions by a Chien search over the shortened codeword,
+      - error values by Forney's formula.
+
+    A codeword is given up on when the locator has more roots than the
+    parity corrects or roots outside the codeword. The decoder has no
+    hardware dependency so it can be built and exercised on a host.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "configuration.h"
+#include "bootloader_protocol.h"
+#include "bootloader_fec.h"
+
+#if (BTL_FEC == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+/* Nonzero elements of GF(256) */
+#define FEC_FIELD_ORDER             255U
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+/* Powers of the generator, twice so that the sum of two logarithms indexes
+ * it directly */
+static const uint8_t fec_exp[2U * FEC_FIELD_ORDER + 2U] = {
+    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1d, 0x3a, 0x74, 0xe8, 0xcd, 0x87, 0x13, 0x26,
+    0x4c, 0x98, 0x2d, 0x5a, 0xb4, 0x75, 0xea, 0xc9, 0x8f, 0x03, 0x06, 0x0c, 0x18, 0x30, 0x60, 0xc0,
+    0x9d, 0x27, 0x4e, 0x9c, 0x25, 0x4a, 0x94, 0x35, 0x6a, 0xd4, 0xb5, 0x77, 0xee, 0xc1, 0x9f, 0x23,
+    0x46, 0x8c, 0x05, 0x0a, 0x14, 0x28, 0x50, 0xa0, 0x5d, 0xba, 0x69, 0xd2, 0xb9, 0x6f, 0xde, 0xa1,
+    0x5f, 0xbe, 0x61, 0xc2, 0x99, 0x2f, 0x5e, 0xbc, 0x65, 0xca, 0x89, 0x0f, 0x1e, 0x3c, 0x78, 0xf0,
+    0xfd, 0xe7, 0xd3, 0xbb, 0x6b, 0xd6, 0xb1, 0x7f, 0xfe, 0xe1, 0xdf, 0xa3, 0x5b, 0xb6, 0x71, 0xe2,
+    0xd9, 0xaf, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0d, 0x1a, 0x34, 0x68, 0xd0, 0xbd, 0x67, 0xce,
+    0x81, 0x1f, 0x3e, 0x7c, 0xf8, 0xed, 0xc7, 0x93, 0x3b, 0x76, 0xec, 0xc5, 0x97, 0x33, 0x66, 0xcc,
+    0x85, 0x17, 0x2e, 0x5c, 0xb8, 0x6d, 0xda, 0xa9, 0x4f, 0x9e, 0x21, 0x42, 0x84, 0x15, 0x2a, 0x54,
+    0xa8, 0x4d, 0x9a, 0x29, 0x52, 0xa4, 0x55, 0xaa, 0x49, 0x92, 0x39, 0x72, 0xe4, 0xd5, 0xb7, 0x73,
+    0xe6, 0xd1, 0xbf, 0x63, 0xc6, 0x91, 0x3f, 0x7e, 0xfc, 0xe5, 0xd7, 0xb3, 0x7b, 0xf6, 0xf1, 0xff,
+    0xe3, 0xdb, 0xab, 0x4b, 0x96, 0x31, 0x62, 0xc4, 0x95, 0x37, 0x6e, 0xdc, 0xa5, 0x57, 0xae, 0x41,
+    0x82, 0x19, 0x32, 0x64, 0xc8, 0x8d, 0x07, 0x0e, 0x1c, 0x38, 0x70, 0xe0, 0xdd, 0xa7, 0x53, 0xa6,
+    0x51, 0xa2, 0x59, 0xb2, 0x79, 0xf2, 0xf9, 0xef, 0xc3, 0x9b, 0x2b, 0x56, 0xac, 0x45, 0x8a, 0x09,
+    0x12, 0x24, 0x48, 0x90, 0x3d, 0x7a, 0xf4, 0xf5, 0xf7, 0xf3, 0xfb, 0xeb, 0xcb, 0x8b, 0x0b, 0x16,
+    0x2c, 0x58, 0xb0, 0x7d, 0xfa, 0xe9, 0xcf, 0x83, 0x1b, 0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e, 0x01,
+    0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1d, 0x3a, 0x74, 0xe8, 0xcd, 0x87, 0x13, 0x26, 0x4c,
+    0x98, 0x2d, 0x5a, 0xb4, 0x75, 0xea, 0xc9, 0x8f, 0x03, 0x06, 0x0c, 0x18, 0x30, 0x60, 0xc0, 0x9d,
+    0x27, 0x4e, 0x9c, 0x25, 0x4a, 0x94, 0x35, 0x6a, 0xd4, 0xb5, 0x77, 0xee, 0xc1, 0x9f, 0x23, 0x46,
+    0x8c, 0x05, 0x0a, 0x14, 0x28, 0x50, 0xa0, 0x5d, 0xba, 0x69, 0xd2, 0xb9, 0x6f, 0xde, 0xa1, 0x5f,
+    0xbe, 0x61, 0xc2, 0x99, 0x2f, 0x5e, 0xbc, 0x65, 0xca, 0x89, 0x0f, 0x1e, 0x3c, 0x78, 0xf0, 0xfd,
+    0xe7, 0xd3, 0xbb, 0x6b, 0xd6, 0xb1, 0x7f, 0xfe, 0xe1, 0xdf, 0xa3, 0x5b, 0xb6, 0x71, 0xe2, 0xd9,
+    0xaf, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0d, 0x1a, 0x34, 0x68, 0xd0, 0xbd, 0x67, 0xce, 0x81,
+    0x1f, 0x3e, 0x7c, 0xf8, 0xed, 0xc7, 0x93, 0x3b, 0x76, 0xec, 0xc5, 0x97, 0x33, 0x66, 0xcc, 0x85,
+    0x17, 0x2e, 0x5c, 0xb8, 0x6d, 0xda, 0xa9, 0x4f, 0x9e, 0x21, 0x42, 0x84, 0x15, 0x2a, 0x54, 0xa8,
+    0x4d, 0x9a, 0x29, 0x52, 0xa4, 0x55, 0xaa, 0x49, 0x92, 0x39, 0x72, 0xe4, 0xd5, 0xb7, 0x73, 0xe6,
+    0xd1, 0xbf, 0x63, 0xc6, 0x91, 0x3f, 0x7e, 0xfc, 0xe5, 0xd7, 0xb3, 0x7b, 0xf6, 0xf1, 0xff, 0xe3,
+    0xdb, 0xab, 0x4b, 0x96, 0x31, 0x62, 0xc4, 0x95, 0x37, 0x6e, 0xdc, 0xa5, 0x57, 0xae, 0x41, 0x82,
+    0x19, 0x32, 0x64, 0xc8, 0x8d, 0x07, 0x0e, 0x1c, 0x38, 0x70, 0xe0, 0xdd, 0xa7, 0x53, 0xa6, 0x51,
+    0xa2, 0x59, 0xb2, 0x79, 0xf2, 0xf9, 0xef, 0xc3, 0x9b, 0x2b, 0x56, 0xac, 0x45, 0x8a, 0x09, 0x12,
+    0x24, 0x48, 0x90, 0x3d, 0x7a, 0xf4, 0xf5, 0xf7, 0xf3, 0xfb, 0xeb, 0xcb, 0x8b, 0x0b, 0x16, 0x2c,
+    0x58, 0xb0, 0x7d, 0xfa, 0xe9, 0xcf, 0x83, 0x1b, 0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e, 0x01, 0x02,
+};
+
+/* Logarithms to the generator, fec_log[0] is unused */
+static const uint8_t fec_log[FEC_FIELD_ORDER + 1U] = {
+    0x00, 0x00, 0x01, 0x19, 0x02, 0x32, 0x1a, 0xc6, 0x03, 0xdf, 0x33, 0xee, 0x1b, 0x68, 0xc7, 0x4b,
+    0x04, 0x64, 0xe0, 0x0e, 0x34, 0x8d, 0xef, 0x81, 0x1c, 0xc1, 0x69, 0xf8, 0xc8, 0x08, 0x4c, 0x71,
+    0x05, 0x8a, 0x65, 0x2f, 0xe1, 0x24, 0x0f, 0x21, 0x35, 0x93, 0x8e, 0xda, 0xf0, 0x12, 0x82, 0x45,
+    0x1d, 0xb5, 0xc2, 0x7d, 0x6a, 0x27, 0xf9, 0xb9, 0xc9, 0x9a, 0x09, 0x78, 0x4d, 0xe4, 0x72, 0xa6,
+    0x06, 0xbf, 0x8b, 0x62, 0x66, 0xdd, 0x30, 0xfd, 0xe2, 0x98, 0x25, 0xb3, 0x10, 0x91, 0x22, 0x88,
+    0x36, 0xd0, 0x94, 0xce, 0x8f, 0x96, 0xdb, 0xbd, 0xf1, 0xd2, 0x13, 0x5c, 0x83, 0x38, 0x46, 0x40,
+    0x1e, 0x42, 0xb6, 0xa3, 0xc3, 0x48, 0x7e, 0x6e, 0x6b, 0x3a, 0x28, 0x54, 0xfa, 0x85, 0xba, 0x3d,
+    0xca, 0x5e, 0x9b, 0x9f, 0x0a, 0x15, 0x79, 0x2b, 0x4e, 0xd4, 0xe5, 0xac, 0x73, 0xf3, 0xa7, 0x57,
+    0x07, 0x70, 0xc0, 0xf7, 0x8c, 0x80, 0x63, 0x0d, 0x67, 0x4a, 0xde, 0xed, 0x31, 0xc5, 0xfe, 0x18,
+    0xe3, 0xa5, 0x99, 0x77, 0x26, 0xb8, 0xb4, 0x7c, 0x11, 0x44, 0x92, 0xd9, 0x23, 0x20, 0x89, 0x2e,
+    0x37, 0x3f, 0xd1, 0x5b, 0x95, 0xbc, 0xcf, 0xcd, 0x90, 0x87, 0x97, 0xb2, 0xdc, 0xfc, 0xbe, 0x61,
+    0xf2, 0x56, 0xd3, 0xab, 0x14, 0x2a, 0x5d, 0x9e, 0x84, 0x3c, 0x39, 0x53, 0x47, 0x6d, 0x41, 0xa2,
+    0x1f, 0x2d, 0x43, 0xd8, 0xb7, 0x7b, 0xa4, 0x76, 0xc4, 0x17, 0x49, 0xec, 0x7f, 0x0c, 0x6f, 0xf6,
+    0x6c, 0xa1, 0x3b, 0x52, 0x29, 0x9d, 0x55, 0xaa, 0xfb, 0x60, 0x86, 0xb1, 0xbb, 0xcc, 0x3e, 0x5a,
+    0xcb, 0x59, 0x5f, 0xb0, 0x9c, 0xa9, 0xa0, 0x51, 0x0b, 0xf5, 0x16, 0xeb, 0x7a, 0x75, 0x2c, 0xd7,
+    0x4f, 0xae, 0xd5, 0xe9, 0xe6, 0xe7, 0xad, 0xe8, 0x74, 0xd6, 0xf4, 0xea, 0xa8, 0x50, 0x58, 0xaf,
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Bootloader Local Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static uint8_t fec_mul(uint8_t a, uint8_t b)
+{
+    if ((a == 0U) || (b == 0U))
+    {
+        return 0;
+    }
+
+    return fec_exp[fec_log[a] + fec_log[b]];
+}
+
+static uint8_t fec_div(uint8_t a, uint8_t b)
+{
+    if (a == 0U)
+    {
+        return 0;
+    }
+
+    return fec_exp[fec_log[a] + FEC_FIELD_ORDER - fec_log[b]];
+}
+
+/* Value of the polynomial poly[0] + poly[1] x + ... at x = 2^power */
+static uint8_t fec_eval(const uint8_t *poly, uint32_t degree, uint32_t power)
+{
+    uint8_t  value = 0;
+    uint32_t i = degree + 1U;
+
+    while (i-- > 0U)
+    {
+        value = (uint8_t)(fec_mul(value, fec_exp[power]) ^ poly[i]);
+    }
+
+    return value;
+}
+
+/* Returns true if all syndromes are zero */
+static bool fec_syndromes(const uint8_t *codeword, uint32_t length, uint32_t parity, uint8_t *syndromes)
+{
+    uint8_t  errors = 0;
+    uint32_t i;
+    uint32_t j;
+
+    for (i = 0; i < parity; i++)
+    {
+        uint8_t s = 0;
+
+        for (j = 0; j < length; j++)
+        {
+            s = (uint8_t)(fec_mul(s, fec_exp[i]) ^ codeword[j]);
+        }
+
+        syndromes[i] = s;
+        errors |= s;
+    }
+
+    return (errors == 0U);
+}
+
+/* Error locator of the syndromes, returns its degree */
+static uint32_t fec_locator(const uint8_t *syndromes, uint32_t parity, uint8_t *lambda)
+{
+    uint8_t  prev[BTL_FEC_PARITY_MAX + 1U] = { 1 };
+    uint8_t  last[BTL_FEC_PARITY_MAX + 1U];
+    uint8_t  b = 1;
+    uint32_t degree = 0;
+    uint32_t shift = 1;
+    uint32_t i;
+    uint32_t k;
+
+    memset(lambda, 0, parity + 1U);
+    lambda[0] = 1;
+
+    for (k = 0; k < parity; k++)
+    {
+        uint8_t d = syndromes[k];
+        uint8_t coef;
+
+        for (i = 1; i <= degree; i++)
+        {
+            d ^= fec_mul(lambda[i], syndromes[k - i]);
+        }
+
+        if (d == 0U)
+        {
+            shift++;
+            continue;
+        }
+
+        coef = fec_div(d, b);
+
+        memcpy(last, lambda, parity + 1U);
+
+        for (i = 0; (i + shift) <= parity; i++)
+        {
+            lambda[i + shift] ^= fec_mul(coef, prev[i]);
+        }
+
+        if ((2U * degree) <= k)
+        {
+            degree = k + 1U - degree;
+            memcpy(prev, last, parity + 1U);
+            b = d;
+            shift = 1;
+        }
+        else
+        {
+            shift++;
+        }
+    }
+
+    return degree;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Bootloader Global Functions
+// *****************************************************************************
+// *****************************************************************************
+
+bool bootloader_FecLayout(uint32_t size, struct btl_fec_layout *layout)
+{
+    uint32_t parity;
+
+    for (parity = 2; parity <= BTL_FEC_PARITY_MAX; parity += 2U)
+    {
+        if (size == BTL_FEC_PAYLOAD_SIZE(parity))
+        {
+            layout->parity    = parity;
+            layout->codewords = BTL_FEC_CODEWORDS(parity);
+            layout->length    = BTL_FEC_MESSAGE_BYTES(parity) + parity;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool bootloader_FecDecode(const uint8_t *data, const struct btl_fec_layout *layout,
+                          uint32_t index, uint8_t *codeword)
+{
+    uint8_t  syndromes[BTL_FEC_PARITY_MAX];
+    uint8_t  lambda[BTL_FEC_PARITY_MAX + 1U];
+    uint8_t  omega[BTL_FEC_PARITY_MAX];
+    uint32_t length = layout->length;
+    uint32_t parity = layout->parity;
+    uint32_t degree;
+    uint32_t found = 0;
+    uint32_t i;
+    uint32_t j;
+
+    for (j = 0; j < length; j++)
+    {
+        codeword[j] = data[(j * layout->codewords) + index];
+    }
+
+    if (fec_syndromes(codeword, length, parity, syndromes) == true)
+    {
+        return true;
+    }
+
+    degree = fec_locator(syndromes, parity, lambda);
+
+    if ((2U * degree) > parity)
+    {
+        return false;
+    }
+
+    /* Error evaluator, syndromes times locator modulo x^parity */
+    for (i = 0; i < parity; i++)
+    {
+        omega[i] = 0;
+
+        for (j = 0; (j <= i) && (j <= degree); j++)
+        {
+            omega[i] ^= fec_mul(syndromes[i - j], lambda[j]);
+        }
+    }
+
+    /* Byte j stands for x^(length - 1 - j), it is wrong if the locator has
+     * a root at the inverse of that position */
+    for (j = 0; j < length; j++)
+    {
+        uint32_t power = length - 1U - j;
+        uint32_t inverse = (FEC_FIELD_ORDER - power) % FEC_FIELD_ORDER;
+        uint8_t  derivative = 0;
+        uint8_t  value;
+
+        if (fec_eval(lambda, degree, inverse) != 0U)
+        {
+            continue;
+        }
+
+        /* Formal derivative, only the odd terms remain */
+        for (i = 1; i <= degree; i += 2U)
+        {
+            derivative ^= fec_mul(lambda[i], fec_exp[((i - 1U) * inverse) % FEC_FIELD_ORDER]);
+        }
+
+        if (derivative == 0U)
+        {
+            return false;
+        }
+
+        value = fec_div(fec_eval(omega, parity - 1U, inverse), derivative);
+
+        codeword[j] ^= fec_mul(fec_exp[power], value);
+
+        found++;
+    }
+
+    return (found == degree);
+}
+
+#endif
@@ -0,0 +1,104 @@
+/*******************************************************************************
+  Bootloader Forward Error Correction Header File
+
+  File Name:
+    bootloader_fec.h
+
+  Summary:
+    This file describes the Reed-Solomon code protecting FEC_DATA packets.
+
+  Description:
+    An FEC_DATA packet carries the same block address and erase block as a
+    DATA packet, the message, as Reed-Solomon codewords over GF(256):
+
+      - the block address in clear, for links tracking the blocks a node
+        programmed,
+      - the message split into codewords of equal length, the last one
+        padded with zeros, each followed by its parity bytes,
+      - codewords interleaved byte by byte: byte j of codeword i is sent at
+        j * codewords + i, so a burst of errors is spread over all of them.
+
+    A codeword with parity bytes p corrects up to p / 2 wrong bytes. The
+    host picks p for each packet, the receiver derives it from the payload
+    size, see BTL_FEC_PAYLOAD_SIZE. The field polynomial is 0x11D with
+    generator 2, the code polynomial has the roots 2^0 .. 2^(p-1).
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef BOOTLOADER_FEC_H
+#define BOOTLOADER_FEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Longest codeword of the code */
+#define BTL_FEC_CODEWORD_SIZE       255U
+
+// *****************************************************************************
+/* FEC Layout
+
+  Description:
+    - parity    : parity bytes per codeword
+    - codewords : number of codewords in the packet
+    - length    : bytes per codeword, parity included
+*/
+struct btl_fec_layout {
+        uint32_t parity;
+        uint32_t codewords;
+        uint32_t length;
+};
+
+// *****************************************************************************
+/* Function:
+    bool bootloader_FecLayout( uint32_t size, struct btl_fec_layout *layout );
+
+ Summary:
+    Finds the parity an FEC_DATA payload of size bytes was encoded with.
+
+ Description:
+    Returns false if no even parity from 2 to BTL_FEC_PARITY_MAX gives that
+    size.
+*/
+bool bootloader_FecLayout( uint32_t size, struct btl_fec_layout *layout );
+
+// *****************************************************************************
+/* Function:
+    bool bootloader_FecDecode( const uint8_t *data, const struct btl_fec_layout *layout,
+                               uint32_t index, uint8_t *codeword );
+
+ Summary:
+    Collects codeword index from the interleaved data and corrects it.
+
+ Description:
+    data points past the clear block address. On return codeword holds
+    layout->length bytes, the message part first. Returns false if the
+    codeword has more errors than its parity corrects.
+*/
+bool bootloader_FecDecode( const uint8_t *data, const struct btl_fec_layout *layout,
+                           uint32_t index, uint8_t *codeword );
+
+#endif
@@ -0,0 +1,285 @@
+/*******************************************************************************
+  Bootloader Ghost FAT Source File
+
+  File Name:
+    bootloader_ghostfat.c
+
+  Summary:
+    This file contains the emulated FAT16 volume.
+
+  Description:
+    Layout of the volume, one sector per cluster:
+
+      LBA 0                 boot sector
+      LBA 1 ...             FAT, two copies
+      after the FATs        root directory
+      after the root dir    data area, cluster 2 onwards
+
+    The root directory holds the volume label and the read only files of
+    ghostfat_files[], stored in consecutive clusters from cluster 2 on.
+    Everything else reads as free space, so the host can copy a UF2 file of
+    any size onto the volume.
+ *******************************************************************************/
+
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "configuration.h"
+#include "bootloader_ghostfat.h"
+
+#if (BTL_UF2 == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define GHOSTFAT_RESERVED_SECTORS   1U
+#define GHOSTFAT_NUM_FATS           2U
+#define GHOSTFAT_ROOT_ENTRIES       64U
+#define GHOSTFAT_DIR_ENTRY_SIZE     32U
+
+/* Two bytes per cluster entry */
+#define GHOSTFAT_SECTORS_PER_FAT    ((((BTL_GHOSTFAT_SECTORS + 2U) * 2U) + BTL_GHOSTFAT_SECTOR_SIZE - 1U) / BTL_GHOSTFAT_SECTOR_SIZE)
+#define GHOSTFAT_ROOT_SECTORS       ((GHOSTFAT_ROOT_ENTRIES * GHOSTFAT_DIR_ENTRY_SIZE) / BTL_GHOSTFAT_SECTOR_SIZE)
+
+#define GHOSTFAT_FAT_START          GHOSTFAT_RESERVED_SECTORS
+#define GHOSTFAT_ROOT_START         (GHOSTFAT_FAT_START + (GHOSTFAT_NUM_FATS * GHOSTFAT_SECTORS_PER_FAT))
+#define GHOSTFAT_DATA_START         (GHOSTFAT_ROOT_START + GHOSTFAT_ROOT_SECTORS)
+
+#define GHOSTFAT_FIRST_CLUSTER      2U
+
+#define GHOSTFAT_ATTR_READ_ONLY     0x01U
+#define GHOSTFAT_ATTR_VOLUME_ID     0x08U
+
+/* 2019-01-01 00:00 */
+#define GHOSTFAT_DATE               (((2019U - 1980U) << 9) | (1U << 5) | 1U)
+
+#define GHOSTFAT_VOLUME_LABEL       "SAME51BOOT "
+#define GHOSTFAT_VOLUME_SERIAL      0x00E51B00UL
+
+struct ghostfat_file {
+        const char *name;
+        const char *content;
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static const char ghostfat_info[] =
+    "UF2 Bootloader\r\n"
+    "Model: SAME51 Bootloader\r\n"
+    "Board-ID: SAME51J20A\r\n";
+
+/* 8.3 names, padded with spaces */
+static const struct ghostfat_file ghostfat_files[] =
+{
+    { "INFO_UF2TXT", ghostfat_info },
+};
+
+#define GHOSTFAT_FILES              (sizeof(ghostfat_files) / sizeof(ghostfat_files[0]))
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Ghost FAT Local Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static void ghostfat_put16(uint8_t *dest, uint32_t value)
+{
+    dest[0] = (uint8_t)value;
+    dest[1] = (uint8_t)(value >> 8);
+}
+
+static void ghostfat_put32(uint8_t *dest, uint32_t value)
+{
+    ghostfat_put16(&dest[0], value);
+    ghostfat_put16(&dest[2], value >> 16);
+}
+
+static uint32_t ghostfat_file_clusters(uint32_t file)
+{
+    uint32_t size = (uint32_t)strlen(ghostfat_files[file].content);
+
+    return (size + BTL_GHOSTFAT_SECTOR_SIZE - 1U) / BTL_GHOSTFAT_SECTOR_SIZE;
+}
+
+static void ghostfat_boot_sector(uint8_t *sector)
+{
+    static const uint8_t jump[3] = { 0xEB, 0x3C, 0x90 };
+
+    memcpy(&sector[0], jump, sizeof(jump));
+    memcpy(&sector[3], "UF2 UF2 ", 8);
+
+    ghostfat_put16(&sector[11], BTL_GHOSTFAT_SECTOR_SIZE);
+    sector[13] = 1;                                     /* sectors per cluster */
+    ghostfat_put16(&sector[14], GHOSTFAT_RESERVED_SECTORS);
+    sector[16] = GHOSTFAT_NUM_FATS;
+    ghostfat_put16(&sector[17], GHOSTFAT_ROOT_ENTRIES);
+    ghostfat_put16(&sector[19], BTL_GHOSTFAT_SECTORS);
+    sector[21] = 0xF8;                                  /* fixed disk */
+    ghostfat_put16(&sector[22], GHOSTFAT_SECTORS_PER_FAT);
+    ghostfat_put16(&sector[24], 1);                     /* sectors per track */
+    ghostfat_put16(&sector[26], 1);                     /* heads */
+
+    sector[36] = 0x80;                                  /* drive number */
+    sector[38] = 0x29;                                  /* extended boot signature */
+    ghostfat_put32(&sector[39], GHOSTFAT_VOLUME_SERIAL);
+    memcpy(&sector[43], GHOSTFAT_VOLUME_LABEL, 11);
+    memcpy(&sector[54], "FAT16   ", 8);
+
+    sector[510] = 0x55;
+    sector[511] = 0xAA;
+}
+
+/* index is the sector number within one FAT copy */
+static void ghostfat_fat_sector(uint32_t index, uint8_t *sector)
+{
+    uint32_t first = index * (BTL_GHOSTFAT_SECTOR_SIZE / 2U);
+    uint32_t cluster = GHOSTFAT_FIRST_CLUSTER;
+    uint32_t file, last, entry;
+
+    if (first == 0U)
+    {
+        ghostfat_put16(&sector[0], 0xFFF8);             /* media */
+        ghostfat_put16(&sector[2], 0xFFFF);
+    }
+
+    /* Every file is one cluster chain ending in 0xFFFF */
+    for (file = 0; file < GHOSTFAT_FILES; file++)
+    {
+        last = cluster + ghostfat_file_clusters(file) - 1U;
+
+        for ( ; cluster <= last; cluster++)
+        {
+            if ((cluster >= first) && (cluster < first + (BTL_GHOSTFAT_SECTOR_SIZE / 2U)))
+            {
+                entry = (cluster == last) ? 0xFFFFU : (cluster + 1U);
+
+                ghostfat_put16(&sector[(cluster - first) * 2U], entry);
+            }
+        }
+    }
+}
+
+static void ghostfat_root_sector(uint32_t index, uint8_t *sector)
+{
+    uint8_t *entry = sector;
+    uint32_t cluster = GHOSTFAT_FIRST_CLUSTER;
+    uint32_t file;
+
+    /* Label and files all fit in the first directory sector */
+    if (index != 0U)
+    {
+        return;
+    }
+
+    memcpy(&entry[0], GHOSTFAT_VOLUME_LABEL, 11);
+    entry[11] = GHOSTFAT_ATTR_VOLUME_ID;
+    entry += GHOSTFAT_DIR_ENTRY_SIZE;
+
+    for (file = 0; file < GHOSTFAT_FILES; file++)
+    {
+        memcpy(&entry[0], ghostfat_files[file].name, 11);
+        entry[11] = GHOSTFAT_ATTR_READ_ONLY;
+        ghostfat_put16(&entry[16], GHOSTFAT_DATE);      /* created */
+        ghostfat_put16(&entry[18], GHOSTFAT_DATE);      /* accessed */
+        ghostfat_put16(&entry[24], GHOSTFAT_DATE);      /* written */
+        ghostfat_put16(&entry[26], cluster);
+        ghostfat_put32(&entry[28], (uint32_t)strlen(ghostfat_files[file].content));
+
+        cluster += ghostfat_file_clusters(file);
+        entry += GHOSTFAT_DIR_ENTRY_SIZE;
+    }
+}
+
+static void ghostfat_data_sector(uint32_t cluster, uint8_t *sector)
+{
+    uint32_t first = GHOSTFAT_FIRST_CLUSTER;
+    uint32_t file, clusters, offset, size;
+
+    for (file = 0; file < GHOSTFAT_FILES; file++)
+    {
+        clusters = ghostfat_file_clusters(file);
+
+        if (cluster < first + clusters)
+        {
+            offset  = (cluster - first) * BTL_GHOSTFAT_SECTOR_SIZE;
+            size    = (uint32_t)strlen(ghostfat_files[file].content) - offset;
+
+            if (size > BTL_GHOSTFAT_SECTOR_SIZE)
+            {
+                size = BTL_GHOSTFAT_SECTOR_SIZE;
+            }
+
+            memcpy(sector, &ghostfat_files[file].content[offset], size);
+            return;
+        }
+
+        first += clusters;
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Ghost FAT Global Functions
+// *****************************************************************************
+// *****************************************************************************
+
+void bootloader_GhostFatRead(uint32_t lba, uint8_t *sector)
+{
+    memset(sector, 0, BTL_GHOSTFAT_SECTOR_SIZE);
+
+    if (lba == 0U)
+    {
+        ghostfat_boot_sector(sector);
+    }
+    else if (lba < GHOSTFAT_ROOT_START)
+    {
+        ghostfat_fat_sector((lba - GHOSTFAT_FAT_START) % GHOSTFAT_SECTORS_PER_FAT, sector);
+    }
+    else if (lba < GHOSTFAT_DATA_START)
+    {
+        ghostfat_root_sector(lba - GHOSTFAT_ROOT_START, sector);
+    }
+    else if (lba < BTL_GHOSTFAT_SECTORS)
+    {
+        ghostfat_data_sector(GHOSTFAT_FIRST_CLUSTER + (lba - GHOSTFAT_DATA_START), sector);
+    }
+}
+
+#endif
@@ -0,0 +1,62 @@
+/*******************************************************************************
+  Bootloader Ghost FAT Header File
+
+  File Name:
+    bootloader_ghostfat.h
+
+  Summary:
+    This file contains the interface of the emulated FAT16 volume.
+
+  Description:
+    The USB mass storage backend presents a FAT16 volume that does not exist
+    anywhere in memory; every sector is generated when the host reads it.
+    Written sectors are not stored, they are only inspected for UF2 blocks.
+    The module has no hardware dependency so it can be built on a host.
+ *******************************************************************************/
+
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef BOOTLOADER_GHOSTFAT_H
+#define BOOTLOADER_GHOSTFAT_H
+
+#include <stdint.h>
+
+#define BTL_GHOSTFAT_SECTOR_SIZE    512U
+
+/* 8 MB, enough clusters for the volume to be FAT16 */
+#define BTL_GHOSTFAT_SECTORS        16384U
+
+// *****************************************************************************
+/* Function:
+    void bootloader_GhostFatRead( uint32_t lba, uint8_t *sector );
+
+ Summary:
+    Fills sector with the content of the given logical block of the volume.
+*/
+void bootloader_GhostFatRead( uint32_t lba, uint8_t *sector );
+
+#endif
@@ -0,0 +1,269 @@
+/*******************************************************************************
+  Bootloader Partition Table Source File
+
+  File Name:
+    bootloader_partition.c
+
+  Summary:
+    This file maintains the flash partition table of each bank.
+
+  Description:
+    Versions of the table are appended page by page to the table block of
+    the bank, see bootloader_partition.h. A page cut short by a reset fails
+    its table_crc and the version before it stays current; only erasing a
+    full block leaves a short window without a table, once every
+    BTL_BLOCK_SIZE / BTL_PARTITION_RECORD_SIZE sessions.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <stddef.h>
+#include <string.h>
+#include "definitions.h"
+#include "bootloader_protocol.h"
+#include "bootloader_partition.h"
+
+#if (BTL_PARTITIONS == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define PARTITION_BANK_SIZE         (0x80000UL)
+
+#define PARTITION_RECORDS           (BTL_BLOCK_SIZE / BTL_PARTITION_RECORD_SIZE)
+
+#define PARTITION_TABLE_CRC_SIZE    ((uint32_t)offsetof(struct btl_partition_table, table_crc))
+
+#define PARTITION_ERASED            0xFFFFFFFFUL
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+/* Next version of the table, padded to a page */
+static uint32_t partition_page[BTL_PARTITION_RECORD_SIZE / sizeof(uint32_t)];
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Bootloader Local Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static bool partition_table_valid(const struct btl_partition_table *table)
+{
+    return ((table->magic == BTL_PARTITION_MAGIC) &&
+            (table->count <= BTL_PARTITIONS_MAX) &&
+            (table->table_crc == (uint32_t)crc32(0, table, PARTITION_TABLE_CRC_SIZE)));
+}
+
+/* Number of pages written in the table block */
+static uint32_t partition_record_count(uint32_t block)
+{
+    uint32_t i;
+
+    for (i = 0; i < PARTITION_RECORDS; i++)
+    {
+        if (*(const uint32_t *)(uintptr_t)(block + (i * BTL_PARTITION_RECORD_SIZE)) == PARTITION_ERASED)
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/* Current table of the bank at bank, or NULL */
+static const struct btl_partition_table *partition_table_get(uint32_t bank)
+{
+    uint32_t block = bank + BTL_PARTITION_TABLE_OFFSET;
+    uint32_t i = partition_record_count(block);
+
+    while (i-- > 0U)
+    {
+        const struct btl_partition_table *table = (const struct btl_partition_table *)(uintptr_t)(block + (i * BTL_PARTITION_RECORD_SIZE));
+
+        if (partition_table_valid(table) == true)
+        {
+            return table;
+        }
+    }
+
+    return NULL;
+}
+
+static void partition_table_write(uint32_t bank)
+{
+    uint32_t block = bank + BTL_PARTITION_TABLE_OFFSET;
+    uint32_t count = partition_record_count(block);
+
+    NVMCTRL_RegionUnlock(block);
+
+    while (NVMCTRL_IsBusy() == true)
+    {
+        /* Wait for the NVM controller */
+    }
+
+    if (count == PARTITION_RECORDS)
+    {
+        NVMCTRL_BlockErase(block);
+
+        while (NVMCTRL_IsBusy() == true)
+        {
+            /* Wait for the NVM controller */
+        }
+
+        count = 0;
+    }
+
+    NVMCTRL_PageWrite(partition_page, block + (count * BTL_PARTITION_RECORD_SIZE));
+
+    while (NVMCTRL_IsBusy() == true)
+    {
+        /* Wait for the NVM controller */
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Bootloader Global Functions
+// *****************************************************************************
+// *****************************************************************************
+
+bool bootloader_PartitionFind(uint32_t id, uint32_t *begin, uint32_t *size)
+{
+    const struct btl_partition_table *table = partition_table_get(0);
+    uint32_t i;
+
+    if (table == NULL)
+    {
+        return false;
+    }
+
+    for (i = 0; i < table->count; i++)
+    {
+        if (table->partitions[i].id == id)
+        {
+            *begin = table->partitions[i].offset;
+            *size  = table->partitions[i].size;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void bootloader_PartitionUpdate(uint32_t begin, uint32_t end)
+{
+    uint32_t bank = begin - (begin % PARTITION_BANK_SIZE);
+    const struct btl_partition_table *current = partition_table_get(bank);
+    struct btl_partition_table *table = (struct btl_partition_table *)partition_page;
+    uint32_t i;
+
+    if (current == NULL)
+    {
+        return;
+    }
+
+    memset(partition_page, 0xFF, sizeof(partition_page));
+    memcpy(table, current, sizeof(*table));
+
+    for (i = 0; i < table->count; i++)
+    {
+        struct btl_partition *p = &table->partitions[i];
+        uint32_t p_begin = bank + p->offset;
+        uint32_t p_end   = p_begin + p->size;
+        uint32_t length;
+
+        if ((begin == p_begin) && (end <= p_end))
+        {
+            length = end - begin;
+        }
+        else if ((begin < p_end) && (p_begin < end))
+        {
+            length = p->size;
+        }
+        else
+        {
+            continue;
+        }
+
+        p->length = length;
+        p->crc32  = (uint32_t)crc32(0, (const void *)(uintptr_t)p_begin, length);
+    }
+
+    /* Same content again */
+    if (memcmp(table, current, sizeof(*table)) == 0)
+    {
+        return;
+    }
+
+    table->table_crc = (uint32_t)crc32(0, table, PARTITION_TABLE_CRC_SIZE);
+
+    partition_table_write(bank);
+}
+
+bool bootloader_PartitionsVerify(void)
+{
+    const struct btl_partition_table *table = partition_table_get(0);
+    uint32_t i;
+
+    if (table == NULL)
+    {
+        return true;
+    }
+
+    for (i = 0; i < table->count; i++)
+    {
+        const struct btl_partition *p = &table->partitions[i];
+
+        if (p->type != BTL_PARTITION_CODE)
+        {
+            continue;
+        }
+
+        if ((p->length == 0U) || (p->length > p->size) ||
+            ((uint32_t)crc32(0, (const void *)(uintptr_t)p->offset, p->length) != p->crc32))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#endif
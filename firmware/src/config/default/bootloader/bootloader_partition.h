@@ -0,0 +1,157 @@
+/*******************************************************************************
+  Bootloader Partition Table Header File
+
+  File Name:
+    bootloader_partition.h
+
+  Summary:
+    This file describes the flash partition table and the interface the
+    protocol engine uses to maintain it.
+
+  Description:
+    The table splits a bank into partitions which are updated on their own:
+    a PARTITION command scopes the session to one of them, so a new
+    calibration table or asset bundle is sent instead of the whole image.
+    Each bank keeps its table in the erase block at
+    BTL_PARTITION_TABLE_OFFSET, one page per version:
+
+      - the last page with a valid table_crc is the current table,
+      - every successful VERIFY appends a version with the length and
+        crc32 of the partitions the session rewrote,
+      - the block is only erased once all of its pages are used.
+
+    The first version is written like any other data, tools/mkpartitions.py
+    creates it. This header is meant to be shared with the application.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef BOOTLOADER_PARTITION_H
+#define BOOTLOADER_PARTITION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* "BPRT" */
+#define BTL_PARTITION_MAGIC         0x54525042UL
+
+#define BTL_PARTITIONS_MAX          8U
+#define BTL_PARTITION_NAME_SIZE     8U
+
+/* Each version of the table takes one page of the table block */
+#define BTL_PARTITION_RECORD_SIZE   512U
+
+/* Types of a partition */
+#define BTL_PARTITION_APP           1U      /* the application, checked at boot by its binary header */
+#define BTL_PARTITION_CODE          2U      /* more code, checked at boot by length and crc32 */
+#define BTL_PARTITION_DATA          3U      /* not checked at boot */
+
+// *****************************************************************************
+/* Partition Entry
+
+  Description:
+    - id        : what the PARTITION command names it by
+    - name      : for tools and the application, not NUL terminated if full
+    - type      : one of the types above
+    - offset    : from the start of the bank, erase block aligned
+    - size      : reserved bytes, a multiple of the erase block
+    - length    : bytes the last session programmed, 0 if never written
+    - crc32     : crc32() of those bytes
+
+    All words are little endian.
+*/
+struct btl_partition {
+        uint32_t id;
+        char     name[BTL_PARTITION_NAME_SIZE];
+        uint32_t type;
+        uint32_t offset;
+        uint32_t size;
+        uint32_t length;
+        uint32_t crc32;
+};
+
+// *****************************************************************************
+/* Partition Table
+
+  Description:
+    - magic     : BTL_PARTITION_MAGIC
+    - count     : entries in use, the rest of the array is 0xFF
+    - table_crc : crc32() of everything before it
+
+    The rest of the page is 0xFF.
+*/
+struct btl_partition_table {
+        uint32_t magic;
+        uint32_t count;
+        struct btl_partition partitions[BTL_PARTITIONS_MAX];
+        uint32_t table_crc;
+};
+
+// *****************************************************************************
+/* Function:
+    bool bootloader_PartitionFind( uint32_t id, uint32_t *begin, uint32_t *size );
+
+ Summary:
+    Looks up a partition of the running bank.
+
+ Description:
+    Returns the flash address and reserved size of partition id, or false if
+    there is no table or no such partition.
+*/
+bool bootloader_PartitionFind( uint32_t id, uint32_t *begin, uint32_t *size );
+
+// *****************************************************************************
+/* Function:
+    void bootloader_PartitionUpdate( uint32_t begin, uint32_t end );
+
+ Summary:
+    Records what a verified session programmed.
+
+ Description:
+    Called once [begin, end) passed VERIFY. A partition the session started
+    at gets length end - begin; any other partition the session overlaps is
+    recorded over its whole size. A new version of the table is appended to
+    the table block of that bank if anything changed.
+*/
+void bootloader_PartitionUpdate( uint32_t begin, uint32_t end );
+
+// *****************************************************************************
+/* Function:
+    bool bootloader_PartitionsVerify( void );
+
+ Summary:
+    Checks the code partitions of the running bank at boot.
+
+ Description:
+    Returns false if a BTL_PARTITION_CODE partition is empty or does not
+    match its crc32. A bank without a table passes.
+
+ Remarks:
+    Runs before the clocks are set up, like the rest of run_Application.
+*/
+bool bootloader_PartitionsVerify( void );
+
+#endif
@@ -0,0 +1,67 @@
+/*******************************************************************************
+  Bootloader Protocol Header File
+
+  File Name:
+    bootloader_protocol.h
+
+  Summary:
+    This file contains the wire format of the bootloader protocol.
+
+  Description:
+    Every packet starts with a header made of the guard word, the payload
+    size and the command code, all little endian. Each packet is answered
+    with a single response byte. Transports that do not carry the byte
+    stream directly (SPI framing, USB DFU) use these definitions to build or
+    check packets for the protocol engine. The packets themselves are
+    defined in tools/btl_protocol.json and generated into
+    bootloader_commands.h; this file adds the sizes that depend on the
+    build.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef BOOTLOADER_PROTOCOL_H
+#define BOOTLOADER_PROTOCOL_H
+
+#include "bootloader_commands.h"
+
+/* Layout of the FEC_DATA codewords with p parity bytes each, see
+ * bootloader_fec.h. p is even and follows from the payload size. */
+#define BTL_FEC_MESSAGE_SIZE        (4U + BTL_BLOCK_SIZE)
+#define BTL_FEC_CODEWORDS(p)        ((BTL_FEC_MESSAGE_SIZE + 254U - (p)) / (255U - (p)))
+#define BTL_FEC_MESSAGE_BYTES(p)    ((BTL_FEC_MESSAGE_SIZE + BTL_FEC_CODEWORDS(p) - 1U) / BTL_FEC_CODEWORDS(p))
+#define BTL_FEC_PAYLOAD_SIZE(p)     (4U + (BTL_FEC_CODEWORDS(p) * (BTL_FEC_MESSAGE_BYTES(p) + (p))))
+
+/* Largest payload a link has to take */
+#if (BTL_FEC == 1)
+#define BTL_MAX_PAYLOAD_SIZE    BTL_FEC_PAYLOAD_SIZE(BTL_FEC_PARITY_MAX)
+#elif (BTL_ENCRYPTION == 1)
+#define BTL_MAX_PAYLOAD_SIZE    BTL_ENC_DATA_PAYLOAD_SIZE
+#else
+#define BTL_MAX_PAYLOAD_SIZE    BTL_DATA_PAYLOAD_SIZE
+#endif
+
+#endif
@@ -0,0 +1,183 @@
+/*******************************************************************************
+  PTY Bootloader Transport Source File
+
+  File Name:
+    bootloader_pty.c
+
+  Summary:
+    This file contains the host pseudo terminal backend of the bootloader
+    transport.
+
+  Description:
+    This backend is only used when the protocol engine is built for a Linux
+    host. It opens a pseudo terminal pair; the host uploader connects to the
+    slave side exactly as it would connect to the device UART, which lets the
+    protocol be exercised and benchmarked without hardware. The host build
+    is in firmware/host, see its Makefile.
+
+    It is not part of the MPLAB X project.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#if defined(__unix__)
+
+#define _GNU_SOURCE
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include "bootloader_transport.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static int pty_fd = -1;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: PTY Transport Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static bool pty_receiver_is_ready(void)
+{
+    struct pollfd pfd = { .fd = pty_fd, .events = POLLIN };
+
+    return (poll(&pfd, 1, 0) == 1) && ((pfd.revents & POLLIN) != 0);
+}
+
+static size_t pty_read(uint8_t *buffer, size_t size)
+{
+    ssize_t count = read(pty_fd, buffer, size);
+
+    return (count > 0) ? (size_t)count : 0;
+}
+
+/* Waits for room while the host is slow to read. Once the host has closed
+ * the slave side, or on any other error, the rest is dropped. */
+static void pty_write(const uint8_t *buffer, size_t size)
+{
+    struct pollfd pfd = { .fd = pty_fd, .events = POLLOUT };
+    ssize_t count;
+
+    while (size > 0)
+    {
+        count = write(pty_fd, buffer, size);
+
+        if (count > 0)
+        {
+            buffer += count;
+            size   -= (size_t)count;
+        }
+        else if ((count < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        else if ((count < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+        {
+            if (poll(&pfd, 1, -1) < 0)
+            {
+                if (errno != EINTR)
+                {
+                    return;
+                }
+            }
+            else if ((pfd.revents & (POLLERR | POLLHUP)) != 0)
+            {
+                return;
+            }
+        }
+        else
+        {
+            return;
+        }
+    }
+}
+
+static void pty_flush(void)
+{
+    tcdrain(pty_fd);
+}
+
+/* A PTY has no physical bit rate, accept anything termios accepts */
+static bool pty_link_setup(uint32_t bitRate)
+{
+    struct termios tio;
+
+    if (tcgetattr(pty_fd, &tio) != 0)
+    {
+        return false;
+    }
+
+    return (cfsetspeed(&tio, (speed_t)bitRate) == 0) &&
+           (tcsetattr(pty_fd, TCSADRAIN, &tio) == 0);
+}
+
+/* Opens the master side in raw, non blocking mode and returns the name of
+ * the slave side the host uploader has to connect to. */
+const char *bootloader_PtyOpen(void)
+{
+    struct termios tio;
+
+    pty_fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if ((pty_fd < 0) || (grantpt(pty_fd) != 0) || (unlockpt(pty_fd) != 0))
+    {
+        return NULL;
+    }
+
+    if (tcgetattr(pty_fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(pty_fd, TCSANOW, &tio);
+    }
+
+    return ptsname(pty_fd);
+}
+
+const BOOTLOADER_TRANSPORT bootloader_PtyTransport =
+{
+    .receiverIsReady    = pty_receiver_is_ready,
+    .read               = pty_read,
+    .write              = pty_write,
+    .flush              = pty_flush,
+    .linkSetup          = pty_link_setup,
+};
+
+#endif
@@ -0,0 +1,419 @@
+/*******************************************************************************
+  QSPI Staging Bootloader Transport Source File
+
+  File Name:
+    bootloader_qspi.c
+
+  Summary:
+    This file contains the QSPI staging area backend of the bootloader
+    transport.
+
+  Description:
+    The application stages updates in external NOR flash on the QSPI, in the
+    format of bootloader_stage.h. At every boot the staging header is read
+    through the memory map; if an image is pending, the bootloader stays up.
+    Once the clocks run, the image is checked against its CRC before
+    anything is erased and installed as a normal update session, with this
+    backend as the only link of the engine:
+
+      - UNLOCK of the target region, then one DATA packet per erase block,
+        the payload read straight out of the QSPI memory map,
+      - VERIFY of the programmed flash,
+      - state set to BTL_STAGE_INSTALLED, then BKSWAP or RESET.
+
+    The UART remains BTL_TRANSPORT and takes over after the reset. The
+    staged copy stays intact until the installed image is verified, so
+    an install interrupted by a power loss starts over at the next boot.
+    Images going to the inactive bank which fail to install are marked
+    BTL_STAGE_REJECTED, the running image is still there to boot.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "definitions.h"
+#include "bootloader_transport.h"
+#include "bootloader_protocol.h"
+#include "bootloader_stage.h"
+#include "peripheral/qspi/plib_qspi.h"
+
+#if (BTL_QSPI_STAGING == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define QSPI_BANK_SIZE              (0x80000UL)
+#define QSPI_BOOTLOADER_SIZE        ((uint32_t)BTL_BOOTLOADER_SIZE)
+
+#define QSPI_HEADER_CRC_SIZE        ((uint32_t)offsetof(struct stage_header, header_crc))
+
+/* Header and address of a DATA packet, or a command with two arguments */
+#define QSPI_HEAD_SIZE              (BTL_HEADER_SIZE + 8U)
+
+enum qspi_state
+{
+    /* Nothing staged */
+    QSPI_STATE_IDLE,
+
+    /* Packet staged, waiting for the response of the engine */
+    QSPI_STATE_UNLOCK,
+    QSPI_STATE_DATA,
+    QSPI_STATE_VERIFY,
+    QSPI_STATE_START,
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static const uint8_t *qspi_image    = NULL;
+
+static struct stage_header qspi_stage;
+
+/* CRC the DSU computes over the programmed, 0xFF padded blocks */
+static unsigned long qspi_flash_crc = 0;
+
+static uint32_t qspi_blocks         = 0;
+static uint32_t qspi_block          = 0;
+
+static enum qspi_state qspi_state   = QSPI_STATE_IDLE;
+
+/* Packet handed to the engine: the head from qspi_head, a DATA payload
+ * from the staged image */
+static uint8_t  qspi_head[QSPI_HEAD_SIZE];
+static size_t   qspi_head_size      = 0;
+static size_t   qspi_tx_size        = 0;
+static size_t   qspi_tx_ptr         = 0;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: QSPI Staging Transport Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static void qspi_put32(uint8_t *dest, uint32_t value)
+{
+    dest[0] = (uint8_t)value;
+    dest[1] = (uint8_t)(value >> 8);
+    dest[2] = (uint8_t)(value >> 16);
+    dest[3] = (uint8_t)(value >> 24);
+}
+
+static void qspi_submit(uint8_t command, uint32_t arg0, uint32_t arg1, uint32_t head_args, uint32_t payload_size, enum qspi_state state)
+{
+    qspi_put32(&qspi_head[0], BTL_GUARD);
+    qspi_put32(&qspi_head[BTL_SIZE_OFFSET], payload_size);
+    qspi_head[BTL_CMD_OFFSET] = command;
+
+    qspi_put32(&qspi_head[BTL_HEADER_SIZE], arg0);
+    qspi_put32(&qspi_head[BTL_HEADER_SIZE + 4U], arg1);
+
+    qspi_head_size  = BTL_HEADER_SIZE + (head_args * 4U);
+    qspi_tx_size    = BTL_HEADER_SIZE + payload_size;
+    qspi_tx_ptr     = 0;
+    qspi_state      = state;
+}
+
+static void qspi_data_submit(void)
+{
+    qspi_submit(BL_CMD_DATA, qspi_stage.address + (qspi_block * BTL_BLOCK_SIZE), 0, 1U,
+                BTL_DATA_PAYLOAD_SIZE, QSPI_STATE_DATA);
+}
+
+/* The state word is programmed in place, the rest of the header stays */
+static void qspi_state_set(uint32_t state)
+{
+    uint8_t value[4];
+
+    qspi_put32(value, state);
+
+    QSPI_PageProgram(BTL_QSPI_STAGE_OFFSET + (uint32_t)offsetof(struct stage_header, state), value, sizeof(value));
+}
+
+/* Same range rules as the engine plus the bootloader of either bank */
+static bool qspi_range_check(void)
+{
+    uint32_t offset = qspi_stage.address % QSPI_BANK_SIZE;
+    bool     upper  = (qspi_stage.address >= QSPI_BANK_SIZE);
+
+    return (qspi_stage.size > 0U) &&
+           ((qspi_stage.address % BTL_BLOCK_SIZE) == 0U) &&
+           (qspi_stage.address < (2U * QSPI_BANK_SIZE)) &&
+           (offset >= QSPI_BOOTLOADER_SIZE) &&
+           (qspi_stage.size <= (QSPI_BANK_SIZE - offset)) &&
+           (upper == ((qspi_stage.flags & BTL_STAGE_FLAG_SWAP) != 0U));
+}
+
+/* The image must carry the header the boot check looks for */
+static bool qspi_binary_header_check(void)
+{
+    struct binary_header header;
+    uint32_t end = (qspi_stage.size < BTL_BLOCK_SIZE) ? qspi_stage.size : BTL_BLOCK_SIZE;
+    uint32_t i;
+
+    for (i = 0; (i + sizeof(header)) <= end; i += 4U)
+    {
+        memcpy(&header, &qspi_image[i], sizeof(header));
+
+        if ((header.sig1 == SIGNATURE1) && (header.sig2 == SIGNATURE2))
+        {
+            return (header.bin_size >= (i + sizeof(header))) && (header.bin_size <= qspi_stage.size);
+        }
+    }
+
+    return false;
+}
+
+/* Reads the whole image once through the memory map */
+static bool qspi_image_check(void)
+{
+    static const uint8_t erased[16] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    uint32_t padding;
+
+    qspi_flash_crc = crc32(0, qspi_image, qspi_stage.size);
+
+    if ((qspi_flash_crc != qspi_stage.crc32) || (qspi_binary_header_check() == false))
+    {
+        return false;
+    }
+
+    for (padding = (qspi_blocks * BTL_BLOCK_SIZE) - qspi_stage.size; padding > 0U; padding -= sizeof(erased))
+    {
+        if (padding < sizeof(erased))
+        {
+            qspi_flash_crc = crc32(qspi_flash_crc, erased, padding);
+            break;
+        }
+
+        qspi_flash_crc = crc32(qspi_flash_crc, erased, sizeof(erased));
+    }
+
+    return true;
+}
+
+static void qspi_engine_response(uint8_t response)
+{
+    enum qspi_state state = qspi_state;
+
+    qspi_tx_size    = 0;
+    qspi_tx_ptr     = 0;
+    qspi_state      = QSPI_STATE_IDLE;
+
+    switch (state)
+    {
+        case QSPI_STATE_UNLOCK:
+            if (response == BL_RESP_OK)
+            {
+                qspi_data_submit();
+                return;
+            }
+            break;
+
+        case QSPI_STATE_DATA:
+            if (response == BL_RESP_OK)
+            {
+                qspi_block++;
+
+                if (qspi_block < qspi_blocks)
+                {
+                    qspi_data_submit();
+                }
+                else
+                {
+                    qspi_submit(BL_CMD_VERIFY, (uint32_t)(qspi_flash_crc ^ 0xFFFFFFFFUL), 0, 1U, 4U, QSPI_STATE_VERIFY);
+                }
+                return;
+            }
+            break;
+
+        case QSPI_STATE_VERIFY:
+            if (response == BL_RESP_CRC_OK)
+            {
+                qspi_state_set(BTL_STAGE_INSTALLED);
+
+                qspi_submit(((qspi_stage.flags & BTL_STAGE_FLAG_SWAP) != 0U) ? BL_CMD_BKSWAP_RESET : BL_CMD_RESET,
+                            0, 0, 0U, 0U, QSPI_STATE_START);
+                return;
+            }
+            break;
+
+        default:
+            /* The engine starts the image */
+            return;
+    }
+
+    /* A failed image in the running bank left no application behind, the
+     * next boot tries again */
+    if ((qspi_stage.flags & BTL_STAGE_FLAG_SWAP) != 0U)
+    {
+        qspi_state_set(BTL_STAGE_REJECTED);
+    }
+
+    qspi_submit(BL_CMD_RESET, 0, 0, 0U, 0U, QSPI_STATE_START);
+}
+
+bool bootloader_QspiInitialize(void)
+{
+    const uint8_t *flash = QSPI_MemoryMap();
+    uint32_t crc;
+
+    memcpy(&qspi_stage, &flash[BTL_QSPI_STAGE_OFFSET], sizeof(qspi_stage));
+
+    qspi_state = QSPI_STATE_IDLE;
+
+    crc = (uint32_t)crc32(0, &qspi_stage, QSPI_HEADER_CRC_SIZE);
+
+    /* A torn or foreign header is left for the application to clean up */
+    if ((qspi_stage.magic != BTL_STAGE_MAGIC) || (qspi_stage.state != BTL_STAGE_PENDING) ||
+        (crc != qspi_stage.header_crc))
+    {
+        QSPI_Deinitialize();
+
+        return false;
+    }
+
+    qspi_image  = &flash[BTL_QSPI_STAGE_OFFSET + BTL_STAGE_DATA_OFFSET];
+    qspi_blocks = (qspi_stage.size + BTL_BLOCK_SIZE - 1U) / BTL_BLOCK_SIZE;
+    qspi_block  = 0;
+
+    return true;
+}
+
+/* The image CRC runs over the whole staged copy, so it waits for the
+ * clocks as well */
+void bootloader_QspiInstall(void)
+{
+    if ((qspi_range_check() == false) || (qspi_image_check() == false))
+    {
+        qspi_state_set(BTL_STAGE_REJECTED);
+
+        NVIC_SystemReset();
+    }
+
+    qspi_submit(BL_CMD_UNLOCK, qspi_stage.address, qspi_blocks * BTL_BLOCK_SIZE, 2U, 8U, QSPI_STATE_UNLOCK);
+
+    bootloader_InstallTasks(&bootloader_QspiTransport);
+}
+
+static bool qspi_receiver_is_ready(void)
+{
+    return (qspi_tx_ptr < qspi_tx_size);
+}
+
+/* The DATA payload is copied straight from the memory map, the padding of
+ * the last block is generated */
+static size_t qspi_read(uint8_t *buffer, size_t size)
+{
+    size_t count = 0;
+    size_t chunk;
+    uint32_t offset;
+
+    while ((count < size) && (qspi_tx_ptr < qspi_tx_size))
+    {
+        chunk = size - count;
+
+        if (qspi_tx_ptr < qspi_head_size)
+        {
+            if (chunk > (qspi_head_size - qspi_tx_ptr))
+            {
+                chunk = qspi_head_size - qspi_tx_ptr;
+            }
+
+            memcpy(&buffer[count], &qspi_head[qspi_tx_ptr], chunk);
+        }
+        else
+        {
+            offset = (qspi_block * BTL_BLOCK_SIZE) + (uint32_t)(qspi_tx_ptr - qspi_head_size);
+
+            if (chunk > (qspi_tx_size - qspi_tx_ptr))
+            {
+                chunk = qspi_tx_size - qspi_tx_ptr;
+            }
+
+            if (offset >= qspi_stage.size)
+            {
+                memset(&buffer[count], 0xFF, chunk);
+            }
+            else
+            {
+                if (chunk > (qspi_stage.size - offset))
+                {
+                    chunk = qspi_stage.size - offset;
+                }
+
+                memcpy(&buffer[count], &qspi_image[offset], chunk);
+            }
+        }
+
+        count       += chunk;
+        qspi_tx_ptr += chunk;
+    }
+
+    return count;
+}
+
+static void qspi_write(const uint8_t *buffer, size_t size)
+{
+    if (size > 0U)
+    {
+        qspi_engine_response(buffer[0]);
+    }
+}
+
+/* Nothing is sent back */
+static void qspi_flush(void)
+{
+}
+
+static bool qspi_link_setup(uint32_t bitRate)
+{
+    (void)bitRate;
+
+    return true;
+}
+
+const BOOTLOADER_TRANSPORT bootloader_QspiTransport =
+{
+    .receiverIsReady    = qspi_receiver_is_ready,
+    .read               = qspi_read,
+    .write              = qspi_write,
+    .flush              = qspi_flush,
+    .linkSetup          = qspi_link_setup,
+};
+
+#endif
@@ -0,0 +1,131 @@
+/*******************************************************************************
+  QSPI Flash Image Backend Source File
+
+  File Name:
+    bootloader_qspiimage.c
+
+  Summary:
+    This file contains a file backed implementation of the QSPI peripheral
+    library calls used by the QSPI staging transport.
+
+  Description:
+    This backend is only used when the protocol engine is built for a Linux
+    host together with bootloader_qspi.c. A file holding the contents of
+    the external flash, e.g. a staging area written by tools/bin2stage.py,
+    stands in for the NOR. The flash reads as erased behind the end of the
+    file. Page programs only clear bits, like on the part, and go straight
+    back to the file so the state the bootloader leaves can be inspected.
+
+    It is not part of the MPLAB X project.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#if defined(__unix__)
+
+#define _GNU_SOURCE
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include "bootloader_transport.h"
+#include "peripheral/qspi/plib_qspi.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+/* Size of the QSPI memory window */
+#define QSPIIMAGE_SIZE          0x1000000U
+
+static int      qspiimage_fd    = -1;
+
+static uint8_t  qspiimage_flash[QSPIIMAGE_SIZE];
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: QSPI Library Functions
+// *****************************************************************************
+// *****************************************************************************
+
+/* Loads the flash contents, the file is updated by page programs */
+bool bootloader_QspiImageOpen(const char *path)
+{
+    ssize_t count;
+
+    memset(qspiimage_flash, 0xFF, sizeof(qspiimage_flash));
+
+    qspiimage_fd = open(path, O_RDWR);
+
+    if (qspiimage_fd < 0)
+    {
+        return false;
+    }
+
+    count = pread(qspiimage_fd, qspiimage_flash, sizeof(qspiimage_flash), 0);
+
+    return (count >= 0);
+}
+
+void QSPI_Initialize( void )
+{
+}
+
+void QSPI_Deinitialize( void )
+{
+}
+
+const uint8_t *QSPI_MemoryMap( void )
+{
+    return qspiimage_flash;
+}
+
+bool QSPI_PageProgram( uint32_t address, const uint8_t *data, size_t size )
+{
+    size_t i;
+
+    if ((size == 0U) || (address >= QSPIIMAGE_SIZE) || (((address % QSPI_PAGE_SIZE) + size) > QSPI_PAGE_SIZE))
+    {
+        return false;
+    }
+
+    for (i = 0; i < size; i++)
+    {
+        qspiimage_flash[address + i] &= data[i];
+    }
+
+    return (pwrite(qspiimage_fd, &qspiimage_flash[address], size, (off_t)address) == (ssize_t)size);
+}
+
+#endif
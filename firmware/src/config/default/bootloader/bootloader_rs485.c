@@ -0,0 +1,401 @@
+/*******************************************************************************
+  RS-485 Bootloader Transport Source File
+
+  File Name:
+    bootloader_rs485.c
+
+  Summary:
+    This file contains the addressed RS-485 backend of the bootloader
+    transport.
+
+  Description:
+    SERCOM0 runs with 9 bit characters on a half-duplex RS-485 pair shared
+    by many nodes. A character with the ninth bit set is an address and
+    selects who the following data characters are for:
+
+        node address                packet for this node, answered
+        BTL_RS485_BROADCAST         packet for every node, never answered
+        BTL_RS485_POLL | address    status request, answered by this backend
+
+    The node address is read from the user page at initialization, see
+    BTL_RS485_ADDRESS_LOCATION.
+
+    Unselected nodes drop data characters, so nodes never see each other's
+    replies. The driver enable line is raised only while a reply is sent.
+
+    In a multicast session the host broadcasts UNLOCK and every DATA block
+    once; each node records the blocks it programmed. The host then polls
+    every node for its status:
+
+        [0] response to the last broadcast packet (0xFF if none)
+        [1] number of blocks in the unlocked range
+        [2..17] bitmap of the blocks programmed since the last UNLOCK
+
+    and broadcasts the missing blocks again. VERIFY goes to each node on
+    its own address and RESET is broadcast, so a fleet update costs about
+    one image transfer plus a short poll per node.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "definitions.h"
+#include "bootloader_transport.h"
+#include "bootloader_protocol.h"
+
+#if (BTL_RS485 == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define RS485_ADDRESS_FLAG      0x100U
+
+/* Header and the first two payload words (address, size) */
+#define RS485_CAPTURE_SIZE      (BTL_HEADER_SIZE + 8U)
+
+#define RS485_MAX_BLOCKS        (FLASH_SIZE / BTL_BLOCK_SIZE)
+#define RS485_MAP_SIZE          (RS485_MAX_BLOCKS / 8U)
+#define RS485_STATUS_SIZE       (2U + RS485_MAP_SIZE)
+
+#define RS485_NO_RESPONSE       0xFFU
+
+#define RS485_ADDRESS_MAX       0x7EU
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static uint8_t  rs485_node_address  = BTL_RS485_ADDRESS;
+static uint8_t  rs485_address       = 0;
+static uint8_t  rs485_packet_address = 0;
+static bool     rs485_selected      = false;
+static int32_t  rs485_pending       = -1;
+
+/* Start of the packet currently passed to the protocol engine */
+static uint8_t  rs485_capture[RS485_CAPTURE_SIZE];
+static uint32_t rs485_packet_ptr    = 0;
+static bool     rs485_packet_bad    = false;
+static bool     rs485_filling       = false;
+
+static uint32_t rs485_begin         = 0;
+static uint8_t  rs485_blocks        = 0;
+static uint8_t  rs485_map[RS485_MAP_SIZE];
+static uint8_t  rs485_response      = RS485_NO_RESPONSE;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: RS-485 Transport Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static uint32_t rs485_get32(const uint8_t *src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) |
+           ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+/* Sends a reply with the driver enabled only for as long as it takes */
+static void rs485_send(const uint8_t *buffer, size_t size)
+{
+    uint32_t i;
+
+    PORT_PinSet(BTL_RS485_DE_PIN);
+
+    for (i = 0; i < size; i++)
+    {
+        SERCOM0_USART_WriteByte((int)buffer[i]);
+    }
+
+    while (SERCOM0_USART_TransmitComplete() == false);
+
+    PORT_PinClear(BTL_RS485_DE_PIN);
+
+    /* The host addresses every packet, and a transceiver with its receiver
+     * left on must not feed the reply back to the engine */
+    rs485_selected = false;
+}
+
+static void rs485_status_send(void)
+{
+    uint8_t status[RS485_STATUS_SIZE];
+
+    status[0] = rs485_response;
+    status[1] = rs485_blocks;
+
+    memcpy(&status[2], rs485_map, RS485_MAP_SIZE);
+
+    rs485_send(status, sizeof(status));
+}
+
+/* An address in the middle of a packet means characters were lost. The
+ * engine gets the rest of that packet as filler so that the next packet
+ * starts aligned, and the broken one is not counted as programmed. */
+static void rs485_address_receive(uint8_t address)
+{
+    rs485_selected = false;
+
+    if (rs485_packet_ptr != 0U)
+    {
+        rs485_filling       = true;
+        rs485_packet_bad    = true;
+    }
+
+    if ((address == rs485_node_address) || (address == BTL_RS485_BROADCAST))
+    {
+        rs485_address   = address;
+        rs485_selected  = true;
+    }
+    else if (address == (BTL_RS485_POLL | rs485_node_address))
+    {
+        rs485_status_send();
+    }
+}
+
+/* Returns the next data character addressed to this node, or -1 */
+static int32_t rs485_byte_get(void)
+{
+    int32_t data;
+
+    if (rs485_pending >= 0)
+    {
+        data = rs485_pending;
+        rs485_pending = -1;
+
+        return data;
+    }
+
+    if (rs485_filling == true)
+    {
+        if (rs485_packet_ptr != 0U)
+        {
+            return 0xFF;
+        }
+
+        rs485_filling = false;
+    }
+
+    while (SERCOM0_USART_ReceiverIsReady() == true)
+    {
+        if ((SERCOM0_USART_ErrorGet() != USART_ERROR_NONE) && (rs485_selected == true))
+        {
+            rs485_packet_bad = true;
+        }
+
+        data = SERCOM0_USART_ReadByte();
+
+        if (((uint32_t)data & RS485_ADDRESS_FLAG) != 0U)
+        {
+            rs485_address_receive((uint8_t)data);
+        }
+        else if (rs485_selected == true)
+        {
+            return data & 0xFF;
+        }
+        else
+        {
+            /* Not for this node */
+        }
+    }
+
+    return -1;
+}
+
+/* Keeps the start of each packet, the response tells whether it was taken.
+ * Follows the engine: a header announcing an oversized payload is dropped
+ * on its own. */
+static void rs485_packet_track(uint8_t data)
+{
+    uint32_t size;
+
+    if (rs485_packet_ptr == 0U)
+    {
+        rs485_packet_address = rs485_address;
+    }
+
+    if (rs485_packet_ptr < RS485_CAPTURE_SIZE)
+    {
+        rs485_capture[rs485_packet_ptr] = data;
+    }
+
+    rs485_packet_ptr++;
+
+    if (rs485_packet_ptr >= BTL_HEADER_SIZE)
+    {
+        size = rs485_get32(&rs485_capture[BTL_SIZE_OFFSET]);
+
+        if ((size > BTL_MAX_PAYLOAD_SIZE) || (rs485_packet_ptr >= (BTL_HEADER_SIZE + size)))
+        {
+            rs485_packet_ptr = 0;
+        }
+    }
+}
+
+static bool rs485_receiver_is_ready(void)
+{
+    if (rs485_pending < 0)
+    {
+        rs485_pending = rs485_byte_get();
+    }
+
+    return (rs485_pending >= 0);
+}
+
+static size_t rs485_read(uint8_t *buffer, size_t size)
+{
+    size_t count = 0;
+    int32_t data;
+
+    while (count < size)
+    {
+        data = rs485_byte_get();
+
+        if (data < 0)
+        {
+            break;
+        }
+
+        buffer[count++] = (uint8_t)data;
+
+        rs485_packet_track((uint8_t)data);
+    }
+
+    return count;
+}
+
+/* Updates the programmed block map from the packet the engine answered */
+static void rs485_response_track(uint8_t response)
+{
+    uint8_t  command    = rs485_capture[BTL_CMD_OFFSET];
+    uint32_t address    = rs485_get32(&rs485_capture[BTL_HEADER_SIZE]) & ~(BTL_BLOCK_SIZE - 1U);
+    uint32_t size       = rs485_get32(&rs485_capture[BTL_HEADER_SIZE + 4U]);
+
+    if (response != BL_RESP_OK)
+    {
+        return;
+    }
+
+    if (command == BL_CMD_UNLOCK)
+    {
+        memset(rs485_map, 0, sizeof(rs485_map));
+
+        rs485_begin     = address;
+        rs485_blocks    = (uint8_t)(size / BTL_BLOCK_SIZE);
+    }
+    else if (((command == BL_CMD_DATA) || (command == BL_CMD_ENC_DATA) || (command == BL_CMD_FEC_DATA)) &&
+             (address >= rs485_begin))
+    {
+        address = (address - rs485_begin) / BTL_BLOCK_SIZE;
+
+        if (address < rs485_blocks)
+        {
+            rs485_map[address / 8U] |= (uint8_t)(1U << (address % 8U));
+        }
+    }
+    else
+    {
+        /* Nothing to track */
+    }
+}
+
+/* Broadcast packets are answered through the status poll only. A broken
+ * packet is not answered at all, the host has moved on already. */
+static void rs485_write(const uint8_t *buffer, size_t size)
+{
+    bool bad = rs485_packet_bad;
+
+    rs485_packet_bad = false;
+
+    if (bad == false)
+    {
+        rs485_response_track(buffer[0]);
+    }
+
+    if (rs485_packet_address == BTL_RS485_BROADCAST)
+    {
+        rs485_response = buffer[0];
+    }
+    else if (bad == false)
+    {
+        rs485_send(buffer, size);
+    }
+    else
+    {
+        /* Dropped */
+    }
+}
+
+/* Replies are complete when rs485_write returns */
+static void rs485_flush(void)
+{
+}
+
+static bool rs485_link_setup(uint32_t bitRate)
+{
+    USART_SERIAL_SETUP setup;
+
+    setup.baudRate  = bitRate;
+    setup.parity    = USART_PARITY_NONE;
+    setup.dataWidth = USART_DATA_9_BIT;
+    setup.stopBits  = USART_STOP_1_BIT;
+
+    return SERCOM0_USART_SerialSetup(&setup, 0);
+}
+
+void bootloader_Rs485Initialize(void)
+{
+    uint8_t address = *(volatile const uint8_t *)BTL_RS485_ADDRESS_LOCATION;
+
+    rs485_node_address = (address <= RS485_ADDRESS_MAX) ? address : BTL_RS485_ADDRESS;
+
+    PORT_PinClear(BTL_RS485_DE_PIN);
+    PORT_PinOutputEnable(BTL_RS485_DE_PIN);
+
+    rs485_link_setup(BTL_RS485_BAUD_RATE);
+}
+
+const BOOTLOADER_TRANSPORT bootloader_Rs485Transport =
+{
+    .receiverIsReady    = rs485_receiver_is_ready,
+    .read               = rs485_read,
+    .write              = rs485_write,
+    .flush              = rs485_flush,
+    .linkSetup          = rs485_link_setup,
+    /* Traffic for other nodes wakes the core as well */
+    .wakeSetup          = bootloader_Sercom0WakeSetup,
+};
+
+#endif
@@ -0,0 +1,452 @@
+/*******************************************************************************
+  SD Card Bootloader Transport Source File
+
+  File Name:
+    bootloader_sdcard.c
+
+  Summary:
+    This file contains the SD card backend of the bootloader transport.
+
+  Description:
+    At startup the card on SDHC0 is searched for the path BTL_SDCARD_FILE on
+    its FAT32 volume. If it is there, the file is streamed into the protocol
+    engine as a normal update session:
+
+      - the first erase block of the file is read and its binary header
+        located before anything is erased,
+      - UNLOCK of the target region, then one DATA packet per erase block,
+      - once every block is programmed the header CRC computed over the
+        streamed file has to match, and VERIFY has to confirm the DSU CRC
+        of the programmed flash,
+      - only then BKSWAP (or RESET) starts the new image.
+
+    Each erase block is fetched with as few multi-block reads as the cluster
+    chain allows. The read of the next block is started from the engine's
+    polling loop while the previous block is being erased and programmed,
+    so card I/O and NVM programming overlap: the engine programs out of its
+    own buffer while the card fills this one.
+
+    Without a card, or without the file, the transport stays silent.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "definitions.h"
+#include "bootloader_transport.h"
+#include "bootloader_protocol.h"
+#include "bootloader_fat32.h"
+#include "peripheral/sdhc/plib_sdhc0.h"
+
+#if (BTL_SDCARD == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define SD_BANK_SIZE                (0x80000UL)
+
+/* Room between the target address and the end of its bank */
+#define SD_MAX_FILE_SIZE            (SD_BANK_SIZE - (BTL_SDCARD_ADDRESS % SD_BANK_SIZE))
+
+#define SD_BLOCK_SECTORS            (BTL_BLOCK_SIZE / BTL_FAT32_SECTOR_SIZE)
+
+#define SD_HEADER_SIZE              ((uint32_t)sizeof(struct binary_header))
+
+/* The header is word aligned within the first erase block */
+#define SD_HEADER_WORDS             ((BTL_BLOCK_SIZE - SD_HEADER_SIZE) / 4U)
+
+/* The DMA target has to be word aligned, so the packet starts 3 bytes into
+ * its buffer to put the erase block data behind the 9 byte header and the
+ * 4 byte address on a word boundary */
+#define SD_PACKET_OFFSET            3U
+#define SD_DATA_OFFSET              (BTL_HEADER_SIZE + 4U)
+
+enum sd_state
+{
+    /* No card or no image, nothing to do */
+    SD_STATE_IDLE,
+
+    /* Erase block being read from the card */
+    SD_STATE_READ,
+
+    /* Packet staged, waiting for the response of the engine */
+    SD_STATE_UNLOCK,
+    SD_STATE_DATA,
+    SD_STATE_VERIFY,
+    SD_STATE_START,
+
+    /* Update abandoned, the running image is left alone */
+    SD_STATE_ERROR,
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static uint32_t sd_packet[(SD_PACKET_OFFSET + SD_DATA_OFFSET + BTL_BLOCK_SIZE + 3U) / 4U] NO_INIT;
+static uint8_t  *const sd_packet_bytes = (uint8_t *)sd_packet + SD_PACKET_OFFSET;
+static uint8_t  *const sd_data = (uint8_t *)sd_packet + SD_PACKET_OFFSET + SD_DATA_OFFSET;
+
+/* UNLOCK, VERIFY and the final reset */
+static uint32_t sd_command[(BTL_HEADER_SIZE + 8U + 3U) / 4U];
+
+/* Packet handed to the engine */
+static const uint8_t *sd_tx         = NULL;
+static size_t   sd_tx_size          = 0;
+static size_t   sd_tx_ptr           = 0;
+
+static enum sd_state sd_state       = SD_STATE_IDLE;
+
+static uint32_t sd_file_size        = 0;
+static uint32_t sd_blocks           = 0;
+static uint32_t sd_sectors_left     = 0;
+
+/* Erase block in sd_data and how many of its sectors were requested */
+static uint32_t sd_block            = 0;
+static uint32_t sd_block_sectors    = 0;
+static bool     sd_reading          = false;
+
+static bool     sd_unlocked         = false;
+
+static struct binary_header sd_header;
+static uint32_t sd_header_offset    = 0;
+static unsigned long sd_header_crc  = 0;
+static unsigned long sd_image_crc   = 0;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: SD Card Transport Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static void sd_put32(uint8_t *dest, uint32_t value)
+{
+    dest[0] = (uint8_t)value;
+    dest[1] = (uint8_t)(value >> 8);
+    dest[2] = (uint8_t)(value >> 16);
+    dest[3] = (uint8_t)(value >> 24);
+}
+
+static void sd_submit(uint8_t *packet, uint8_t command, uint32_t payload_size, enum sd_state state)
+{
+    sd_put32(&packet[0], BTL_GUARD);
+    sd_put32(&packet[BTL_SIZE_OFFSET], payload_size);
+    packet[BTL_CMD_OFFSET] = command;
+
+    sd_tx       = packet;
+    sd_tx_size  = BTL_HEADER_SIZE + payload_size;
+    sd_tx_ptr   = 0;
+    sd_state    = state;
+}
+
+static void sd_command_submit(uint8_t command, uint32_t arg0, uint32_t arg1, uint32_t payload_size, enum sd_state state)
+{
+    uint8_t *packet = (uint8_t *)sd_command;
+
+    sd_put32(&packet[BTL_HEADER_SIZE], arg0);
+    sd_put32(&packet[BTL_HEADER_SIZE + 4U], arg1);
+
+    sd_submit(packet, command, payload_size, state);
+}
+
+/* Same search as the boot check: the first word aligned signature pair */
+static bool sd_header_find(void)
+{
+    const uint32_t *words = (const uint32_t *)sd_data;
+    uint32_t i;
+
+    for (i = 0; i < SD_HEADER_WORDS; i++)
+    {
+        if ((words[i] == SIGNATURE1) && (words[i + 1U] == SIGNATURE2))
+        {
+            memcpy(&sd_header, &words[i], SD_HEADER_SIZE);
+
+            sd_header_offset = i * 4U;
+
+            return (sd_header.bin_size >= (sd_header_offset + SD_HEADER_SIZE)) &&
+                   (sd_header.bin_size <= sd_file_size);
+        }
+    }
+
+    return false;
+}
+
+static void sd_header_crc_range(uint32_t offset, uint32_t begin, uint32_t end)
+{
+    if (end > begin)
+    {
+        sd_header_crc = crc32(sd_header_crc, &sd_data[begin - offset], end - begin);
+    }
+}
+
+/* Runs the boot time header check over the file as it streams past */
+static void sd_header_crc_update(uint32_t offset)
+{
+    uint32_t end    = offset + BTL_BLOCK_SIZE;
+    uint32_t resume = sd_header_offset + SD_HEADER_SIZE;
+
+    if (end > sd_header.bin_size)
+    {
+        end = sd_header.bin_size;
+    }
+
+    if (offset < sd_header_offset)
+    {
+        sd_header_crc_range(offset, offset, (end < sd_header_offset) ? end : sd_header_offset);
+    }
+
+    sd_header_crc_range(offset, (offset > resume) ? offset : resume, end);
+}
+
+static void sd_block_complete(void)
+{
+    uint32_t offset = sd_block * BTL_BLOCK_SIZE;
+    uint32_t valid  = sd_file_size - offset;
+
+    if (valid < BTL_BLOCK_SIZE)
+    {
+        memset(&sd_data[valid], 0xFF, BTL_BLOCK_SIZE - valid);
+    }
+
+    if ((sd_block == 0U) && (sd_header_find() == false))
+    {
+        sd_state = SD_STATE_ERROR;
+        return;
+    }
+
+    sd_header_crc_update(offset);
+
+    sd_image_crc = crc32(sd_image_crc, sd_data, BTL_BLOCK_SIZE);
+
+    sd_put32(&sd_packet_bytes[BTL_HEADER_SIZE], BTL_SDCARD_ADDRESS + offset);
+
+    if (sd_unlocked == false)
+    {
+        sd_command_submit(BL_CMD_UNLOCK, BTL_SDCARD_ADDRESS, sd_blocks * BTL_BLOCK_SIZE, 8U, SD_STATE_UNLOCK);
+    }
+    else
+    {
+        sd_submit(sd_packet_bytes, BL_CMD_DATA, BTL_DATA_PAYLOAD_SIZE, SD_STATE_DATA);
+    }
+}
+
+/* Fills sd_data with the next erase block, one run of sectors at a time */
+static void sd_read_task(void)
+{
+    SDHC0_XFER_STATUS status;
+    uint32_t lba, count;
+
+    if (sd_reading == true)
+    {
+        status = SDHC0_ReadStatusGet();
+
+        if (status == SDHC0_XFER_BUSY)
+        {
+            return;
+        }
+
+        sd_reading = false;
+
+        if (status != SDHC0_XFER_DONE)
+        {
+            sd_state = SD_STATE_ERROR;
+            return;
+        }
+    }
+
+    if ((sd_block_sectors == SD_BLOCK_SECTORS) || (sd_sectors_left == 0U))
+    {
+        sd_block_complete();
+        return;
+    }
+
+    count = SD_BLOCK_SECTORS - sd_block_sectors;
+
+    if (count > sd_sectors_left)
+    {
+        count = sd_sectors_left;
+    }
+
+    count = bootloader_Fat32Run(&lba, count);
+
+    if ((count == 0U) || (SDHC0_ReadStart(lba, &sd_data[sd_block_sectors * BTL_FAT32_SECTOR_SIZE], count) == false))
+    {
+        sd_state = SD_STATE_ERROR;
+        return;
+    }
+
+    sd_block_sectors += count;
+    sd_sectors_left  -= count;
+    sd_reading        = true;
+}
+
+/* The last block is in flash once the engine answers the next packet */
+static void sd_image_finish(void)
+{
+    if (sd_header_crc != sd_header.crc32)
+    {
+        sd_state = SD_STATE_ERROR;
+        return;
+    }
+
+    sd_command_submit(BL_CMD_VERIFY, (uint32_t)(sd_image_crc ^ 0xFFFFFFFFUL), 0, 4U, SD_STATE_VERIFY);
+}
+
+static void sd_engine_response(uint8_t response)
+{
+    enum sd_state state = sd_state;
+
+    sd_tx       = NULL;
+    sd_tx_size  = 0;
+    sd_tx_ptr   = 0;
+    sd_state    = SD_STATE_ERROR;
+
+    switch (state)
+    {
+        case SD_STATE_UNLOCK:
+            if (response == BL_RESP_OK)
+            {
+                sd_unlocked = true;
+
+                sd_submit(sd_packet_bytes, BL_CMD_DATA, BTL_DATA_PAYLOAD_SIZE, SD_STATE_DATA);
+            }
+            break;
+
+        case SD_STATE_DATA:
+            if (response == BL_RESP_OK)
+            {
+                sd_block++;
+                sd_block_sectors = 0;
+
+                if (sd_block < sd_blocks)
+                {
+                    sd_state = SD_STATE_READ;
+                }
+                else
+                {
+                    sd_image_finish();
+                }
+            }
+            break;
+
+        case SD_STATE_VERIFY:
+            if (response == BL_RESP_CRC_OK)
+            {
+                sd_command_submit((BTL_SDCARD_SWAP == 1) ? BL_CMD_BKSWAP_RESET : BL_CMD_RESET, 0, 0, 0U, SD_STATE_START);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void bootloader_SdCardInitialize(void)
+{
+    uint32_t size = 0;
+
+    if ((SDHC0_CardInitialize() == false) || (bootloader_Fat32Mount() == false) ||
+        (bootloader_Fat32Open(BTL_SDCARD_FILE, &size) == false) ||
+        (size == 0U) || (size > SD_MAX_FILE_SIZE))
+    {
+        sd_state = SD_STATE_IDLE;
+        return;
+    }
+
+    sd_file_size    = size;
+    sd_blocks       = (size + BTL_BLOCK_SIZE - 1U) / BTL_BLOCK_SIZE;
+    sd_sectors_left = (size + BTL_FAT32_SECTOR_SIZE - 1U) / BTL_FAT32_SECTOR_SIZE;
+    sd_state        = SD_STATE_READ;
+}
+
+static bool sd_receiver_is_ready(void)
+{
+    if (sd_state == SD_STATE_READ)
+    {
+        sd_read_task();
+    }
+
+    return (sd_tx_ptr < sd_tx_size);
+}
+
+static size_t sd_read(uint8_t *buffer, size_t size)
+{
+    size_t count = sd_tx_size - sd_tx_ptr;
+
+    if (count > size)
+    {
+        count = size;
+    }
+
+    memcpy(buffer, &sd_tx[sd_tx_ptr], count);
+
+    sd_tx_ptr += count;
+
+    return count;
+}
+
+static void sd_write(const uint8_t *buffer, size_t size)
+{
+    if (size > 0U)
+    {
+        sd_engine_response(buffer[0]);
+    }
+}
+
+/* Nothing is sent back */
+static void sd_flush(void)
+{
+}
+
+/* The card clock is set up by the SDHC library */
+static bool sd_link_setup(uint32_t bitRate)
+{
+    (void)bitRate;
+
+    return true;
+}
+
+const BOOTLOADER_TRANSPORT bootloader_SdCardTransport =
+{
+    .receiverIsReady    = sd_receiver_is_ready,
+    .read               = sd_read,
+    .write              = sd_write,
+    .flush              = sd_flush,
+    .linkSetup          = sd_link_setup,
+};
+
+#endif
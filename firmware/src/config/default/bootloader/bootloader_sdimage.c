@@ -0,0 +1,141 @@
+/*******************************************************************************
+  SD Card Image Backend Source File
+
+  File Name:
+    bootloader_sdimage.c
+
+  Summary:
+    This file contains a disk image implementation of the SDHC0 peripheral
+    library calls used by the SD card transport.
+
+  Description:
+    This backend is only used when the protocol engine is built for a Linux
+    host together with bootloader_fat32.c and bootloader_sdcard.c. A raw
+    image of a card, e.g. made with
+
+        mkfs.fat -F 32 -C card.img 65536
+        mcopy -i card.img app.bin ::FIRMWARE.BIN
+
+    stands in for the card. Every read reports busy once before it completes,
+    so the transport goes through the same overlap path as on the device.
+
+    It is not part of the MPLAB X project.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#if defined(__unix__)
+
+#define _GNU_SOURCE
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include "bootloader_transport.h"
+#include "peripheral/sdhc/plib_sdhc0.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static int  sdimage_fd          = -1;
+
+static bool sdimage_reading     = false;
+static bool sdimage_polled      = false;
+static bool sdimage_error       = false;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: SDHC0 Library Functions
+// *****************************************************************************
+// *****************************************************************************
+
+/* Opens the card image read-only */
+bool bootloader_SdImageOpen(const char *path)
+{
+    sdimage_fd = open(path, O_RDONLY);
+
+    return (sdimage_fd >= 0);
+}
+
+bool SDHC0_CardInitialize( void )
+{
+    return (sdimage_fd >= 0);
+}
+
+/* Blocks behind the end of the image read as zeros */
+bool SDHC0_ReadStart( uint32_t lba, void *buffer, uint32_t blocks )
+{
+    size_t size = (size_t)blocks * SDHC0_BLOCK_SIZE;
+    ssize_t count;
+
+    if ((sdimage_reading == true) || (blocks == 0U) || (blocks > SDHC0_MAX_BLOCKS))
+    {
+        return false;
+    }
+
+    count = pread(sdimage_fd, buffer, size, (off_t)lba * SDHC0_BLOCK_SIZE);
+
+    if ((count >= 0) && ((size_t)count < size))
+    {
+        memset((uint8_t *)buffer + count, 0, size - (size_t)count);
+    }
+
+    sdimage_reading = true;
+    sdimage_polled  = false;
+    sdimage_error   = (count < 0);
+
+    return true;
+}
+
+SDHC0_XFER_STATUS SDHC0_ReadStatusGet( void )
+{
+    if (sdimage_reading == false)
+    {
+        return SDHC0_XFER_DONE;
+    }
+
+    if (sdimage_polled == false)
+    {
+        sdimage_polled = true;
+
+        return SDHC0_XFER_BUSY;
+    }
+
+    sdimage_reading = false;
+
+    return (sdimage_error == true) ? SDHC0_XFER_ERROR : SDHC0_XFER_DONE;
+}
+
+#endif
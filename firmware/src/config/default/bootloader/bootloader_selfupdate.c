@@ -0,0 +1,268 @@
+/*******************************************************************************
+  Bootloader Self-Update Source File
+
+  File Name:
+    bootloader_selfupdate.c
+
+  Summary:
+    This file replaces the bootloader with a copy staged in flash.
+
+  Description:
+    The host stages the new bootloader in an erase block of the application
+    area with UNLOCK, DATA and VERIFY, then sends SELF_UPDATE. The staged
+    block is checked with the DSU and written to the inactive bank together
+    with the application area of the running one, both checked with the DSU
+    again. The host then sends BKSWAP_RESET and the new bootloader boots
+    from the other bank with the same application. The running bank is
+    never written, so a power loss at any point leaves it to boot as
+    before. A brown-out during the copy is detected by BOD33 instead of
+    resetting the core, and the copy is started over once the supply is
+    back. At boot the block 0 of the inactive bank is brought in line with
+    the running bootloader, so a later bank swap starts the same one.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include "definitions.h"
+#include <device.h>
+
+#if (BTL_SELF_UPDATE == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define SELF_UPDATE_BOOT_SIZE       ((uint32_t)BTL_BOOTLOADER_SIZE)
+#define SELF_UPDATE_APP_START       ((uint32_t)BTL_BOOTLOADER_SIZE)
+#define SELF_UPDATE_BANK_SIZE       (FLASH_SIZE / 2UL)
+#define SELF_UPDATE_INACTIVE_BANK   (FLASH_ADDR + SELF_UPDATE_BANK_SIZE)
+#define SELF_UPDATE_APP_SIZE        (SELF_UPDATE_BANK_SIZE - SELF_UPDATE_APP_START)
+#define SELF_UPDATE_PAGE_WORDS      (NVMCTRL_FLASH_PAGESIZE / sizeof(uint32_t))
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Bootloader Local Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static uint32_t self_update_crc(uint32_t address, uint32_t size)
+{
+    uint32_t crc = 0;
+
+    PAC_PeripheralProtectSetup (PAC_PERIPHERAL_DSU, PAC_PROTECTION_CLEAR);
+
+    DSU_CRCCalculate (address, size, 0xffffffff, &crc);
+
+    PAC_PeripheralProtectSetup (PAC_PERIPHERAL_DSU, PAC_PROTECTION_SET);
+
+    return crc;
+}
+
+static void self_update_command(uint32_t command)
+{
+    NVMCTRL_REGS->NVMCTRL_CTRLB = command | NVMCTRL_CTRLB_CMDEX_KEY;
+
+    while (NVMCTRL_IsBusy() == true)
+    {
+        /* Wait for the command to complete */
+    }
+}
+
+/* ACTION may only change while BOD33 is disabled */
+static void self_update_bod33_set(uint32_t bod33)
+{
+    SUPC_REGS->SUPC_BOD33 &= ~SUPC_BOD33_ENABLE_Msk;
+    SUPC_REGS->SUPC_BOD33 = bod33 & ~SUPC_BOD33_ENABLE_Msk;
+    SUPC_REGS->SUPC_BOD33 = bod33;
+
+    if ((bod33 & SUPC_BOD33_ENABLE_Msk) != 0U)
+    {
+        while ((SUPC_REGS->SUPC_STATUS & SUPC_STATUS_BOD33RDY_Msk) == 0U)
+        {
+            /* Wait for the detector to settle */
+        }
+    }
+}
+
+/* The vector table has to be one of a bootloader: its stack in RAM and its
+ * reset handler inside the boot block */
+static bool self_update_vectors_check(const uint32_t *vectors)
+{
+    return (vectors[0] > HSRAM_ADDR) && (vectors[0] <= (HSRAM_ADDR + HSRAM_SIZE)) &&
+           ((vectors[1] & 1U) != 0U) && (vectors[1] < SELF_UPDATE_BOOT_SIZE);
+}
+
+static bool self_update_block_is_equal(const uint32_t *dst, const uint32_t *src)
+{
+    uint32_t i;
+
+    for (i = 0; i < (NVMCTRL_FLASH_BLOCKSIZE / sizeof(uint32_t)); i++)
+    {
+        if (dst[i] != src[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Erases and rewrites the blocks of [dst, dst + size) which differ from the
+ * ones at src, page by page. Blocks already equal are left alone, so a copy
+ * started over after a brown-out or power loss picks up where it was. */
+static void self_update_copy(uint32_t dst, uint32_t src, uint32_t size)
+{
+    uint32_t page[SELF_UPDATE_PAGE_WORDS];
+    const uint32_t *from;
+    uint32_t block;
+    uint32_t addr;
+    uint32_t i;
+
+    for (block = 0; block < size; block += NVMCTRL_FLASH_BLOCKSIZE)
+    {
+        from = (const uint32_t *)(uintptr_t)(src + block);
+
+        if (self_update_block_is_equal((const uint32_t *)(uintptr_t)(dst + block), from) == true)
+        {
+            continue;
+        }
+
+        NVMCTRL_RegionUnlock(dst + block);
+
+        while (NVMCTRL_IsBusy() == true)
+        {
+            /* Wait for the unlock */
+        }
+
+        NVMCTRL_BlockErase(dst + block);
+
+        while (NVMCTRL_IsBusy() == true)
+        {
+            /* Wait for the erase */
+        }
+
+        for (addr = dst + block; addr < (dst + block + NVMCTRL_FLASH_BLOCKSIZE); addr += NVMCTRL_FLASH_PAGESIZE)
+        {
+            for (i = 0; i < SELF_UPDATE_PAGE_WORDS; i++)
+            {
+                page[i] = *from++;
+            }
+
+            NVMCTRL_PageWrite(page, addr);
+
+            while (NVMCTRL_IsBusy() == true)
+            {
+                /* Wait for the page write */
+            }
+        }
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Bootloader Global Functions
+// *****************************************************************************
+// *****************************************************************************
+
+bool bootloader_SelfUpdateCheck(uint32_t address, uint32_t crc)
+{
+    /* Staged in the running bank, the copy to the inactive one takes it
+     * along with the application */
+    if (((address % SELF_UPDATE_BOOT_SIZE) != 0U) || (address < SELF_UPDATE_APP_START) ||
+        (address > (SELF_UPDATE_BANK_SIZE - SELF_UPDATE_BOOT_SIZE)))
+    {
+        return false;
+    }
+
+    return self_update_vectors_check((const uint32_t *)(uintptr_t)address) &&
+           (self_update_crc(address, SELF_UPDATE_BOOT_SIZE) == crc);
+}
+
+bool bootloader_SelfUpdate(uint32_t address, uint32_t crc)
+{
+    uint32_t bod33      = SUPC_REGS->SUPC_BOD33;
+    uint32_t app_crc    = self_update_crc(FLASH_ADDR + SELF_UPDATE_APP_START, SELF_UPDATE_APP_SIZE);
+    uint32_t tries      = 0;
+    bool     done       = false;
+
+    /* A brown-out is waited out instead of resetting the core with a block
+     * half written */
+    self_update_bod33_set((bod33 & ~SUPC_BOD33_ACTION_Msk) | SUPC_BOD33_ACTION_NONE | SUPC_BOD33_ENABLE_Msk);
+
+    self_update_command(NVMCTRL_CTRLB_CMD_SBPDIS);
+
+    while ((done == false) && (tries < BTL_SELF_UPDATE_TRIES))
+    {
+        tries++;
+
+        while ((SUPC_REGS->SUPC_STATUS & SUPC_STATUS_BOD33DET_Msk) != 0U)
+        {
+            /* Wait for the supply to come back */
+        }
+
+        SUPC_REGS->SUPC_INTFLAG = SUPC_INTFLAG_BOD33DET_Msk;
+
+        /* The application the new bootloader is going to start, then the
+         * bootloader itself */
+        self_update_copy(SELF_UPDATE_INACTIVE_BANK + SELF_UPDATE_APP_START, FLASH_ADDR + SELF_UPDATE_APP_START,
+                         SELF_UPDATE_APP_SIZE);
+        self_update_copy(SELF_UPDATE_INACTIVE_BANK, address, SELF_UPDATE_BOOT_SIZE);
+
+        /* Pages written while the supply was low are not trusted even if
+         * they read back right */
+        done = ((SUPC_REGS->SUPC_INTFLAG & SUPC_INTFLAG_BOD33DET_Msk) == 0U) &&
+               (self_update_crc(SELF_UPDATE_INACTIVE_BANK, SELF_UPDATE_BOOT_SIZE) == crc) &&
+               (self_update_crc(SELF_UPDATE_INACTIVE_BANK + SELF_UPDATE_APP_START, SELF_UPDATE_APP_SIZE) == app_crc);
+    }
+
+    self_update_command(NVMCTRL_CTRLB_CMD_CBPDIS);
+
+    self_update_bod33_set(bod33);
+
+    return done;
+}
+
+void bootloader_SelfUpdateSync(void)
+{
+    if (self_update_block_is_equal((const uint32_t *)SELF_UPDATE_INACTIVE_BANK, (const uint32_t *)FLASH_ADDR) == false)
+    {
+        self_update_command(NVMCTRL_CTRLB_CMD_SBPDIS);
+
+        self_update_copy(SELF_UPDATE_INACTIVE_BANK, FLASH_ADDR, SELF_UPDATE_BOOT_SIZE);
+
+        self_update_command(NVMCTRL_CTRLB_CMD_CBPDIS);
+    }
+}
+
+#endif
@@ -0,0 +1,231 @@
+/*******************************************************************************
+  Bootloader Image Signature Source File
+
+  File Name:
+    bootloader_signature.c
+
+  Summary:
+    This file checks the ECDSA signature of the application image.
+
+  Description:
+    Called once the image passed its CRC check. The ICM hashes the image in
+    place and the PUKCC verifies the signature following it, which takes a
+    fraction of what the same in software would. Each bank keeps a record
+    of the image verified there in an erase block of its own, so the check
+    runs once per new image:
+
+      - a record holds the size and crc32 of the image which passed,
+      - flash_task appends an empty record before it programs anything into
+        the bank, so any change of the image drops the record,
+      - records are appended in quad words, the block is only erased once
+        it is full.
+
+    The record only says the bootloader verified the image and has not
+    written the bank since; the CRC check keeps guarding against bit rot.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "definitions.h"
+#include "peripheral/icm/plib_icm.h"
+#include "peripheral/pukcc/plib_pukcc.h"
+
+#if (BTL_SIGNATURE == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define SIGNATURE_APP_START         ((uint32_t)BTL_BOOTLOADER_SIZE)
+#define SIGNATURE_BANK_SIZE         (0x80000UL)
+#define SIGNATURE_CACHE_SIZE        (8192UL)
+
+#define SIGNATURE_MAX_SIZE          (BTL_SIGNATURE_CACHE_OFFSET - SIGNATURE_APP_START - BTL_SIGNATURE_SIZE)
+
+/* "BSIG" */
+#define SIGNATURE_RECORD_MAGIC      0x47495342UL
+#define SIGNATURE_RECORD_ERASED     0xFFFFFFFFUL
+
+#define SIGNATURE_RECORD_CRC_SIZE   ((uint32_t)offsetof(struct signature_record, record_crc))
+
+#define SIGNATURE_RECORDS           (SIGNATURE_CACHE_SIZE / sizeof(struct signature_record))
+
+/* One quad word. An empty record is all zero and matches no image. */
+struct signature_record {
+        uint32_t magic;
+        uint32_t size;
+        uint32_t crc32;
+        uint32_t record_crc;
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static const uint8_t signature_public_key[PUKCC_P256_PUBLIC_KEY_SIZE] = BTL_SIGNATURE_PUBLIC_KEY;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Bootloader Local Functions
+// *****************************************************************************
+// *****************************************************************************
+
+/* Records are appended, the first erased one ends the list */
+static uint32_t signature_record_count(const struct signature_record *records)
+{
+    uint32_t i;
+
+    for (i = 0; i < SIGNATURE_RECORDS; i++)
+    {
+        if (records[i].magic == SIGNATURE_RECORD_ERASED)
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+static void signature_record_write(uint32_t cache, const struct signature_record *record)
+{
+    uint32_t count = signature_record_count((const struct signature_record *)cache);
+
+    NVMCTRL_RegionUnlock(cache);
+
+    while (NVMCTRL_IsBusy() == true)
+    {
+        /* Wait for the NVM controller */
+    }
+
+    if (count == SIGNATURE_RECORDS)
+    {
+        NVMCTRL_BlockErase(cache);
+
+        while (NVMCTRL_IsBusy() == true)
+        {
+            /* Wait for the NVM controller */
+        }
+
+        count = 0;
+    }
+
+    NVMCTRL_QuadWordWrite((const uint32_t *)record, cache + (count * sizeof(struct signature_record)));
+
+    while (NVMCTRL_IsBusy() == true)
+    {
+        /* Wait for the NVM controller */
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Bootloader Global Functions
+// *****************************************************************************
+// *****************************************************************************
+
+bool bootloader_SignatureVerify(uint32_t bin_size, uint32_t app_crc32)
+{
+    const uint8_t *image = (const uint8_t *)SIGNATURE_APP_START;
+    const struct signature_record *records = (const struct signature_record *)BTL_SIGNATURE_CACHE_OFFSET;
+    struct signature_record record;
+    uint8_t  digest[ICM_SHA256_DIGEST_SIZE];
+    uint32_t count = signature_record_count(records);
+
+    if (bin_size > SIGNATURE_MAX_SIZE)
+    {
+        return false;
+    }
+
+    record.magic        = SIGNATURE_RECORD_MAGIC;
+    record.size         = bin_size;
+    record.crc32        = app_crc32;
+    record.record_crc   = (uint32_t)crc32(0, &record, SIGNATURE_RECORD_CRC_SIZE);
+
+    /* Verified before and not written since */
+    if ((count > 0U) && (memcmp(&records[count - 1U], &record, sizeof(record)) == 0))
+    {
+        return true;
+    }
+
+    ICM_Initialize();
+
+    ICM_Sha256(image, bin_size, digest);
+
+    PUKCC_Initialize();
+
+    if (PUKCC_EcdsaP256Verify(digest, &image[BTL_SIGNATURE_OFFSET(bin_size)], signature_public_key) == false)
+    {
+        return false;
+    }
+
+    signature_record_write(BTL_SIGNATURE_CACHE_OFFSET, &record);
+
+    return true;
+}
+
+void bootloader_SignatureInvalidate(uint32_t address)
+{
+    static const struct signature_record empty = { 0 };
+    uint32_t cache = (address - (address % SIGNATURE_BANK_SIZE)) + BTL_SIGNATURE_CACHE_OFFSET;
+    const struct signature_record *records = (const struct signature_record *)cache;
+    uint32_t count = signature_record_count(records);
+
+    /* Nothing verified, or already forgotten in this session */
+    if ((count == 0U) || (records[count - 1U].magic != SIGNATURE_RECORD_MAGIC))
+    {
+        return;
+    }
+
+    signature_record_write(cache, &empty);
+}
+
+bool bootloader_SignatureRangeCheck(uint32_t begin, uint32_t end)
+{
+    uint32_t cache;
+
+    for (cache = BTL_SIGNATURE_CACHE_OFFSET; cache < (2U * SIGNATURE_BANK_SIZE); cache += SIGNATURE_BANK_SIZE)
+    {
+        if ((begin < (cache + SIGNATURE_CACHE_SIZE)) && (cache < end))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,171 @@
+/*******************************************************************************
+  SocketCAN Bootloader Transport Source File
+
+  File Name:
+    bootloader_socketcan.c
+
+  Summary:
+    This file contains a SocketCAN implementation of the CAN0 peripheral
+    library calls used by the CAN FD transport.
+
+  Description:
+    This backend is only used when the protocol engine is built for a Linux
+    host together with bootloader_can.c. Any number of host built nodes,
+    each with its own BTL_CAN_NODE_ID, and the host uploader attach to the
+    same CAN FD capable interface. A vcan interface makes this a simulated
+    bus; a CAN FD adapter connects the host nodes to real hardware.
+
+        ip link add dev vcan0 type vcan
+        ip link set vcan0 mtu 72 up
+
+    It is not part of the MPLAB X project.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#if defined(__unix__)
+
+#define _GNU_SOURCE
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include "bootloader_transport.h"
+#include "peripheral/can/plib_can0.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static int socketcan_fd = -1;
+
+/* Payload length of each data length code */
+static const uint8_t socketcan_fd_length[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: CAN0 Library Functions
+// *****************************************************************************
+// *****************************************************************************
+
+/* Opens a non blocking raw socket taking CAN FD frames on interface */
+bool bootloader_SocketCanOpen(const char *interface)
+{
+    struct sockaddr_can addr;
+    int enable = 1;
+
+    memset(&addr, 0, sizeof(addr));
+
+    addr.can_family  = AF_CAN;
+    addr.can_ifindex = (int)if_nametoindex(interface);
+
+    socketcan_fd = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK, CAN_RAW);
+
+    if ((socketcan_fd < 0) || (addr.can_ifindex == 0))
+    {
+        return false;
+    }
+
+    return (setsockopt(socketcan_fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)) == 0) &&
+           (bind(socketcan_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+}
+
+/* The kernel filter takes the place of the dual ID filter element */
+void CAN0_Initialize( uint16_t id0, uint16_t id1 )
+{
+    struct can_filter filter[2] =
+    {
+        { .can_id = id0, .can_mask = CAN_SFF_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG },
+        { .can_id = id1, .can_mask = CAN_SFF_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG },
+    };
+
+    setsockopt(socketcan_fd, SOL_CAN_RAW, CAN_RAW_FILTER, filter, sizeof(filter));
+}
+
+/* Frames leave the socket in write order */
+bool CAN0_TransmitIsComplete( void )
+{
+    return true;
+}
+
+bool CAN0_MessageTransmit( uint16_t id, const uint8_t *data, uint8_t length )
+{
+    struct canfd_frame frame;
+    uint8_t dlc = 0;
+
+    if (length > CAN0_FRAME_SIZE)
+    {
+        return false;
+    }
+
+    while (socketcan_fd_length[dlc] < length)
+    {
+        dlc++;
+    }
+
+    memset(&frame, CAN0_PADDING_BYTE, sizeof(frame));
+
+    frame.can_id = id;
+    frame.len    = socketcan_fd_length[dlc];
+    frame.flags  = CANFD_BRS;
+    frame.__res0 = 0;
+    frame.__res1 = 0;
+
+    memcpy(frame.data, data, length);
+
+    return (write(socketcan_fd, &frame, CANFD_MTU) == (ssize_t)CANFD_MTU);
+}
+
+bool CAN0_MessageReceive( uint16_t *id, uint8_t *data, uint8_t *length )
+{
+    struct canfd_frame frame;
+    ssize_t count = read(socketcan_fd, &frame, CANFD_MTU);
+
+    if ((count != (ssize_t)CANFD_MTU) && (count != (ssize_t)CAN_MTU))
+    {
+        return false;
+    }
+
+    *id     = (uint16_t)(frame.can_id & CAN_SFF_MASK);
+    *length = frame.len;
+
+    memcpy(data, frame.data, frame.len);
+
+    return true;
+}
+
+#endif
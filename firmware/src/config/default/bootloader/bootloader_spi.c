@@ -0,0 +1,248 @@
+/*******************************************************************************
+  SPI Slave Bootloader Transport Source File
+
+  File Name:
+    bootloader_spi.c
+
+  Summary:
+    This file contains the SERCOM1 SPI slave backend of the bootloader
+    transport.
+
+  Description:
+    The SPI master (usually the board's host processor) sends one protocol
+    packet per slave select transaction. Both directions are moved by the
+    DMAC, the main loop only looks at the transaction boundaries.
+
+    The ready line (BTL_SPI_READY_PIN) is driven low as soon as a transaction
+    has been seen and high again once the slave is armed for the next one.
+    After every transaction the master waits for that rising edge before it
+    selects the slave again:
+
+      1. Master sends a packet (guard, size, command, payload) in one
+         transaction. A transaction whose length does not match the size
+         field of its header is dropped.
+      2. When the packet has been handled the response is preloaded and the
+         ready line rises. The response bytes are shifted out at the start
+         of the next transaction, either a dummy one byte read or the next
+         packet. 0xFF is shifted out when no response is pending.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "definitions.h"
+#include "bootloader_transport.h"
+#include "bootloader_protocol.h"
+
+#if (BTL_SPI_SLAVE == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define SPI_RX_CHANNEL          DMAC_CHANNEL_0
+#define SPI_TX_CHANNEL          DMAC_CHANNEL_1
+
+/* Largest packet is a DATA command */
+#define SPI_FRAME_SIZE          (BTL_HEADER_SIZE + BTL_MAX_PAYLOAD_SIZE)
+
+#define SPI_RESPONSE_SIZE       4U
+
+#define SPI_NO_RESPONSE         0xFFU
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static uint8_t  spi_frame[SPI_FRAME_SIZE] NO_INIT;
+static uint8_t  spi_response[SPI_RESPONSE_SIZE];
+
+static size_t   spi_frame_size      = 0;
+static size_t   spi_frame_ptr       = 0;
+
+static bool     spi_frame_ready     = false;
+static bool     spi_response_ready  = false;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: SPI Transport Functions
+// *****************************************************************************
+// *****************************************************************************
+
+/* Accept the next transaction into the frame buffer and tell the master */
+static void spi_receive_start(void)
+{
+    SERCOM1_SPI_ReceiverFlush();
+
+    DMAC_ChannelTransfer(SPI_RX_CHANNEL, (const void *)SERCOM1_SPI_DataAddressGet(), spi_frame, SPI_FRAME_SIZE);
+
+    PORT_PinSet(BTL_SPI_READY_PIN);
+}
+
+/* Only a transaction carrying exactly one packet is handed to the protocol */
+static bool spi_frame_is_valid(size_t size)
+{
+    uint32_t packet_size;
+
+    if (size < BTL_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    packet_size = (uint32_t)spi_frame[BTL_SIZE_OFFSET] |
+                  ((uint32_t)spi_frame[BTL_SIZE_OFFSET + 1U] << 8) |
+                  ((uint32_t)spi_frame[BTL_SIZE_OFFSET + 2U] << 16) |
+                  ((uint32_t)spi_frame[BTL_SIZE_OFFSET + 3U] << 24);
+
+    return (packet_size == (size - BTL_HEADER_SIZE));
+}
+
+/* Advances the backend when the master has released slave select */
+static void spi_task(void)
+{
+    size_t size;
+
+    if (SERCOM1_SPI_TransactionIsComplete() == false)
+    {
+        return;
+    }
+
+    PORT_PinClear(BTL_SPI_READY_PIN);
+
+    DMAC_ChannelDisable(SPI_TX_CHANNEL);
+    DMAC_ChannelDisable(SPI_RX_CHANNEL);
+
+    size = DMAC_ChannelGetTransferredCount(SPI_RX_CHANNEL);
+
+    spi_response_ready = false;
+
+    if (spi_frame_is_valid(size) == true)
+    {
+        spi_frame_size  = size;
+        spi_frame_ptr   = 0;
+        spi_frame_ready = true;
+    }
+    else
+    {
+        SERCOM1_SPI_Preload(SPI_NO_RESPONSE);
+
+        spi_receive_start();
+    }
+}
+
+static bool spi_receiver_is_ready(void)
+{
+    spi_task();
+
+    return (spi_frame_ready == true) && (spi_frame_ptr < spi_frame_size);
+}
+
+static size_t spi_read(uint8_t *buffer, size_t size)
+{
+    size_t count = spi_frame_size - spi_frame_ptr;
+
+    if (spi_frame_ready == false)
+    {
+        return 0;
+    }
+
+    if (count > size)
+    {
+        count = size;
+    }
+
+    memcpy(buffer, &spi_frame[spi_frame_ptr], count);
+
+    spi_frame_ptr += count;
+
+    return count;
+}
+
+/* A response always closes the current frame, unread bytes are dropped */
+static void spi_write(const uint8_t *buffer, size_t size)
+{
+    if (size > SPI_RESPONSE_SIZE)
+    {
+        size = SPI_RESPONSE_SIZE;
+    }
+
+    memcpy(spi_response, buffer, size);
+
+    spi_frame_ready     = false;
+    spi_response_ready  = true;
+
+    DMAC_ChannelTransfer(SPI_TX_CHANNEL, spi_response, (const void *)SERCOM1_SPI_DataAddressGet(), size);
+
+    spi_receive_start();
+}
+
+/* Waits until the master has clocked out the pending response */
+static void spi_flush(void)
+{
+    while (spi_response_ready == true)
+    {
+        spi_task();
+    }
+}
+
+/* The bit clock is driven by the master */
+static bool spi_link_setup(uint32_t bitRate)
+{
+    (void)bitRate;
+
+    return true;
+}
+
+void bootloader_SpiInitialize(void)
+{
+    PORT_PinClear(BTL_SPI_READY_PIN);
+    PORT_PinOutputEnable(BTL_SPI_READY_PIN);
+
+    SERCOM1_SPI_Preload(SPI_NO_RESPONSE);
+
+    spi_receive_start();
+}
+
+const BOOTLOADER_TRANSPORT bootloader_SpiTransport =
+{
+    .receiverIsReady    = spi_receiver_is_ready,
+    .read               = spi_read,
+    .write              = spi_write,
+    .flush              = spi_flush,
+    .linkSetup          = spi_link_setup,
+};
+
+#endif
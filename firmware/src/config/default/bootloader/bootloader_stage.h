@@ -0,0 +1,96 @@
+/*******************************************************************************
+  Bootloader Staging Area Header File
+
+  File Name:
+    bootloader_stage.h
+
+  Summary:
+    This file describes the staging area an application leaves an update in.
+
+  Description:
+    The application downloads an image at its own pace into external flash
+    and publishes it with a header; the bootloader installs it at the next
+    boot. In the flash the header sits at the start of the staging area and
+    the image follows at BTL_STAGE_DATA_OFFSET:
+
+      - erase the staging area,
+      - program the image, then the header with state BTL_STAGE_PENDING,
+      - reset.
+
+    Writing the header last publishes the image in one page program, so a
+    power loss during the download leaves nothing to install. The bootloader
+    writes state once the image is installed, or rejected, and never erases
+    the area itself. This header is meant to be shared with the application.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef BOOTLOADER_STAGE_H
+#define BOOTLOADER_STAGE_H
+
+#include <stdint.h>
+
+/* "BSTG" */
+#define BTL_STAGE_MAGIC             0x47545342UL
+
+/* The header has a page of its own */
+#define BTL_STAGE_DATA_OFFSET       256U
+
+/* Values of state, each one only clears bits of the one before */
+#define BTL_STAGE_PENDING           0xFFFFFFFFUL
+#define BTL_STAGE_REJECTED          0xFFFF0000UL
+#define BTL_STAGE_INSTALLED         0x00000000UL
+
+/* Swap banks once the image is installed. The image has to go to the
+ * inactive bank then, otherwise into the running one. */
+#define BTL_STAGE_FLAG_SWAP         0x00000001UL
+
+// *****************************************************************************
+/* Staging Header
+
+  Description:
+    - magic       : BTL_STAGE_MAGIC
+    - address     : internal flash address of the image, erase block aligned
+                    and past the bootloader of its bank
+    - size        : image bytes following the header
+    - crc32       : crc32() of the image bytes
+    - flags       : BTL_STAGE_FLAG_SWAP
+    - header_crc  : crc32() of the five words above
+    - state       : BTL_STAGE_PENDING when written, updated by the bootloader
+
+    All words are little endian.
+*/
+struct stage_header {
+        uint32_t magic;
+        uint32_t address;
+        uint32_t size;
+        uint32_t crc32;
+        uint32_t flags;
+        uint32_t header_crc;
+        uint32_t state;
+};
+
+#endif
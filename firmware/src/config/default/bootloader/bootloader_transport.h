@@ -0,0 +1,160 @@
+/*******************************************************************************
+  Bootloader Transport Header File
+
+  File Name:
+    bootloader_transport.h
+
+  Summary:
+    This file contains the link interface used by the bootloader protocol.
+
+  Description:
+    The bootloader protocol engine does not talk to a peripheral directly.
+    Every link (UART, host PTY, ...) is exposed as a BOOTLOADER_TRANSPORT
+    instance and the engine only calls through that interface.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef BOOTLOADER_TRANSPORT_H
+#define BOOTLOADER_TRANSPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// *****************************************************************************
+/* Bootloader Transport Interface
+
+  Summary:
+    Set of functions a link has to provide to carry the bootloader protocol.
+
+  Description:
+    - receiverIsReady : Returns true if at least one received byte is waiting.
+    - read            : Copies up to size received bytes into buffer without
+                        blocking and returns the number of bytes copied.
+    - write           : Queues size bytes for transmission. Blocks until all
+                        bytes have been accepted by the link.
+    - flush           : Blocks until every queued byte has left the link.
+    - linkSetup       : Changes the link bit rate once every queued byte has
+                        left the link. Returns false if the rate is not
+                        supported, the previous setting is kept then. Called
+                        for the BIT_RATE command; links whose bit rate is set
+                        elsewhere accept any and keep theirs.
+    - wakeSetup       : Optional. With true the next received byte leaves
+                        its interrupt pending, which ends a sleep; with
+                        false the interrupt is disabled and cleared again.
+                        NULL for links which can not wake the core.
+
+  Remarks:
+    All functions are called from the bootloader main loop only. wakeSetup
+    is called with interrupts disabled and undone before they are enabled,
+    no handler ever runs.
+*/
+typedef struct
+{
+    bool    (*receiverIsReady)(void);
+
+    size_t  (*read)(uint8_t *buffer, size_t size);
+
+    void    (*write)(const uint8_t *buffer, size_t size);
+
+    void    (*flush)(void);
+
+    bool    (*linkSetup)(uint32_t bitRate);
+
+    void    (*wakeSetup)(bool enable);
+
+} BOOTLOADER_TRANSPORT;
+
+/* SERCOM0 USART link */
+extern const BOOTLOADER_TRANSPORT bootloader_UartTransport;
+
+/* wakeSetup of SERCOM0, shared with the RS-485 backend */
+void bootloader_Sercom0WakeSetup( bool enable );
+
+/* SERCOM0 as an addressed node on a half-duplex RS-485 bus */
+extern const BOOTLOADER_TRANSPORT bootloader_Rs485Transport;
+
+void bootloader_Rs485Initialize( void );
+
+/* SERCOM2 USART link, second port of a striped dual UART session */
+extern const BOOTLOADER_TRANSPORT bootloader_Uart2Transport;
+
+/* SERCOM1 SPI slave link with ready line, driven by a host processor */
+extern const BOOTLOADER_TRANSPORT bootloader_SpiTransport;
+
+void bootloader_SpiInitialize( void );
+
+/* USB full speed DFU 1.1 device, programmed with dfu-util */
+extern const BOOTLOADER_TRANSPORT bootloader_UsbDfuTransport;
+
+/* USB mass storage device taking UF2 files */
+extern const BOOTLOADER_TRANSPORT bootloader_UsbMscTransport;
+
+void bootloader_UsbMscInitialize( void );
+
+/* CAN FD node, unicast ISO-TP or gateway multicast */
+extern const BOOTLOADER_TRANSPORT bootloader_CanTransport;
+
+void bootloader_CanInitialize( void );
+
+/* Image file on the FAT32 volume of an SD card */
+extern const BOOTLOADER_TRANSPORT bootloader_SdCardTransport;
+
+void bootloader_SdCardInitialize( void );
+
+/* Update staged by the application in QSPI flash. bootloader_QspiInitialize
+ * returns true if one is pending and the bootloader has to stay up to
+ * install it. bootloader_QspiInstall checks and installs it once the
+ * clocks are up and ends in a reset, whether the image was taken or not. */
+extern const BOOTLOADER_TRANSPORT bootloader_QspiTransport;
+
+bool bootloader_QspiInitialize( void );
+
+void bootloader_QspiInstall( void );
+
+/* Runs the protocol engine with transport as its only link, for a backend
+ * which feeds an install from the device itself while BTL_TRANSPORT stays
+ * the link to the host. Never returns. */
+void bootloader_InstallTasks( const BOOTLOADER_TRANSPORT *transport );
+
+#if defined(__unix__)
+/* Pseudo terminal link, used when the protocol engine is built on a host */
+extern const BOOTLOADER_TRANSPORT bootloader_PtyTransport;
+
+const char *bootloader_PtyOpen( void );
+
+/* SocketCAN backend of the CAN0 library calls, vcan gives a simulated bus */
+bool bootloader_SocketCanOpen( const char *interface );
+
+/* Disk image backend of the SDHC0 library calls, stands in for the card */
+bool bootloader_SdImageOpen( const char *path );
+
+/* Flash image backend of the QSPI library calls, stands in for the NOR */
+bool bootloader_QspiImageOpen( const char *path );
+#endif
+
+#endif
@@ -0,0 +1,196 @@
+/*******************************************************************************
+  UART Bootloader Transport Source File
+
+  File Name:
+    bootloader_uart.c
+
+  Summary:
+    This file contains the USART backends of the bootloader transport.
+
+  Description:
+    This file maps the BOOTLOADER_TRANSPORT interface onto the SERCOM0 USART
+    peripheral library, and onto SERCOM2 when BTL_DUAL_UART is enabled.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include "definitions.h"
+#include "bootloader_transport.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: SERCOM0 Transport Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static bool sercom0_receiver_is_ready(void)
+{
+    return SERCOM0_USART_ReceiverIsReady();
+}
+
+/* Drain whatever the receiver holds, stop as soon as it runs empty */
+static size_t sercom0_read(uint8_t *buffer, size_t size)
+{
+    size_t count = 0;
+
+    while ((count < size) && (SERCOM0_USART_ReceiverIsReady() == true))
+    {
+        buffer[count++] = (uint8_t)SERCOM0_USART_ReadByte();
+    }
+
+    return count;
+}
+
+static void sercom0_write(const uint8_t *buffer, size_t size)
+{
+    SERCOM0_USART_Write((void *)buffer, size);
+}
+
+static void sercom0_flush(void)
+{
+    while(SERCOM0_USART_TransmitComplete() == false);
+}
+
+static bool sercom0_link_setup(uint32_t bitRate)
+{
+    USART_SERIAL_SETUP setup;
+
+    setup.baudRate  = bitRate;
+    setup.parity    = USART_PARITY_NONE;
+    setup.dataWidth = USART_DATA_8_BIT;
+    setup.stopBits  = USART_STOP_1_BIT;
+
+    sercom0_flush();
+
+    return SERCOM0_USART_SerialSetup(&setup, 0);
+}
+
+void bootloader_Sercom0WakeSetup(bool enable)
+{
+    if (enable == true)
+    {
+        SERCOM0_REGS->USART_INT.SERCOM_INTENSET = (uint8_t)SERCOM_USART_INT_INTENSET_RXC_Msk;
+        NVIC_EnableIRQ(SERCOM0_2_IRQn);
+    }
+    else
+    {
+        NVIC_DisableIRQ(SERCOM0_2_IRQn);
+        SERCOM0_REGS->USART_INT.SERCOM_INTENCLR = (uint8_t)SERCOM_USART_INT_INTENCLR_RXC_Msk;
+        NVIC_ClearPendingIRQ(SERCOM0_2_IRQn);
+    }
+}
+
+const BOOTLOADER_TRANSPORT bootloader_UartTransport =
+{
+    .receiverIsReady    = sercom0_receiver_is_ready,
+    .read               = sercom0_read,
+    .write              = sercom0_write,
+    .flush              = sercom0_flush,
+    .linkSetup          = sercom0_link_setup,
+    .wakeSetup          = bootloader_Sercom0WakeSetup,
+};
+
+#if (BTL_DUAL_UART == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: SERCOM2 Transport Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static bool sercom2_receiver_is_ready(void)
+{
+    return SERCOM2_USART_ReceiverIsReady();
+}
+
+static size_t sercom2_read(uint8_t *buffer, size_t size)
+{
+    size_t count = 0;
+
+    while ((count < size) && (SERCOM2_USART_ReceiverIsReady() == true))
+    {
+        buffer[count++] = (uint8_t)SERCOM2_USART_ReadByte();
+    }
+
+    return count;
+}
+
+static void sercom2_write(const uint8_t *buffer, size_t size)
+{
+    SERCOM2_USART_Write((void *)buffer, size);
+}
+
+static void sercom2_flush(void)
+{
+    while(SERCOM2_USART_TransmitComplete() == false);
+}
+
+static bool sercom2_link_setup(uint32_t bitRate)
+{
+    USART_SERIAL_SETUP setup;
+
+    setup.baudRate  = bitRate;
+    setup.parity    = USART_PARITY_NONE;
+    setup.dataWidth = USART_DATA_8_BIT;
+    setup.stopBits  = USART_STOP_1_BIT;
+
+    sercom2_flush();
+
+    return SERCOM2_USART_SerialSetup(&setup, 0);
+}
+
+static void sercom2_wake_setup(bool enable)
+{
+    if (enable == true)
+    {
+        SERCOM2_REGS->USART_INT.SERCOM_INTENSET = (uint8_t)SERCOM_USART_INT_INTENSET_RXC_Msk;
+        NVIC_EnableIRQ(SERCOM2_2_IRQn);
+    }
+    else
+    {
+        NVIC_DisableIRQ(SERCOM2_2_IRQn);
+        SERCOM2_REGS->USART_INT.SERCOM_INTENCLR = (uint8_t)SERCOM_USART_INT_INTENCLR_RXC_Msk;
+        NVIC_ClearPendingIRQ(SERCOM2_2_IRQn);
+    }
+}
+
+const BOOTLOADER_TRANSPORT bootloader_Uart2Transport =
+{
+    .receiverIsReady    = sercom2_receiver_is_ready,
+    .read               = sercom2_read,
+    .write              = sercom2_write,
+    .flush              = sercom2_flush,
+    .linkSetup          = sercom2_link_setup,
+    .wakeSetup          = sercom2_wake_setup,
+};
+
+#endif
@@ -0,0 +1,370 @@
+/*******************************************************************************
+  Bootloader UF2 Source File
+
+  File Name:
+    bootloader_uf2.c
+
+  Summary:
+    This file contains the UF2 block reassembly.
+
+  Description:
+    Payloads are copied into a small set of erase block buffers keyed by
+    their target block. A bitmap per erase block of the region records every
+    payload received in the session, which detects duplicates, tells when a
+    block is complete and which slots an earlier partial commit of the same
+    block already holds in flash.
+ *******************************************************************************/
+
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "configuration.h"
+#include "bootloader_protocol.h"
+#include "bootloader_uf2.h"
+
+#if (BTL_UF2 == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define UF2_MAGIC_START0            0x0A324655UL
+#define UF2_MAGIC_START1            0x9E5D5157UL
+#define UF2_MAGIC_END               0x0AB16F30UL
+
+#define UF2_FLAG_NOT_MAIN_FLASH     0x00000001UL
+#define UF2_FLAG_FAMILY_ID          0x00002000UL
+
+/* Block layout */
+#define UF2_MAGIC_START0_OFFSET     0U
+#define UF2_MAGIC_START1_OFFSET     4U
+#define UF2_FLAGS_OFFSET            8U
+#define UF2_ADDRESS_OFFSET          12U
+#define UF2_PAYLOAD_SIZE_OFFSET     16U
+#define UF2_NUM_BLOCKS_OFFSET       24U
+#define UF2_FAMILY_ID_OFFSET        28U
+#define UF2_DATA_OFFSET             32U
+#define UF2_MAGIC_END_OFFSET        508U
+
+/* 32 payloads per erase block, one bit each */
+#define UF2_SLOTS_FULL              0xFFFFFFFFUL
+
+#define UF2_NO_BUFFER               BTL_UF2_CACHE_BLOCKS
+
+struct uf2_buffer {
+        uint32_t data[BTL_BLOCK_SIZE / sizeof(uint32_t)];
+        uint32_t address;
+        uint32_t slots;
+        uint32_t age;
+        bool     used;
+        bool     ready;
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static struct uf2_buffer uf2_buffers[BTL_UF2_CACHE_BLOCKS];
+
+/* Payloads received in this session, per erase block of the region */
+static uint32_t uf2_received[BTL_UF2_REGION_BLOCKS];
+
+static uint32_t uf2_start           = 0;
+static uint32_t uf2_end             = 0;
+
+static uint32_t uf2_num_blocks      = 0;
+static uint32_t uf2_count           = 0;
+static uint32_t uf2_age             = 0;
+
+static uint32_t uf2_taken           = UF2_NO_BUFFER;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: UF2 Local Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static uint32_t uf2_get32(const uint8_t *src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) |
+           ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static void uf2_session_reset(uint32_t num_blocks)
+{
+    memset(uf2_received, 0, sizeof(uf2_received));
+
+    uf2_num_blocks  = num_blocks;
+    uf2_count       = 0;
+}
+
+/* Buffer collecting the given erase block, a free one, or UF2_NO_BUFFER */
+static uint32_t uf2_buffer_find(uint32_t address)
+{
+    uint32_t i;
+    uint32_t free = UF2_NO_BUFFER;
+
+    for (i = 0; i < BTL_UF2_CACHE_BLOCKS; i++)
+    {
+        if (uf2_buffers[i].used == false)
+        {
+            if (free == UF2_NO_BUFFER)
+            {
+                free = i;
+            }
+        }
+        else if ((uf2_buffers[i].address == address) && (i != uf2_taken))
+        {
+            return i;
+        }
+    }
+
+    return free;
+}
+
+/* Queues the oldest incomplete buffer so it can be reused */
+static void uf2_buffer_evict(void)
+{
+    uint32_t i;
+    uint32_t oldest = UF2_NO_BUFFER;
+
+    for (i = 0; i < BTL_UF2_CACHE_BLOCKS; i++)
+    {
+        if ((uf2_buffers[i].ready == false) &&
+            ((oldest == UF2_NO_BUFFER) || (uf2_buffers[i].age < uf2_buffers[oldest].age)))
+        {
+            oldest = i;
+        }
+    }
+
+    if (oldest != UF2_NO_BUFFER)
+    {
+        uf2_buffers[oldest].ready = true;
+    }
+}
+
+/* Every block of the file is in, nothing more will complete the rest */
+static void uf2_flush(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < BTL_UF2_CACHE_BLOCKS; i++)
+    {
+        if (uf2_buffers[i].used == true)
+        {
+            uf2_buffers[i].ready = true;
+        }
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: UF2 Global Functions
+// *****************************************************************************
+// *****************************************************************************
+
+void bootloader_Uf2Initialize(uint32_t start, uint32_t end)
+{
+    memset(uf2_buffers, 0, sizeof(uf2_buffers));
+
+    if ((end - start) > (BTL_UF2_REGION_BLOCKS * BTL_BLOCK_SIZE))
+    {
+        end = start + (BTL_UF2_REGION_BLOCKS * BTL_BLOCK_SIZE);
+    }
+
+    uf2_start   = start;
+    uf2_end     = end;
+    uf2_age     = 0;
+    uf2_taken   = UF2_NO_BUFFER;
+
+    uf2_session_reset(0);
+}
+
+BTL_UF2_RESULT bootloader_Uf2SectorWrite(const uint8_t *sector)
+{
+    uint32_t flags      = uf2_get32(&sector[UF2_FLAGS_OFFSET]);
+    uint32_t address    = uf2_get32(&sector[UF2_ADDRESS_OFFSET]);
+    uint32_t num_blocks = uf2_get32(&sector[UF2_NUM_BLOCKS_OFFSET]);
+    uint32_t block, region, slot, index;
+    struct uf2_buffer *buffer;
+
+    if ((uf2_get32(&sector[UF2_MAGIC_START0_OFFSET]) != UF2_MAGIC_START0) ||
+        (uf2_get32(&sector[UF2_MAGIC_START1_OFFSET]) != UF2_MAGIC_START1) ||
+        (uf2_get32(&sector[UF2_MAGIC_END_OFFSET]) != UF2_MAGIC_END))
+    {
+        return BTL_UF2_IGNORED;
+    }
+
+    /* Blocks for other targets or chips share the file, skip them */
+    if (((flags & UF2_FLAG_NOT_MAIN_FLASH) != 0U) ||
+        (((flags & UF2_FLAG_FAMILY_ID) != 0U) && (uf2_get32(&sector[UF2_FAMILY_ID_OFFSET]) != BTL_UF2_FAMILY_ID)) ||
+        (uf2_get32(&sector[UF2_PAYLOAD_SIZE_OFFSET]) != BTL_UF2_PAYLOAD_SIZE) ||
+        ((address % BTL_UF2_PAYLOAD_SIZE) != 0U) ||
+        (address < uf2_start) || (address >= uf2_end))
+    {
+        return BTL_UF2_ACCEPTED;
+    }
+
+    /* A different block count means a new file */
+    if (num_blocks != uf2_num_blocks)
+    {
+        uf2_session_reset(num_blocks);
+    }
+
+    block   = address & ~(BTL_BLOCK_SIZE - 1U);
+    region  = (block - uf2_start) / BTL_BLOCK_SIZE;
+    slot    = 1UL << ((address - block) / BTL_UF2_PAYLOAD_SIZE);
+    index   = uf2_buffer_find(block);
+
+    /* Hosts rewrite sectors, a payload already committed stays as it is */
+    if (((index == UF2_NO_BUFFER) || (uf2_buffers[index].used == false)) &&
+        ((uf2_received[region] & slot) != 0U))
+    {
+        return BTL_UF2_ACCEPTED;
+    }
+
+    if (index == UF2_NO_BUFFER)
+    {
+        uf2_buffer_evict();
+
+        return BTL_UF2_BUSY;
+    }
+
+    buffer = &uf2_buffers[index];
+
+    if (buffer->used == false)
+    {
+        memset(buffer->data, 0xFF, sizeof(buffer->data));
+
+        buffer->address = block;
+        buffer->slots   = 0;
+        buffer->ready   = false;
+        buffer->used    = true;
+    }
+
+    memcpy((uint8_t *)buffer->data + (address - block), &sector[UF2_DATA_OFFSET], BTL_UF2_PAYLOAD_SIZE);
+
+    buffer->slots  |= slot;
+    buffer->age     = uf2_age++;
+
+    if ((uf2_received[region] & slot) == 0U)
+    {
+        uf2_received[region] |= slot;
+        uf2_count++;
+    }
+
+    if (uf2_received[region] == UF2_SLOTS_FULL)
+    {
+        buffer->ready = true;
+    }
+
+    if (uf2_count >= uf2_num_blocks)
+    {
+        uf2_flush();
+    }
+
+    return BTL_UF2_ACCEPTED;
+}
+
+const uint8_t *bootloader_Uf2CommitGet(uint32_t *address, uint32_t *keep)
+{
+    uint32_t i;
+    uint32_t next = UF2_NO_BUFFER;
+    struct uf2_buffer *buffer;
+
+    if (uf2_taken != UF2_NO_BUFFER)
+    {
+        next = uf2_taken;
+    }
+    else
+    {
+        for (i = 0; i < BTL_UF2_CACHE_BLOCKS; i++)
+        {
+            if ((uf2_buffers[i].used == true) && (uf2_buffers[i].ready == true) &&
+                ((next == UF2_NO_BUFFER) || (uf2_buffers[i].age < uf2_buffers[next].age)))
+            {
+                next = i;
+            }
+        }
+    }
+
+    if (next == UF2_NO_BUFFER)
+    {
+        return NULL;
+    }
+
+    uf2_taken   = next;
+    buffer      = &uf2_buffers[next];
+
+    *address    = buffer->address;
+    *keep       = uf2_received[(buffer->address - uf2_start) / BTL_BLOCK_SIZE] & ~buffer->slots;
+
+    return (const uint8_t *)buffer->data;
+}
+
+void bootloader_Uf2CommitDone(void)
+{
+    if (uf2_taken != UF2_NO_BUFFER)
+    {
+        uf2_buffers[uf2_taken].used     = false;
+        uf2_buffers[uf2_taken].ready    = false;
+
+        uf2_taken = UF2_NO_BUFFER;
+    }
+}
+
+bool bootloader_Uf2IsComplete(void)
+{
+    uint32_t i;
+
+    if ((uf2_num_blocks == 0U) || (uf2_count < uf2_num_blocks))
+    {
+        return false;
+    }
+
+    for (i = 0; i < BTL_UF2_CACHE_BLOCKS; i++)
+    {
+        if (uf2_buffers[i].used == true)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#endif
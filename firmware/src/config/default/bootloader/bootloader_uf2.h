@@ -0,0 +1,133 @@
+/*******************************************************************************
+  Bootloader UF2 Header File
+
+  File Name:
+    bootloader_uf2.h
+
+  Summary:
+    This file contains the interface of the UF2 block reassembly.
+
+  Description:
+    UF2 files carry the image as 512 byte blocks with 256 bytes of payload
+    and a target address each. This module collects the payloads of
+    arbitrary blocks, in any order, into erase block sized buffers and hands
+    out every buffer once it is complete. It has no hardware dependency so
+    it can be built and exercised on a host.
+ *******************************************************************************/
+
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef BOOTLOADER_UF2_H
+#define BOOTLOADER_UF2_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Size of a UF2 block and of its flash payload */
+#define BTL_UF2_BLOCK_SIZE          512U
+#define BTL_UF2_PAYLOAD_SIZE        256U
+
+/* Erase block buffers, blocks arriving out of order are collected in these */
+#ifndef BTL_UF2_CACHE_BLOCKS
+#define BTL_UF2_CACHE_BLOCKS        4U
+#endif
+
+/* Largest region that can be programmed, in erase blocks */
+#define BTL_UF2_REGION_BLOCKS       128U
+
+/* Family ID of SAMD51/SAME51 images */
+#define BTL_UF2_FAMILY_ID           0x55114460UL
+
+typedef enum
+{
+    /* Payload stored, or the block is not meant for this device */
+    BTL_UF2_ACCEPTED,
+
+    /* Sector is no UF2 block, e.g. file system metadata */
+    BTL_UF2_IGNORED,
+
+    /* No buffer free, call again once a buffer has been committed */
+    BTL_UF2_BUSY,
+
+} BTL_UF2_RESULT;
+
+// *****************************************************************************
+/* Function:
+    void bootloader_Uf2Initialize( uint32_t start, uint32_t end );
+
+ Summary:
+    Starts a new session accepting payloads for the flash range [start, end).
+
+ Remarks:
+    start has to be erase block aligned, the range is limited to
+    BTL_UF2_REGION_BLOCKS erase blocks.
+*/
+void bootloader_Uf2Initialize( uint32_t start, uint32_t end );
+
+// *****************************************************************************
+/* Function:
+    BTL_UF2_RESULT bootloader_Uf2SectorWrite( const uint8_t *sector );
+
+ Summary:
+    Takes one 512 byte sector written by the host.
+
+ Description:
+    An erase block buffer is queued for commit once all of its payloads have
+    arrived, or once the number of blocks announced by the file has been
+    received. When a payload needs a buffer and none is free, the oldest
+    incomplete one is queued for commit and BTL_UF2_BUSY is returned.
+*/
+BTL_UF2_RESULT bootloader_Uf2SectorWrite( const uint8_t *sector );
+
+// *****************************************************************************
+/* Function:
+    const uint8_t *bootloader_Uf2CommitGet( uint32_t *address, uint32_t *keep );
+
+ Summary:
+    Returns the next erase block to be programmed, or NULL.
+
+ Description:
+    keep is a bitmap of the 256 byte payload slots of the block that were
+    programmed by an earlier, partial commit of the same block. The caller
+    has to take those from the flash, they are left 0xFF in the buffer.
+    The buffer stays valid until bootloader_Uf2CommitDone() is called.
+*/
+const uint8_t *bootloader_Uf2CommitGet( uint32_t *address, uint32_t *keep );
+
+void bootloader_Uf2CommitDone( void );
+
+// *****************************************************************************
+/* Function:
+    bool bootloader_Uf2IsComplete( void );
+
+ Summary:
+    Returns true once every block of the file has been received and
+    committed.
+*/
+bool bootloader_Uf2IsComplete( void );
+
+#endif
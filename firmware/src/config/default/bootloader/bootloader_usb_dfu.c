@@ -0,0 +1,796 @@
+/*******************************************************************************
+  USB DFU Bootloader Transport Source File
+
+  File Name:
+    bootloader_usb_dfu.c
+
+  Summary:
+    This file contains the USB DFU 1.1 backend of the bootloader transport.
+
+  Description:
+    The device enumerates as a DFU mode device (class 0xFE, subclass 1,
+    protocol 2) so standard tools such as dfu-util can program it:
+
+      dfu-util -D app.bin -R
+
+    DFU requests are translated into bootloader protocol packets that the
+    protocol engine reads through the BOOTLOADER_TRANSPORT interface, so
+    downloads use the same erase/write engine as the UART links:
+
+      - the first DNLOAD of a session unlocks the application region,
+      - DNLOAD block n becomes a DATA packet for APP_START + n * 8 KB, a
+        short last block is padded with 0xFF,
+      - manifestation unlocks exactly the downloaded range and runs VERIFY
+        against a CRC accumulated over the received blocks,
+      - DFU_DETACH or a bus reset after a successful manifestation becomes
+        a RESET packet.
+
+    The USB side only uses the endpoint 0 interface of plib_usb.h.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "definitions.h"
+#include "bootloader_transport.h"
+#include "bootloader_protocol.h"
+
+#if (BTL_USB_DFU == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define DFU_APP_START               ((uint32_t)BTL_BOOTLOADER_SIZE)
+#define DFU_APP_END                 (0x80000UL)
+
+#define DFU_TRANSFER_SIZE           BTL_BLOCK_SIZE
+
+/* Time the host waits between GETSTATUS requests while the engine is busy */
+#define DFU_POLL_TIMEOUT            10U
+
+#define DFU_DETACH_TIMEOUT          1000U
+
+/* Descriptor types */
+#define USB_DESC_DEVICE             0x01U
+#define USB_DESC_CONFIGURATION      0x02U
+#define USB_DESC_STRING             0x03U
+#define USB_DESC_INTERFACE          0x04U
+#define USB_DESC_DFU_FUNCTIONAL     0x21U
+
+/* bmRequestType type field */
+#define USB_REQ_TYPE_MASK           0x60U
+#define USB_REQ_TYPE_STANDARD       0x00U
+#define USB_REQ_TYPE_CLASS          0x20U
+
+#define USB_REQ_DIR_IN              0x80U
+
+/* Standard requests */
+#define USB_REQ_GET_STATUS          0x00U
+#define USB_REQ_CLEAR_FEATURE       0x01U
+#define USB_REQ_SET_FEATURE         0x03U
+#define USB_REQ_SET_ADDRESS         0x05U
+#define USB_REQ_GET_DESCRIPTOR      0x06U
+#define USB_REQ_GET_CONFIGURATION   0x08U
+#define USB_REQ_SET_CONFIGURATION   0x09U
+#define USB_REQ_GET_INTERFACE       0x0AU
+#define USB_REQ_SET_INTERFACE       0x0BU
+
+/* DFU class requests */
+#define DFU_REQ_DETACH              0x00U
+#define DFU_REQ_DNLOAD              0x01U
+#define DFU_REQ_UPLOAD              0x02U
+#define DFU_REQ_GETSTATUS           0x03U
+#define DFU_REQ_CLRSTATUS           0x04U
+#define DFU_REQ_GETSTATE            0x05U
+#define DFU_REQ_ABORT               0x06U
+
+/* bitCanDnload | bitManifestationTolerant */
+#define DFU_ATTRIBUTES              0x05U
+
+enum dfu_state
+{
+    DFU_STATE_IDLE                  = 2,
+    DFU_STATE_DNLOAD_SYNC           = 3,
+    DFU_STATE_DNBUSY                = 4,
+    DFU_STATE_DNLOAD_IDLE           = 5,
+    DFU_STATE_MANIFEST_SYNC         = 6,
+    DFU_STATE_MANIFEST              = 7,
+    DFU_STATE_ERROR                 = 10,
+};
+
+enum dfu_status
+{
+    DFU_STATUS_OK                   = 0x00,
+    DFU_STATUS_ERR_VERIFY           = 0x07,
+    DFU_STATUS_ERR_ADDRESS          = 0x08,
+    DFU_STATUS_ERR_NOTDONE          = 0x09,
+    DFU_STATUS_ERR_STALLEDPKT       = 0x0F,
+};
+
+/* Progress of the packets handed to the protocol engine */
+enum dfu_step
+{
+    DFU_STEP_NONE,
+    DFU_STEP_SESSION_UNLOCK,
+    DFU_STEP_DATA,
+    DFU_STEP_VERIFY_UNLOCK,
+    DFU_STEP_VERIFY,
+    DFU_STEP_DONE,
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Descriptors
+// *****************************************************************************
+// *****************************************************************************
+
+static const uint8_t dfu_device_descriptor[] =
+{
+    18, USB_DESC_DEVICE,
+    0x00, 0x02,                                     /* bcdUSB 2.00 */
+    0x00, 0x00, 0x00,                               /* class per interface */
+    USB_DEVICE_EP0_SIZE,
+    (uint8_t)BTL_USB_VID, (uint8_t)(BTL_USB_VID >> 8),
+    (uint8_t)BTL_USB_PID, (uint8_t)(BTL_USB_PID >> 8),
+    0x00, 0x01,                                     /* bcdDevice 1.00 */
+    1, 2, 0,                                        /* strings */
+    1,                                              /* configurations */
+};
+
+static const uint8_t dfu_configuration_descriptor[] =
+{
+    9, USB_DESC_CONFIGURATION,
+    27, 0,                                          /* wTotalLength */
+    1, 1, 0,
+    0x80,                                           /* bus powered */
+    50,                                             /* 100 mA */
+
+    9, USB_DESC_INTERFACE,
+    0, 0, 0,
+    0xFE, 0x01, 0x02,                               /* DFU mode */
+    2,
+
+    9, USB_DESC_DFU_FUNCTIONAL,
+    DFU_ATTRIBUTES,
+    (uint8_t)DFU_DETACH_TIMEOUT, (uint8_t)(DFU_DETACH_TIMEOUT >> 8),
+    (uint8_t)DFU_TRANSFER_SIZE, (uint8_t)(DFU_TRANSFER_SIZE >> 8),
+    0x10, 0x01,                                     /* bcdDFUVersion 1.1 */
+};
+
+#define DFU_FUNCTIONAL_OFFSET       18U
+
+static const uint8_t dfu_language_descriptor[] = { 4, USB_DESC_STRING, 0x09, 0x04 };
+
+static const char * const dfu_strings[] =
+{
+    "Microchip Technology Inc.",
+    "SAME51 DFU Bootloader",
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+/* Packet handed to the protocol engine, word aligned for the size fields */
+static uint32_t dfu_packet[(BTL_HEADER_SIZE + BTL_DATA_PAYLOAD_SIZE + 3U) / 4U];
+static uint8_t  *const dfu_packet_bytes = (uint8_t *)dfu_packet;
+
+static size_t   dfu_packet_size     = 0;
+static size_t   dfu_packet_ptr      = 0;
+
+static enum dfu_state   dfu_state   = DFU_STATE_IDLE;
+static enum dfu_status  dfu_status  = DFU_STATUS_OK;
+static enum dfu_step    dfu_step    = DFU_STEP_NONE;
+
+/* Download session */
+static uint16_t dfu_block           = 0;
+static uint32_t dfu_blocks          = 0;
+static uint32_t dfu_crc             = 0;
+static bool     dfu_unlocked        = false;
+static bool     dfu_reset_pending   = false;
+
+/* DNLOAD data stage in progress */
+static size_t   dfu_out_size        = 0;
+static size_t   dfu_out_count       = 0;
+
+/* Control transfer housekeeping */
+static uint8_t  dfu_address         = 0;
+static uint8_t  dfu_configuration   = 0;
+static bool     dfu_in_pending      = false;
+
+static uint8_t  dfu_reply[48];
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Protocol Engine Side
+// *****************************************************************************
+// *****************************************************************************
+
+static void dfu_put32(uint8_t *dest, uint32_t value)
+{
+    dest[0] = (uint8_t)value;
+    dest[1] = (uint8_t)(value >> 8);
+    dest[2] = (uint8_t)(value >> 16);
+    dest[3] = (uint8_t)(value >> 24);
+}
+
+/* Stages a packet; the payload may already be in place behind the header */
+static void dfu_packet_submit(uint8_t command, uint32_t payload_size, enum dfu_step step)
+{
+    dfu_put32(&dfu_packet_bytes[0], BTL_GUARD);
+    dfu_put32(&dfu_packet_bytes[BTL_SIZE_OFFSET], payload_size);
+    dfu_packet_bytes[BTL_CMD_OFFSET] = command;
+
+    dfu_packet_size = BTL_HEADER_SIZE + payload_size;
+    dfu_packet_ptr  = 0;
+    dfu_step        = step;
+}
+
+static void dfu_packet_submit2(uint8_t command, uint32_t first, uint32_t second, enum dfu_step step)
+{
+    dfu_put32(&dfu_packet_bytes[BTL_HEADER_SIZE], first);
+    dfu_put32(&dfu_packet_bytes[BTL_HEADER_SIZE + 4U], second);
+
+    dfu_packet_submit(command, 8U, step);
+}
+
+/* The engine has answered and no packet is staged */
+static bool dfu_engine_is_idle(void)
+{
+    return (dfu_packet_size == 0U);
+}
+
+static void dfu_fail(enum dfu_status status)
+{
+    dfu_status  = status;
+    dfu_state   = DFU_STATE_ERROR;
+
+    /* Do not leave the host NAKed on an open data stage */
+    if (dfu_out_size != 0U)
+    {
+        dfu_out_size = 0;
+
+        USB_DEVICE_ControlStall();
+    }
+}
+
+static void dfu_session_reset(void)
+{
+    dfu_block       = 0;
+    dfu_blocks      = 0;
+    dfu_crc         = 0;
+    dfu_unlocked    = false;
+    dfu_out_size    = 0;
+    dfu_out_count   = 0;
+
+    dfu_step            = DFU_STEP_NONE;
+    dfu_reset_pending   = false;
+}
+
+/* Response byte of the engine for the staged packet */
+static void dfu_engine_response(uint8_t response)
+{
+    enum dfu_step step = dfu_step;
+
+    dfu_packet_size = 0;
+    dfu_packet_ptr  = 0;
+    dfu_step        = DFU_STEP_NONE;
+
+    switch (step)
+    {
+        case DFU_STEP_SESSION_UNLOCK:
+            dfu_unlocked = (response == BL_RESP_OK);
+
+            if (dfu_unlocked == false)
+            {
+                dfu_fail(DFU_STATUS_ERR_ADDRESS);
+            }
+            break;
+
+        case DFU_STEP_DATA:
+            if (response != BL_RESP_OK)
+            {
+                dfu_fail(DFU_STATUS_ERR_ADDRESS);
+            }
+            break;
+
+        case DFU_STEP_VERIFY_UNLOCK:
+            if (response == BL_RESP_OK)
+            {
+                dfu_put32(&dfu_packet_bytes[BTL_HEADER_SIZE], dfu_crc ^ 0xFFFFFFFFUL);
+
+                dfu_packet_submit(BL_CMD_VERIFY, 4U, DFU_STEP_VERIFY);
+            }
+            else
+            {
+                dfu_fail(DFU_STATUS_ERR_VERIFY);
+            }
+            break;
+
+        case DFU_STEP_VERIFY:
+            if (response == BL_RESP_CRC_OK)
+            {
+                dfu_step            = DFU_STEP_DONE;
+                dfu_reset_pending   = true;
+            }
+            else
+            {
+                dfu_fail(DFU_STATUS_ERR_VERIFY);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* A full DNLOAD block has been received behind the DATA header */
+static void dfu_block_complete(void)
+{
+    uint8_t *data = &dfu_packet_bytes[BTL_HEADER_SIZE + 4U];
+
+    memset(&data[dfu_out_size], 0xFF, DFU_TRANSFER_SIZE - dfu_out_size);
+
+    /* Same value the DSU produces over the flash, see VERIFY */
+    dfu_crc = crc32(dfu_crc, data, DFU_TRANSFER_SIZE);
+
+    dfu_put32(&dfu_packet_bytes[BTL_HEADER_SIZE], DFU_APP_START + ((uint32_t)dfu_block * DFU_TRANSFER_SIZE));
+
+    dfu_packet_submit(BL_CMD_DATA, BTL_DATA_PAYLOAD_SIZE, DFU_STEP_DATA);
+
+    dfu_block++;
+    dfu_blocks++;
+
+    dfu_out_size = 0;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Control Requests
+// *****************************************************************************
+// *****************************************************************************
+
+static void dfu_control_write(const uint8_t *buffer, size_t size, uint16_t length)
+{
+    dfu_in_pending = true;
+
+    USB_DEVICE_ControlWrite(buffer, (size < length) ? size : length);
+}
+
+static void dfu_control_ack(void)
+{
+    dfu_control_write(NULL, 0, 0);
+}
+
+static size_t dfu_string_descriptor(uint8_t index)
+{
+    const char *string = dfu_strings[index - 1U];
+    size_t      count  = 2;
+
+    while ((*string != '\0') && (count < sizeof(dfu_reply)))
+    {
+        dfu_reply[count++] = (uint8_t)*string++;
+        dfu_reply[count++] = 0;
+    }
+
+    dfu_reply[0] = (uint8_t)count;
+    dfu_reply[1] = USB_DESC_STRING;
+
+    return count;
+}
+
+static bool dfu_get_descriptor(const USB_SETUP_PACKET *setup)
+{
+    uint8_t type  = (uint8_t)(setup->wValue >> 8);
+    uint8_t index = (uint8_t)setup->wValue;
+
+    switch (type)
+    {
+        case USB_DESC_DEVICE:
+            dfu_control_write(dfu_device_descriptor, sizeof(dfu_device_descriptor), setup->wLength);
+            return true;
+
+        case USB_DESC_CONFIGURATION:
+            dfu_control_write(dfu_configuration_descriptor, sizeof(dfu_configuration_descriptor), setup->wLength);
+            return true;
+
+        case USB_DESC_DFU_FUNCTIONAL:
+            dfu_control_write(&dfu_configuration_descriptor[DFU_FUNCTIONAL_OFFSET], 9U, setup->wLength);
+            return true;
+
+        case USB_DESC_STRING:
+            if (index == 0U)
+            {
+                dfu_control_write(dfu_language_descriptor, sizeof(dfu_language_descriptor), setup->wLength);
+                return true;
+            }
+
+            if (index <= (sizeof(dfu_strings) / sizeof(dfu_strings[0])))
+            {
+                dfu_control_write(dfu_reply, dfu_string_descriptor(index), setup->wLength);
+                return true;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+static bool dfu_standard_request(const USB_SETUP_PACKET *setup)
+{
+    switch (setup->bRequest)
+    {
+        case USB_REQ_GET_DESCRIPTOR:
+            return dfu_get_descriptor(setup);
+
+        case USB_REQ_SET_ADDRESS:
+            /* Applied once the status stage has completed */
+            dfu_address = (uint8_t)(setup->wValue & 0x7FU);
+            dfu_control_ack();
+            return true;
+
+        case USB_REQ_SET_CONFIGURATION:
+            dfu_configuration = (uint8_t)setup->wValue;
+            dfu_control_ack();
+            return true;
+
+        case USB_REQ_GET_CONFIGURATION:
+            dfu_control_write(&dfu_configuration, 1U, setup->wLength);
+            return true;
+
+        case USB_REQ_GET_STATUS:
+        case USB_REQ_GET_INTERFACE:
+            dfu_reply[0] = 0;
+            dfu_reply[1] = 0;
+            dfu_control_write(dfu_reply, (setup->bRequest == USB_REQ_GET_STATUS) ? 2U : 1U, setup->wLength);
+            return true;
+
+        case USB_REQ_SET_INTERFACE:
+        case USB_REQ_CLEAR_FEATURE:
+        case USB_REQ_SET_FEATURE:
+            dfu_control_ack();
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+static bool dfu_download_request(const USB_SETUP_PACKET *setup)
+{
+    if ((dfu_state != DFU_STATE_IDLE) && (dfu_state != DFU_STATE_DNLOAD_IDLE))
+    {
+        return false;
+    }
+
+    if (setup->wLength == 0U)
+    {
+        /* End of the download, manifestation starts on GETSTATUS */
+        if (dfu_state == DFU_STATE_IDLE)
+        {
+            dfu_fail(DFU_STATUS_ERR_NOTDONE);
+            return false;
+        }
+
+        dfu_state = DFU_STATE_MANIFEST_SYNC;
+        dfu_control_ack();
+        return true;
+    }
+
+    if (dfu_state == DFU_STATE_IDLE)
+    {
+        dfu_session_reset();
+    }
+
+    if ((setup->wLength > DFU_TRANSFER_SIZE) || (setup->wValue != dfu_block))
+    {
+        dfu_fail(DFU_STATUS_ERR_ADDRESS);
+        return false;
+    }
+
+    dfu_out_size    = setup->wLength;
+    dfu_out_count   = 0;
+    dfu_state       = DFU_STATE_DNLOAD_SYNC;
+
+    return true;
+}
+
+/* GETSTATUS is where the DFU state machine advances */
+static void dfu_get_status(const USB_SETUP_PACKET *setup)
+{
+    uint32_t poll_timeout = 0;
+
+    switch (dfu_state)
+    {
+        case DFU_STATE_DNLOAD_SYNC:
+        case DFU_STATE_DNBUSY:
+            if ((dfu_out_size != 0U) || (dfu_engine_is_idle() == false))
+            {
+                dfu_state       = DFU_STATE_DNBUSY;
+                poll_timeout    = DFU_POLL_TIMEOUT;
+            }
+            else
+            {
+                dfu_state       = DFU_STATE_DNLOAD_IDLE;
+            }
+            break;
+
+        case DFU_STATE_MANIFEST_SYNC:
+        case DFU_STATE_MANIFEST:
+            if (dfu_step == DFU_STEP_DONE)
+            {
+                dfu_state = DFU_STATE_IDLE;
+            }
+            else
+            {
+                if ((dfu_step == DFU_STEP_NONE) && (dfu_engine_is_idle() == true))
+                {
+                    dfu_packet_submit2(BL_CMD_UNLOCK, DFU_APP_START, dfu_blocks * DFU_TRANSFER_SIZE, DFU_STEP_VERIFY_UNLOCK);
+                }
+
+                dfu_state       = DFU_STATE_MANIFEST;
+                poll_timeout    = DFU_POLL_TIMEOUT;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    dfu_reply[0] = (uint8_t)dfu_status;
+    dfu_reply[1] = (uint8_t)poll_timeout;
+    dfu_reply[2] = (uint8_t)(poll_timeout >> 8);
+    dfu_reply[3] = (uint8_t)(poll_timeout >> 16);
+    dfu_reply[4] = (uint8_t)dfu_state;
+    dfu_reply[5] = 0;
+
+    dfu_control_write(dfu_reply, 6U, setup->wLength);
+}
+
+static bool dfu_class_request(const USB_SETUP_PACKET *setup)
+{
+    switch (setup->bRequest)
+    {
+        case DFU_REQ_DNLOAD:
+            return dfu_download_request(setup);
+
+        case DFU_REQ_GETSTATUS:
+            dfu_get_status(setup);
+            return true;
+
+        case DFU_REQ_GETSTATE:
+            dfu_reply[0] = (uint8_t)dfu_state;
+            dfu_control_write(dfu_reply, 1U, setup->wLength);
+            return true;
+
+        case DFU_REQ_CLRSTATUS:
+        case DFU_REQ_ABORT:
+            if ((dfu_out_size != 0U) || (dfu_engine_is_idle() == false))
+            {
+                return false;
+            }
+
+            dfu_session_reset();
+            dfu_status  = DFU_STATUS_OK;
+            dfu_state   = DFU_STATE_IDLE;
+            dfu_control_ack();
+            return true;
+
+        case DFU_REQ_DETACH:
+            dfu_control_ack();
+
+            if ((dfu_reset_pending == true) && (dfu_engine_is_idle() == true))
+            {
+                dfu_packet_submit(BL_CMD_RESET, 0U, DFU_STEP_NONE);
+            }
+            return true;
+
+        case DFU_REQ_UPLOAD:
+        default:
+            break;
+    }
+
+    return false;
+}
+
+static void dfu_setup_handle(const USB_SETUP_PACKET *setup)
+{
+    bool handled = false;
+
+    /* A new SETUP cancels an unfinished data stage */
+    dfu_out_size = 0;
+
+    if ((setup->bmRequestType & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_STANDARD)
+    {
+        handled = dfu_standard_request(setup);
+    }
+    else if ((setup->bmRequestType & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_CLASS)
+    {
+        handled = dfu_class_request(setup);
+
+        if ((handled == false) && (dfu_state != DFU_STATE_ERROR))
+        {
+            dfu_fail(DFU_STATUS_ERR_STALLEDPKT);
+        }
+    }
+
+    if (handled == false)
+    {
+        USB_DEVICE_ControlStall();
+    }
+}
+
+/* DNLOAD data stage: packets are only taken while the engine buffer is free,
+ * otherwise the OUT bank stays full and the host is NAKed. */
+static void dfu_download_task(void)
+{
+    uint8_t *data = &dfu_packet_bytes[BTL_HEADER_SIZE + 4U];
+
+    if ((dfu_out_size == 0U) || (dfu_engine_is_idle() == false))
+    {
+        return;
+    }
+
+    if (dfu_unlocked == false)
+    {
+        dfu_packet_submit2(BL_CMD_UNLOCK, DFU_APP_START, DFU_APP_END - DFU_APP_START, DFU_STEP_SESSION_UNLOCK);
+        return;
+    }
+
+    if (USB_DEVICE_ControlOutIsReady() == false)
+    {
+        return;
+    }
+
+    dfu_out_count += USB_DEVICE_ControlRead(&data[dfu_out_count], dfu_out_size - dfu_out_count);
+
+    if (dfu_out_count >= dfu_out_size)
+    {
+        dfu_out_size = dfu_out_count;
+
+        dfu_block_complete();
+
+        dfu_control_ack();
+    }
+}
+
+static void dfu_usb_task(void)
+{
+    USB_SETUP_PACKET setup;
+
+    if (USB_DEVICE_ResetIsDetected() == true)
+    {
+        dfu_address     = 0;
+        dfu_out_size    = 0;
+        dfu_in_pending  = false;
+
+        if ((dfu_reset_pending == true) && (dfu_engine_is_idle() == true))
+        {
+            dfu_packet_submit(BL_CMD_RESET, 0U, DFU_STEP_NONE);
+        }
+    }
+
+    if (USB_DEVICE_SetupRead(&setup) == true)
+    {
+        dfu_in_pending = false;
+
+        dfu_setup_handle(&setup);
+    }
+
+    dfu_download_task();
+
+    if (USB_DEVICE_ControlInIsComplete() == true)
+    {
+        dfu_in_pending = false;
+
+        if (dfu_address != 0U)
+        {
+            USB_DEVICE_AddressSet(dfu_address);
+            dfu_address = 0;
+        }
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: USB DFU Transport Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static bool dfu_receiver_is_ready(void)
+{
+    dfu_usb_task();
+
+    return (dfu_packet_ptr < dfu_packet_size);
+}
+
+static size_t dfu_read(uint8_t *buffer, size_t size)
+{
+    size_t count = dfu_packet_size - dfu_packet_ptr;
+
+    if (count > size)
+    {
+        count = size;
+    }
+
+    memcpy(buffer, &dfu_packet_bytes[dfu_packet_ptr], count);
+
+    dfu_packet_ptr += count;
+
+    return count;
+}
+
+static void dfu_write(const uint8_t *buffer, size_t size)
+{
+    if (size > 0U)
+    {
+        dfu_engine_response(buffer[0]);
+    }
+}
+
+/* Lets the status stage of the last request finish, e.g. before a reset */
+static void dfu_flush(void)
+{
+    while (dfu_in_pending == true)
+    {
+        dfu_usb_task();
+    }
+}
+
+/* USB full speed has a fixed bit rate */
+static bool dfu_link_setup(uint32_t bitRate)
+{
+    (void)bitRate;
+
+    return true;
+}
+
+const BOOTLOADER_TRANSPORT bootloader_UsbDfuTransport =
+{
+    .receiverIsReady    = dfu_receiver_is_ready,
+    .read               = dfu_read,
+    .write              = dfu_write,
+    .flush              = dfu_flush,
+    .linkSetup          = dfu_link_setup,
+};
+
+#endif
@@ -0,0 +1,1120 @@
+/*******************************************************************************
+  USB MSC Bootloader Transport Source File
+
+  File Name:
+    bootloader_usb_msc.c
+
+  Summary:
+    This file contains the USB mass storage (UF2) backend of the bootloader
+    transport.
+
+  Description:
+    The device enumerates as a bulk-only mass storage device holding an
+    emulated FAT16 volume (bootloader_ghostfat.c). Copying a UF2 file onto
+    the volume programs the application:
+
+      - every written sector goes to the UF2 reassembly (bootloader_uf2.c),
+        which collects the 256 byte payloads into erase blocks in any order,
+      - each completed erase block becomes a DATA packet for the protocol
+        engine, the first one is preceded by an UNLOCK of the application
+        region,
+      - once every block of the file has been committed a RESET packet
+        starts the new application.
+
+    The protocol engine reads the packets through the BOOTLOADER_TRANSPORT
+    interface, so flash programming is the same as for the UART links. The
+    image itself is checked at the next boot by the binary header CRC.
+
+    Sector data moves in multi-packet bulk transfers straight into one of two
+    sector buffers, so the next sector of a WRITE(10) is already received
+    while the current one is being reassembled.
+ *******************************************************************************/
+
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "definitions.h"
+#include "bootloader_transport.h"
+#include "bootloader_protocol.h"
+#include "bootloader_ghostfat.h"
+#include "bootloader_uf2.h"
+
+#if (BTL_USB_MSC == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define MSC_APP_START               ((uint32_t)BTL_BOOTLOADER_SIZE)
+#define MSC_APP_END                 (0x80000UL)
+
+#define MSC_NO_ADDRESS              (0xFFFFFFFFUL)
+
+/* Bulk endpoint pair, OUT 0x01 and IN 0x81 */
+#define MSC_ENDPOINT                1U
+#define MSC_ENDPOINT_IN             (0x80U | MSC_ENDPOINT)
+
+#define MSC_SECTOR_SIZE             BTL_GHOSTFAT_SECTOR_SIZE
+
+/* Chip serial number words, used for the USB serial number string */
+#define MSC_SERIAL_WORD0            (0x008061FCUL)
+#define MSC_SERIAL_WORD3            (0x00806018UL)
+
+/* Descriptor types */
+#define USB_DESC_DEVICE             0x01U
+#define USB_DESC_CONFIGURATION      0x02U
+#define USB_DESC_STRING             0x03U
+#define USB_DESC_INTERFACE          0x04U
+#define USB_DESC_ENDPOINT           0x05U
+
+/* bmRequestType fields */
+#define USB_REQ_TYPE_MASK           0x60U
+#define USB_REQ_TYPE_STANDARD       0x00U
+#define USB_REQ_TYPE_CLASS          0x20U
+
+#define USB_REQ_RECIPIENT_MASK      0x1FU
+#define USB_REQ_RECIPIENT_ENDPOINT  0x02U
+
+/* Standard requests */
+#define USB_REQ_GET_STATUS          0x00U
+#define USB_REQ_CLEAR_FEATURE       0x01U
+#define USB_REQ_SET_FEATURE         0x03U
+#define USB_REQ_SET_ADDRESS         0x05U
+#define USB_REQ_GET_DESCRIPTOR      0x06U
+#define USB_REQ_GET_CONFIGURATION   0x08U
+#define USB_REQ_SET_CONFIGURATION   0x09U
+#define USB_REQ_GET_INTERFACE       0x0AU
+#define USB_REQ_SET_INTERFACE       0x0BU
+
+/* Bulk-only transport class requests */
+#define MSC_REQ_GET_MAX_LUN         0xFEU
+#define MSC_REQ_RESET               0xFFU
+
+/* Command and status wrappers */
+#define MSC_CBW_SIGNATURE           0x43425355UL
+#define MSC_CSW_SIGNATURE           0x53425355UL
+#define MSC_CBW_SIZE                31U
+#define MSC_CSW_SIZE                13U
+#define MSC_CBW_DIR_IN              0x80U
+
+#define MSC_CSW_PASSED              0x00U
+#define MSC_CSW_FAILED              0x01U
+
+/* SCSI commands */
+#define SCSI_TEST_UNIT_READY        0x00U
+#define SCSI_REQUEST_SENSE          0x03U
+#define SCSI_INQUIRY                0x12U
+#define SCSI_MODE_SENSE_6           0x1AU
+#define SCSI_START_STOP_UNIT        0x1BU
+#define SCSI_PREVENT_ALLOW_REMOVAL  0x1EU
+#define SCSI_READ_FORMAT_CAPACITIES 0x23U
+#define SCSI_READ_CAPACITY_10       0x25U
+#define SCSI_READ_10                0x28U
+#define SCSI_WRITE_10               0x2AU
+#define SCSI_VERIFY_10              0x2FU
+#define SCSI_SYNCHRONIZE_CACHE_10   0x35U
+#define SCSI_MODE_SENSE_10          0x5AU
+
+/* Sense keys and additional sense codes */
+#define SCSI_SENSE_NONE             0x00U
+#define SCSI_SENSE_MEDIUM_ERROR     0x03U
+#define SCSI_SENSE_ILLEGAL_REQUEST  0x05U
+
+#define SCSI_ASC_NONE               0x00U
+#define SCSI_ASC_WRITE_ERROR        0x0CU
+#define SCSI_ASC_INVALID_COMMAND    0x20U
+#define SCSI_ASC_LBA_OUT_OF_RANGE   0x21U
+
+enum msc_state
+{
+    MSC_STATE_IDLE,
+    MSC_STATE_CBW,
+    MSC_STATE_DATA_IN,
+    MSC_STATE_DATA_OUT,
+    MSC_STATE_STALL_IN,
+    MSC_STATE_CSW,
+};
+
+/* Packets handed to the protocol engine */
+enum msc_step
+{
+    MSC_STEP_NONE,
+    MSC_STEP_UNLOCK,
+    MSC_STEP_DATA,
+    MSC_STEP_RESET,
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Descriptors
+// *****************************************************************************
+// *****************************************************************************
+
+static const uint8_t msc_device_descriptor[] =
+{
+    18, USB_DESC_DEVICE,
+    0x00, 0x02,                                     /* bcdUSB 2.00 */
+    0x00, 0x00, 0x00,                               /* class per interface */
+    USB_DEVICE_EP0_SIZE,
+    (uint8_t)BTL_USB_VID, (uint8_t)(BTL_USB_VID >> 8),
+    (uint8_t)BTL_USB_PID, (uint8_t)(BTL_USB_PID >> 8),
+    0x00, 0x01,                                     /* bcdDevice 1.00 */
+    1, 2, 3,                                        /* strings */
+    1,                                              /* configurations */
+};
+
+static const uint8_t msc_configuration_descriptor[] =
+{
+    9, USB_DESC_CONFIGURATION,
+    32, 0,                                          /* wTotalLength */
+    1, 1, 0,
+    0x80,                                           /* bus powered */
+    50,                                             /* 100 mA */
+
+    9, USB_DESC_INTERFACE,
+    0, 0, 2,
+    0x08, 0x06, 0x50,                               /* mass storage, SCSI, bulk-only */
+    0,
+
+    7, USB_DESC_ENDPOINT,
+    MSC_ENDPOINT_IN, 0x02,                          /* bulk IN */
+    USB_DEVICE_BULK_SIZE, 0,
+    0,
+
+    7, USB_DESC_ENDPOINT,
+    MSC_ENDPOINT, 0x02,                             /* bulk OUT */
+    USB_DEVICE_BULK_SIZE, 0,
+    0,
+};
+
+static const uint8_t msc_language_descriptor[] = { 4, USB_DESC_STRING, 0x09, 0x04 };
+
+static const char * const msc_strings[] =
+{
+    "Microchip Technology Inc.",
+    "SAME51 UF2 Bootloader",
+};
+
+static const uint8_t msc_inquiry_data[36] =
+{
+    0x00,                                           /* direct access block device */
+    0x80,                                           /* removable */
+    0x02, 0x02,
+    31,                                             /* additional length */
+    0x00, 0x00, 0x00,
+    'M', 'i', 'c', 'r', 'o', 'c', 'h', 'p',
+    'S', 'A', 'M', 'E', '5', '1', ' ', 'U', 'F', '2', ' ', 'B', 'o', 'o', 't', ' ',
+    '1', '.', '0', '0',
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+/* Packet handed to the protocol engine, word aligned for the size fields */
+static uint32_t msc_packet[(BTL_HEADER_SIZE + BTL_DATA_PAYLOAD_SIZE + 3U) / 4U];
+static uint8_t  *const msc_packet_bytes = (uint8_t *)msc_packet;
+
+static size_t   msc_packet_size     = 0;
+static size_t   msc_packet_ptr      = 0;
+
+static enum msc_step msc_step       = MSC_STEP_NONE;
+
+static bool     msc_unlocked        = false;
+static bool     msc_reset_sent      = false;
+static bool     msc_write_error     = false;
+
+/* Last block answered by the engine, possibly still being programmed */
+static uint32_t msc_data_address    = MSC_NO_ADDRESS;
+static uint32_t msc_flash_address   = MSC_NO_ADDRESS;
+
+/* Bulk buffers, the hardware moves data straight in and out of these */
+static uint32_t msc_sectors[2][MSC_SECTOR_SIZE / 4U];
+static uint32_t msc_cbw[USB_DEVICE_BULK_SIZE / 4U];
+static uint32_t msc_csw[(MSC_CSW_SIZE + 3U) / 4U];
+
+static enum msc_state msc_state     = MSC_STATE_IDLE;
+
+/* Command in progress */
+static uint32_t msc_tag             = 0;
+static uint32_t msc_residue         = 0;
+static uint8_t  msc_status          = MSC_CSW_PASSED;
+static uint32_t msc_lba             = 0;
+static uint32_t msc_blocks          = 0;
+static uint32_t msc_in_size         = 0;
+
+/* WRITE(10): sectors received into msc_sectors[], oldest first */
+static uint32_t msc_rx_head         = 0;
+static uint32_t msc_rx_count        = 0;
+static bool     msc_rx_armed        = false;
+
+static uint8_t  msc_sense_key       = SCSI_SENSE_NONE;
+static uint8_t  msc_sense_asc       = SCSI_ASC_NONE;
+
+/* Control transfer housekeeping */
+static uint8_t  msc_address         = 0;
+static uint8_t  msc_configuration   = 0;
+static bool     msc_in_pending      = false;
+
+static uint8_t  msc_reply[64];
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Protocol Engine Side
+// *****************************************************************************
+// *****************************************************************************
+
+static void msc_put32(uint8_t *dest, uint32_t value)
+{
+    dest[0] = (uint8_t)value;
+    dest[1] = (uint8_t)(value >> 8);
+    dest[2] = (uint8_t)(value >> 16);
+    dest[3] = (uint8_t)(value >> 24);
+}
+
+static void msc_put32_be(uint8_t *dest, uint32_t value)
+{
+    dest[0] = (uint8_t)(value >> 24);
+    dest[1] = (uint8_t)(value >> 16);
+    dest[2] = (uint8_t)(value >> 8);
+    dest[3] = (uint8_t)value;
+}
+
+static uint32_t msc_get32(const uint8_t *src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) |
+           ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static uint32_t msc_get32_be(const uint8_t *src)
+{
+    return ((uint32_t)src[0] << 24) | ((uint32_t)src[1] << 16) |
+           ((uint32_t)src[2] << 8) | (uint32_t)src[3];
+}
+
+/* Stages a packet; the payload may already be in place behind the header */
+static void msc_packet_submit(uint8_t command, uint32_t payload_size, enum msc_step step)
+{
+    msc_put32(&msc_packet_bytes[0], BTL_GUARD);
+    msc_put32(&msc_packet_bytes[BTL_SIZE_OFFSET], payload_size);
+    msc_packet_bytes[BTL_CMD_OFFSET] = command;
+
+    msc_packet_size = BTL_HEADER_SIZE + payload_size;
+    msc_packet_ptr  = 0;
+    msc_step        = step;
+}
+
+/* Also serves as a fence: the engine only answers it once the previous
+ * DATA block has been programmed */
+static void msc_unlock_submit(void)
+{
+    msc_put32(&msc_packet_bytes[BTL_HEADER_SIZE], MSC_APP_START);
+    msc_put32(&msc_packet_bytes[BTL_HEADER_SIZE + 4U], MSC_APP_END - MSC_APP_START);
+
+    msc_packet_submit(BL_CMD_UNLOCK, 8U, MSC_STEP_UNLOCK);
+}
+
+/* The engine has answered and no packet is staged */
+static bool msc_engine_is_idle(void)
+{
+    return (msc_packet_size == 0U);
+}
+
+/* Response byte of the engine for the staged packet */
+static void msc_engine_response(uint8_t response)
+{
+    enum msc_step step = msc_step;
+
+    msc_packet_size = 0;
+    msc_packet_ptr  = 0;
+    msc_step        = MSC_STEP_NONE;
+
+    /* The engine only takes a packet once the previous block is in flash */
+    msc_flash_address = MSC_NO_ADDRESS;
+
+    switch (step)
+    {
+        case MSC_STEP_UNLOCK:
+            msc_unlocked = (response == BL_RESP_OK);
+
+            if (msc_unlocked == false)
+            {
+                msc_write_error = true;
+            }
+            break;
+
+        case MSC_STEP_DATA:
+            if (response == BL_RESP_OK)
+            {
+                msc_flash_address = msc_data_address;
+            }
+            else
+            {
+                msc_write_error = true;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Hands the next completed erase block to the engine */
+static void msc_commit_task(void)
+{
+    uint8_t *payload = &msc_packet_bytes[BTL_HEADER_SIZE + 4U];
+    const uint8_t *data;
+    uint32_t address, keep, slot;
+
+    if (msc_engine_is_idle() == false)
+    {
+        return;
+    }
+
+    data = bootloader_Uf2CommitGet(&address, &keep);
+
+    if (data == NULL)
+    {
+        /* Let the host finish the last command before starting the image */
+        if ((bootloader_Uf2IsComplete() == true) && (msc_state == MSC_STATE_CBW) && (msc_reset_sent == false))
+        {
+            msc_reset_sent = true;
+
+            msc_packet_submit(BL_CMD_RESET, 0U, MSC_STEP_RESET);
+        }
+        return;
+    }
+
+    /* Payloads kept from an earlier commit are read back from the flash,
+     * which must not be in the middle of programming that block */
+    if ((msc_unlocked == false) || ((keep != 0U) && (address == msc_flash_address)))
+    {
+        msc_unlock_submit();
+        return;
+    }
+
+    memcpy(payload, data, BTL_BLOCK_SIZE);
+
+    for (slot = 0; keep != 0U; slot++, keep >>= 1)
+    {
+        if ((keep & 1U) != 0U)
+        {
+            memcpy(&payload[slot * BTL_UF2_PAYLOAD_SIZE], (const void *)(uintptr_t)(address + (slot * BTL_UF2_PAYLOAD_SIZE)), BTL_UF2_PAYLOAD_SIZE);
+        }
+    }
+
+    bootloader_Uf2CommitDone();
+
+    msc_put32(&msc_packet_bytes[BTL_HEADER_SIZE], address);
+
+    msc_data_address = address;
+
+    msc_packet_submit(BL_CMD_DATA, BTL_DATA_PAYLOAD_SIZE, MSC_STEP_DATA);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Bulk-Only Transport
+// *****************************************************************************
+// *****************************************************************************
+
+static void msc_cbw_receive(void)
+{
+    msc_state = MSC_STATE_CBW;
+
+    USB_DEVICE_BulkReadStart(MSC_ENDPOINT, (uint8_t *)msc_cbw, sizeof(msc_cbw));
+}
+
+static void msc_csw_send(void)
+{
+    uint8_t *csw = (uint8_t *)msc_csw;
+
+    msc_put32(&csw[0], MSC_CSW_SIGNATURE);
+    msc_put32(&csw[4], msc_tag);
+    msc_put32(&csw[8], msc_residue);
+    csw[12] = msc_status;
+
+    msc_state = MSC_STATE_CSW;
+
+    USB_DEVICE_BulkWriteStart(MSC_ENDPOINT, csw, MSC_CSW_SIZE);
+}
+
+static void msc_sense_set(uint8_t key, uint8_t asc)
+{
+    msc_sense_key = key;
+    msc_sense_asc = asc;
+}
+
+/* Fails the command; a data stage the host expects is cut short by a stall */
+static void msc_command_fail(uint8_t key, uint8_t asc, bool in)
+{
+    msc_sense_set(key, asc);
+
+    msc_status = MSC_CSW_FAILED;
+
+    if (msc_residue == 0U)
+    {
+        msc_csw_send();
+    }
+    else if (in == true)
+    {
+        USB_DEVICE_BulkStall(MSC_ENDPOINT, true);
+
+        msc_state = MSC_STATE_STALL_IN;
+    }
+    else
+    {
+        USB_DEVICE_BulkStall(MSC_ENDPOINT, false);
+
+        msc_csw_send();
+    }
+}
+
+/* Sends a short reply, trimmed to what the host asked for */
+static void msc_reply_send(const uint8_t *reply, uint32_t size)
+{
+    uint8_t *buffer = (uint8_t *)msc_sectors[0];
+
+    if (size > msc_residue)
+    {
+        size = msc_residue;
+    }
+
+    /* No data stage expected */
+    if (size == 0U)
+    {
+        msc_csw_send();
+        return;
+    }
+
+    memcpy(buffer, reply, size);
+
+    msc_residue -= size;
+    msc_blocks   = 0;
+    msc_in_size  = size;
+    msc_state    = MSC_STATE_DATA_IN;
+
+    USB_DEVICE_BulkWriteStart(MSC_ENDPOINT, buffer, size);
+}
+
+static void msc_read_sector(void)
+{
+    uint8_t *buffer = (uint8_t *)msc_sectors[0];
+
+    bootloader_GhostFatRead(msc_lba, buffer);
+
+    msc_lba++;
+    msc_blocks--;
+    msc_residue -= MSC_SECTOR_SIZE;
+    msc_in_size  = MSC_SECTOR_SIZE;
+
+    USB_DEVICE_BulkWriteStart(MSC_ENDPOINT, buffer, MSC_SECTOR_SIZE);
+}
+
+static void msc_write_arm(void)
+{
+    uint32_t next = (msc_rx_head + msc_rx_count) % 2U;
+
+    msc_rx_armed = true;
+
+    USB_DEVICE_BulkReadStart(MSC_ENDPOINT, (uint8_t *)msc_sectors[next], MSC_SECTOR_SIZE);
+}
+
+/* READ(10) and WRITE(10) share the range check */
+static bool msc_transfer_setup(const uint8_t *cb, bool in)
+{
+    msc_lba     = msc_get32_be(&cb[2]);
+    msc_blocks  = ((uint32_t)cb[7] << 8) | cb[8];
+
+    if ((msc_lba >= BTL_GHOSTFAT_SECTORS) || (msc_blocks > (BTL_GHOSTFAT_SECTORS - msc_lba)) ||
+        ((msc_blocks * MSC_SECTOR_SIZE) > msc_residue))
+    {
+        msc_command_fail(SCSI_SENSE_ILLEGAL_REQUEST, SCSI_ASC_LBA_OUT_OF_RANGE, in);
+        return false;
+    }
+
+    if (msc_blocks == 0U)
+    {
+        msc_csw_send();
+        return false;
+    }
+
+    return true;
+}
+
+static void msc_scsi_command(const uint8_t *cb, bool in)
+{
+    uint8_t *reply = msc_reply;
+
+    memset(reply, 0, 20);
+
+    switch (cb[0])
+    {
+        case SCSI_TEST_UNIT_READY:
+        case SCSI_PREVENT_ALLOW_REMOVAL:
+        case SCSI_START_STOP_UNIT:
+        case SCSI_VERIFY_10:
+        case SCSI_SYNCHRONIZE_CACHE_10:
+            msc_csw_send();
+            break;
+
+        case SCSI_INQUIRY:
+            msc_reply_send(msc_inquiry_data, sizeof(msc_inquiry_data));
+            break;
+
+        case SCSI_REQUEST_SENSE:
+            reply[0]    = 0x70;                     /* current error, fixed format */
+            reply[2]    = msc_sense_key;
+            reply[7]    = 10;
+            reply[12]   = msc_sense_asc;
+
+            msc_sense_set(SCSI_SENSE_NONE, SCSI_ASC_NONE);
+            msc_reply_send(reply, 18U);
+            break;
+
+        case SCSI_MODE_SENSE_6:
+            reply[0] = 3;
+            msc_reply_send(reply, 4U);
+            break;
+
+        case SCSI_MODE_SENSE_10:
+            reply[1] = 6;
+            msc_reply_send(reply, 8U);
+            break;
+
+        case SCSI_READ_FORMAT_CAPACITIES:
+            reply[3] = 8;
+            msc_put32_be(&reply[4], BTL_GHOSTFAT_SECTORS);
+            msc_put32_be(&reply[8], MSC_SECTOR_SIZE);
+            reply[8] = 0x02;                        /* formatted media, above the 24 bit block length */
+            msc_reply_send(reply, 12U);
+            break;
+
+        case SCSI_READ_CAPACITY_10:
+            msc_put32_be(&reply[0], BTL_GHOSTFAT_SECTORS - 1U);
+            msc_put32_be(&reply[4], MSC_SECTOR_SIZE);
+            msc_reply_send(reply, 8U);
+            break;
+
+        case SCSI_READ_10:
+            if (msc_transfer_setup(cb, true) == true)
+            {
+                msc_state = MSC_STATE_DATA_IN;
+
+                msc_read_sector();
+            }
+            break;
+
+        case SCSI_WRITE_10:
+            if (msc_transfer_setup(cb, false) == true)
+            {
+                msc_state       = MSC_STATE_DATA_OUT;
+                msc_rx_head     = 0;
+                msc_rx_count    = 0;
+
+                msc_write_arm();
+            }
+            break;
+
+        default:
+            msc_command_fail(SCSI_SENSE_ILLEGAL_REQUEST, SCSI_ASC_INVALID_COMMAND, in);
+            break;
+    }
+}
+
+static void msc_cbw_task(void)
+{
+    const uint8_t *cbw = (const uint8_t *)msc_cbw;
+    size_t count;
+
+    if (USB_DEVICE_BulkReadIsComplete(MSC_ENDPOINT, &count) == false)
+    {
+        return;
+    }
+
+    /* Not a valid CBW, wait for the host to reset the interface */
+    if ((count != MSC_CBW_SIZE) || (msc_get32(&cbw[0]) != MSC_CBW_SIGNATURE))
+    {
+        USB_DEVICE_BulkStall(MSC_ENDPOINT, true);
+        USB_DEVICE_BulkStall(MSC_ENDPOINT, false);
+
+        msc_state = MSC_STATE_IDLE;
+        return;
+    }
+
+    msc_tag     = msc_get32(&cbw[4]);
+    msc_residue = msc_get32(&cbw[8]);
+    msc_status  = MSC_CSW_PASSED;
+
+    msc_scsi_command(&cbw[15], ((cbw[12] & MSC_CBW_DIR_IN) != 0U));
+}
+
+static void msc_data_in_task(void)
+{
+    if (USB_DEVICE_BulkWriteIsComplete(MSC_ENDPOINT) == false)
+    {
+        return;
+    }
+
+    if (msc_blocks != 0U)
+    {
+        msc_read_sector();
+    }
+    else if ((msc_residue != 0U) && ((msc_in_size % USB_DEVICE_BULK_SIZE) == 0U))
+    {
+        /* The host expects more and no short packet ended the data */
+        USB_DEVICE_BulkStall(MSC_ENDPOINT, true);
+
+        msc_state = MSC_STATE_STALL_IN;
+    }
+    else
+    {
+        msc_csw_send();
+    }
+}
+
+/* WRITE(10): the next sector is received while the oldest is reassembled.
+ * A sector the reassembly can not take yet stays queued and the host is
+ * NAKed once both buffers are full. */
+static void msc_data_out_task(void)
+{
+    size_t count;
+
+    if ((msc_rx_armed == true) && (USB_DEVICE_BulkReadIsComplete(MSC_ENDPOINT, &count) == true))
+    {
+        msc_rx_armed = false;
+        msc_rx_count++;
+        msc_blocks--;
+        msc_residue -= MSC_SECTOR_SIZE;
+
+        if ((msc_blocks != 0U) && (msc_rx_count < 2U))
+        {
+            msc_write_arm();
+        }
+    }
+
+    if (msc_rx_count != 0U)
+    {
+        if (bootloader_Uf2SectorWrite((const uint8_t *)msc_sectors[msc_rx_head]) == BTL_UF2_BUSY)
+        {
+            return;
+        }
+
+        msc_rx_head = (msc_rx_head + 1U) % 2U;
+        msc_rx_count--;
+
+        if ((msc_blocks != 0U) && (msc_rx_armed == false))
+        {
+            msc_write_arm();
+        }
+    }
+
+    if ((msc_blocks == 0U) && (msc_rx_count == 0U) && (msc_rx_armed == false))
+    {
+        if (msc_write_error == true)
+        {
+            msc_write_error = false;
+
+            msc_sense_set(SCSI_SENSE_MEDIUM_ERROR, SCSI_ASC_WRITE_ERROR);
+            msc_status = MSC_CSW_FAILED;
+        }
+
+        msc_csw_send();
+    }
+}
+
+static void msc_bulk_task(void)
+{
+    switch (msc_state)
+    {
+        case MSC_STATE_CBW:
+            msc_cbw_task();
+            break;
+
+        case MSC_STATE_DATA_IN:
+            msc_data_in_task();
+            break;
+
+        case MSC_STATE_DATA_OUT:
+            msc_data_out_task();
+            break;
+
+        case MSC_STATE_STALL_IN:
+            /* The status follows once the host has cleared the halt */
+            if (USB_DEVICE_BulkIsStalled(MSC_ENDPOINT, true) == false)
+            {
+                msc_csw_send();
+            }
+            break;
+
+        case MSC_STATE_CSW:
+            if (USB_DEVICE_BulkWriteIsComplete(MSC_ENDPOINT) == true)
+            {
+                msc_cbw_receive();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Control Requests
+// *****************************************************************************
+// *****************************************************************************
+
+static void msc_control_write(const uint8_t *buffer, size_t size, uint16_t length)
+{
+    msc_in_pending = true;
+
+    USB_DEVICE_ControlWrite(buffer, (size < length) ? size : length);
+}
+
+static void msc_control_ack(void)
+{
+    msc_control_write(NULL, 0, 0);
+}
+
+static void msc_bulk_start(void)
+{
+    USB_DEVICE_BulkConfigure(MSC_ENDPOINT);
+
+    msc_rx_armed = false;
+
+    msc_cbw_receive();
+}
+
+static size_t msc_string_descriptor(uint8_t index)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    size_t count = 2;
+    uint32_t serial[2];
+    uint32_t i;
+
+    if (index == 3U)
+    {
+        /* 12 hex digits, as bulk-only devices are required to report */
+        serial[0] = *(const uint32_t *)MSC_SERIAL_WORD3;
+        serial[1] = *(const uint32_t *)MSC_SERIAL_WORD0;
+
+        for (i = 0; i < 12U; i++)
+        {
+            msc_reply[count++] = (uint8_t)hex[(serial[i / 8U] >> (28U - ((i % 8U) * 4U))) & 0xFU];
+            msc_reply[count++] = 0;
+        }
+    }
+    else
+    {
+        const char *string = msc_strings[index - 1U];
+
+        while ((*string != '\0') && (count < sizeof(msc_reply)))
+        {
+            msc_reply[count++] = (uint8_t)*string++;
+            msc_reply[count++] = 0;
+        }
+    }
+
+    msc_reply[0] = (uint8_t)count;
+    msc_reply[1] = USB_DESC_STRING;
+
+    return count;
+}
+
+static bool msc_get_descriptor(const USB_SETUP_PACKET *setup)
+{
+    uint8_t type  = (uint8_t)(setup->wValue >> 8);
+    uint8_t index = (uint8_t)setup->wValue;
+
+    switch (type)
+    {
+        case USB_DESC_DEVICE:
+            msc_control_write(msc_device_descriptor, sizeof(msc_device_descriptor), setup->wLength);
+            return true;
+
+        case USB_DESC_CONFIGURATION:
+            msc_control_write(msc_configuration_descriptor, sizeof(msc_configuration_descriptor), setup->wLength);
+            return true;
+
+        case USB_DESC_STRING:
+            if (index == 0U)
+            {
+                msc_control_write(msc_language_descriptor, sizeof(msc_language_descriptor), setup->wLength);
+                return true;
+            }
+
+            if (index <= 3U)
+            {
+                msc_control_write(msc_reply, msc_string_descriptor(index), setup->wLength);
+                return true;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+static bool msc_standard_request(const USB_SETUP_PACKET *setup)
+{
+    bool endpoint = ((setup->bmRequestType & USB_REQ_RECIPIENT_MASK) == USB_REQ_RECIPIENT_ENDPOINT);
+    bool in       = ((setup->wIndex & 0x80U) != 0U);
+
+    switch (setup->bRequest)
+    {
+        case USB_REQ_GET_DESCRIPTOR:
+            return msc_get_descriptor(setup);
+
+        case USB_REQ_SET_ADDRESS:
+            /* Applied once the status stage has completed */
+            msc_address = (uint8_t)(setup->wValue & 0x7FU);
+            msc_control_ack();
+            return true;
+
+        case USB_REQ_SET_CONFIGURATION:
+            msc_configuration = (uint8_t)setup->wValue;
+
+            if (msc_configuration != 0U)
+            {
+                msc_bulk_start();
+            }
+            else
+            {
+                msc_state = MSC_STATE_IDLE;
+            }
+
+            msc_control_ack();
+            return true;
+
+        case USB_REQ_GET_CONFIGURATION:
+            msc_control_write(&msc_configuration, 1U, setup->wLength);
+            return true;
+
+        case USB_REQ_GET_STATUS:
+            msc_reply[0] = ((endpoint == true) && (USB_DEVICE_BulkIsStalled(MSC_ENDPOINT, in) == true)) ? 1U : 0U;
+            msc_reply[1] = 0;
+            msc_control_write(msc_reply, 2U, setup->wLength);
+            return true;
+
+        case USB_REQ_GET_INTERFACE:
+            msc_reply[0] = 0;
+            msc_control_write(msc_reply, 1U, setup->wLength);
+            return true;
+
+        case USB_REQ_CLEAR_FEATURE:
+            /* ENDPOINT_HALT, the only feature of a bulk endpoint */
+            if ((endpoint == true) && ((setup->wIndex & 0x0FU) == MSC_ENDPOINT))
+            {
+                /* An invalid CBW keeps the endpoints halted until a reset */
+                if (msc_state != MSC_STATE_IDLE)
+                {
+                    USB_DEVICE_BulkStallClear(MSC_ENDPOINT, in);
+                }
+            }
+            msc_control_ack();
+            return true;
+
+        case USB_REQ_SET_FEATURE:
+            if ((endpoint == true) && ((setup->wIndex & 0x0FU) == MSC_ENDPOINT))
+            {
+                USB_DEVICE_BulkStall(MSC_ENDPOINT, in);
+            }
+            msc_control_ack();
+            return true;
+
+        case USB_REQ_SET_INTERFACE:
+            msc_control_ack();
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+static bool msc_class_request(const USB_SETUP_PACKET *setup)
+{
+    switch (setup->bRequest)
+    {
+        case MSC_REQ_GET_MAX_LUN:
+            msc_reply[0] = 0;
+            msc_control_write(msc_reply, 1U, setup->wLength);
+            return true;
+
+        case MSC_REQ_RESET:
+            /* The host clears both halts next, then sends a new CBW */
+            if (msc_configuration != 0U)
+            {
+                msc_bulk_start();
+            }
+            msc_control_ack();
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+static void msc_setup_handle(const USB_SETUP_PACKET *setup)
+{
+    bool handled = false;
+
+    if ((setup->bmRequestType & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_STANDARD)
+    {
+        handled = msc_standard_request(setup);
+    }
+    else if ((setup->bmRequestType & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_CLASS)
+    {
+        handled = msc_class_request(setup);
+    }
+
+    if (handled == false)
+    {
+        USB_DEVICE_ControlStall();
+    }
+}
+
+static void msc_usb_task(void)
+{
+    USB_SETUP_PACKET setup;
+
+    if (USB_DEVICE_ResetIsDetected() == true)
+    {
+        msc_address         = 0;
+        msc_configuration   = 0;
+        msc_in_pending      = false;
+        msc_state           = MSC_STATE_IDLE;
+    }
+
+    if (USB_DEVICE_SetupRead(&setup) == true)
+    {
+        msc_in_pending = false;
+
+        msc_setup_handle(&setup);
+    }
+
+    if (USB_DEVICE_ControlInIsComplete() == true)
+    {
+        msc_in_pending = false;
+
+        if (msc_address != 0U)
+        {
+            USB_DEVICE_AddressSet(msc_address);
+            msc_address = 0;
+        }
+    }
+
+    msc_bulk_task();
+
+    msc_commit_task();
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: USB MSC Transport Functions
+// *****************************************************************************
+// *****************************************************************************
+
+void bootloader_UsbMscInitialize(void)
+{
+    bootloader_Uf2Initialize(MSC_APP_START, MSC_APP_END);
+}
+
+static bool msc_receiver_is_ready(void)
+{
+    msc_usb_task();
+
+    return (msc_packet_ptr < msc_packet_size);
+}
+
+static size_t msc_read(uint8_t *buffer, size_t size)
+{
+    size_t count = msc_packet_size - msc_packet_ptr;
+
+    if (count > size)
+    {
+        count = size;
+    }
+
+    memcpy(buffer, &msc_packet_bytes[msc_packet_ptr], count);
+
+    msc_packet_ptr += count;
+
+    return count;
+}
+
+static void msc_write(const uint8_t *buffer, size_t size)
+{
+    if (size > 0U)
+    {
+        msc_engine_response(buffer[0]);
+    }
+}
+
+/* Lets a pending control status stage finish, e.g. before a reset */
+static void msc_flush(void)
+{
+    while (msc_in_pending == true)
+    {
+        msc_usb_task();
+    }
+}
+
+/* USB full speed has a fixed bit rate */
+static bool msc_link_setup(uint32_t bitRate)
+{
+    (void)bitRate;
+
+    return true;
+}
+
+const BOOTLOADER_TRANSPORT bootloader_UsbMscTransport =
+{
+    .receiverIsReady    = msc_receiver_is_ready,
+    .read               = msc_read,
+    .write              = msc_write,
+    .flush              = msc_flush,
+    .linkSetup          = msc_link_setup,
+};
+
+#endif
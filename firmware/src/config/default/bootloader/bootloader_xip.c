@@ -0,0 +1,128 @@
+/*******************************************************************************
+  Bootloader Execute In Place Source File
+
+  File Name:
+    bootloader_xip.c
+
+  Summary:
+    This file starts applications executing partly from QSPI flash.
+
+  Description:
+    Called once the internal part of the application passed its CRC check.
+    The header of the external part, see bootloader_xip.h, is read through
+    a memory map which already uses the read the application will execute
+    with, so the check costs a few microseconds and startup is not slowed
+    down. By default only the header is checked: that it is intact and was
+    written for the internal image found. BTL_QSPI_XIP_CHECK_CRC adds the
+    CRC of the whole external part, read at the boot clock.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Include Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <string.h>
+#include "definitions.h"
+#include "bootloader_xip.h"
+#include "peripheral/qspi/plib_qspi.h"
+#include "peripheral/cmcc/plib_cmcc.h"
+
+#if (BTL_QSPI_XIP == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Type Definitions
+// *****************************************************************************
+// *****************************************************************************
+
+#define XIP_HEADER_CRC_SIZE         ((uint32_t)offsetof(struct xip_header, header_crc))
+
+#define XIP_MAX_SIZE                (QSPI_SIZE - BTL_QSPI_XIP_OFFSET - BTL_XIP_DATA_OFFSET)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Bootloader Local Functions
+// *****************************************************************************
+// *****************************************************************************
+
+static bool xip_header_check(const struct xip_header *hdr, uint32_t app_crc32)
+{
+    if ((hdr->magic != BTL_XIP_MAGIC) ||
+        ((uint32_t)crc32(0, hdr, XIP_HEADER_CRC_SIZE) != hdr->header_crc))
+    {
+        return false;
+    }
+
+    /* An external part left over from another build would be called at
+     * addresses which mean nothing to this one */
+    return ((hdr->app_crc32 == app_crc32) && (hdr->size <= XIP_MAX_SIZE));
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Bootloader Global Functions
+// *****************************************************************************
+// *****************************************************************************
+
+bool bootloader_XipInitialize(uint32_t app_crc32)
+{
+    const uint8_t *window;
+    struct xip_header hdr;
+
+    QSPI_Initialize();
+
+    window = QSPI_XipMemoryMap(BTL_QSPI_XIP_MODE_BITS, BTL_QSPI_XIP_DUMMY_CYCLES);
+
+    memcpy(&hdr, &window[BTL_QSPI_XIP_OFFSET], sizeof(hdr));
+
+    if (xip_header_check(&hdr, app_crc32) == false)
+    {
+        QSPI_Deinitialize();
+
+        return false;
+    }
+
+#if (BTL_QSPI_XIP_CHECK_CRC == 1)
+    if ((uint32_t)crc32(0, &window[BTL_QSPI_XIP_OFFSET + BTL_XIP_DATA_OFFSET], hdr.size) != hdr.crc32)
+    {
+        QSPI_Deinitialize();
+
+        return false;
+    }
+#endif
+
+    /* Code and constants fetched from the window go through the cache */
+    CMCC_EnableDCache();
+    CMCC_EnableICache();
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,112 @@
+/*******************************************************************************
+  Bootloader Execute In Place Header File
+
+  File Name:
+    bootloader_xip.h
+
+  Summary:
+    This file describes the part of an application executing from QSPI flash.
+
+  Description:
+    An application larger than the internal flash is linked in two parts.
+    The internal part is an ordinary application image at APP_START_ADDRESS,
+    binary header included, and the bootloader checks and starts it as
+    usual. The external part follows its header at BTL_XIP_DATA_OFFSET of
+    BTL_QSPI_XIP_OFFSET in the QSPI flash and executes from the QSPI window
+    at QSPI_ADDR. Before starting the application the bootloader checks that
+    header belongs to the internal image, maps the flash with quad I/O reads
+    in continuous read mode and enables the CMCC.
+
+    Anything running before the application set up its own clocks, and
+    anything else which must not wait for a cache line fill from the flash,
+    stays internal:
+
+      - the vector table, Reset_Handler and the C runtime startup,
+      - clock, NVMCTRL wait state and QSPI baud rate setup,
+      - interrupt handlers with latency bounds,
+      - code erasing or programming the QSPI flash; it has to take the
+        flash out of continuous read mode first, see QSPI_Initialize(), and
+        must not touch the window until it maps it again.
+
+    The linker script of the application gets a second code region for the
+    window, the section collecting external code goes there:
+
+      MEMORY
+      {
+        rom  (LRX) : ORIGIN = 0x00002000, LENGTH = 0x0007E000
+        xip  (LRX) : ORIGIN = 0x04100100, LENGTH = 0x00EFFF00
+        ram  (WX!R): ORIGIN = 0x20000000, LENGTH = 0x00040000
+      }
+
+      .xip_text :
+      {
+        *(.xip_text .xip_text.*)
+        *libxyz.a:*(.text .text.* .rodata .rodata.*)
+      } > xip
+
+    with ORIGIN = QSPI_ADDR + BTL_QSPI_XIP_OFFSET + BTL_XIP_DATA_OFFSET.
+    Functions and constants are moved with
+    __attribute__((section(".xip_text"))) or whole archives as above. After
+    the build the output sections are split with objcopy: everything but
+    .xip_text gives the internal binary, .xip_text alone the external one.
+    tools/bin2xip.py puts the header in front of the latter.
+
+    All fields are little endian and the header has a page of its own.
+ *******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef BOOTLOADER_XIP_H
+#define BOOTLOADER_XIP_H
+
+#include <stdint.h>
+
+/* "BXIP" */
+#define BTL_XIP_MAGIC               0x50495842UL
+
+/* The external part is linked to start after the header page */
+#define BTL_XIP_DATA_OFFSET         256U
+
+// *****************************************************************************
+/* Execute In Place Header
+
+  Description:
+    - magic       : BTL_XIP_MAGIC
+    - size        : bytes of the external part following the header
+    - crc32       : crc32() of the external part
+    - app_crc32   : crc32 field of the binary header of the internal part
+                    linked together with it
+    - header_crc  : crc32() of the four words above
+*/
+struct xip_header {
+        uint32_t magic;
+        uint32_t size;
+        uint32_t crc32;
+        uint32_t app_crc32;
+        uint32_t header_crc;
+};
+
+#endif
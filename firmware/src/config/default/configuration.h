@@ -0,0 +1,402 @@
+/*******************************************************************************
+  System Configuration Header
+
+  File Name:
+    configuration.h
+
+  Summary:
+    Build-time configuration header for the system defined by this project.
+
+  Description:
+    An MPLAB Project may have multiple configurations.  This file defines the
+    build-time options for a single configuration.
+
+  Remarks:
+    This configuration header must not define any prototypes or data
+    definitions (or include any files that do).  It only provides macro
+    definitions for build-time configuration options
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef CONFIGURATION_H
+#define CONFIGURATION_H
+
+// DOM-IGNORE-BEGIN
+#ifdef __cplusplus  // Provide C++ Compatibility
+
+extern "C" {
+
+#endif
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Bootloader Configuration
+// *****************************************************************************
+// *****************************************************************************
+
+/* Set to 1 to take updates from an SPI master on SERCOM1 instead of the
+ * UART. SERCOM1 uses PA16 (MOSI, PAD0), PA17 (SCK, PAD1), PA18 (SS, PAD2)
+ * and PA19 (MISO, PAD3); the ready line is a plain GPIO. The host test
+ * of the SPI backend defines it on the command line. */
+#ifndef BTL_SPI_SLAVE
+#define BTL_SPI_SLAVE                   0
+#endif
+
+#define BTL_SPI_READY_PIN               PORT_PIN_PA20
+
+/* Set to 1 to enumerate as a USB DFU 1.1 device on PA24 (D-) and PA25 (D+)
+ * instead of using the UART. The USB code does not fit next to the
+ * protocol engine in 8 KB, see BTL_BOOTLOADER_SIZE. The host test of the
+ * DFU backend defines it on the command line. */
+#ifndef BTL_USB_DFU
+#define BTL_USB_DFU                     0
+#endif
+
+/* Set to 1 to enumerate as a USB mass storage device instead; copying a
+ * UF2 file onto the volume programs the application. Same pins and same
+ * size caveat as BTL_USB_DFU. */
+#ifndef BTL_USB_MSC
+#define BTL_USB_MSC                     0
+#endif
+
+/* UF2 reassembly and the emulated FAT volume of BTL_USB_MSC. Neither uses
+ * the USB stack, their host tests build them on their own. */
+#ifndef BTL_UF2
+#define BTL_UF2                         BTL_USB_MSC
+#endif
+
+/* pid.codes test IDs, replace with the product's own */
+#define BTL_USB_VID                     0x1209
+#define BTL_USB_PID                     0x0001
+
+/* Flash taken by the bootloader, a multiple of the 8 KB erase block. The
+ * application starts right behind it. btl.ld includes this file and sizes
+ * its rom region from it, so the value is a plain number. Applications
+ * for a 16 KB bootloader are linked with ROM_ORIGIN=0x4000 and
+ * ROM_LENGTH=0xFC000, see app_blocks.ld. */
+#ifndef BTL_BOOTLOADER_SIZE
+#if (BTL_USB_DFU == 1) || (BTL_USB_MSC == 1)
+#define BTL_BOOTLOADER_SIZE             16384
+#else
+#define BTL_BOOTLOADER_SIZE             8192
+#endif
+#endif
+
+/* Set to 1 to take updates over CAN FD on PA22 (TX) and PA23 (RX) instead
+ * of the UART. The node listens on 0x600 + BTL_CAN_NODE_ID and on the
+ * multicast identifier shared by all nodes, and answers on
+ * 0x680 + BTL_CAN_NODE_ID. Node IDs range from 0 to 0x7F. Host builds
+ * define both on the command line. */
+#ifndef BTL_CAN_FD
+#define BTL_CAN_FD                      0
+#endif
+
+#ifndef BTL_CAN_NODE_ID
+#define BTL_CAN_NODE_ID                 1
+#endif
+
+#define BTL_CAN_MULTICAST_ID            0x5FF
+
+/* Set to 1 to run SERCOM0 as an addressed node on a half-duplex RS-485
+ * pair shared with other nodes, see bootloader_rs485.c. Characters are
+ * 9 bit wide, the ninth bit marks an address. Unicast addresses range from
+ * 0x00 to 0x7E. The driver enable line is a plain GPIO; tie the receiver
+ * enable of the transceiver to it or leave the receiver always on. */
+#ifndef BTL_RS485
+#define BTL_RS485                       0
+#endif
+
+/* The node address is the byte at BTL_RS485_ADDRESS_LOCATION, the first
+ * byte of the user page after the fuses, so every board runs the same
+ * image and is given its address when it is provisioned. An erased or out
+ * of range byte selects BTL_RS485_ADDRESS. */
+#define BTL_RS485_ADDRESS_LOCATION      (USER_PAGE_ADDR + 32U)
+
+#ifndef BTL_RS485_ADDRESS
+#define BTL_RS485_ADDRESS               0x01
+#endif
+
+#define BTL_RS485_BROADCAST             0xFF
+#define BTL_RS485_POLL                  0x80
+#define BTL_RS485_DE_PIN                PORT_PIN_PA06
+#define BTL_RS485_BAUD_RATE             115200
+
+/* Set to 1 to update from an SD card on SDHC0 instead of the UART, see
+ * bootloader_sdcard.c. SDHC0 uses PA08 (CMD), PA09..PA11 and PB10
+ * (DAT0..DAT3) and PB11 (CK). When the bootloader runs and the card's
+ * FAT32 volume holds BTL_SDCARD_FILE, a path which may use long names and
+ * directories such as "updates/firmware.bin", the file is programmed at
+ * BTL_SDCARD_ADDRESS. By default that is the application area of the
+ * inactive bank, which is then swapped in; the other bank has to carry a
+ * copy of the bootloader as well. Host builds define BTL_SDCARD and
+ * BTL_SDCARD_FILE on the command line. */
+#ifndef BTL_SDCARD
+#define BTL_SDCARD                      0
+#endif
+
+#ifndef BTL_SDCARD_FILE
+#define BTL_SDCARD_FILE                 "FIRMWARE.BIN"
+#endif
+#define BTL_SDCARD_ADDRESS              (0x82000UL)
+
+/* Set to 0 to program BTL_SDCARD_ADDRESS in the running bank and reset */
+#define BTL_SDCARD_SWAP                 1
+
+/* Set to 1 to install updates the application staged in QSPI NOR flash,
+ * see bootloader_qspi.c and bootloader_stage.h. The QSPI uses the SDHC0
+ * pins, PA08..PA11 (DATA0..DATA3), PB10 (SCK) and PB11 (CS), so it can not
+ * be combined with BTL_SDCARD. The staging header is checked at every
+ * boot; the bootloader only stays up if an update is pending, installs it
+ * and resets. It is no transport of its own, the host link stays the one
+ * of BTL_TRANSPORT. Host builds define BTL_QSPI_STAGING on the command
+ * line. */
+#ifndef BTL_QSPI_STAGING
+#define BTL_QSPI_STAGING                0
+#endif
+
+/* Offset of the staging area in the external flash, sector aligned */
+#define BTL_QSPI_STAGE_OFFSET           (0x0UL)
+
+/* Set to 1 for applications executing partly from QSPI flash, see
+ * bootloader_xip.h. Uses the pins of BTL_QSPI_STAGING and can be combined
+ * with it as long as the staging area and the external part do not
+ * overlap. A missing or mismatched external part is treated like a CRC
+ * error of the internal image. */
+#ifndef BTL_QSPI_XIP
+#define BTL_QSPI_XIP                    0
+#endif
+
+/* Offset of the header of the external part, page aligned. Applications
+ * link their external code to QSPI_ADDR + BTL_QSPI_XIP_OFFSET + 256. */
+#define BTL_QSPI_XIP_OFFSET             (0x100000UL)
+
+/* Quad I/O fast read (EBh) timing: the mode bits keeping the flash in
+ * continuous read mode and the dummy clocks following them. 0xA0 and 4
+ * suit W25Q and SST26VF parts. */
+#define BTL_QSPI_XIP_MODE_BITS          0xA0U
+#define BTL_QSPI_XIP_DUMMY_CYCLES       4U
+
+/* Set to 1 to check the CRC of the whole external part at every boot, at
+ * the boot clock that adds a few tenths of a second per MB */
+#define BTL_QSPI_XIP_CHECK_CRC          0
+
+/* Set to 1 to accept ENC_DATA blocks, encrypted with AES-128-GCM under
+ * BTL_ENCRYPTION_KEY and decrypted by the AES peripheral. Each block has
+ * its own nonce and tag and is only programmed if the tag matches; a block
+ * which fails makes the following VERIFY fail. Plain DATA blocks are still
+ * accepted. Host builds take bootloader_aesmodel.c for the peripheral and
+ * define BTL_ENCRYPTION on the command line. */
+#ifndef BTL_ENCRYPTION
+#define BTL_ENCRYPTION                  0
+#endif
+
+/* Key bytes 0..15 as little endian words, the key given to btl_host.py -k
+ * 000102030405060708090a0b0c0d0e0f being
+ *
+ *   -DBTL_ENCRYPTION_KEY="{ 0x03020100UL, 0x07060504UL, 0x0b0a0908UL, 0x0f0e0d0cUL }"
+ *
+ * There is no default, every product has to bring its own key. The
+ * bootloader region has to be read protected, or the key can be read out
+ * with the flash. */
+#if (BTL_ENCRYPTION == 1) && !defined(BTL_ENCRYPTION_KEY)
+#error "BTL_ENCRYPTION needs the AES-128 key in BTL_ENCRYPTION_KEY"
+#endif
+
+/* Set to 1 to start only images signed with ECDSA P-256 by the owner of
+ * BTL_SIGNATURE_PUBLIC_KEY, see tools/imgsign.py. The SHA-256 digest is
+ * computed by the ICM and the signature checked by the PUKCC, which needs
+ * Microchip's PUKCL headers, see src/third_party/pukcl/README.md. An image
+ * which passed is remembered, so later boots only check its CRC. An
+ * unsigned image is treated like a CRC error. NVMCTRL_BOOTPROT has to
+ * protect the bootloader, or the check can simply be overwritten. */
+#ifndef BTL_SIGNATURE
+#define BTL_SIGNATURE                   0
+#endif
+
+/* Public key X then Y, big endian. Paste the #define printed by
+ * imgsign.py genkey here, or pass it on the command line. There is no
+ * default, every product has to bring its own key. */
+#if (BTL_SIGNATURE == 1) && !defined(BTL_SIGNATURE_PUBLIC_KEY)
+#error "BTL_SIGNATURE needs the ECDSA P-256 public key in BTL_SIGNATURE_PUBLIC_KEY"
+#endif
+
+/* Erase block at this offset of each bank remembering the image verified
+ * there. Images have to end below it; UNLOCK refuses ranges covering it. */
+#define BTL_SIGNATURE_CACHE_OFFSET      (0x7E000UL)
+
+/* Set to 1 to accept update containers, see bootloader_container.h and
+ * tools/mkcontainer.py. A container is sent as STREAM packets and unlocks
+ * the region its manifest names by itself; segments are decoded on the fly
+ * and programmed as soon as an erase block is complete. Host builds of the
+ * decoder define it on the command line. */
+#ifndef BTL_CONTAINER
+#define BTL_CONTAINER                   0
+#endif
+
+/* Set to 1 to keep a partition table in each bank, see
+ * bootloader_partition.h and tools/mkpartitions.py. A PARTITION command
+ * scopes a session to one partition, code partitions besides the
+ * application are checked at boot. Images have to end below the table
+ * block; plain sessions may still rewrite it to change the layout. */
+#ifndef BTL_PARTITIONS
+#define BTL_PARTITIONS                  0
+#endif
+
+/* Erase block at this offset of each bank holding the table */
+#define BTL_PARTITION_TABLE_OFFSET      (0x7C000UL)
+
+/* Set to 1 to accept FEC_DATA packets, see bootloader_fec.h. Blocks come
+ * as Reed-Solomon codewords and are corrected in RAM before programming; a
+ * block with too many errors is answered FEC_FAIL and sent again. Host
+ * builds of the decoder define it on the command line. */
+#ifndef BTL_FEC
+#define BTL_FEC                         0
+#endif
+
+/* Most parity bytes per codeword the host may use, even and at most 64.
+ * Sizes the packet buffers: 32 adds about 1.2 KB to each. */
+#define BTL_FEC_PARITY_MAX              32U
+
+/* Set to 1 to have sessions start with BEGIN and the manifest of the image:
+ * size, binary header crc32, version and hardware ID. The device answers
+ * INSTALLED when the intact application already is that image, INCOMPATIBLE
+ * when the image is for other hardware and OK otherwise. UNLOCK, PARTITION
+ * and containers are refused before an OK, so no flash is erased for an
+ * image that is not taken. */
+#ifndef BTL_MANIFEST
+#define BTL_MANIFEST                    0
+#endif
+
+/* Hardware ID of the board the manifest has to name. 0 takes it from the
+ * image information of the installed application, see bootloader.h; an
+ * application without one accepts any. */
+#define BTL_HARDWARE_ID                 0UL
+
+/* Set to 1 to let the host replace the bootloader. The new one is staged
+ * like any image in an erase block of the application area, then
+ * SELF_UPDATE has it checked with the DSU and written to block 0 of the
+ * inactive bank, after the application area of the running bank, with
+ * BOOTPROT lifted for the copy. Both are checked with the DSU and the host
+ * sends BKSWAP_RESET to start the new bootloader. The running bank is never
+ * written, so a power loss at any point leaves the old bootloader to boot;
+ * the inactive bank loses what it held before. BOD33 is switched from
+ * reset to detection during the copy: a brown-out holds it until the
+ * supply is back, then it starts over. At every boot block 0 of the
+ * inactive bank is made a copy of the running bootloader, which undoes an
+ * update cut off before its swap. With BTL_SIGNATURE the staged bootloader
+ * is not checked, so anyone who can stage one can drop the signature
+ * check. */
+#ifndef BTL_SELF_UPDATE
+#define BTL_SELF_UPDATE                 0
+#endif
+
+/* Copies of the staged bootloader tried before SELF_UPDATE fails */
+#define BTL_SELF_UPDATE_TRIES           3U
+
+/* Set to 1 to sleep while waiting for the host: when no link is in the
+ * middle of a packet the core enters IDLE sleep until the next byte. Only
+ * links with a wakeSetup, the SERCOM UART and RS-485 backends, allow it.
+ * The core is woken by the pending receive interrupt with interrupts
+ * disabled, so the bootloader still needs no vector table. */
+#ifndef BTL_LOW_POWER
+#define BTL_LOW_POWER                   0
+#endif
+
+/* CPU clock divider while asleep, 1 to leave the clock alone. The SERCOMs
+ * run from GCLK1 and keep their bit rate. */
+#define BTL_LOW_POWER_CPUDIV            8U
+
+/* Set to a port pin driven high while the core sleeps, to measure the
+ * time asleep and the wake-up latency against the start bit with a scope.
+ * Neither the idle current nor the wake-up latency has been measured on a
+ * board yet, there are no figures for them. */
+/* #define BTL_LOW_POWER_PIN            PORT_PIN_PA07 */
+
+/* Set to 1 to count the CPU cycles from reset to main() with the DWT cycle
+ * counter. The count is left in startup_cycles for the debugger; pass it to
+ * tools/btl_size.py --measured to track it next to the section sizes. */
+#ifndef BTL_STARTUP_CYCLES
+#define BTL_STARTUP_CYCLES              0
+#endif
+
+/* Percentage of the application the CPU checksums at boot while the DSU
+ * computes the CRC of the rest; the two are joined with crc32_combine().
+ * 0 leaves it all to the DSU, 100 all to the CPU. Best where both finish
+ * together, which depends on the flash wait states. */
+#ifndef BTL_CRC_CPU_PERCENT
+#define BTL_CRC_CPU_PERCENT             50U
+#endif
+
+/* Receive timeouts in microseconds, 0 for none, counted by TC0. A packet
+ * is dropped when its next byte does not come within the inter-byte
+ * timeout or the whole packet not within the per-packet timeout. A session
+ * without a packet for the session timeout locks the flash again and goes
+ * back to these defaults. The host can set others for its session with
+ * the TIMEOUTS command; values below BTL_TIMEOUT_MIN_US are refused. */
+#define BTL_BYTE_TIMEOUT_US             100000UL
+#define BTL_PACKET_TIMEOUT_US           0UL
+#define BTL_SESSION_TIMEOUT_US          0UL
+#define BTL_TIMEOUT_MIN_US              100UL
+
+/* Primary transport carrying the bootloader protocol, see
+ * bootloader_transport.h. Host builds override it on the command line. */
+#ifndef BTL_TRANSPORT
+#if (BTL_SPI_SLAVE == 1)
+#define BTL_TRANSPORT                   bootloader_SpiTransport
+#elif (BTL_USB_DFU == 1)
+#define BTL_TRANSPORT                   bootloader_UsbDfuTransport
+#elif (BTL_USB_MSC == 1)
+#define BTL_TRANSPORT                   bootloader_UsbMscTransport
+#elif (BTL_CAN_FD == 1)
+#define BTL_TRANSPORT                   bootloader_CanTransport
+#elif (BTL_RS485 == 1)
+#define BTL_TRANSPORT                   bootloader_Rs485Transport
+#elif (BTL_SDCARD == 1)
+#define BTL_TRANSPORT                   bootloader_SdCardTransport
+#else
+#define BTL_TRANSPORT                   bootloader_UartTransport
+#endif
+#endif
+
+/* Set to 1 to accept one update session striped across SERCOM0 and SERCOM2.
+ * SERCOM2 uses PA12 (TX, PAD0) and PA13 (RX, PAD1). */
+#ifndef BTL_DUAL_UART
+#define BTL_DUAL_UART                   0
+#endif
+
+//DOM-IGNORE-BEGIN
+#ifdef __cplusplus
+}
+#endif
+//DOM-IGNORE-END
+
+#endif // CONFIGURATION_H
+/*******************************************************************************
+ End of File
+*/
@@ -48,10 +48,22 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include "configuration.h"
 #include "peripheral/nvmctrl/plib_nvmctrl.h"
 #include "peripheral/evsys/plib_evsys.h"
 #include "peripheral/sercom/usart/plib_sercom0_usart.h"
+#include "peripheral/sercom/usart/plib_sercom2_usart.h"
+#include "peripheral/sercom/spi_slave/plib_sercom1_spi_slave.h"
+#include "peripheral/dmac/plib_dmac.h"
+#include "peripheral/usb/plib_usb.h"
+#include "peripheral/can/plib_can0.h"
+#include "peripheral/sdhc/plib_sdhc0.h"
+#include "peripheral/qspi/plib_qspi.h"
+#include "peripheral/aes/plib_aes.h"
+#include "peripheral/icm/plib_icm.h"
+#include "peripheral/pukcc/plib_pukcc.h"
 #include "bootloader/bootloader.h"
+#include "bootloader/bootloader_transport.h"
 #include "peripheral/port/plib_port.h"
 #include "peripheral/clock/plib_clock.h"
 #include "peripheral/nvic/plib_nvic.h"
@@ -59,6 +71,8 @@
 #include "peripheral/pac/plib_pac.h"
 #include "peripheral/cmcc/plib_cmcc.h"
 #include "peripheral/dsu/plib_dsu.h"
+#include "peripheral/pm/plib_pm.h"
+#include "peripheral/tc/plib_tc0.h"
 
 // DOM-IGNORE-BEGIN
 #ifdef __cplusplus  // Provide C++ Compatibility
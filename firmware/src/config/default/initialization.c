@@ -120,12 +120,35 @@
 
 void SYS_Initialize ( void* data )
 {
+    bool staged = false;
+
     NVMCTRL_Initialize();
 
+#if (BTL_SELF_UPDATE == 1)
+    /* A bank swap has to start this bootloader as well */
+    bootloader_SelfUpdateSync();
+#endif
+
 
     PORT_Initialize();
 
-    if (bootloader_Trigger() == false)
+#if (BTL_QSPI_STAGING == 1) || (BTL_QSPI_XIP == 1)
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA08, PERIPHERAL_FUNCTION_H);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA09, PERIPHERAL_FUNCTION_H);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA10, PERIPHERAL_FUNCTION_H);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA11, PERIPHERAL_FUNCTION_H);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PB10, PERIPHERAL_FUNCTION_H);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PB11, PERIPHERAL_FUNCTION_H);
+#endif
+
+#if (BTL_QSPI_STAGING == 1)
+    QSPI_Initialize();
+
+    /* A pending update keeps the bootloader up, it is installed below */
+    staged = bootloader_QspiInitialize();
+#endif
+
+    if ((staged == false) && (bootloader_Trigger() == false))
     {
         run_Application();
     }
@@ -134,12 +157,79 @@ void SYS_Initialize ( void* data )
 
     EVSYS_Initialize();
 
+#if (BTL_ENCRYPTION == 1)
+    AES_Initialize();
+#endif
+
     SERCOM0_USART_Initialize();
 
+#if (BTL_RS485 == 1)
+    bootloader_Rs485Initialize();
+#endif
+
+#if (BTL_DUAL_UART == 1)
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA12, PERIPHERAL_FUNCTION_C);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA13, PERIPHERAL_FUNCTION_C);
+
+    SERCOM2_USART_Initialize();
+#endif
+
+#if (BTL_SPI_SLAVE == 1)
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA16, PERIPHERAL_FUNCTION_C);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA17, PERIPHERAL_FUNCTION_C);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA18, PERIPHERAL_FUNCTION_C);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA19, PERIPHERAL_FUNCTION_C);
+
+    DMAC_Initialize();
+
+    SERCOM1_SPI_Initialize();
+
+    bootloader_SpiInitialize();
+#endif
+
+#if (BTL_USB_DFU == 1) || (BTL_USB_MSC == 1)
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA24, PERIPHERAL_FUNCTION_H);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA25, PERIPHERAL_FUNCTION_H);
+
+    USB_DEVICE_Initialize();
+#endif
+
+#if (BTL_USB_MSC == 1)
+    bootloader_UsbMscInitialize();
+#endif
+
+#if (BTL_CAN_FD == 1)
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA22, PERIPHERAL_FUNCTION_I);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA23, PERIPHERAL_FUNCTION_I);
+
+    bootloader_CanInitialize();
+#endif
+
+#if (BTL_SDCARD == 1)
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA08, PERIPHERAL_FUNCTION_I);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA09, PERIPHERAL_FUNCTION_I);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA10, PERIPHERAL_FUNCTION_I);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PA11, PERIPHERAL_FUNCTION_I);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PB10, PERIPHERAL_FUNCTION_I);
+    PORT_PinPeripheralFunctionConfig(PORT_PIN_PB11, PERIPHERAL_FUNCTION_I);
+
+    bootloader_SdCardInitialize();
+#endif
+
 	SYSTICK_TimerInitialize();
+	TC0_TimerInitialize();
     PAC_Initialize();
 
     NVIC_Initialize();
+
+#if (BTL_QSPI_STAGING == 1)
+    /* At full clock speed, before the host link is served. Ends in a
+     * reset. */
+    if (staged == true)
+    {
+        bootloader_QspiInstall();
+    }
+#endif
     
  
     
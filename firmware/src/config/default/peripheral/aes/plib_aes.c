@@ -0,0 +1,268 @@
+/*******************************************************************************
+  Advanced Encryption Standard (AES) Peripheral Library Source File
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_aes.c
+
+  Summary
+    AES peripheral library implementation.
+
+  Description
+    AES-128-GCM decryption on the AES peripheral, following the GCM
+    procedure of the data sheet:
+
+      - the hash subkey H is the encrypted zero block, loaded into HASHKEY,
+      - the additional data goes through GF multiplications only,
+      - every data block is decrypted from the counter in INTVECTV, which
+        starts at J0 + 1; the peripheral hashes the ciphertext on its own,
+      - the length block is hashed last and the tag is GHASH encrypted with
+        the counter J0.
+
+    In counter mode the output is the encrypted counter XOR the input, so H
+    and the tag are produced with the counter set to 0 and J0 respectively.
+    Everything is polled, no interrupt line is enabled.
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#include "device.h"
+#include "configuration.h"
+#include "plib_aes.h"
+
+#if (BTL_ENCRYPTION == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Data Types
+// *****************************************************************************
+// *****************************************************************************
+
+#define AES_WORDS(x)                ((x) / sizeof(uint32_t))
+
+/* Counter word of J0 for a 96 bit nonce, big endian 1 */
+#define AES_GCM_J0_COUNTER          0x01000000UL
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Data
+// *****************************************************************************
+// *****************************************************************************
+
+static uint32_t aes_j0[AES_WORDS(AES_BLOCK_SIZE)];
+static uint32_t aes_aad_bits;
+static uint32_t aes_data_bits;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: AES Implementation
+// *****************************************************************************
+// *****************************************************************************
+
+static void AES_CounterSet(const uint32_t *counter)
+{
+    uint32_t i;
+
+    for (i = 0; i < AES_WORDS(AES_BLOCK_SIZE); i++)
+    {
+        AES_REGS->AES_INTVECTV[i] = counter[i];
+    }
+}
+
+static void AES_BlockWrite(const uint32_t *in)
+{
+    uint32_t i;
+
+    AES_REGS->AES_DATABUFPTR = 0U;
+
+    for (i = 0; i < AES_WORDS(AES_BLOCK_SIZE); i++)
+    {
+        AES_REGS->AES_INDATA = in[i];
+    }
+}
+
+/* Runs one block through the cipher, ctrlb selects NEWMSG to restart from
+ * the counter in INTVECTV */
+static void AES_BlockProcess(const uint32_t *in, uint32_t *out, uint8_t ctrlb)
+{
+    uint32_t i;
+
+    AES_BlockWrite(in);
+
+    AES_REGS->AES_CTRLB = ctrlb | AES_CTRLB_START_Msk;
+
+    while ((AES_REGS->AES_INTFLAG & AES_INTFLAG_ENCCMP_Msk) == 0U)
+    {
+        /* Wait for the block */
+    }
+
+    AES_REGS->AES_DATABUFPTR = 0U;
+
+    for (i = 0; i < AES_WORDS(AES_BLOCK_SIZE); i++)
+    {
+        out[i] = AES_REGS->AES_INDATA;
+    }
+
+    AES_REGS->AES_INTFLAG = AES_INTFLAG_ENCCMP_Msk;
+}
+
+/* GHASH = (GHASH ^ in) * H */
+static void AES_GhashUpdate(const uint32_t *in)
+{
+    AES_BlockWrite(in);
+
+    AES_REGS->AES_CTRLB = AES_CTRLB_GFMUL_Msk;
+
+    while ((AES_REGS->AES_INTFLAG & AES_INTFLAG_GFMCMP_Msk) == 0U)
+    {
+        /* Wait for the multiplication */
+    }
+
+    AES_REGS->AES_INTFLAG = AES_INTFLAG_GFMCMP_Msk;
+}
+
+void AES_Initialize( void )
+{
+    AES_REGS->AES_CTRLA = AES_CTRLA_SWRST_Msk;
+
+    while ((AES_REGS->AES_CTRLA & AES_CTRLA_SWRST_Msk) != 0U)
+    {
+        /* Wait for the reset to complete */
+    }
+}
+
+void AES_GcmStart( const uint32_t *key, const uint32_t *nonce, const uint32_t *aad, size_t aad_size )
+{
+    uint32_t block[AES_WORDS(AES_BLOCK_SIZE)] = { 0 };
+    uint32_t i;
+
+    AES_REGS->AES_CTRLA = 0U;
+    AES_REGS->AES_CTRLA = AES_CTRLA_AESMODE_GCM | AES_CTRLA_KEYSIZE_128BIT |
+                          AES_CTRLA_CIPHER_DEC | AES_CTRLA_STARTMODE_MANUAL;
+    AES_REGS->AES_CTRLA |= AES_CTRLA_ENABLE_Msk;
+
+    for (i = 0; i < AES_WORDS(AES_KEY_SIZE); i++)
+    {
+        AES_REGS->AES_KEYWORD[i] = key[i];
+    }
+
+    /* H = E(K, 0) */
+    AES_CounterSet(block);
+    AES_BlockProcess(block, block, AES_CTRLB_NEWMSG_Msk);
+
+    for (i = 0; i < AES_WORDS(AES_BLOCK_SIZE); i++)
+    {
+        AES_REGS->AES_HASHKEY[i] = block[i];
+        AES_REGS->AES_GHASH[i]   = 0U;
+        block[i]                 = 0U;
+    }
+
+    /* The additional data is zero padded to a block */
+    if (aad_size > AES_BLOCK_SIZE)
+    {
+        aad_size = AES_BLOCK_SIZE;
+    }
+
+    for (i = 0; i < aad_size; i++)
+    {
+        ((uint8_t *)block)[i] = ((const uint8_t *)aad)[i];
+    }
+
+    if (aad_size != 0U)
+    {
+        AES_GhashUpdate(block);
+    }
+
+    aes_aad_bits  = aad_size * 8U;
+    aes_data_bits = 0U;
+
+    for (i = 0; i < AES_WORDS(AES_GCM_NONCE_SIZE); i++)
+    {
+        aes_j0[i] = nonce[i];
+        block[i]  = nonce[i];
+    }
+
+    aes_j0[i] = AES_GCM_J0_COUNTER;
+    block[i]  = __REV(2U);
+
+    /* The first data block restarts from J0 + 1 */
+    AES_CounterSet(block);
+}
+
+void AES_GcmDecrypt( uint32_t *data, size_t size )
+{
+    size_t i;
+    uint8_t ctrlb = (aes_data_bits == 0U) ? AES_CTRLB_NEWMSG_Msk : 0U;
+
+    for (i = 0; i < AES_WORDS(size); i += AES_WORDS(AES_BLOCK_SIZE))
+    {
+        AES_BlockProcess(&data[i], &data[i], ctrlb);
+
+        ctrlb = 0U;
+    }
+
+    aes_data_bits += size * 8U;
+}
+
+bool AES_GcmTagCheck( const uint32_t *tag )
+{
+    uint32_t block[AES_WORDS(AES_BLOCK_SIZE)];
+    uint32_t diff = 0U;
+    uint32_t i;
+
+    /* len(A) || len(C), 64 bit big endian bit counts */
+    block[0] = 0U;
+    block[1] = __REV(aes_aad_bits);
+    block[2] = 0U;
+    block[3] = __REV(aes_data_bits);
+
+    AES_GhashUpdate(block);
+
+    for (i = 0; i < AES_WORDS(AES_BLOCK_SIZE); i++)
+    {
+        block[i] = AES_REGS->AES_GHASH[i];
+    }
+
+    /* T = E(K, J0) ^ S */
+    AES_CounterSet(aes_j0);
+    AES_BlockProcess(block, block, AES_CTRLB_NEWMSG_Msk);
+
+    /* Compares every word so the time taken does not tell the position of
+     * the first mismatch */
+    for (i = 0; i < AES_WORDS(AES_GCM_TAG_SIZE); i++)
+    {
+        diff |= block[i] ^ tag[i];
+    }
+
+    AES_REGS->AES_CTRLA = 0U;
+
+    return (diff == 0U);
+}
+
+#endif
@@ -0,0 +1,108 @@
+/*******************************************************************************
+  Advanced Encryption Standard (AES) Peripheral Library Interface Header File
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_aes.h
+
+  Summary
+    AES peripheral library interface, AES-128-GCM decryption.
+
+  Description
+    This file defines a small polled interface to authenticated decryption
+    with the AES peripheral in Galois counter mode. A message is started
+    with its key, 96 bit nonce and additional authenticated data, decrypted
+    in place in pieces of whole AES blocks, then checked against its tag.
+    A host build can replace this library with a software model implementing
+    the same calls.
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef PLIB_AES_H    // Guards against multiple inclusion
+#define PLIB_AES_H
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// DOM-IGNORE-BEGIN
+#ifdef __cplusplus // Provide C++ Compatibility
+
+    extern "C" {
+
+#endif
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Data Types
+// *****************************************************************************
+// *****************************************************************************
+
+/* Sizes of the AES block, the key, the GCM nonce and the GCM tag in bytes */
+#define AES_BLOCK_SIZE              16U
+#define AES_KEY_SIZE                16U
+#define AES_GCM_NONCE_SIZE          12U
+#define AES_GCM_TAG_SIZE            16U
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Interface Routines
+// *****************************************************************************
+// *****************************************************************************
+
+void AES_Initialize( void );
+
+/* Starts a message. Keys, nonces and data are byte strings, passed as words
+ * so the peripheral is fed without repacking. The additional data is hashed
+ * right away, up to 16 bytes of it. */
+void AES_GcmStart( const uint32_t *key, const uint32_t *nonce, const uint32_t *aad, size_t aad_size );
+
+/* Decrypts size bytes in place, a multiple of AES_BLOCK_SIZE */
+void AES_GcmDecrypt( uint32_t *data, size_t size );
+
+/* Ends the message and compares its tag with the expected one */
+bool AES_GcmTagCheck( const uint32_t *tag );
+
+// DOM-IGNORE-BEGIN
+#ifdef __cplusplus // Provide C++ Compatibility
+
+    }
+
+#endif
+// DOM-IGNORE-END
+
+#endif // PLIB_AES_H
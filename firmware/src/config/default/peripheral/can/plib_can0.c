@@ -0,0 +1,230 @@
+/*******************************************************************************
+  Controller Area Network (CAN) Peripheral Library Source File
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_can0.c
+
+  Summary
+    CAN0 peripheral library implementation.
+
+  Description
+    CAN FD with bit rate switching on PA22 (TX) and PA23 (RX). The generic
+    clock is GCLK1 (60 MHz): 500 kbit/s nominal phase, 2 Mbit/s data phase,
+    both sampled at 80 %. Only 11 bit identifiers are used. Everything is
+    polled, no interrupt line is enabled.
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#include <string.h>
+#include "device.h"
+#include "configuration.h"
+#include "plib_can0.h"
+
+#if (BTL_CAN_FD == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Data Types
+// *****************************************************************************
+// *****************************************************************************
+
+#define CAN0_RX_FIFO_SIZE           16U
+#define CAN0_TX_FIFO_SIZE           8U
+
+/* Element size code 7 selects 64 data bytes for Rx and Tx elements */
+#define CAN0_ELEMENT_DATA_CODE      7U
+
+/* Standard identifiers sit in bits 28:18 of the first element word */
+#define CAN0_STD_ID_POS             18U
+
+/* Rx FIFO and Tx buffer element with a 64 byte data field */
+typedef struct
+{
+    uint32_t    header[2];
+
+    uint8_t     data[CAN0_FRAME_SIZE];
+
+} CAN0_ELEMENT;
+
+/* The controller takes 16 bit start addresses relative to the start of
+ * SRAM, so the message RAM has to be placed in the first 64 KB. The
+ * bootloader .bss always is. */
+typedef struct
+{
+    uint32_t        filter[1];
+
+    CAN0_ELEMENT    rxFifo[CAN0_RX_FIFO_SIZE];
+
+    CAN0_ELEMENT    txFifo[CAN0_TX_FIFO_SIZE];
+
+} CAN0_MESSAGE_RAM;
+
+static CAN0_MESSAGE_RAM can0MessageRAM __attribute__((aligned (4)));
+
+/* Payload length of each data length code */
+static const uint8_t can0FdLength[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: CAN0 Implementation
+// *****************************************************************************
+// *****************************************************************************
+
+/* Smallest data length code able to carry length bytes */
+static uint8_t CAN0_DlcGet(uint8_t length)
+{
+    uint8_t dlc = 0;
+
+    while (can0FdLength[dlc] < length)
+    {
+        dlc++;
+    }
+
+    return dlc;
+}
+
+/* Frames with either identifier are stored in Rx FIFO 0, all others and
+ * remote frames are rejected. */
+void CAN0_Initialize( uint16_t id0, uint16_t id1 )
+{
+    CAN0_REGS->CAN_CCCR = CAN_CCCR_INIT_Msk;
+
+    while ((CAN0_REGS->CAN_CCCR & CAN_CCCR_INIT_Msk) != CAN_CCCR_INIT_Msk)
+    {
+        /* Wait for initialization mode */
+    }
+
+    CAN0_REGS->CAN_CCCR = CAN_CCCR_INIT_Msk | CAN_CCCR_CCE_Msk;
+
+    CAN0_REGS->CAN_CCCR = CAN_CCCR_INIT_Msk | CAN_CCCR_CCE_Msk | CAN_CCCR_FDOE_Msk | CAN_CCCR_BRSE_Msk;
+
+    /* 60 MHz / 4 = 15 MHz, 1 + 23 + 6 = 30 tq per bit */
+    CAN0_REGS->CAN_NBTP = CAN_NBTP_NBRP(3U) | CAN_NBTP_NTSEG1(22U) | CAN_NBTP_NTSEG2(5U) | CAN_NBTP_NSJW(5U);
+
+    /* 60 MHz / 2 = 30 MHz, 1 + 11 + 3 = 15 tq per bit, delay compensation on */
+    CAN0_REGS->CAN_DBTP = CAN_DBTP_DBRP(1U) | CAN_DBTP_DTSEG1(10U) | CAN_DBTP_DTSEG2(2U) | CAN_DBTP_DSJW(2U) | CAN_DBTP_TDC_Msk;
+
+    CAN0_REGS->CAN_TDCR = CAN_TDCR_TDCO(24U);
+
+    CAN0_REGS->CAN_GFC = CAN_GFC_ANFS(2U) | CAN_GFC_ANFE(2U) | CAN_GFC_RRFS_Msk | CAN_GFC_RRFE_Msk;
+
+    /* One dual ID filter, store in Rx FIFO 0 */
+    can0MessageRAM.filter[0] = CAN_SIDFE_0_SFT(1U) | CAN_SIDFE_0_SFEC(1U) | CAN_SIDFE_0_SFID1(id0) | CAN_SIDFE_0_SFID2(id1);
+
+    CAN0_REGS->CAN_SIDFC = CAN_SIDFC_LSS(1U) | CAN_SIDFC_FLSSA((uint32_t)can0MessageRAM.filter);
+
+    CAN0_REGS->CAN_RXESC = CAN_RXESC_F0DS(CAN0_ELEMENT_DATA_CODE);
+
+    CAN0_REGS->CAN_RXF0C = CAN_RXF0C_F0S(CAN0_RX_FIFO_SIZE) | CAN_RXF0C_F0SA((uint32_t)can0MessageRAM.rxFifo);
+
+    CAN0_REGS->CAN_TXESC = CAN_TXESC_TBDS(CAN0_ELEMENT_DATA_CODE);
+
+    CAN0_REGS->CAN_TXBC = CAN_TXBC_TFQS(CAN0_TX_FIFO_SIZE) | CAN_TXBC_TBSA((uint32_t)can0MessageRAM.txFifo);
+
+    /* Leaving initialization mode also clears CCE */
+    CAN0_REGS->CAN_CCCR = CAN_CCCR_FDOE_Msk | CAN_CCCR_BRSE_Msk;
+
+    while ((CAN0_REGS->CAN_CCCR & CAN_CCCR_INIT_Msk) == CAN_CCCR_INIT_Msk)
+    {
+        /* Wait for the controller to join the bus */
+    }
+}
+
+/* True once no queued frame is waiting for transmission */
+bool CAN0_TransmitIsComplete( void )
+{
+    return (CAN0_REGS->CAN_TXBRP == 0U);
+}
+
+/* Queues one CAN FD frame with bit rate switching. Returns false if the Tx
+ * FIFO is full. */
+bool CAN0_MessageTransmit( uint16_t id, const uint8_t *data, uint8_t length )
+{
+    CAN0_ELEMENT *element;
+    uint32_t index;
+    uint8_t dlc;
+
+    if ((length > CAN0_FRAME_SIZE) || ((CAN0_REGS->CAN_TXFQS & CAN_TXFQS_TFQF_Msk) == CAN_TXFQS_TFQF_Msk))
+    {
+        return false;
+    }
+
+    index   = (CAN0_REGS->CAN_TXFQS & CAN_TXFQS_TFQPI_Msk) >> CAN_TXFQS_TFQPI_Pos;
+    element = &can0MessageRAM.txFifo[index];
+    dlc     = CAN0_DlcGet(length);
+
+    element->header[0] = CAN_TXBE_0_ID((uint32_t)id << CAN0_STD_ID_POS);
+    element->header[1] = CAN_TXBE_1_DLC(dlc) | CAN_TXBE_1_FDF_Msk | CAN_TXBE_1_BRS_Msk;
+
+    memcpy(element->data, data, length);
+    memset(&element->data[length], CAN0_PADDING_BYTE, can0FdLength[dlc] - length);
+
+    __DMB();
+
+    CAN0_REGS->CAN_TXBAR = 1UL << index;
+
+    return true;
+}
+
+/* Takes the oldest frame out of Rx FIFO 0. data must hold CAN0_FRAME_SIZE
+ * bytes. Returns false if the FIFO is empty. */
+bool CAN0_MessageReceive( uint16_t *id, uint8_t *data, uint8_t *length )
+{
+    CAN0_ELEMENT *element;
+    uint32_t index;
+    uint32_t dlc;
+
+    if ((CAN0_REGS->CAN_RXF0S & CAN_RXF0S_F0FL_Msk) == 0U)
+    {
+        return false;
+    }
+
+    index   = (CAN0_REGS->CAN_RXF0S & CAN_RXF0S_F0GI_Msk) >> CAN_RXF0S_F0GI_Pos;
+    element = &can0MessageRAM.rxFifo[index];
+    dlc     = (element->header[1] & CAN_RXF0E_1_DLC_Msk) >> CAN_RXF0E_1_DLC_Pos;
+
+    /* Classic frames carry at most 8 bytes whatever the DLC says */
+    if (((element->header[1] & CAN_RXF0E_1_FDF_Msk) == 0U) && (dlc > 8U))
+    {
+        dlc = 8U;
+    }
+
+    *id     = (uint16_t)((element->header[0] & CAN_RXF0E_0_ID_Msk) >> CAN0_STD_ID_POS);
+    *length = can0FdLength[dlc];
+
+    memcpy(data, element->data, *length);
+
+    CAN0_REGS->CAN_RXF0A = CAN_RXF0A_F0AI(index);
+
+    return true;
+}
+
+#endif
@@ -40,6 +40,7 @@
 
 #include "plib_clock.h"
 #include "device.h"
+#include "configuration.h"
 
 static void OSCCTRL_Initialize(void)
 {
@@ -91,6 +92,59 @@ static void FDPLL0_Initialize(void)
 
 static void DFLL_Initialize(void)
 {
+#if (BTL_USB_DFU == 1) || (BTL_USB_MSC == 1)
+    /****************** DFLL Initialization  *********************************/
+
+    /* GCLK0 runs from the DFLL out of reset, keep the CPU on OSCULP32K
+     * while the DFLL is stopped */
+    GCLK_REGS->GCLK_GENCTRL[0] = GCLK_GENCTRL_DIV(1) | GCLK_GENCTRL_SRC(4) | GCLK_GENCTRL_GENEN_Msk;
+
+    while((GCLK_REGS->GCLK_SYNCBUSY & GCLK_SYNCBUSY_GENCTRL_GCLK0) == GCLK_SYNCBUSY_GENCTRL_GCLK0)
+    {
+        /* wait for the Generator 0 synchronization */
+    }
+
+    OSCCTRL_REGS->OSCCTRL_DFLLCTRLA = 0;
+
+    while((OSCCTRL_REGS->OSCCTRL_DFLLSYNC & OSCCTRL_DFLLSYNC_ENABLE_Msk) == OSCCTRL_DFLLSYNC_ENABLE_Msk)
+    {
+        /* Waiting for the DFLL to be disabled */
+    }
+
+    /* Closed loop 48 MHz locked to the USB start of frame */
+    OSCCTRL_REGS->OSCCTRL_DFLLMUL = OSCCTRL_DFLLMUL_MUL(48000) | OSCCTRL_DFLLMUL_FSTEP(1) | OSCCTRL_DFLLMUL_CSTEP(1);
+
+    while((OSCCTRL_REGS->OSCCTRL_DFLLSYNC & OSCCTRL_DFLLSYNC_DFLLMUL_Msk) == OSCCTRL_DFLLSYNC_DFLLMUL_Msk)
+    {
+        /* Waiting for the synchronization */
+    }
+
+    OSCCTRL_REGS->OSCCTRL_DFLLCTRLB = OSCCTRL_DFLLCTRLB_MODE_Msk | OSCCTRL_DFLLCTRLB_USBCRM_Msk | OSCCTRL_DFLLCTRLB_CCDIS_Msk;
+
+    while((OSCCTRL_REGS->OSCCTRL_DFLLSYNC & OSCCTRL_DFLLSYNC_DFLLCTRLB_Msk) == OSCCTRL_DFLLSYNC_DFLLCTRLB_Msk)
+    {
+        /* Waiting for the synchronization */
+    }
+
+    OSCCTRL_REGS->OSCCTRL_DFLLCTRLA = OSCCTRL_DFLLCTRLA_ENABLE_Msk;
+
+    while((OSCCTRL_REGS->OSCCTRL_DFLLSYNC & OSCCTRL_DFLLSYNC_ENABLE_Msk) == OSCCTRL_DFLLSYNC_ENABLE_Msk)
+    {
+        /* Waiting for the DFLL enable synchronization */
+    }
+
+    while((OSCCTRL_REGS->OSCCTRL_STATUS & OSCCTRL_STATUS_DFLLRDY_Msk) != OSCCTRL_STATUS_DFLLRDY_Msk)
+    {
+        /* Waiting for the DFLL to be ready */
+    }
+
+    GCLK_REGS->GCLK_GENCTRL[0] = GCLK_GENCTRL_DIV(1) | GCLK_GENCTRL_SRC(6) | GCLK_GENCTRL_GENEN_Msk;
+
+    while((GCLK_REGS->GCLK_SYNCBUSY & GCLK_SYNCBUSY_GENCTRL_GCLK0) == GCLK_SYNCBUSY_GENCTRL_GCLK0)
+    {
+        /* wait for the Generator 0 synchronization */
+    }
+#endif
 }
 
 
@@ -122,6 +176,19 @@ static void GCLK1_Initialize(void)
     }
 }
 
+/* 48 MHz for USB and SDHC0 */
+#if (BTL_USB_DFU == 1) || (BTL_USB_MSC == 1) || (BTL_SDCARD == 1)
+static void GCLK3_Initialize(void)
+{
+    GCLK_REGS->GCLK_GENCTRL[3] = GCLK_GENCTRL_DIV(1) | GCLK_GENCTRL_SRC(6) | GCLK_GENCTRL_GENEN_Msk;
+
+    while((GCLK_REGS->GCLK_SYNCBUSY & GCLK_SYNCBUSY_GENCTRL_GCLK3) == GCLK_SYNCBUSY_GENCTRL_GCLK3)
+    {
+        /* wait for the Generator 3 synchronization */
+    }
+}
+#endif
+
 static void GCLK2_Initialize(void)
 {
     GCLK_REGS->GCLK_GENCTRL[2] = GCLK_GENCTRL_DIV(48) | GCLK_GENCTRL_SRC(6) | GCLK_GENCTRL_GENEN_Msk;
@@ -145,6 +212,9 @@ void CLOCK_Initialize (void)
     FDPLL0_Initialize();
     GCLK0_Initialize();
     GCLK1_Initialize();
+#if (BTL_USB_DFU == 1) || (BTL_USB_MSC == 1) || (BTL_SDCARD == 1)
+    GCLK3_Initialize();
+#endif
 
 
 
@@ -156,11 +226,97 @@ void CLOCK_Initialize (void)
         /* Wait for synchronization */
     }
 
+#if (BTL_USB_DFU == 1) || (BTL_USB_MSC == 1)
+    /* Selection of the Generator and write Lock for USB */
+    GCLK_REGS->GCLK_PCHCTRL[10] = GCLK_PCHCTRL_GEN(0x3)  | GCLK_PCHCTRL_CHEN_Msk;
+
+    while ((GCLK_REGS->GCLK_PCHCTRL[10] & GCLK_PCHCTRL_CHEN_Msk) != GCLK_PCHCTRL_CHEN_Msk)
+    {
+        /* Wait for synchronization */
+    }
+#endif
+
+    /* Selection of the Generator and write Lock for TC0 TC1 */
+    GCLK_REGS->GCLK_PCHCTRL[9] = GCLK_PCHCTRL_GEN(0x1)  | GCLK_PCHCTRL_CHEN_Msk;
+
+    while ((GCLK_REGS->GCLK_PCHCTRL[9] & GCLK_PCHCTRL_CHEN_Msk) != GCLK_PCHCTRL_CHEN_Msk)
+    {
+        /* Wait for synchronization */
+    }
+
+#if (BTL_SPI_SLAVE == 1)
+    /* Selection of the Generator and write Lock for SERCOM1_CORE */
+    GCLK_REGS->GCLK_PCHCTRL[8] = GCLK_PCHCTRL_GEN(0x1)  | GCLK_PCHCTRL_CHEN_Msk;
+
+    while ((GCLK_REGS->GCLK_PCHCTRL[8] & GCLK_PCHCTRL_CHEN_Msk) != GCLK_PCHCTRL_CHEN_Msk)
+    {
+        /* Wait for synchronization */
+    }
+#endif
+
+#if (BTL_DUAL_UART == 1)
+    /* Selection of the Generator and write Lock for SERCOM2_CORE */
+    GCLK_REGS->GCLK_PCHCTRL[23] = GCLK_PCHCTRL_GEN(0x1)  | GCLK_PCHCTRL_CHEN_Msk;
+
+    while ((GCLK_REGS->GCLK_PCHCTRL[23] & GCLK_PCHCTRL_CHEN_Msk) != GCLK_PCHCTRL_CHEN_Msk)
+    {
+        /* Wait for synchronization */
+    }
+#endif
+
+#if (BTL_CAN_FD == 1)
+    /* Selection of the Generator and write Lock for CAN0 */
+    GCLK_REGS->GCLK_PCHCTRL[27] = GCLK_PCHCTRL_GEN(0x1)  | GCLK_PCHCTRL_CHEN_Msk;
+
+    while ((GCLK_REGS->GCLK_PCHCTRL[27] & GCLK_PCHCTRL_CHEN_Msk) != GCLK_PCHCTRL_CHEN_Msk)
+    {
+        /* Wait for synchronization */
+    }
+#endif
+
+#if (BTL_SDCARD == 1)
+    /* Selection of the Generator and write Lock for SDHC0 */
+    GCLK_REGS->GCLK_PCHCTRL[45] = GCLK_PCHCTRL_GEN(0x3)  | GCLK_PCHCTRL_CHEN_Msk;
+
+    while ((GCLK_REGS->GCLK_PCHCTRL[45] & GCLK_PCHCTRL_CHEN_Msk) != GCLK_PCHCTRL_CHEN_Msk)
+    {
+        /* Wait for synchronization */
+    }
+#endif
+
     /* Configure the AHB Bridge Clocks */
     MCLK_REGS->MCLK_AHBMASK = 0xffffff;
 
     /* Configure the APBA Bridge Clocks */
     MCLK_REGS->MCLK_APBAMASK = 0x17ff;
 
+    /* TC0 times packets and sessions in every build, TC1 is its 32 bit
+     * half */
+    MCLK_REGS->MCLK_APBAMASK |= MCLK_APBAMASK_TC0_Msk | MCLK_APBAMASK_TC1_Msk;
+
+#if (BTL_SPI_SLAVE == 1)
+    MCLK_REGS->MCLK_APBAMASK |= MCLK_APBAMASK_SERCOM1_Msk;
+#endif
+
+    /* Configure the APBB Bridge Clocks, on top of the reset value */
+#if (BTL_USB_DFU == 1) || (BTL_USB_MSC == 1)
+    MCLK_REGS->MCLK_APBBMASK |= MCLK_APBBMASK_USB_Msk;
+#endif
+
+#if (BTL_DUAL_UART == 1)
+    MCLK_REGS->MCLK_APBBMASK |= MCLK_APBBMASK_SERCOM2_Msk;
+#endif
+
+    /* Configure the APBC Bridge Clocks, on top of the reset value */
+#if (BTL_ENCRYPTION == 1)
+    MCLK_REGS->MCLK_APBCMASK |= MCLK_APBCMASK_AES_Msk;
+#endif
+
+#if (BTL_QSPI_STAGING == 0) && (BTL_QSPI_XIP == 0)
+    /* The QSPI is clocked from reset, QSPI_Initialize turns it on again */
+    MCLK_REGS->MCLK_APBCMASK &= ~MCLK_APBCMASK_QSPI_Msk;
+    MCLK_REGS->MCLK_AHBMASK &= ~(MCLK_AHBMASK_QSPI_Msk | MCLK_AHBMASK_QSPI_2X_Msk);
+#endif
+
 
 }
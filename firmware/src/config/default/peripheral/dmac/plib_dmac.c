@@ -0,0 +1,185 @@
+/*******************************************************************************
+  Direct Memory Access Controller (DMAC) PLIB
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_dmac.c
+
+  Summary
+    Source for DMAC peripheral library interface Implementation.
+
+  Description
+    This file defines the interface to the DMAC peripheral library. This
+    library provides access to and control of the DMAC controller.
+
+  Remarks:
+    None.
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#include "plib_dmac.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global Data
+// *****************************************************************************
+// *****************************************************************************
+
+/* Channel descriptors and write back area, both have to be 128-bit aligned */
+static dmac_descriptor_registers_t  write_back_section[DMAC_CHANNELS_NUMBER]    __ALIGNED(16);
+static dmac_descriptor_registers_t  descriptor_section[DMAC_CHANNELS_NUMBER]    __ALIGNED(16);
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: DMAC PLib Interface Implementations
+// *****************************************************************************
+// *****************************************************************************
+
+/*******************************************************************************
+This function initializes the DMAC controller of the device.
+********************************************************************************/
+
+void DMAC_Initialize( void )
+{
+    /* Update the Base address and Write Back address register */
+    DMAC_REGS->DMAC_BASEADDR = (uint32_t) descriptor_section;
+    DMAC_REGS->DMAC_WRBADDR  = (uint32_t) write_back_section;
+
+    /* Update the Priority Control register */
+    DMAC_REGS->DMAC_PRICTRL0 = DMAC_PRICTRL0_LVLPRI0(1UL) | DMAC_PRICTRL0_RRLVLEN0_Msk;
+
+    /***************** Configure DMA channel 0 ********************/
+
+    /* SERCOM1 RX: one byte per trigger from the data register into memory */
+    DMAC_REGS->CHANNEL[0].DMAC_CHCTRLA = DMAC_CHCTRLA_TRIGACT_BURST | DMAC_CHCTRLA_TRIGSRC(SERCOM1_DMAC_ID_RX) | DMAC_CHCTRLA_THRESHOLD_1BEAT | DMAC_CHCTRLA_BURSTLEN_SINGLE;
+
+    DMAC_REGS->CHANNEL[0].DMAC_CHPRILVL = DMAC_CHPRILVL_PRILVL(0UL);
+
+    descriptor_section[0].DMAC_BTCTRL = (uint16_t)(DMAC_BTCTRL_BLOCKACT_NOACT | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_DSTINC_Msk);
+
+    /***************** Configure DMA channel 1 ********************/
+
+    /* SERCOM1 TX: one byte per trigger from memory into the data register */
+    DMAC_REGS->CHANNEL[1].DMAC_CHCTRLA = DMAC_CHCTRLA_TRIGACT_BURST | DMAC_CHCTRLA_TRIGSRC(SERCOM1_DMAC_ID_TX) | DMAC_CHCTRLA_THRESHOLD_1BEAT | DMAC_CHCTRLA_BURSTLEN_SINGLE;
+
+    DMAC_REGS->CHANNEL[1].DMAC_CHPRILVL = DMAC_CHPRILVL_PRILVL(0UL);
+
+    descriptor_section[1].DMAC_BTCTRL = (uint16_t)(DMAC_BTCTRL_BLOCKACT_NOACT | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_VALID_Msk | DMAC_BTCTRL_SRCINC_Msk);
+
+    /* Enable the DMAC module & Priority Level 0 */
+    DMAC_REGS->DMAC_CTRL = (uint16_t)(DMAC_CTRL_DMAENABLE_Msk | DMAC_CTRL_LVLEN0_Msk);
+}
+
+/*******************************************************************************
+    This function schedules a DMA transfer on the specified DMA channel.
+********************************************************************************/
+
+bool DMAC_ChannelTransfer( DMAC_CHANNEL channel, const void *srcAddr, const void *destAddr, size_t blockSize )
+{
+    uint8_t beat_size = 0U;
+    bool returnStatus = false;
+
+    if ((DMAC_REGS->CHANNEL[channel].DMAC_CHCTRLA & DMAC_CHCTRLA_ENABLE_Msk) == 0U)
+    {
+        /* Clear all the interrupt flags */
+        DMAC_REGS->CHANNEL[channel].DMAC_CHINTFLAG = (uint8_t)DMAC_CHINTFLAG_Msk;
+
+        beat_size = (uint8_t)((descriptor_section[channel].DMAC_BTCTRL & DMAC_BTCTRL_BEATSIZE_Msk) >> DMAC_BTCTRL_BEATSIZE_Pos);
+
+        /* Set source address, with increment it points past the last beat */
+        if ((descriptor_section[channel].DMAC_BTCTRL & DMAC_BTCTRL_SRCINC_Msk) != 0U)
+        {
+            descriptor_section[channel].DMAC_SRCADDR = (uint32_t) ((uintptr_t)srcAddr + blockSize);
+        }
+        else
+        {
+            descriptor_section[channel].DMAC_SRCADDR = (uint32_t) (srcAddr);
+        }
+
+        /* Set destination address, with increment it points past the last beat */
+        if ((descriptor_section[channel].DMAC_BTCTRL & DMAC_BTCTRL_DSTINC_Msk) != 0U)
+        {
+            descriptor_section[channel].DMAC_DSTADDR = (uint32_t) ((uintptr_t)destAddr + blockSize);
+        }
+        else
+        {
+            descriptor_section[channel].DMAC_DSTADDR = (uint32_t) (destAddr);
+        }
+
+        /* Calculate the beat size and then set the BTCNT value */
+        descriptor_section[channel].DMAC_BTCNT = (uint16_t)(blockSize >> beat_size);
+
+        /* The write back area is only updated once the channel was active,
+         * start it from the full count so an untouched transfer reads 0. */
+        write_back_section[channel].DMAC_BTCNT = descriptor_section[channel].DMAC_BTCNT;
+
+        /* Enable the channel */
+        DMAC_REGS->CHANNEL[channel].DMAC_CHCTRLA |= DMAC_CHCTRLA_ENABLE_Msk;
+
+        returnStatus = true;
+    }
+
+    return returnStatus;
+}
+
+/*******************************************************************************
+    This function disables the specified DMAC channel and waits until an
+    ongoing beat has completed and the descriptor has been written back.
+********************************************************************************/
+
+void DMAC_ChannelDisable( DMAC_CHANNEL channel )
+{
+    /* Disable the DMA channel */
+    DMAC_REGS->CHANNEL[channel].DMAC_CHCTRLA &= (~DMAC_CHCTRLA_ENABLE_Msk);
+
+    while((DMAC_REGS->CHANNEL[channel].DMAC_CHCTRLA & DMAC_CHCTRLA_ENABLE_Msk) != 0U)
+    {
+        /* Wait for the channel to stop */
+    }
+}
+
+/*******************************************************************************
+    A channel is busy until its block is done or it has been disabled.
+********************************************************************************/
+
+bool DMAC_ChannelIsBusy( DMAC_CHANNEL channel )
+{
+    return ((DMAC_REGS->CHANNEL[channel].DMAC_CHCTRLA & DMAC_CHCTRLA_ENABLE_Msk) != 0U);
+}
+
+/*******************************************************************************
+    Number of beats moved by the last transfer. Only valid once the channel
+    is no longer busy.
+********************************************************************************/
+
+uint16_t DMAC_ChannelGetTransferredCount( DMAC_CHANNEL channel )
+{
+    return (descriptor_section[channel].DMAC_BTCNT - write_back_section[channel].DMAC_BTCNT);
+}
@@ -54,37 +54,57 @@
 // *****************************************************************************
 // *****************************************************************************
 
-bool DSU_CRCCalculate (uint32_t startAddress, size_t length, uint32_t crcSeed, uint32_t * crc)
+bool DSU_CRCStart (uint32_t startAddress, size_t length, uint32_t crcSeed)
 {
-    bool statusValue = false;
-
-    if( (0 != length) && (NULL != crc) )
+    if (0 == length)
     {
-        DSU_REGS->DSU_ADDR = startAddress;
+        return false;
+    }
+
+    DSU_REGS->DSU_ADDR = startAddress;
+
+    DSU_REGS->DSU_LENGTH = (uint32_t)length;
 
-        DSU_REGS->DSU_LENGTH = (uint32_t)length;
+    /* Initial CRC Value  */
+    DSU_REGS->DSU_DATA = crcSeed;
 
-        /* Initial CRC Value  */
-        DSU_REGS->DSU_DATA = crcSeed;
+    /* Clear Status Register */
+    DSU_REGS->DSU_STATUSA = DSU_REGS->DSU_STATUSA;
+
+    DSU_REGS->DSU_CTRL = DSU_CTRL_CRC_Msk;
+
+    return true;
+}
+
+bool DSU_CRCIsBusy (void)
+{
+    return ((DSU_REGS->DSU_STATUSA & DSU_STATUSA_DONE_Msk) == 0U);
+}
 
-        /* Clear Status Register */
-        DSU_REGS->DSU_STATUSA = DSU_REGS->DSU_STATUSA;
+bool DSU_CRCResultGet (uint32_t * crc)
+{
+    while (DSU_CRCIsBusy())
+    {
+        /* Wait for the DSU Operation to Complete */
+    }
 
-        DSU_REGS->DSU_CTRL = DSU_CTRL_CRC_Msk;
+    if (DSU_REGS->DSU_STATUSA & DSU_STATUSA_BERR_Msk)
+    {
+        return false;
+    }
 
-        while(!(DSU_REGS->DSU_STATUSA & DSU_STATUSA_DONE_Msk))
-        {
-            /* Wait for the DSU Operation to Complete */
-        }
+    /* Reading the resultant crc value from the DATA register */
+    *crc = (uint32_t) DSU_REGS->DSU_DATA;
 
-        if(!(DSU_REGS->DSU_STATUSA & DSU_STATUSA_BERR_Msk))
-        {
-            /* Reading the resultant crc value from the DATA register */
-            *crc = (uint32_t) DSU_REGS->DSU_DATA;
+    return true;
+}
 
-            statusValue = true;
-        }
+bool DSU_CRCCalculate (uint32_t startAddress, size_t length, uint32_t crcSeed, uint32_t * crc)
+{
+    if ((NULL == crc) || (DSU_CRCStart(startAddress, length, crcSeed) == false))
+    {
+        return false;
     }
 
-    return statusValue;
+    return DSU_CRCResultGet(crc);
 }
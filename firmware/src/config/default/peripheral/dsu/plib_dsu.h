@@ -62,6 +62,15 @@ extern "C" {
 
 bool DSU_CRCCalculate (uint32_t startAddress, size_t length, uint32_t crcSeed, uint32_t * crc);
 
+/* Non-blocking form: DSU_CRCStart starts the CRC of a word aligned range
+ * and returns at once, so the CPU can work next to the DSU. DSU_CRCResultGet
+ * waits for the end and returns false on a bus error. */
+bool DSU_CRCStart (uint32_t startAddress, size_t length, uint32_t crcSeed);
+
+bool DSU_CRCIsBusy (void);
+
+bool DSU_CRCResultGet (uint32_t * crc);
+
 #ifdef __cplusplus // Provide C++ Compatibility
 }
 #endif
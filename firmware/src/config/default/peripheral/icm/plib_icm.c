@@ -0,0 +1,180 @@
+/*******************************************************************************
+  Integrity Check Monitor (ICM) Peripheral Library Source File
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_icm.c
+
+  Summary
+    ICM peripheral library implementation.
+
+  Description
+    The ICM hashes whole 64 byte blocks only and leaves the SHA padding to
+    software. The digest is therefore computed over one region made of two
+    pieces: the complete blocks read in place, then a copy of the remaining
+    bytes with the padding appended, chained as a secondary list. The
+    region ends the main list, so the ICM stops on its own once the digest
+    is written back. Everything is polled, no interrupt line is enabled.
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#include <string.h>
+#include "device.h"
+#include "configuration.h"
+#include "plib_icm.h"
+
+#if (BTL_SIGNATURE == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Data Types
+// *****************************************************************************
+// *****************************************************************************
+
+#define ICM_BLOCK_SIZE              64U
+
+/* Padding is the 0x80 byte and the 64 bit message length at least */
+#define ICM_PAD_MIN_SIZE            9U
+
+/* SHA-256, the region ends the main list. Writing the digest back is the
+ * default, comparing it is not wanted. */
+#define ICM_REGION_CONFIG           (ICM_RCFG_ALGO(ICM_CFG_UALGO_SHA256_Val) | ICM_RCFG_EOM_Msk)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Data
+// *****************************************************************************
+// *****************************************************************************
+
+/* Main list descriptor of region 0 and the one secondary list descriptor */
+static icm_descriptor_registers_t icm_descriptors[2] __ALIGNED(64);
+
+/* Hash area, region 0 has the first eight words */
+static volatile uint32_t icm_hash[32] __ALIGNED(128);
+
+/* Last partial block and the padding, one or two blocks */
+static uint32_t icm_tail[(2U * ICM_BLOCK_SIZE) / sizeof(uint32_t)];
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: ICM Implementation
+// *****************************************************************************
+// *****************************************************************************
+
+/* Copies the bytes past the last complete block and pads them, returns the
+ * number of blocks */
+static uint32_t ICM_TailPad(const uint8_t *data, size_t size)
+{
+    uint8_t *tail = (uint8_t *)icm_tail;
+    size_t   rest = size % ICM_BLOCK_SIZE;
+    size_t   length;
+    uint64_t bits = (uint64_t)size * 8U;
+    uint32_t i;
+
+    length = ((rest + ICM_PAD_MIN_SIZE) > ICM_BLOCK_SIZE) ? (2U * ICM_BLOCK_SIZE) : ICM_BLOCK_SIZE;
+
+    (void)memset(tail, 0, length);
+    (void)memcpy(tail, &data[size - rest], rest);
+
+    tail[rest] = 0x80U;
+
+    /* Message length in bits, big endian */
+    for (i = 0; i < 8U; i++)
+    {
+        tail[length - 1U - i] = (uint8_t)(bits >> (8U * i));
+    }
+
+    return length / ICM_BLOCK_SIZE;
+}
+
+void ICM_Initialize( void )
+{
+    MCLK_REGS->MCLK_APBCMASK |= MCLK_APBCMASK_ICM_Msk;
+
+    ICM_REGS->ICM_CTRL = ICM_CTRL_SWRST_Msk;
+}
+
+void ICM_Sha256( const void *data, size_t size, uint8_t *digest )
+{
+    uint32_t blocks      = size / ICM_BLOCK_SIZE;
+    uint32_t tail_blocks = ICM_TailPad(data, size);
+    uint32_t i;
+
+    if (blocks > 0U)
+    {
+        /* The complete blocks in place, then the tail */
+        icm_descriptors[0].ICM_RADDR = (uint32_t)data;
+        icm_descriptors[0].ICM_RCFG  = ICM_REGION_CONFIG;
+        icm_descriptors[0].ICM_RCTRL = ICM_RCTRL_TRSIZE(blocks - 1U);
+        icm_descriptors[0].ICM_RNEXT = (uint32_t)&icm_descriptors[1];
+
+        icm_descriptors[1].ICM_RADDR = (uint32_t)icm_tail;
+        icm_descriptors[1].ICM_RCFG  = ICM_REGION_CONFIG;
+        icm_descriptors[1].ICM_RCTRL = ICM_RCTRL_TRSIZE(tail_blocks - 1U);
+        icm_descriptors[1].ICM_RNEXT = 0U;
+    }
+    else
+    {
+        icm_descriptors[0].ICM_RADDR = (uint32_t)icm_tail;
+        icm_descriptors[0].ICM_RCFG  = ICM_REGION_CONFIG;
+        icm_descriptors[0].ICM_RCTRL = ICM_RCTRL_TRSIZE(tail_blocks - 1U);
+        icm_descriptors[0].ICM_RNEXT = 0U;
+    }
+
+    ICM_REGS->ICM_CTRL = ICM_CTRL_SWRST_Msk;
+    ICM_REGS->ICM_CFG  = 0U;
+    ICM_REGS->ICM_DSCR = (uint32_t)icm_descriptors;
+    ICM_REGS->ICM_HASH = (uint32_t)icm_hash;
+
+    /* The ICM reads the descriptors and the tail as a bus master */
+    __DSB();
+
+    ICM_REGS->ICM_CTRL = ICM_CTRL_ENABLE_Msk;
+
+    while ((ICM_REGS->ICM_ISR & ICM_ISR_RHC(1U)) == 0U)
+    {
+        /* Wait for the digest of region 0 */
+    }
+
+    ICM_REGS->ICM_CTRL = ICM_CTRL_DISABLE_Msk;
+
+    while ((ICM_REGS->ICM_SR & ICM_SR_ENABLE_Msk) != 0U)
+    {
+        /* Wait for the ICM to stop */
+    }
+
+    /* The digest words are written back in memory byte order */
+    for (i = 0; i < ICM_SHA256_DIGEST_SIZE; i++)
+    {
+        digest[i] = ((volatile const uint8_t *)icm_hash)[i];
+    }
+}
+
+#endif
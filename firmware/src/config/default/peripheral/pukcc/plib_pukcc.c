@@ -0,0 +1,244 @@
+/*******************************************************************************
+  Public Key Cryptography Controller (PUKCC) Peripheral Library Source File
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_pukcc.c
+
+  Summary
+    PUKCC peripheral library implementation.
+
+  Description
+    The PUKCC is driven by the PUKCL library in ROM; its services take their
+    operands in the 4 KB crypto RAM as little endian numbers padded with four
+    zero bytes, and points in Jacobian coordinates. The operands are laid
+    out once per verification, the reduction constant of the modulus is set
+    up by RedMod and the signature checked by ZpEcDsaVerifyFast. The service
+    interface comes from Microchip's PUKCL headers (CryptoLib_Headers_pb.h),
+    which builds with BTL_SIGNATURE take from src/third_party/pukcl.
+    Everything is polled, no interrupt line is enabled.
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#include <string.h>
+#include "device.h"
+#include "configuration.h"
+#include "plib_pukcc.h"
+
+#if (BTL_SIGNATURE == 1)
+
+#if defined(__has_include)
+#if !__has_include("CryptoLib_Headers_pb.h")
+#error "BTL_SIGNATURE needs the PUKCL headers, see src/third_party/pukcl/README.md"
+#endif
+#endif
+
+#include "CryptoLib_Headers_pb.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Data Types
+// *****************************************************************************
+// *****************************************************************************
+
+#define PUKCC_CRYPTO_RAM            0x02011000UL
+#define PUKCC_CRYPTO_RAM_SIZE       0x1000U
+
+/* Numbers carry four zero bytes above their most significant one */
+#define PUKCC_NUMBER_SIZE           (PUKCC_P256_SIZE + 4U)
+
+/* Crypto RAM layout */
+#define PUKCC_MOD_OFFSET            0U
+#define PUKCC_CNS_OFFSET            (PUKCC_MOD_OFFSET + PUKCC_NUMBER_SIZE)
+#define PUKCC_ORDER_OFFSET          (PUKCC_CNS_OFFSET + PUKCC_P256_SIZE + 12U)
+#define PUKCC_SIGNATURE_OFFSET      (PUKCC_ORDER_OFFSET + PUKCC_P256_SIZE + 8U)
+#define PUKCC_HASH_OFFSET           (PUKCC_SIGNATURE_OFFSET + (2U * PUKCC_NUMBER_SIZE))
+#define PUKCC_POINT_A_OFFSET        (PUKCC_HASH_OFFSET + PUKCC_NUMBER_SIZE)
+#define PUKCC_PUBLIC_KEY_OFFSET     (PUKCC_POINT_A_OFFSET + (3U * PUKCC_NUMBER_SIZE))
+#define PUKCC_A_OFFSET              (PUKCC_PUBLIC_KEY_OFFSET + (3U * PUKCC_NUMBER_SIZE))
+#define PUKCC_WORKSPACE_OFFSET      (PUKCC_A_OFFSET + PUKCC_NUMBER_SIZE)
+
+/* RedMod SetUp needs 64 bytes at R and the rest of the workspace at X */
+#define PUKCC_REDMOD_R_OFFSET       PUKCC_WORKSPACE_OFFSET
+#define PUKCC_REDMOD_X_OFFSET       (PUKCC_WORKSPACE_OFFSET + 64U)
+
+/* Operands are passed to the services as crypto RAM addresses, cut to the
+ * 16 bits the PUKCC decodes */
+#define PUKCC_NU1(offset)           ((nu1)(PUKCC_CRYPTO_RAM + (offset)))
+#define PUKCC_RAM(offset)           ((uint8_t *)(PUKCC_CRYPTO_RAM + (offset)))
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Data
+// *****************************************************************************
+// *****************************************************************************
+
+/* NIST P-256 (FIPS 186-4 D.1.2.3), big endian */
+static const uint8_t pukcc_p256_p[PUKCC_P256_SIZE] = {
+    0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+/* a = -3 mod p */
+static const uint8_t pukcc_p256_a[PUKCC_P256_SIZE] = {
+    0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfc
+};
+
+static const uint8_t pukcc_p256_n[PUKCC_P256_SIZE] = {
+    0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xbc, 0xe6, 0xfa, 0xad, 0xa7, 0x17, 0x9e, 0x84,
+    0xf3, 0xb9, 0xca, 0xc2, 0xfc, 0x63, 0x25, 0x51
+};
+
+static const uint8_t pukcc_p256_g[2U * PUKCC_P256_SIZE] = {
+    0x6b, 0x17, 0xd1, 0xf2, 0xe1, 0x2c, 0x42, 0x47,
+    0xf8, 0xbc, 0xe6, 0xe5, 0x63, 0xa4, 0x40, 0xf2,
+    0x77, 0x03, 0x7d, 0x81, 0x2d, 0xeb, 0x33, 0xa0,
+    0xf4, 0xa1, 0x39, 0x45, 0xd8, 0x98, 0xc2, 0x96,
+    0x4f, 0xe3, 0x42, 0xe2, 0xfe, 0x1a, 0x7f, 0x9b,
+    0x8e, 0xe7, 0xeb, 0x4a, 0x7c, 0x0f, 0x9e, 0x16,
+    0x2b, 0xce, 0x33, 0x57, 0x6b, 0x31, 0x5e, 0xce,
+    0xcb, 0xb6, 0x40, 0x68, 0x37, 0xbf, 0x51, 0xf5
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: PUKCC Implementation
+// *****************************************************************************
+// *****************************************************************************
+
+/* Stores a big endian number little endian, the padding is already zero */
+static void PUKCC_NumberLoad(uint32_t offset, const uint8_t *number)
+{
+    uint8_t *ram = PUKCC_RAM(offset);
+    uint32_t i;
+
+    for (i = 0; i < PUKCC_P256_SIZE; i++)
+    {
+        ram[i] = number[PUKCC_P256_SIZE - 1U - i];
+    }
+}
+
+/* Affine X and Y, Z = 1 */
+static void PUKCC_PointLoad(uint32_t offset, const uint8_t *point)
+{
+    PUKCC_NumberLoad(offset, &point[0]);
+    PUKCC_NumberLoad(offset + PUKCC_NUMBER_SIZE, &point[PUKCC_P256_SIZE]);
+
+    PUKCC_RAM(offset + (2U * PUKCC_NUMBER_SIZE))[0] = 1U;
+}
+
+/* r and s have to be in [1, n - 1] */
+static bool PUKCC_ScalarCheck(const uint8_t *scalar)
+{
+    bool     zero = true;
+    uint32_t i;
+
+    for (i = 0; i < PUKCC_P256_SIZE; i++)
+    {
+        zero = zero && (scalar[i] == 0U);
+    }
+
+    return (zero == false) && (memcmp(scalar, pukcc_p256_n, PUKCC_P256_SIZE) < 0);
+}
+
+void PUKCC_Initialize( void )
+{
+    while ((PUKCCSR & BIT_PUKCCSR_CLRRAM_BUSY) != 0U)
+    {
+        /* Wait for the crypto RAM to be cleared */
+    }
+}
+
+bool PUKCC_EcdsaP256Verify( const uint8_t *digest, const uint8_t *signature, const uint8_t *public_key )
+{
+    PUKCL_PARAM  PUKCLParam;
+    PPUKCL_PARAM pvPUKCLParam = &PUKCLParam;
+
+    if ((PUKCC_ScalarCheck(&signature[0]) == false) ||
+        (PUKCC_ScalarCheck(&signature[PUKCC_P256_SIZE]) == false))
+    {
+        return false;
+    }
+
+    (void)memset(PUKCC_RAM(0U), 0, PUKCC_CRYPTO_RAM_SIZE);
+
+    PUKCC_NumberLoad(PUKCC_MOD_OFFSET, pukcc_p256_p);
+    PUKCC_NumberLoad(PUKCC_ORDER_OFFSET, pukcc_p256_n);
+    PUKCC_NumberLoad(PUKCC_A_OFFSET, pukcc_p256_a);
+    PUKCC_NumberLoad(PUKCC_HASH_OFFSET, digest);
+    PUKCC_NumberLoad(PUKCC_SIGNATURE_OFFSET, &signature[0]);
+    PUKCC_NumberLoad(PUKCC_SIGNATURE_OFFSET + PUKCC_NUMBER_SIZE, &signature[PUKCC_P256_SIZE]);
+    PUKCC_PointLoad(PUKCC_POINT_A_OFFSET, pukcc_p256_g);
+    PUKCC_PointLoad(PUKCC_PUBLIC_KEY_OFFSET, public_key);
+
+    /* Reduction constant of the modulus */
+    (void)memset(pvPUKCLParam, 0, sizeof(PUKCL_PARAM));
+
+    PUKCL(u2Option)                 = PUKCL_REDMOD_SETUP;
+    PUKCL_RedMod(u2ModLength)       = PUKCC_P256_SIZE;
+    PUKCL_RedMod(nu1ModBase)        = PUKCC_NU1(PUKCC_MOD_OFFSET);
+    PUKCL_RedMod(nu1CnsBase)        = PUKCC_NU1(PUKCC_CNS_OFFSET);
+    PUKCL_RedMod(nu1RBase)          = PUKCC_NU1(PUKCC_REDMOD_R_OFFSET);
+    PUKCL_RedMod(nu1XBase)          = PUKCC_NU1(PUKCC_REDMOD_X_OFFSET);
+
+    vPUKCL_Process(RedMod, pvPUKCLParam);
+
+    if (PUKCL(u2Status) != PUKCL_OK)
+    {
+        return false;
+    }
+
+    (void)memset(pvPUKCLParam, 0, sizeof(PUKCL_PARAM));
+
+    PUKCL_ZpEcDsaVerify(u2ModLength)            = PUKCC_P256_SIZE;
+    PUKCL_ZpEcDsaVerify(u2ScalarLength)         = PUKCC_P256_SIZE;
+    PUKCL_ZpEcDsaVerify(nu1ModBase)             = PUKCC_NU1(PUKCC_MOD_OFFSET);
+    PUKCL_ZpEcDsaVerify(nu1CnsBase)             = PUKCC_NU1(PUKCC_CNS_OFFSET);
+    PUKCL_ZpEcDsaVerify(nu1OrderPointBase)      = PUKCC_NU1(PUKCC_ORDER_OFFSET);
+    PUKCL_ZpEcDsaVerify(nu1PointSignature)      = PUKCC_NU1(PUKCC_SIGNATURE_OFFSET);
+    PUKCL_ZpEcDsaVerify(nu1HashBase)            = PUKCC_NU1(PUKCC_HASH_OFFSET);
+    PUKCL_ZpEcDsaVerify(nu1PointABase)          = PUKCC_NU1(PUKCC_POINT_A_OFFSET);
+    PUKCL_ZpEcDsaVerify(nu1PointPublicKeyGen)   = PUKCC_NU1(PUKCC_PUBLIC_KEY_OFFSET);
+    PUKCL_ZpEcDsaVerify(nu1AWorkSpace)          = PUKCC_NU1(PUKCC_A_OFFSET);
+    PUKCL_ZpEcDsaVerify(nu1Workspace)           = PUKCC_NU1(PUKCC_WORKSPACE_OFFSET);
+
+    vPUKCL_Process(ZpEcDsaVerifyFast, pvPUKCLParam);
+
+    return (PUKCL(u2Status) == PUKCL_OK);
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*******************************************************************************
+  Public Key Cryptography Controller (PUKCC) Peripheral Library Interface Header File
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_pukcc.h
+
+  Summary
+    PUKCC peripheral library interface, ECDSA P-256 signature verification.
+
+  Description
+    This file defines a polled interface verifying ECDSA signatures on the
+    NIST P-256 curve with the PUKCC. All numbers are passed as big endian
+    byte strings, the way signing tools write them: a digest, r followed by
+    s, and the public key X followed by Y.
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef PLIB_PUKCC_H    // Guards against multiple inclusion
+#define PLIB_PUKCC_H
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// DOM-IGNORE-BEGIN
+#ifdef __cplusplus // Provide C++ Compatibility
+
+    extern "C" {
+
+#endif
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Data Types
+// *****************************************************************************
+// *****************************************************************************
+
+/* Size of a P-256 number, of the digest it signs, in bytes */
+#define PUKCC_P256_SIZE             32U
+
+/* r and s, X and Y */
+#define PUKCC_P256_SIGNATURE_SIZE   (2U * PUKCC_P256_SIZE)
+#define PUKCC_P256_PUBLIC_KEY_SIZE  (2U * PUKCC_P256_SIZE)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Interface Routines
+// *****************************************************************************
+// *****************************************************************************
+
+/* Waits for the PUKCC to finish clearing its RAM after reset */
+void PUKCC_Initialize( void );
+
+/* Returns true only if signature is a valid signature of digest for
+ * public_key. The public key is trusted to be a point of the curve. */
+bool PUKCC_EcdsaP256Verify( const uint8_t *digest, const uint8_t *signature, const uint8_t *public_key );
+
+// DOM-IGNORE-BEGIN
+#ifdef __cplusplus // Provide C++ Compatibility
+
+    }
+
+#endif
+// DOM-IGNORE-END
+
+#endif // PLIB_PUKCC_H
@@ -0,0 +1,252 @@
+/*******************************************************************************
+  Quad Serial Peripheral Interface (QSPI) Peripheral Library Source File
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_qspi.c
+
+  Summary
+    QSPI peripheral library implementation.
+
+  Description
+    Serial NOR flash on PA08..PA11 (DATA0..DATA3), PB10 (SCK) and PB11 (CS),
+    the same pins SDHC0 uses. SCK is MCLK / 3: 16 MHz while the bootloader
+    still runs from the 48 MHz reset clock, 40 MHz at 120 MHz. The memory
+    map uses the quad output fast read (6Bh), which every common quad NOR
+    supports; the quad enable bit of parts which need it is expected to be
+    set non-volatile by whoever wrote the flash. Code executing in place
+    gets the quad I/O fast read (EBh) in continuous read mode instead, which
+    saves the instruction and part of the address time on every cache line
+    fill. Everything is polled, no interrupt line is enabled.
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#include "device.h"
+#include "configuration.h"
+#include "plib_qspi.h"
+
+#if (BTL_QSPI_STAGING == 1) || (BTL_QSPI_XIP == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Data Types
+// *****************************************************************************
+// *****************************************************************************
+
+/* SCK = MCLK / (divider + 1) */
+#define QSPI_BAUD_DIVIDER           2U
+
+/* Serial flash instructions */
+#define QSPI_CMD_WRITE_ENABLE       0x06U
+#define QSPI_CMD_PAGE_PROGRAM       0x02U
+#define QSPI_CMD_READ_STATUS        0x05U
+#define QSPI_CMD_QUAD_OUTPUT_READ   0x6BU
+#define QSPI_CMD_QUAD_IO_READ       0xEBU
+#define QSPI_CMD_MODE_RESET         0xFFU
+
+#define QSPI_READ_DUMMY_CYCLES      8U
+
+/* Write in progress bit of the status register */
+#define QSPI_STATUS_WIP             0x01U
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: QSPI Implementation
+// *****************************************************************************
+// *****************************************************************************
+
+static void QSPI_FrameSet(uint8_t instruction, uint32_t frame)
+{
+    QSPI_REGS->QSPI_INSTRCTRL  = QSPI_INSTRCTRL_INSTR(instruction);
+    QSPI_REGS->QSPI_INSTRFRAME = frame | QSPI_INSTRFRAME_INSTREN_Msk;
+
+    /* Synchronizes the APB write with the AHB accesses that follow */
+    (void)QSPI_REGS->QSPI_INSTRFRAME;
+}
+
+/* Raises the chip select after the data phase of an instruction */
+static void QSPI_TransferEnd(void)
+{
+    __DSB();
+    __ISB();
+
+    QSPI_REGS->QSPI_CTRLA = QSPI_CTRLA_ENABLE_Msk | QSPI_CTRLA_LASTXFER_Msk;
+
+    while ((QSPI_REGS->QSPI_INTFLAG & QSPI_INTFLAG_INSTREND_Msk) == 0U)
+    {
+        /* Wait for the instruction to end */
+    }
+
+    QSPI_REGS->QSPI_INTFLAG = QSPI_INTFLAG_INSTREND_Msk;
+}
+
+/* Instructions without data end on their own */
+static void QSPI_CommandWrite(uint8_t instruction)
+{
+    QSPI_FrameSet(instruction, QSPI_INSTRFRAME_WIDTH_SINGLE_BIT_SPI);
+
+    while ((QSPI_REGS->QSPI_INTFLAG & QSPI_INTFLAG_INSTREND_Msk) == 0U)
+    {
+        /* Wait for the instruction to end */
+    }
+
+    QSPI_REGS->QSPI_INTFLAG = QSPI_INTFLAG_INSTREND_Msk;
+}
+
+/* A mapped read leaves the chip select low for a sequential read */
+static void QSPI_MemoryUnmap(void)
+{
+    if ((QSPI_REGS->QSPI_STATUS & QSPI_STATUS_CSSTATUS_Msk) == 0U)
+    {
+        QSPI_TransferEnd();
+    }
+}
+
+/* A flash left in continuous read mode, by an application reset while it
+ * executed in place, takes the next clocks as address and mode bits. Eight
+ * clocks with all data lines high end that mode; any other flash sees an
+ * undefined instruction it ignores. */
+static void QSPI_ContinuousReadReset(void)
+{
+    QSPI_REGS->QSPI_INSTRADDR = QSPI_INSTRADDR_ADDR(0xFFFFFFU);
+
+    QSPI_FrameSet(QSPI_CMD_MODE_RESET, QSPI_INSTRFRAME_WIDTH_QUAD_CMD | QSPI_INSTRFRAME_ADDREN_Msk);
+
+    while ((QSPI_REGS->QSPI_INTFLAG & QSPI_INTFLAG_INSTREND_Msk) == 0U)
+    {
+        /* Wait for the instruction to end */
+    }
+
+    QSPI_REGS->QSPI_INTFLAG = QSPI_INTFLAG_INSTREND_Msk;
+}
+
+static uint8_t QSPI_StatusRead(void)
+{
+    const volatile uint8_t *window = (const volatile uint8_t *)QSPI_ADDR;
+    uint8_t status;
+
+    QSPI_FrameSet(QSPI_CMD_READ_STATUS, QSPI_INSTRFRAME_WIDTH_SINGLE_BIT_SPI |
+                  QSPI_INSTRFRAME_DATAEN_Msk | QSPI_INSTRFRAME_TFRTYPE_READ);
+
+    status = window[0];
+
+    QSPI_TransferEnd();
+
+    return status;
+}
+
+void QSPI_Initialize( void )
+{
+    /* On from reset, this may run before or after CLOCK_Initialize */
+    MCLK_REGS->MCLK_AHBMASK |= MCLK_AHBMASK_QSPI_Msk;
+    MCLK_REGS->MCLK_APBCMASK |= MCLK_APBCMASK_QSPI_Msk;
+
+    QSPI_REGS->QSPI_CTRLA = QSPI_CTRLA_SWRST_Msk;
+
+    /* The chip select stays low while mapped reads are sequential */
+    QSPI_REGS->QSPI_CTRLB = QSPI_CTRLB_MODE_MEMORY | QSPI_CTRLB_CSMODE_LASTXFER | QSPI_CTRLB_DATALEN_8BITS;
+
+    QSPI_REGS->QSPI_BAUD  = QSPI_BAUD_BAUD(QSPI_BAUD_DIVIDER);
+
+    QSPI_REGS->QSPI_CTRLA = QSPI_CTRLA_ENABLE_Msk;
+
+    QSPI_ContinuousReadReset();
+}
+
+void QSPI_Deinitialize( void )
+{
+    QSPI_MemoryUnmap();
+
+    QSPI_REGS->QSPI_CTRLA = QSPI_CTRLA_SWRST_Msk;
+}
+
+const uint8_t *QSPI_MemoryMap( void )
+{
+    QSPI_FrameSet(QSPI_CMD_QUAD_OUTPUT_READ, QSPI_INSTRFRAME_WIDTH_QUAD_OUTPUT |
+                  QSPI_INSTRFRAME_ADDREN_Msk | QSPI_INSTRFRAME_DATAEN_Msk |
+                  QSPI_INSTRFRAME_TFRTYPE_READMEMORY | QSPI_INSTRFRAME_DUMMYLEN(QSPI_READ_DUMMY_CYCLES));
+
+    return (const uint8_t *)QSPI_ADDR;
+}
+
+const uint8_t *QSPI_XipMemoryMap( uint8_t mode_bits, uint8_t dummy_cycles )
+{
+    QSPI_MemoryUnmap();
+
+    /* Only the first read sends the instruction, the mode bits keep the
+     * flash expecting another address */
+    QSPI_REGS->QSPI_INSTRCTRL  = QSPI_INSTRCTRL_INSTR(QSPI_CMD_QUAD_IO_READ) | QSPI_INSTRCTRL_OPTCODE(mode_bits);
+    QSPI_REGS->QSPI_INSTRFRAME = QSPI_INSTRFRAME_WIDTH_QUAD_IO | QSPI_INSTRFRAME_INSTREN_Msk |
+                                 QSPI_INSTRFRAME_ADDREN_Msk | QSPI_INSTRFRAME_OPTCODEEN_Msk |
+                                 QSPI_INSTRFRAME_OPTCODELEN_8BITS | QSPI_INSTRFRAME_DATAEN_Msk |
+                                 QSPI_INSTRFRAME_TFRTYPE_READMEMORY | QSPI_INSTRFRAME_CRMODE_Msk |
+                                 QSPI_INSTRFRAME_DUMMYLEN(dummy_cycles);
+
+    (void)QSPI_REGS->QSPI_INSTRFRAME;
+
+    return (const uint8_t *)QSPI_ADDR;
+}
+
+bool QSPI_PageProgram( uint32_t address, const uint8_t *data, size_t size )
+{
+    volatile uint8_t *window = (volatile uint8_t *)(QSPI_ADDR + address);
+    size_t i;
+
+    if ((size == 0U) || (address >= QSPI_SIZE) || (((address % QSPI_PAGE_SIZE) + size) > QSPI_PAGE_SIZE))
+    {
+        return false;
+    }
+
+    QSPI_MemoryUnmap();
+
+    QSPI_CommandWrite(QSPI_CMD_WRITE_ENABLE);
+
+    QSPI_FrameSet(QSPI_CMD_PAGE_PROGRAM, QSPI_INSTRFRAME_WIDTH_SINGLE_BIT_SPI |
+                  QSPI_INSTRFRAME_ADDREN_Msk | QSPI_INSTRFRAME_DATAEN_Msk |
+                  QSPI_INSTRFRAME_TFRTYPE_WRITEMEMORY);
+
+    for (i = 0; i < size; i++)
+    {
+        window[i] = data[i];
+    }
+
+    QSPI_TransferEnd();
+
+    while ((QSPI_StatusRead() & QSPI_STATUS_WIP) != 0U)
+    {
+        /* Wait for the page to be programmed */
+    }
+
+    QSPI_MemoryMap();
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*******************************************************************************
+  Quad Serial Peripheral Interface (QSPI) Peripheral Library Interface Header File
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_qspi.h
+
+  Summary
+    QSPI peripheral library interface, serial NOR flash in memory mode.
+
+  Description
+    This file defines a small polled interface to a serial NOR flash on the
+    QSPI. Once mapped, the flash is read through the AHB window at QSPI_ADDR
+    like internal memory, the controller issuing quad output fast reads on
+    its own, or quad I/O reads in continuous read mode for code executing
+    in place. Programming is limited to single pages. A host build can replace
+    this library with a file backed flash implementing the same calls.
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef PLIB_QSPI_H    // Guards against multiple inclusion
+#define PLIB_QSPI_H
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// DOM-IGNORE-BEGIN
+#ifdef __cplusplus // Provide C++ Compatibility
+
+    extern "C" {
+
+#endif
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Data Types
+// *****************************************************************************
+// *****************************************************************************
+
+/* Largest single program operation, pages must not be crossed */
+#define QSPI_PAGE_SIZE              256U
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Interface Routines
+// *****************************************************************************
+// *****************************************************************************
+
+void QSPI_Initialize( void );
+
+/* Releases the flash and returns the controller to its reset state */
+void QSPI_Deinitialize( void );
+
+/* Sets the controller up for memory mapped reads and returns the start of
+ * the window the flash is seen through */
+const uint8_t *QSPI_MemoryMap( void );
+
+/* Maps the flash for execution in place with quad I/O fast reads (EBh) in
+ * continuous read mode. mode_bits follow the address and have to be the
+ * value keeping the flash in that mode, dummy_cycles the clocks after them.
+ * Nothing but mapped reads may be issued afterwards until QSPI_Initialize()
+ * takes the flash out of continuous read mode again. */
+const uint8_t *QSPI_XipMemoryMap( uint8_t mode_bits, uint8_t dummy_cycles );
+
+/* Programs size bytes at address within one page and waits for the flash
+ * to finish. Like any NOR write it can only clear bits. The memory map is
+ * restored afterwards. */
+bool QSPI_PageProgram( uint32_t address, const uint8_t *data, size_t size );
+
+// DOM-IGNORE-BEGIN
+#ifdef __cplusplus // Provide C++ Compatibility
+
+    }
+
+#endif
+// DOM-IGNORE-END
+
+#endif // PLIB_QSPI_H
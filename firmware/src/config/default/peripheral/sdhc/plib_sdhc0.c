@@ -0,0 +1,337 @@
+/*******************************************************************************
+  SD/MMC Host Controller (SDHC) Peripheral Library Source File
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_sdhc0.c
+
+  Summary
+    SDHC0 peripheral library implementation.
+
+  Description
+    SD card on PA08 (CMD), PA09..PA11 and PB10 (DAT0..DAT3) and PB11 (CK).
+    The card detect and write protect pins are not used. The generic clock
+    is GCLK3 (48 MHz): the card is identified at 400 kHz and read at 24 MHz
+    in default speed mode. Reads use single address SDMA; the SRAM never
+    crosses the 512 KB DMA boundary, so no boundary interrupt has to be
+    serviced. Everything is polled, no interrupt line is enabled.
+
+*******************************************************************************/
+
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#include "device.h"
+#include "configuration.h"
+#include "plib_sdhc0.h"
+
+#if (BTL_SDCARD == 1)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Data Types
+// *****************************************************************************
+// *****************************************************************************
+
+/* SDCLK = 48 MHz / (2 * divider) */
+#define SDHC0_DIV_IDENTIFICATION    60U
+#define SDHC0_DIV_TRANSFER          1U
+
+/* ACMD41 attempts, one per millisecond */
+#define SDHC0_INIT_RETRIES          1000U
+
+#define SDHC0_CYCLES_PER_MS         120000U
+
+/* Commands */
+#define SD_CMD0_GO_IDLE             0U
+#define SD_CMD2_ALL_SEND_CID        2U
+#define SD_CMD3_SEND_RELATIVE_ADDR  3U
+#define SD_CMD7_SELECT_CARD         7U
+#define SD_CMD8_SEND_IF_COND        8U
+#define SD_CMD16_SET_BLOCKLEN       16U
+#define SD_CMD17_READ_SINGLE        17U
+#define SD_CMD18_READ_MULTIPLE      18U
+#define SD_CMD55_APP_CMD            55U
+#define SD_ACMD6_SET_BUS_WIDTH      6U
+#define SD_ACMD41_SEND_OP_COND      41U
+
+#define SD_IF_COND_CHECK            0x1AAUL
+
+/* 3.2 - 3.4 V window and the host capacity support bit */
+#define SD_OCR_VOLTAGE              0x00300000UL
+#define SD_OCR_HCS                  0x40000000UL
+#define SD_OCR_BUSY                 0x80000000UL
+
+#define SD_BUS_WIDTH_4              2UL
+
+/* Command register settings of each response type */
+#define SDHC0_RESP_NONE             SDHC_CR_RESPTYP_NONE
+#define SDHC0_RESP_R1               (SDHC_CR_RESPTYP_48_BIT | SDHC_CR_CMDCCEN_Msk | SDHC_CR_CMDICEN_Msk)
+#define SDHC0_RESP_R1B              (SDHC_CR_RESPTYP_48_BIT_BUSY | SDHC_CR_CMDCCEN_Msk | SDHC_CR_CMDICEN_Msk)
+#define SDHC0_RESP_R2               (SDHC_CR_RESPTYP_136_BIT | SDHC_CR_CMDCCEN_Msk)
+#define SDHC0_RESP_R3               SDHC_CR_RESPTYP_48_BIT
+
+#define SDHC0_STATUS_ALL            0xFFFFU
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global objects
+// *****************************************************************************
+// *****************************************************************************
+
+static uint32_t sdhc0Rca            = 0;
+
+/* Standard capacity cards take byte addresses */
+static bool     sdhc0BlockAddress   = false;
+
+static bool     sdhc0Reading        = false;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: SDHC0 Implementation
+// *****************************************************************************
+// *****************************************************************************
+
+static void SDHC0_Delay(uint32_t ms)
+{
+    volatile uint32_t count = ms * (SDHC0_CYCLES_PER_MS / 4U);
+
+    while (count > 0U)
+    {
+        count--;
+    }
+}
+
+static void SDHC0_ClockSet(uint32_t divider)
+{
+    SDHC0_REGS->SDHC_CCR = 0;
+
+    SDHC0_REGS->SDHC_CCR = SDHC_CCR_SDCLKFSEL(divider & 0xFFU) | SDHC_CCR_USDCLKFSEL(divider >> 8) | SDHC_CCR_INTCLKEN_Msk;
+
+    while ((SDHC0_REGS->SDHC_CCR & SDHC_CCR_INTCLKS_Msk) == 0U)
+    {
+        /* Wait for the internal clock to be stable */
+    }
+
+    SDHC0_REGS->SDHC_CCR |= SDHC_CCR_SDCLKEN_Msk;
+}
+
+/* Sends a command without data and waits for its response */
+static bool SDHC0_CommandSend(uint8_t index, uint32_t argument, uint16_t response)
+{
+    uint16_t status;
+
+    while ((SDHC0_REGS->SDHC_PSR & (SDHC_PSR_CMDINHC_Msk | SDHC_PSR_CMDINHD_Msk)) != 0U)
+    {
+        /* Wait for the previous command and busy signalling to end */
+    }
+
+    SDHC0_REGS->SDHC_NISTR = SDHC0_STATUS_ALL;
+    SDHC0_REGS->SDHC_EISTR = SDHC0_STATUS_ALL;
+
+    SDHC0_REGS->SDHC_ARG1R = argument;
+    SDHC0_REGS->SDHC_CR    = SDHC_CR_CMDIDX(index) | response;
+
+    do
+    {
+        status = SDHC0_REGS->SDHC_NISTR;
+    } while ((status & (SDHC_NISTR_CMDC_Msk | SDHC_NISTR_ERRINT_Msk)) == 0U);
+
+    if ((status & SDHC_NISTR_ERRINT_Msk) != 0U)
+    {
+        SDHC0_REGS->SDHC_SRR = SDHC_SRR_SWRSTCMD_Msk;
+
+        while ((SDHC0_REGS->SDHC_SRR & SDHC_SRR_SWRSTCMD_Msk) != 0U)
+        {
+            /* Wait for the command line reset */
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+static bool SDHC0_AppCommandSend(uint8_t index, uint32_t argument, uint16_t response)
+{
+    return SDHC0_CommandSend(SD_CMD55_APP_CMD, sdhc0Rca << 16, SDHC0_RESP_R1) &&
+           SDHC0_CommandSend(index, argument, response);
+}
+
+bool SDHC0_CardInitialize( void )
+{
+    uint32_t ocr = SD_OCR_VOLTAGE;
+    uint32_t retries;
+
+    SDHC0_REGS->SDHC_SRR = SDHC_SRR_SWRSTALL_Msk;
+
+    while ((SDHC0_REGS->SDHC_SRR & SDHC_SRR_SWRSTALL_Msk) != 0U)
+    {
+        /* Wait for the controller reset */
+    }
+
+    sdhc0Rca            = 0;
+    sdhc0BlockAddress   = false;
+    sdhc0Reading        = false;
+
+    /* No card detect pin: report a card as always present */
+    SDHC0_REGS->SDHC_HC1R   = SDHC_HC1R_CARDDSEL_Msk | SDHC_HC1R_CARDDTL_Msk | SDHC_HC1R_DMASEL_SDMA;
+    SDHC0_REGS->SDHC_PCR    = SDHC_PCR_SDBVSEL_3V3 | SDHC_PCR_SDBPWR_Msk;
+    SDHC0_REGS->SDHC_TCR    = SDHC_TCR_DTCVAL(0xEU);
+    SDHC0_REGS->SDHC_NISTER = SDHC0_STATUS_ALL;
+    SDHC0_REGS->SDHC_EISTER = SDHC0_STATUS_ALL;
+
+    SDHC0_ClockSet(SDHC0_DIV_IDENTIFICATION);
+
+    /* Power ramp up and at least 74 clocks before the first command */
+    SDHC0_Delay(2U);
+
+    SDHC0_CommandSend(SD_CMD0_GO_IDLE, 0, SDHC0_RESP_NONE);
+
+    /* Version 2 cards echo the check pattern and may be high capacity */
+    if (SDHC0_CommandSend(SD_CMD8_SEND_IF_COND, SD_IF_COND_CHECK, SDHC0_RESP_R1) == true)
+    {
+        if ((SDHC0_REGS->SDHC_RR[0] & 0xFFFU) != SD_IF_COND_CHECK)
+        {
+            return false;
+        }
+
+        ocr |= SD_OCR_HCS;
+    }
+
+    for (retries = 0; retries < SDHC0_INIT_RETRIES; retries++)
+    {
+        if (SDHC0_AppCommandSend(SD_ACMD41_SEND_OP_COND, ocr, SDHC0_RESP_R3) == false)
+        {
+            return false;
+        }
+
+        if ((SDHC0_REGS->SDHC_RR[0] & SD_OCR_BUSY) != 0U)
+        {
+            break;
+        }
+
+        SDHC0_Delay(1U);
+    }
+
+    if (retries == SDHC0_INIT_RETRIES)
+    {
+        return false;
+    }
+
+    sdhc0BlockAddress = ((SDHC0_REGS->SDHC_RR[0] & SD_OCR_HCS) != 0U);
+
+    if ((SDHC0_CommandSend(SD_CMD2_ALL_SEND_CID, 0, SDHC0_RESP_R2) == false) ||
+        (SDHC0_CommandSend(SD_CMD3_SEND_RELATIVE_ADDR, 0, SDHC0_RESP_R1) == false))
+    {
+        return false;
+    }
+
+    sdhc0Rca = SDHC0_REGS->SDHC_RR[0] >> 16;
+
+    if ((SDHC0_CommandSend(SD_CMD7_SELECT_CARD, sdhc0Rca << 16, SDHC0_RESP_R1B) == false) ||
+        (SDHC0_AppCommandSend(SD_ACMD6_SET_BUS_WIDTH, SD_BUS_WIDTH_4, SDHC0_RESP_R1) == false) ||
+        (SDHC0_CommandSend(SD_CMD16_SET_BLOCKLEN, SDHC0_BLOCK_SIZE, SDHC0_RESP_R1) == false))
+    {
+        return false;
+    }
+
+    SDHC0_REGS->SDHC_HC1R |= SDHC_HC1R_DW_4BIT;
+
+    SDHC0_ClockSet(SDHC0_DIV_TRANSFER);
+
+    return true;
+}
+
+/* A multiple block read is ended by an automatic CMD12 */
+bool SDHC0_ReadStart( uint32_t lba, void *buffer, uint32_t blocks )
+{
+    uint16_t mode = SDHC_TMR_DMAEN_ENABLE | SDHC_TMR_DTDSEL_READ;
+    uint8_t command = SD_CMD17_READ_SINGLE;
+
+    if ((sdhc0Reading == true) || (blocks == 0U) || (blocks > SDHC0_MAX_BLOCKS) ||
+        ((SDHC0_REGS->SDHC_PSR & (SDHC_PSR_CMDINHC_Msk | SDHC_PSR_CMDINHD_Msk)) != 0U))
+    {
+        return false;
+    }
+
+    if (blocks > 1U)
+    {
+        mode   |= SDHC_TMR_BCEN_ENABLE | SDHC_TMR_MSBSEL_MULTIPLE | SDHC_TMR_ACMDEN_CMD12;
+        command = SD_CMD18_READ_MULTIPLE;
+    }
+
+    SDHC0_REGS->SDHC_NISTR = SDHC0_STATUS_ALL;
+    SDHC0_REGS->SDHC_EISTR = SDHC0_STATUS_ALL;
+
+    SDHC0_REGS->SDHC_SSAR  = (uint32_t)buffer;
+    SDHC0_REGS->SDHC_BSR   = SDHC_BSR_BLOCKSIZE(SDHC0_BLOCK_SIZE) | SDHC_BSR_BOUNDARY_512K;
+    SDHC0_REGS->SDHC_BCR   = (uint16_t)blocks;
+    SDHC0_REGS->SDHC_ARG1R = (sdhc0BlockAddress == true) ? lba : (lba * SDHC0_BLOCK_SIZE);
+    SDHC0_REGS->SDHC_TMR   = mode;
+    SDHC0_REGS->SDHC_CR    = SDHC_CR_CMDIDX(command) | SDHC0_RESP_R1 | SDHC_CR_DPSEL_Msk;
+
+    sdhc0Reading = true;
+
+    return true;
+}
+
+SDHC0_XFER_STATUS SDHC0_ReadStatusGet( void )
+{
+    uint16_t status = SDHC0_REGS->SDHC_NISTR;
+
+    if (sdhc0Reading == false)
+    {
+        return SDHC0_XFER_DONE;
+    }
+
+    if ((status & SDHC_NISTR_ERRINT_Msk) != 0U)
+    {
+        SDHC0_REGS->SDHC_SRR = SDHC_SRR_SWRSTCMD_Msk | SDHC_SRR_SWRSTDAT_Msk;
+
+        while ((SDHC0_REGS->SDHC_SRR & (SDHC_SRR_SWRSTCMD_Msk | SDHC_SRR_SWRSTDAT_Msk)) != 0U)
+        {
+            /* Wait for the command and data line reset */
+        }
+
+        sdhc0Reading = false;
+
+        return SDHC0_XFER_ERROR;
+    }
+
+    if ((status & SDHC_NISTR_TRFC_Msk) == 0U)
+    {
+        return SDHC0_XFER_BUSY;
+    }
+
+    sdhc0Reading = false;
+
+    return SDHC0_XFER_DONE;
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*******************************************************************************
+  SD/MMC Host Controller (SDHC) Peripheral Library Interface Header File
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_sdhc0.h
+
+  Summary
+    SDHC0 peripheral library interface, SD card reads in 4 bit mode.
+
+  Description
+    This file defines a small polled interface to an SD card on SDHC0. The
+    card is brought up in 4 bit mode and read in 512 byte blocks; a read
+    runs in the background through the controller's SDMA engine so the CPU
+    can do other work until it completes. A host build can replace this
+    library with a disk image backend implementing the same calls.
+
+*******************************************************************************/
+
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef PLIB_SDHC0_H    // Guards against multiple inclusion
+#define PLIB_SDHC0_H
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// DOM-IGNORE-BEGIN
+#ifdef __cplusplus // Provide C++ Compatibility
+
+    extern "C" {
+
+#endif
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Data Types
+// *****************************************************************************
+// *****************************************************************************
+
+#define SDHC0_BLOCK_SIZE            512U
+
+/* Most blocks one read can transfer */
+#define SDHC0_MAX_BLOCKS            0xFFFFU
+
+typedef enum
+{
+    SDHC0_XFER_BUSY,
+
+    SDHC0_XFER_DONE,
+
+    SDHC0_XFER_ERROR,
+
+} SDHC0_XFER_STATUS;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Interface Routines
+// *****************************************************************************
+// *****************************************************************************
+
+/* Identifies the card and switches it to 4 bit transfers. Returns false if
+ * no usable card answers. */
+bool SDHC0_CardInitialize( void );
+
+/* Starts reading blocks consecutive 512 byte blocks from lba into buffer,
+ * which must be word aligned. Returns false if the controller is busy. */
+bool SDHC0_ReadStart( uint32_t lba, void *buffer, uint32_t blocks );
+
+SDHC0_XFER_STATUS SDHC0_ReadStatusGet( void );
+
+// DOM-IGNORE-BEGIN
+#ifdef __cplusplus // Provide C++ Compatibility
+
+    }
+
+#endif
+// DOM-IGNORE-END
+
+#endif // PLIB_SDHC0_H
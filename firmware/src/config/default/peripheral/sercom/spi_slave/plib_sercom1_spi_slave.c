@@ -0,0 +1,128 @@
+/*******************************************************************************
+  SERIAL COMMUNICATION SERIAL PERIPHERAL INTERFACE(SERCOM1_SPI) PLIB
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_sercom1_spi_slave.c
+
+  Summary
+    SERCOM1_SPI Slave PLIB Implementation File.
+
+  Description
+    This file defines the interface to the SERCOM SPI slave peripheral
+    library. Pads: PA16 MOSI (PAD0), PA17 SCK (PAD1), PA18 SS (PAD2) and
+    PA19 MISO (PAD3), SPI mode 0, MSB first.
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#include "plib_sercom1_spi_slave.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: SERCOM1 SPI Slave Implementation
+// *****************************************************************************
+// *****************************************************************************
+
+void SERCOM1_SPI_Initialize( void )
+{
+    /*
+     * Configures the slave mode
+     * Configures DOPO (MISO on PAD3, SCK on PAD1, SS on PAD2)
+     * Configures DIPO (MOSI on PAD0)
+     * Configures SPI mode 0, MSB first
+     */
+    SERCOM1_REGS->SPIS.SERCOM_CTRLA = SERCOM_SPIS_CTRLA_MODE_SPI_SLAVE | SERCOM_SPIS_CTRLA_DOPO(0x2UL) | SERCOM_SPIS_CTRLA_DIPO(0x0UL) | SERCOM_SPIS_CTRLA_FORM(0x0UL);
+
+    /*
+     * Configures the character size
+     * Enables the receiver
+     * Enables data preload so the first byte is ready when SS goes low
+     */
+    SERCOM1_REGS->SPIS.SERCOM_CTRLB = SERCOM_SPIS_CTRLB_CHSIZE_8_BIT | SERCOM_SPIS_CTRLB_RXEN_Msk | SERCOM_SPIS_CTRLB_PLOADEN_Msk;
+
+    /* Wait for synchronization */
+    while((SERCOM1_REGS->SPIS.SERCOM_SYNCBUSY) != 0U)
+    {
+        /* Do nothing */
+    }
+
+    /* Enable SERCOM1 SPI */
+    SERCOM1_REGS->SPIS.SERCOM_CTRLA |= SERCOM_SPIS_CTRLA_ENABLE_Msk;
+
+    /* Wait for synchronization */
+    while((SERCOM1_REGS->SPIS.SERCOM_SYNCBUSY) != 0U)
+    {
+        /* Do nothing */
+    }
+}
+
+/* Address the DMAC reads received bytes from and writes bytes to send to */
+volatile void *SERCOM1_SPI_DataAddressGet( void )
+{
+    return (volatile void *)&SERCOM1_REGS->SPIS.SERCOM_DATA;
+}
+
+/* In slave mode TXC is set when the master releases SS. Returns true once per
+ * transaction and clears the flag. */
+bool SERCOM1_SPI_TransactionIsComplete( void )
+{
+    if ((SERCOM1_REGS->SPIS.SERCOM_INTFLAG & (uint8_t)SERCOM_SPIS_INTFLAG_TXC_Msk) != 0U)
+    {
+        SERCOM1_REGS->SPIS.SERCOM_INTFLAG = (uint8_t)SERCOM_SPIS_INTFLAG_TXC_Msk;
+
+        return true;
+    }
+
+    return false;
+}
+
+/* Drops stale received bytes and clears an overflow, so a DMA transfer armed
+ * afterwards starts with the first byte of the next transaction. */
+void SERCOM1_SPI_ReceiverFlush( void )
+{
+    uint32_t dummyData = 0U;
+
+    while((SERCOM1_REGS->SPIS.SERCOM_INTFLAG & (uint8_t)SERCOM_SPIS_INTFLAG_RXC_Msk) != 0U)
+    {
+        dummyData = SERCOM1_REGS->SPIS.SERCOM_DATA;
+    }
+
+    SERCOM1_REGS->SPIS.SERCOM_STATUS = (uint16_t)SERCOM_SPIS_STATUS_BUFOVF_Msk;
+    SERCOM1_REGS->SPIS.SERCOM_INTFLAG = (uint8_t)(SERCOM_SPIS_INTFLAG_ERROR_Msk | SERCOM_SPIS_INTFLAG_SSL_Msk);
+
+    /* Ignore the warning */
+    (void)dummyData;
+}
+
+/* Byte shifted out first in the next transaction when no DMA feeds DATA */
+void SERCOM1_SPI_Preload( uint8_t data )
+{
+    SERCOM1_REGS->SPIS.SERCOM_DATA = data;
+}
@@ -0,0 +1,73 @@
+/*******************************************************************************
+  Interface definition of TC0 PLIB.
+
+  Company:
+    Microchip Technology Inc.
+
+  File Name:
+    plib_tc0.h
+
+  Summary:
+    Interface definition of the Timer Counter Plib (TC0).
+
+  Description:
+    This file defines the interface for the TC0 Plib. TC0 and TC1 run as
+    one free running 32-bit counter clocked by GCLK1 (60 MHz) divided by 64.
+*******************************************************************************/
+
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+
+#ifndef PLIB_TC0_H    // Guards against multiple inclusion
+#define PLIB_TC0_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus // Provide C++ Compatibility
+    extern "C" {
+#endif
+
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Interface
+// *****************************************************************************
+// *****************************************************************************
+
+#define TC0_FREQ   937500U
+
+
+/***************************** TC0 API *******************************/
+void TC0_TimerInitialize ( void );
+void TC0_TimerStart ( void );
+void TC0_TimerStop ( void );
+uint32_t TC0_Timer32bitCounterGet ( void );
+uint32_t TC0_TimerFrequencyGet ( void );
+
+#ifdef __cplusplus // Provide C++ Compatibility
+ }
+#endif
+
+#endif
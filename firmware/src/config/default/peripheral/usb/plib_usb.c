@@ -0,0 +1,349 @@
+/*******************************************************************************
+  Universal Serial Bus (USB) Device PLIB
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_usb.c
+
+  Summary
+    USB full speed device, control and bulk endpoint implementation.
+
+  Description
+    Polled endpoint 0 handling on top of the USB device endpoint descriptor
+    table. Bank 0 of endpoint 0 receives SETUP and OUT packets, bank 1
+    sends IN packets. An OUT bank that has not been read keeps BK0RDY set,
+    so the host is NAKed until the class driver is ready for more data.
+    Bulk transfers use the multi-packet mode of the descriptor table, a
+    whole transfer is moved without CPU help between packets.
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#include <string.h>
+#include "device.h"
+#include "plib_usb.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Global Data
+// *****************************************************************************
+// *****************************************************************************
+
+/* Endpoint types in EPCFG */
+#define USB_EPTYPE_CONTROL          0x1U
+#define USB_EPTYPE_BULK             0x3U
+
+/* Endpoint 0 plus one bulk endpoint pair */
+#define USB_DEVICE_ENDPOINTS        2U
+
+/* PCKSIZE.SIZE encoding of 64 byte packets */
+#define USB_PCKSIZE_64_BYTES        0x3U
+
+/* Pad calibration defaults, used when the software calibration row is blank */
+#define USB_PADCAL_TRANSN_DEFAULT   9U
+#define USB_PADCAL_TRANSP_DEFAULT   25U
+#define USB_PADCAL_TRIM_DEFAULT     6U
+
+static usb_descriptor_device_registers_t usb_endpoint_table[USB_DEVICE_ENDPOINTS]  __ALIGNED(4);
+
+static uint8_t usb_ep0_out[USB_DEVICE_EP0_SIZE]                 __ALIGNED(4);
+static uint8_t usb_ep0_in[USB_DEVICE_EP0_SIZE]                  __ALIGNED(4);
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: USB Device Interface Routines
+// *****************************************************************************
+// *****************************************************************************
+
+static void USB_DEVICE_EndpointZeroConfigure( void )
+{
+    usb_endpoint_table[0].DEVICE_DESC_BANK[0].USB_ADDR      = (uint32_t)usb_ep0_out;
+    usb_endpoint_table[0].DEVICE_DESC_BANK[0].USB_PCKSIZE   = USB_DEVICE_PCKSIZE_SIZE(USB_PCKSIZE_64_BYTES) | USB_DEVICE_PCKSIZE_MULTI_PACKET_SIZE(USB_DEVICE_EP0_SIZE);
+    usb_endpoint_table[0].DEVICE_DESC_BANK[1].USB_ADDR      = (uint32_t)usb_ep0_in;
+    usb_endpoint_table[0].DEVICE_DESC_BANK[1].USB_PCKSIZE   = USB_DEVICE_PCKSIZE_SIZE(USB_PCKSIZE_64_BYTES);
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPCFG = (uint8_t)(USB_DEVICE_EPCFG_EPTYPE0(USB_EPTYPE_CONTROL) | USB_DEVICE_EPCFG_EPTYPE1(USB_EPTYPE_CONTROL));
+
+    /* OUT bank empty and ready to receive, nothing to send on the IN bank */
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPSTATUSCLR = (uint8_t)(USB_DEVICE_EPSTATUSCLR_BK0RDY_Msk | USB_DEVICE_EPSTATUSCLR_STALLRQ_Msk);
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPSTATUSCLR = (uint8_t)USB_DEVICE_EPSTATUSCLR_BK1RDY_Msk;
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPINTFLAG = (uint8_t)(USB_DEVICE_EPINTFLAG_TRCPT_Msk | USB_DEVICE_EPINTFLAG_RXSTP_Msk | USB_DEVICE_EPINTFLAG_STALL_Msk);
+}
+
+void USB_DEVICE_Initialize( void )
+{
+    uint32_t calibration = *((uint32_t *)(SW0_ADDR + 4U));
+    uint32_t transn = (calibration & FUSES_SW0_WORD_1_USB_TRANSN_Msk) >> FUSES_SW0_WORD_1_USB_TRANSN_Pos;
+    uint32_t transp = (calibration & FUSES_SW0_WORD_1_USB_TRANSP_Msk) >> FUSES_SW0_WORD_1_USB_TRANSP_Pos;
+    uint32_t trim   = (calibration & FUSES_SW0_WORD_1_USB_TRIM_Msk) >> FUSES_SW0_WORD_1_USB_TRIM_Pos;
+
+    USB_REGS->DEVICE.USB_CTRLA = USB_CTRLA_SWRST_Msk;
+
+    while((USB_REGS->DEVICE.USB_SYNCBUSY & USB_SYNCBUSY_SWRST_Msk) != 0U)
+    {
+        /* Wait for synchronization */
+    }
+
+    if (transn == 0x1FU)
+    {
+        transn = USB_PADCAL_TRANSN_DEFAULT;
+    }
+
+    if (transp == 0x1FU)
+    {
+        transp = USB_PADCAL_TRANSP_DEFAULT;
+    }
+
+    if (trim == 0x7U)
+    {
+        trim = USB_PADCAL_TRIM_DEFAULT;
+    }
+
+    USB_REGS->DEVICE.USB_PADCAL = (uint16_t)(USB_PADCAL_TRANSN(transn) | USB_PADCAL_TRANSP(transp) | USB_PADCAL_TRIM(trim));
+
+    memset(usb_endpoint_table, 0, sizeof(usb_endpoint_table));
+
+    USB_REGS->DEVICE.USB_DESCADD = (uint32_t)usb_endpoint_table;
+
+    USB_REGS->DEVICE.USB_CTRLA = (uint8_t)(USB_CTRLA_MODE_DEVICE | USB_CTRLA_ENABLE_Msk);
+
+    while((USB_REGS->DEVICE.USB_SYNCBUSY & USB_SYNCBUSY_ENABLE_Msk) != 0U)
+    {
+        /* Wait for synchronization */
+    }
+
+    /* Full speed, attach to the bus */
+    USB_REGS->DEVICE.USB_CTRLB = (uint16_t)USB_DEVICE_CTRLB_SPDCONF_FS;
+}
+
+/* A bus reset puts the device back to address 0 with only endpoint 0 */
+bool USB_DEVICE_ResetIsDetected( void )
+{
+    if ((USB_REGS->DEVICE.USB_INTFLAG & USB_DEVICE_INTFLAG_EORST_Msk) == 0U)
+    {
+        return false;
+    }
+
+    USB_REGS->DEVICE.USB_INTFLAG = (uint16_t)USB_DEVICE_INTFLAG_EORST_Msk;
+
+    USB_REGS->DEVICE.USB_DADD = 0U;
+
+    USB_DEVICE_EndpointZeroConfigure();
+
+    return true;
+}
+
+/* A SETUP packet aborts any control transfer in progress, including a stall */
+bool USB_DEVICE_SetupRead( USB_SETUP_PACKET *setup )
+{
+    if ((USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPINTFLAG & USB_DEVICE_EPINTFLAG_RXSTP_Msk) == 0U)
+    {
+        return false;
+    }
+
+    setup->bmRequestType    = usb_ep0_out[0];
+    setup->bRequest         = usb_ep0_out[1];
+    setup->wValue           = (uint16_t)(usb_ep0_out[2] | (usb_ep0_out[3] << 8));
+    setup->wIndex           = (uint16_t)(usb_ep0_out[4] | (usb_ep0_out[5] << 8));
+    setup->wLength          = (uint16_t)(usb_ep0_out[6] | (usb_ep0_out[7] << 8));
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPINTFLAG = (uint8_t)(USB_DEVICE_EPINTFLAG_RXSTP_Msk | USB_DEVICE_EPINTFLAG_TRCPT_Msk);
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPSTATUSCLR = (uint8_t)(USB_DEVICE_EPSTATUSCLR_STALLRQ_Msk | USB_DEVICE_EPSTATUSCLR_BK1RDY_Msk);
+
+    /* Free the OUT bank for a data or status stage */
+    usb_endpoint_table[0].DEVICE_DESC_BANK[0].USB_PCKSIZE = USB_DEVICE_PCKSIZE_SIZE(USB_PCKSIZE_64_BYTES) | USB_DEVICE_PCKSIZE_MULTI_PACKET_SIZE(USB_DEVICE_EP0_SIZE);
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPSTATUSCLR = (uint8_t)USB_DEVICE_EPSTATUSCLR_BK0RDY_Msk;
+
+    return true;
+}
+
+bool USB_DEVICE_ControlOutIsReady( void )
+{
+    return ((USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPINTFLAG & USB_DEVICE_EPINTFLAG_TRCPT0_Msk) != 0U);
+}
+
+/* Copies one received OUT packet and releases the bank for the next one */
+size_t USB_DEVICE_ControlRead( uint8_t *buffer, size_t size )
+{
+    size_t count = (usb_endpoint_table[0].DEVICE_DESC_BANK[0].USB_PCKSIZE & USB_DEVICE_PCKSIZE_BYTE_COUNT_Msk) >> USB_DEVICE_PCKSIZE_BYTE_COUNT_Pos;
+
+    if (count > size)
+    {
+        count = size;
+    }
+
+    memcpy(buffer, usb_ep0_out, count);
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPINTFLAG = (uint8_t)USB_DEVICE_EPINTFLAG_TRCPT0_Msk;
+
+    usb_endpoint_table[0].DEVICE_DESC_BANK[0].USB_PCKSIZE = USB_DEVICE_PCKSIZE_SIZE(USB_PCKSIZE_64_BYTES) | USB_DEVICE_PCKSIZE_MULTI_PACKET_SIZE(USB_DEVICE_EP0_SIZE);
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPSTATUSCLR = (uint8_t)USB_DEVICE_EPSTATUSCLR_BK0RDY_Msk;
+
+    return count;
+}
+
+/* Queues one IN packet, a zero length packet completes a status stage */
+void USB_DEVICE_ControlWrite( const uint8_t *buffer, size_t size )
+{
+    if (size > USB_DEVICE_EP0_SIZE)
+    {
+        size = USB_DEVICE_EP0_SIZE;
+    }
+
+    if (size > 0U)
+    {
+        memcpy(usb_ep0_in, buffer, size);
+    }
+
+    usb_endpoint_table[0].DEVICE_DESC_BANK[1].USB_PCKSIZE = USB_DEVICE_PCKSIZE_SIZE(USB_PCKSIZE_64_BYTES) | USB_DEVICE_PCKSIZE_BYTE_COUNT(size);
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPINTFLAG = (uint8_t)USB_DEVICE_EPINTFLAG_TRCPT1_Msk;
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPSTATUSSET = (uint8_t)USB_DEVICE_EPSTATUSSET_BK1RDY_Msk;
+}
+
+bool USB_DEVICE_ControlInIsComplete( void )
+{
+    if ((USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPINTFLAG & USB_DEVICE_EPINTFLAG_TRCPT1_Msk) == 0U)
+    {
+        return false;
+    }
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPINTFLAG = (uint8_t)USB_DEVICE_EPINTFLAG_TRCPT1_Msk;
+
+    return true;
+}
+
+/* Rejects the current control request, cleared by the next SETUP */
+void USB_DEVICE_ControlStall( void )
+{
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[0].USB_EPSTATUSSET = (uint8_t)USB_DEVICE_EPSTATUSSET_STALLRQ_Msk;
+}
+
+/* Has to be called once the status stage of SET_ADDRESS has completed */
+void USB_DEVICE_AddressSet( uint8_t address )
+{
+    USB_REGS->DEVICE.USB_DADD = (uint8_t)(USB_DEVICE_DADD_ADDEN_Msk | USB_DEVICE_DADD_DADD(address));
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: USB Device Bulk Endpoint Routines
+// *****************************************************************************
+// *****************************************************************************
+
+/* Bank 0 is the OUT direction and bank 1 the IN direction of the endpoint.
+ * Both banks start out NAKing until a transfer is started. */
+void USB_DEVICE_BulkConfigure( uint8_t endpoint )
+{
+    usb_endpoint_table[endpoint].DEVICE_DESC_BANK[0].USB_PCKSIZE = USB_DEVICE_PCKSIZE_SIZE(USB_PCKSIZE_64_BYTES);
+    usb_endpoint_table[endpoint].DEVICE_DESC_BANK[1].USB_PCKSIZE = USB_DEVICE_PCKSIZE_SIZE(USB_PCKSIZE_64_BYTES);
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPCFG = (uint8_t)(USB_DEVICE_EPCFG_EPTYPE0(USB_EPTYPE_BULK) | USB_DEVICE_EPCFG_EPTYPE1(USB_EPTYPE_BULK));
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPSTATUSSET = (uint8_t)USB_DEVICE_EPSTATUSSET_BK0RDY_Msk;
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPSTATUSCLR = (uint8_t)(USB_DEVICE_EPSTATUSCLR_BK1RDY_Msk | USB_DEVICE_EPSTATUSCLR_STALLRQ_Msk |
+                                                                          USB_DEVICE_EPSTATUSCLR_DTGLOUT_Msk | USB_DEVICE_EPSTATUSCLR_DTGLIN_Msk);
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPINTFLAG = (uint8_t)(USB_DEVICE_EPINTFLAG_TRCPT_Msk | USB_DEVICE_EPINTFLAG_STALL_Msk);
+}
+
+/* Receives up to size bytes straight into buffer. The hardware splits the
+ * transfer into packets on its own, size has to be a multiple of 64 and the
+ * transfer also ends on a short packet. */
+void USB_DEVICE_BulkReadStart( uint8_t endpoint, uint8_t *buffer, size_t size )
+{
+    usb_endpoint_table[endpoint].DEVICE_DESC_BANK[0].USB_ADDR      = (uint32_t)buffer;
+    usb_endpoint_table[endpoint].DEVICE_DESC_BANK[0].USB_PCKSIZE   = USB_DEVICE_PCKSIZE_SIZE(USB_PCKSIZE_64_BYTES) | USB_DEVICE_PCKSIZE_MULTI_PACKET_SIZE(size);
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPINTFLAG = (uint8_t)USB_DEVICE_EPINTFLAG_TRCPT0_Msk;
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPSTATUSCLR = (uint8_t)USB_DEVICE_EPSTATUSCLR_BK0RDY_Msk;
+}
+
+bool USB_DEVICE_BulkReadIsComplete( uint8_t endpoint, size_t *count )
+{
+    if ((USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPINTFLAG & USB_DEVICE_EPINTFLAG_TRCPT0_Msk) == 0U)
+    {
+        return false;
+    }
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPINTFLAG = (uint8_t)USB_DEVICE_EPINTFLAG_TRCPT0_Msk;
+
+    *count = (usb_endpoint_table[endpoint].DEVICE_DESC_BANK[0].USB_PCKSIZE & USB_DEVICE_PCKSIZE_BYTE_COUNT_Msk) >> USB_DEVICE_PCKSIZE_BYTE_COUNT_Pos;
+
+    return true;
+}
+
+/* Sends size bytes straight from buffer, which has to stay untouched until
+ * the transfer has completed */
+void USB_DEVICE_BulkWriteStart( uint8_t endpoint, const uint8_t *buffer, size_t size )
+{
+    usb_endpoint_table[endpoint].DEVICE_DESC_BANK[1].USB_ADDR      = (uint32_t)buffer;
+    usb_endpoint_table[endpoint].DEVICE_DESC_BANK[1].USB_PCKSIZE   = USB_DEVICE_PCKSIZE_SIZE(USB_PCKSIZE_64_BYTES) | USB_DEVICE_PCKSIZE_BYTE_COUNT(size);
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPINTFLAG = (uint8_t)USB_DEVICE_EPINTFLAG_TRCPT1_Msk;
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPSTATUSSET = (uint8_t)USB_DEVICE_EPSTATUSSET_BK1RDY_Msk;
+}
+
+bool USB_DEVICE_BulkWriteIsComplete( uint8_t endpoint )
+{
+    if ((USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPINTFLAG & USB_DEVICE_EPINTFLAG_TRCPT1_Msk) == 0U)
+    {
+        return false;
+    }
+
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPINTFLAG = (uint8_t)USB_DEVICE_EPINTFLAG_TRCPT1_Msk;
+
+    return true;
+}
+
+void USB_DEVICE_BulkStall( uint8_t endpoint, bool in )
+{
+    USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPSTATUSSET = (uint8_t)(in ? USB_DEVICE_EPSTATUSSET_STALLRQ1_Msk : USB_DEVICE_EPSTATUSSET_STALLRQ0_Msk);
+}
+
+/* CLEAR_FEATURE(ENDPOINT_HALT) also resets the data toggle */
+void USB_DEVICE_BulkStallClear( uint8_t endpoint, bool in )
+{
+    if (in)
+    {
+        USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPSTATUSCLR = (uint8_t)(USB_DEVICE_EPSTATUSCLR_STALLRQ1_Msk | USB_DEVICE_EPSTATUSCLR_DTGLIN_Msk);
+    }
+    else
+    {
+        USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPSTATUSCLR = (uint8_t)(USB_DEVICE_EPSTATUSCLR_STALLRQ0_Msk | USB_DEVICE_EPSTATUSCLR_DTGLOUT_Msk);
+    }
+}
+
+bool USB_DEVICE_BulkIsStalled( uint8_t endpoint, bool in )
+{
+    uint8_t mask = (uint8_t)(in ? USB_DEVICE_EPSTATUS_STALLRQ1_Msk : USB_DEVICE_EPSTATUS_STALLRQ0_Msk);
+
+    return ((USB_REGS->DEVICE.DEVICE_ENDPOINT[endpoint].USB_EPSTATUS & mask) != 0U);
+}
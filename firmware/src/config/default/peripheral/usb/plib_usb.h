@@ -0,0 +1,144 @@
+/*******************************************************************************
+  Universal Serial Bus (USB) Device PLIB
+
+  Company
+    Microchip Technology Inc.
+
+  File Name
+    plib_usb.h
+
+  Summary
+    USB full speed device, control and bulk endpoint interface.
+
+  Description
+    This file defines a small polled interface to the USB peripheral in
+    device mode. Endpoint 0 is all a DFU class device needs; a mass storage
+    device adds one bulk endpoint pair. The functions keep no class
+    knowledge; a class driver calls them from its task loop, and a host
+    build can replace this library with a simulated endpoint layer
+    implementing the same calls.
+
+*******************************************************************************/
+
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2018 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+*******************************************************************************/
+// DOM-IGNORE-END
+
+#ifndef PLIB_USB_H    // Guards against multiple inclusion
+#define PLIB_USB_H
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+// *****************************************************************************
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// DOM-IGNORE-BEGIN
+#ifdef __cplusplus // Provide C++ Compatibility
+
+    extern "C" {
+
+#endif
+// DOM-IGNORE-END
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Data Types
+// *****************************************************************************
+// *****************************************************************************
+
+/* Maximum packet size of the control endpoint */
+#define USB_DEVICE_EP0_SIZE         64U
+
+/* Maximum packet size of the bulk endpoints */
+#define USB_DEVICE_BULK_SIZE        64U
+
+/* Standard setup packet, as received on the control endpoint */
+typedef struct
+{
+    uint8_t     bmRequestType;
+
+    uint8_t     bRequest;
+
+    uint16_t    wValue;
+
+    uint16_t    wIndex;
+
+    uint16_t    wLength;
+
+} USB_SETUP_PACKET;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Interface Routines
+// *****************************************************************************
+// *****************************************************************************
+
+void USB_DEVICE_Initialize( void );
+
+bool USB_DEVICE_ResetIsDetected( void );
+
+bool USB_DEVICE_SetupRead( USB_SETUP_PACKET *setup );
+
+bool USB_DEVICE_ControlOutIsReady( void );
+
+size_t USB_DEVICE_ControlRead( uint8_t *buffer, size_t size );
+
+void USB_DEVICE_ControlWrite( const uint8_t *buffer, size_t size );
+
+bool USB_DEVICE_ControlInIsComplete( void );
+
+void USB_DEVICE_ControlStall( void );
+
+void USB_DEVICE_AddressSet( uint8_t address );
+
+void USB_DEVICE_BulkConfigure( uint8_t endpoint );
+
+void USB_DEVICE_BulkReadStart( uint8_t endpoint, uint8_t *buffer, size_t size );
+
+bool USB_DEVICE_BulkReadIsComplete( uint8_t endpoint, size_t *count );
+
+void USB_DEVICE_BulkWriteStart( uint8_t endpoint, const uint8_t *buffer, size_t size );
+
+bool USB_DEVICE_BulkWriteIsComplete( uint8_t endpoint );
+
+void USB_DEVICE_BulkStall( uint8_t endpoint, bool in );
+
+void USB_DEVICE_BulkStallClear( uint8_t endpoint, bool in );
+
+bool USB_DEVICE_BulkIsStalled( uint8_t endpoint, bool in );
+
+// DOM-IGNORE-BEGIN
+#ifdef __cplusplus // Provide C++ Compatibility
+
+    }
+
+#endif
+// DOM-IGNORE-END
+
+#endif // PLIB_USB_H
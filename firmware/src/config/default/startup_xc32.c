@@ -53,10 +53,21 @@ void (* const vectors[])(void) =
 extern uint32_t _sdata, _edata, _etext;
 extern uint32_t _sbss, _ebss;
 
+#if (BTL_STARTUP_CYCLES == 1)
+/* Cycles from reset to main(), read it with the debugger */
+volatile uint32_t startup_cycles;
+#endif
+
 void __attribute__((noinline, section(".romfunc.Reset_Handler"))) Reset_Handler(void)
 {
     uint32_t *pSrc, *pDst;;
 
+#if (BTL_STARTUP_CYCLES == 1)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
     pSrc = (uint32_t *) &_etext; /* flash functions start after .text */
     pDst = (uint32_t *) &_sdata;  /* boundaries of .data area to init */
 
@@ -76,6 +87,10 @@ void __attribute__((noinline, section(".romfunc.Reset_Handler"))) Reset_Handler(
 #  endif /* SCB_VTOR_TBLOFF_Msk */
 
 
+#if (BTL_STARTUP_CYCLES == 1)
+    startup_cycles = DWT->CYCCNT;
+#endif
+
      /* Branch to application's main function */
     main();
 
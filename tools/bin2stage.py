@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Application binary to QSPI staging area converter.
+
+Wraps an application binary into the staging area format the SAME51
+bootloader installs from QSPI flash (firmware built with BTL_QSPI_STAGING):
+
+    bin2stage.py -i app.bin -o stage.bin
+    bin2stage.py -i app.bin -o stage.bin -s
+
+The output is what the application has to leave at BTL_QSPI_STAGE_OFFSET of
+the external flash: the header page followed by the image. It should program
+the image first and the header page last, the header publishes the update.
+With -s the image goes to the inactive bank and the banks are swapped.
+
+Host builds of the bootloader with bootloader_qspiimage.c take the output
+file as the contents of the flash.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+STAGE_MAGIC = 0x47545342
+STAGE_DATA_OFFSET = 256
+STAGE_PENDING = 0xFFFFFFFF
+STAGE_FLAG_SWAP = 0x00000001
+
+ERASE_BLOCK_SIZE = 8192
+BANK_SIZE = 0x80000
+APP_START_ADDRESS = 0x2000
+
+
+def convert(image, address, swap):
+    flags = STAGE_FLAG_SWAP if swap else 0
+    words = struct.pack("<IIIII", STAGE_MAGIC, address, len(image), zlib.crc32(image), flags)
+    header = words + struct.pack("<II", zlib.crc32(words), STAGE_PENDING)
+    return header + b"\xff" * (STAGE_DATA_OFFSET - len(header)) + image
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-i", "--input", required=True, help="application binary")
+    parser.add_argument("-o", "--output", required=True, help="staging area file to write")
+    parser.add_argument("-a", "--address", type=lambda x: int(x, 0),
+                        help="flash address of the image, the application area of the target bank by default")
+    parser.add_argument("-s", "--swap", action="store_true",
+                        help="install into the inactive bank and swap banks")
+    args = parser.parse_args()
+
+    if args.address is None:
+        args.address = APP_START_ADDRESS + (BANK_SIZE if args.swap else 0)
+
+    with open(args.input, "rb") as f:
+        image = f.read()
+
+    offset = args.address % BANK_SIZE
+    if args.address % ERASE_BLOCK_SIZE or offset < APP_START_ADDRESS:
+        parser.error("address has to be erase block aligned and past the bootloader")
+    if (args.address >= BANK_SIZE) != args.swap or args.address >= 2 * BANK_SIZE:
+        parser.error("address has to be in the inactive bank with -s, in the running one without")
+    if not image or len(image) > BANK_SIZE - offset:
+        parser.error("image does not fit into the bank")
+
+    with open(args.output, "wb") as f:
+        f.write(convert(image, args.address, args.swap))
+
+    print("staged %d bytes for 0x%08x" % (len(image), args.address))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
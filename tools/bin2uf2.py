@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Application binary to UF2 converter.
+
+Wraps an application binary into a UF2 file for the USB mass storage update
+mode of the SAME51 bootloader (firmware built with BTL_USB_MSC):
+
+    bin2uf2.py -i app.bin -o app.uf2
+
+Copying the UF2 file onto the bootloader volume programs the application and
+starts it once every block has been written.
+"""
+
+import argparse
+import struct
+import sys
+
+UF2_MAGIC_START0 = 0x0A324655
+UF2_MAGIC_START1 = 0x9E5D5157
+UF2_MAGIC_END = 0x0AB16F30
+
+UF2_FLAG_FAMILY_ID = 0x00002000
+UF2_FAMILY_SAME51 = 0x55114460
+
+UF2_PAYLOAD_SIZE = 256
+UF2_DATA_SIZE = 476
+
+# Behind the 16 KB a BTL_USB_MSC bootloader takes, see BTL_BOOTLOADER_SIZE
+APP_START_ADDRESS = 0x4000
+
+
+def convert(image, address):
+    count = (len(image) + UF2_PAYLOAD_SIZE - 1) // UF2_PAYLOAD_SIZE
+    blocks = []
+    for n in range(count):
+        payload = image[n * UF2_PAYLOAD_SIZE:(n + 1) * UF2_PAYLOAD_SIZE]
+        payload += b"\xff" * (UF2_PAYLOAD_SIZE - len(payload))
+        header = struct.pack("<IIIIIIII", UF2_MAGIC_START0, UF2_MAGIC_START1,
+                             UF2_FLAG_FAMILY_ID, address + n * UF2_PAYLOAD_SIZE,
+                             UF2_PAYLOAD_SIZE, n, count, UF2_FAMILY_SAME51)
+        data = payload + b"\x00" * (UF2_DATA_SIZE - UF2_PAYLOAD_SIZE)
+        blocks.append(header + data + struct.pack("<I", UF2_MAGIC_END))
+    return b"".join(blocks)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-i", "--input", required=True, help="application binary")
+    parser.add_argument("-o", "--output", required=True, help="UF2 file to write")
+    parser.add_argument("-a", "--address", type=lambda x: int(x, 0), default=APP_START_ADDRESS)
+    args = parser.parse_args()
+
+    if args.address % UF2_PAYLOAD_SIZE:
+        parser.error("address has to be %d byte aligned" % UF2_PAYLOAD_SIZE)
+
+    with open(args.input, "rb") as f:
+        image = f.read()
+
+    with open(args.output, "wb") as f:
+        f.write(convert(image, args.address))
+
+    print("wrote %d blocks for 0x%08x" % ((len(image) + UF2_PAYLOAD_SIZE - 1) // UF2_PAYLOAD_SIZE, args.address))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
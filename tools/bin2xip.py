@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Application binary to QSPI execute in place image converter.
+
+Puts the header in front of the part of an application which executes from
+QSPI flash (firmware built with BTL_QSPI_XIP), see bootloader_xip.h:
+
+    bin2xip.py -a app.bin -i app_xip.bin -o xip.bin
+
+app.bin is the internal part with its binary header, app_xip.bin the
+.xip_text section of the same build. The output goes to BTL_QSPI_XIP_OFFSET
+of the external flash; the bootloader only starts app.bin together with it.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+XIP_MAGIC = 0x50495842
+XIP_DATA_OFFSET = 256
+
+SIGNATURE1 = 0xAA55FADE
+SIGNATURE2 = 0x55AAC0DE
+
+ERASE_BLOCK_SIZE = 8192
+
+
+def app_crc32(app):
+    """crc32 field of the binary header, searched like the bootloader does"""
+    for offset in range(0, min(len(app), ERASE_BLOCK_SIZE) - 15, 4):
+        sig1, sig2, _, crc = struct.unpack_from("<IIII", app, offset)
+        if sig1 == SIGNATURE1 and sig2 == SIGNATURE2:
+            return crc
+    return None
+
+
+def convert(image, crc):
+    words = struct.pack("<IIII", XIP_MAGIC, len(image), zlib.crc32(image), crc)
+    header = words + struct.pack("<I", zlib.crc32(words))
+    return header + b"\xff" * (XIP_DATA_OFFSET - len(header)) + image
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-a", "--app", required=True, help="internal part of the application")
+    parser.add_argument("-i", "--input", required=True, help="external part of the application")
+    parser.add_argument("-o", "--output", required=True, help="external flash image to write")
+    args = parser.parse_args()
+
+    with open(args.app, "rb") as f:
+        crc = app_crc32(f.read())
+    with open(args.input, "rb") as f:
+        image = f.read()
+
+    if crc is None:
+        parser.error("no binary header in the first erase block of the internal part")
+
+    with open(args.output, "wb") as f:
+        f.write(convert(image, crc))
+
+    print("%d bytes for the image with crc32 0x%08x" % (len(image), crc))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
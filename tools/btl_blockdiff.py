@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Erase block difference of two application builds.
+
+Counts the erase blocks two binaries of an application differ in, which is
+what an update sending changed blocks only has to transfer:
+
+    btl_blockdiff.py old.bin new.bin
+
+Both are padded with 0xFF to whole blocks the way they are programmed. With
+the ELF of the new build every differing block is listed with the output
+sections it holds, which tells a change in place from a region that moved:
+
+    btl_blockdiff.py old.bin new.bin --elf new.elf
+
+Applications linked with firmware/src/config/default/app_blocks.ld keep
+their regions on erase block boundaries; a change in the application code
+then leaves the blocks of the libraries and constants alone. --max fails
+the run when more blocks differ, to keep an eye on it from build to build.
+"""
+
+import argparse
+import struct
+import sys
+
+from btl_cache import pad_image
+from btl_protocol import BLOCK_SIZE
+from btl_size import SHT_NOBITS, read_sections
+
+APP_START_ADDRESS = 0x2000
+
+
+def changed_blocks(old, new):
+    """Numbers of the blocks which differ, a block missing from one of the
+    images included."""
+    old, new = pad_image(bytearray(old)), pad_image(bytearray(new))
+    count = max(len(old), len(new)) // BLOCK_SIZE
+    return [n for n in range(count)
+            if old[n * BLOCK_SIZE:(n + 1) * BLOCK_SIZE] != new[n * BLOCK_SIZE:(n + 1) * BLOCK_SIZE]], count
+
+
+def block_sections(sections, address):
+    """Names of the sections with contents in the block at address."""
+    return [name for name, addr, size, kind in sections
+            if kind != SHT_NOBITS and addr < address + BLOCK_SIZE and address < addr + size]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("old", help="binary of the build on the device")
+    parser.add_argument("new", help="binary of the build to update to")
+    parser.add_argument("-a", "--address", type=lambda x: int(x, 0), default=APP_START_ADDRESS,
+                        help="where the binaries go, 0x%x by default" % APP_START_ADDRESS)
+    parser.add_argument("--elf", help="ELF of the new build, names the sections of each block")
+    parser.add_argument("--max", type=int, help="fail when more blocks than this differ")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+    sections = []
+    if args.elf:
+        try:
+            sections = read_sections(args.elf)
+        except (ValueError, OSError, struct.error) as e:
+            parser.error(str(e))
+
+    changed, count = changed_blocks(old, new)
+    for n in changed:
+        address = args.address + n * BLOCK_SIZE
+        names = " ".join(block_sections(sections, address))
+        print("block %4d at 0x%08x%s" % (n, address, "  " + names if names else ""))
+
+    print("%d of %d blocks differ, %d of %d bytes to send" %
+          (len(changed), count, len(changed) * BLOCK_SIZE, count * BLOCK_SIZE))
+    # A run of changed blocks up to the end is the sign of code that moved
+    tail = 0
+    while tail < len(changed) and changed[-1 - tail] == count - 1 - tail:
+        tail += 1
+    if tail > 1 and tail < count:
+        print("every block from %d on differs, the layout shifted at 0x%08x" %
+              (count - tail, args.address + (count - tail) * BLOCK_SIZE))
+
+    if args.max is not None and len(changed) > args.max:
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
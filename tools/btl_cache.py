@@ -0,0 +1,282 @@
+#!/usr/bin/env python3
+"""Prepared image cache of the host tools.
+
+Preparing an application for upload gives the same bytes for every device:
+the image padded to erase blocks, the CRC VERIFY checks, the CRC of its
+binary header and the framed DATA packets. The cache keeps all of it on
+disk, addressed by the SHA-256 of the image, the load address and the
+protocol parameters, so a production line pays for it once per image
+instead of once per device:
+
+    btl_cache.py prepare -i app.bin -a 0x2000
+    btl_host.py -p /dev/ttyUSB0 -i app.bin -a 0x2000 --cache
+
+An entry is a directory holding packets.bin, the DATA packets back to back
+exactly as they go on the wire, and meta.json with the CRCs. Uploaders map
+packets.bin and send views of it, so every station on a machine shares the
+same pages. Entries are written to a temporary directory and renamed into
+place, which makes a cache shared by several stations safe to fill
+concurrently. The per-block CRCs let check find entries damaged on disk;
+prune drops the entries used least recently:
+
+    btl_cache.py list
+    btl_cache.py check
+    btl_cache.py prune --keep 8
+
+The cache lives in $BTL_CACHE, or ~/.cache/btl without it. Encrypted and
+FEC blocks are built per send from the cached blocks, a nonce must never be
+reused.
+"""
+
+import argparse
+import hashlib
+import json
+import mmap
+import os
+import shutil
+import struct
+import sys
+import tempfile
+import time
+import zlib
+
+from btl_protocol import BL_CMD_DATA, BLOCK_SIZE, BTL_GUARD, FIELDS, HEADER, HEADER_SIZE, Encoder
+
+SIGNATURE1 = 0xAA55FADE
+SIGNATURE2 = 0x55AAC0DE
+BINARY_HEADER = struct.Struct("<IIII")
+
+IMAGE_INFO_MAGIC = 0x4F464E49
+IMAGE_INFO = struct.Struct("<III")
+
+# Bump when the layout of an entry changes
+CACHE_VERSION = 2
+
+DATA_FIELDS_SIZE = FIELDS[BL_CMD_DATA].size
+PACKET_SIZE = HEADER_SIZE + DATA_FIELDS_SIZE + BLOCK_SIZE
+
+PACKETS_FILE = "packets.bin"
+META_FILE = "meta.json"
+
+
+def default_root():
+    return os.environ.get("BTL_CACHE") or os.path.join(os.path.expanduser("~"), ".cache", "btl")
+
+
+def dsu_crc32(data, crc=0xFFFFFFFF):
+    """CRC the DSU computes over flash: CRC-32 seeded with 0xFFFFFFFF and no
+    final inversion. Pass the result of one piece as crc of the next."""
+    return zlib.crc32(data, crc ^ 0xFFFFFFFF) ^ 0xFFFFFFFF
+
+
+def pad_image(data):
+    rem = len(data) % BLOCK_SIZE
+    if rem:
+        data += b"\xff" * (BLOCK_SIZE - rem)
+    return data
+
+
+def binary_header(image):
+    """Binary header searched and checked like run_Application does, with
+    the version and hardware ID of the image information after it if there
+    is one, or None."""
+    for offset in range(0, min(len(image), BLOCK_SIZE) - BINARY_HEADER.size + 1, 4):
+        sig1, sig2, size, crc = BINARY_HEADER.unpack_from(image, offset)
+        if sig1 == SIGNATURE1 and sig2 == SIGNATURE2:
+            body = memoryview(image)[:size]
+            computed = zlib.crc32(body[offset + BINARY_HEADER.size:], zlib.crc32(body[:offset]))
+            header = {"offset": offset, "size": size, "crc": crc, "computed": computed,
+                      "version": None, "hardware": None}
+            info = offset + BINARY_HEADER.size
+            if info + IMAGE_INFO.size <= len(image):
+                magic, version, hardware = IMAGE_INFO.unpack_from(image, info)
+                if magic == IMAGE_INFO_MAGIC:
+                    header.update(version=version, hardware=hardware)
+            return header
+    return None
+
+
+def cache_key(image, address):
+    """Names the entry: the image and everything that shapes its packets."""
+    digest = hashlib.sha256()
+    digest.update(struct.pack("<IIIBI", CACHE_VERSION, BTL_GUARD, BLOCK_SIZE, BL_CMD_DATA, address))
+    digest.update(HEADER.format.encode() + FIELDS[BL_CMD_DATA].format.encode())
+    digest.update(image)
+    return digest.hexdigest()
+
+
+class PreparedImage:
+    """Packets and CRCs of an image, in memory or mapped from the cache."""
+
+    def __init__(self, meta, packets):
+        self.meta = meta
+        self.address = meta["address"]
+        self.length = meta["length"]
+        self.count = meta["count"]
+        self.size = self.count * BLOCK_SIZE
+        self.crc = meta["crc"]
+        self.block_crcs = meta["block_crcs"]
+        self.header = meta["header"]
+        self.packets = memoryview(packets)
+
+    def packet(self, n):
+        """DATA packet of block n, header included, ready for the wire."""
+        return self.packets[n * PACKET_SIZE:(n + 1) * PACKET_SIZE]
+
+    def block(self, n):
+        start = n * PACKET_SIZE + HEADER_SIZE + DATA_FIELDS_SIZE
+        return self.packets[start:start + BLOCK_SIZE]
+
+    def header_ok(self):
+        """False for an image whose binary header CRC is wrong, which the
+        bootloader would never start."""
+        return self.header is None or self.header["crc"] == self.header["computed"]
+
+    def damaged(self):
+        """Blocks whose CRC no longer matches."""
+        return [n for n in range(self.count) if dsu_crc32(self.block(n)) != self.block_crcs[n]]
+
+
+def build(image, address):
+    """Meta data and packets of an image."""
+    length = len(image)
+    image = pad_image(bytearray(image))
+    count = len(image) // BLOCK_SIZE
+    packets = bytearray(count * PACKET_SIZE)
+    encoder = Encoder()
+    view = memoryview(image)
+    block_crcs = []
+    crc = 0xFFFFFFFF
+    for n in range(count):
+        block = view[n * BLOCK_SIZE:(n + 1) * BLOCK_SIZE]
+        head, _ = encoder.encode(BL_CMD_DATA, (address + n * BLOCK_SIZE,), block)
+        start = n * PACKET_SIZE
+        packets[start:start + len(head)] = head
+        packets[start + len(head):start + PACKET_SIZE] = block
+        block_crcs.append(dsu_crc32(block))
+        crc = dsu_crc32(block, crc)
+
+    meta = {
+        "version": CACHE_VERSION,
+        "address": address,
+        "length": length,
+        "count": count,
+        "crc": crc,
+        "block_crcs": block_crcs,
+        "header": binary_header(image),
+        "sha256": hashlib.sha256(bytes(view[:length])).hexdigest(),
+    }
+    return meta, packets
+
+
+def load(path, touch=True):
+    with open(os.path.join(path, META_FILE)) as f:
+        meta = json.load(f)
+    with open(os.path.join(path, PACKETS_FILE), "rb") as f:
+        if os.fstat(f.fileno()).st_size != meta["count"] * PACKET_SIZE:
+            raise ValueError("%s: truncated" % path)
+        packets = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) if meta["count"] else b""
+    if touch:
+        # Recently used, for prune
+        os.utime(os.path.join(path, META_FILE))
+    return PreparedImage(meta, packets)
+
+
+def store(root, key, meta, packets):
+    """Writes an entry unless another process got there first."""
+    os.makedirs(root, exist_ok=True)
+    path = os.path.join(root, key)
+    temp = tempfile.mkdtemp(prefix=".tmp-", dir=root)
+    try:
+        with open(os.path.join(temp, PACKETS_FILE), "wb") as f:
+            f.write(packets)
+        with open(os.path.join(temp, META_FILE), "w") as f:
+            json.dump(meta, f)
+        os.rename(temp, path)
+    except OSError:
+        shutil.rmtree(temp, ignore_errors=True)
+        if not os.path.isdir(path):
+            raise
+    return path
+
+
+def prepare(image, address, root=None):
+    """Prepared image from the cache under root, built and stored on a miss.
+    Without a root it is built in memory only."""
+    if root is None:
+        return PreparedImage(*build(image, address))
+    path = os.path.join(root, cache_key(image, address))
+    try:
+        return load(path)
+    except (OSError, ValueError):
+        shutil.rmtree(path, ignore_errors=True)
+    return load(store(root, os.path.basename(path), *build(image, address)))
+
+
+def entries(root):
+    """Path and meta data of every entry, most recently used first."""
+    found = []
+    for name in os.listdir(root) if os.path.isdir(root) else []:
+        meta_path = os.path.join(root, name, META_FILE)
+        if name.startswith(".") or not os.path.exists(meta_path):
+            continue
+        with open(meta_path) as f:
+            found.append((os.path.getmtime(meta_path), os.path.join(root, name), json.load(f)))
+    found.sort(key=lambda e: e[0], reverse=True)
+    return [(path, meta) for _, path, meta in found]
+
+
+def describe(prepared):
+    header = prepared.header
+    if header is None:
+        state = "no binary header"
+    elif prepared.header_ok():
+        state = "header CRC 0x%08x" % header["crc"]
+    else:
+        state = "header CRC 0x%08x, computed 0x%08x" % (header["crc"], header["computed"])
+    if header is not None and header["version"] is not None:
+        state += ", version %d for hardware 0x%x" % (header["version"], header["hardware"])
+    return "%d blocks at 0x%08x, CRC 0x%08x, %s" % (prepared.count, prepared.address, prepared.crc, state)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--cache", default=default_root(), help="cache directory")
+    sub = parser.add_subparsers(dest="command", required=True)
+    prep = sub.add_parser("prepare", help="prepare an image ahead of the uploads")
+    prep.add_argument("-i", "--input", required=True, help="application binary")
+    prep.add_argument("-a", "--address", type=lambda x: int(x, 0), default=0x2000)
+    sub.add_parser("list", help="list the entries, most recently used first")
+    sub.add_parser("check", help="check the blocks of every entry against their CRCs")
+    prune = sub.add_parser("prune", help="remove the entries used least recently")
+    prune.add_argument("--keep", type=int, default=8, help="entries to keep")
+    args = parser.parse_args()
+
+    if args.command == "prepare":
+        with open(args.input, "rb") as f:
+            image = f.read()
+        started = time.monotonic()
+        prepared = prepare(image, args.address, args.cache)
+        print("%s: %s, %.3f s" % (cache_key(image, args.address)[:16], describe(prepared),
+                                  time.monotonic() - started))
+        return 0 if prepared.header_ok() else 1
+
+    failed = 0
+    for i, (path, meta) in enumerate(entries(args.cache)):
+        name = os.path.basename(path)[:16]
+        if args.command == "list":
+            print("%s: %s" % (name, describe(PreparedImage(meta, b""))))
+        elif args.command == "check":
+            damaged = load(path, touch=False).damaged()
+            if damaged:
+                failed += 1
+                shutil.rmtree(path, ignore_errors=True)
+            print("%s: %s" % (name, "damaged blocks %s, removed" % damaged if damaged else "ok"))
+        elif i >= args.keep:
+            shutil.rmtree(path, ignore_errors=True)
+            print("%s: removed" % name)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,350 @@
+#!/usr/bin/env python3
+"""Serial session capture and latency analyser of the host tools.
+
+btl_host.py --capture records every byte it sends to and receives from the
+bootloader, with monotonic timestamps, in a compact binary file. This tool
+decodes the packets in it (guard, size, command) and splits the time of
+each session into its parts:
+
+    wire     the bytes on the line at the recorded baud rate
+    device   from the last byte of a packet on the wire to its response
+    host     from a response to the first byte of the next packet
+    timeout  waiting for responses which never came
+
+It also counts the responses that never came, the resyncs after broken
+packets and the bytes that belong to no packet. A session ends with RESET or
+BKSWAP_RESET.
+
+    btl_host.py -p /dev/ttyUSB0 -i app.bin --capture upload.btlcap
+    btl_capture.py upload.btlcap
+    btl_capture.py upload.btlcap --csv upload.csv
+
+The CSV has a row per packet, times in milliseconds, for plotting.
+
+A capture is a file header followed by records. Each record is the
+monotonic time in nanoseconds since the capture started, the number of
+bytes following, its kind and the link it happened on:
+
+    TX       bytes written to the port
+    RX       bytes read from the port
+    TIMEOUT  a read returned less than asked for; the record holds the
+             number of bytes that were missing
+    MARK     a note of the host, e.g. "resync"
+"""
+
+import argparse
+import csv
+import struct
+import sys
+import threading
+import time
+
+from btl_protocol import BL_CMD_BKSWAP_RESET, BL_CMD_RESET, BTL_GUARD, HEADER, HEADER_SIZE, RESPONSES, name
+
+CAPTURE_MAGIC = b"BTLS"
+CAPTURE_VERSION = 1
+# magic, version, bits per character, baud rate, wall clock at the start
+FILE_HEADER = struct.Struct("<4sHHId")
+# time in ns, length, kind, link
+RECORD = struct.Struct("<QIBB")
+
+TX = 0
+RX = 1
+TIMEOUT = 2
+MARK = 3
+
+# 8N1 on a UART, 8 bits and the address bit on RS-485
+UART_BITS = 10
+RS485_BITS = 11
+
+GUARD_BYTES = struct.pack("<I", BTL_GUARD)
+SESSION_END = (BL_CMD_RESET, BL_CMD_BKSWAP_RESET)
+
+
+class Capture:
+    """Writes a capture; wrap() the ports to record."""
+
+    def __init__(self, path, baud, bits=UART_BITS):
+        self.file = open(path, "wb")
+        self.lock = threading.Lock()
+        self.file.write(FILE_HEADER.pack(CAPTURE_MAGIC, CAPTURE_VERSION, bits, baud, time.time()))
+        self.started = time.monotonic_ns()
+
+    def record(self, kind, link, data=b""):
+        now = time.monotonic_ns() - self.started
+        with self.lock:
+            self.file.write(RECORD.pack(now, len(data), kind, link))
+            self.file.write(data)
+
+    def wrap(self, port, link=0):
+        return CapturedPort(self, port, link)
+
+    def close(self):
+        self.file.close()
+
+
+class CapturedPort:
+    """Serial port which records what goes through it. Everything but
+    read() and write() is passed on to the port."""
+
+    def __init__(self, capture, port, link):
+        object.__setattr__(self, "_capture", capture)
+        object.__setattr__(self, "_port", port)
+        object.__setattr__(self, "_link", link)
+
+    def __getattr__(self, attr):
+        return getattr(self._port, attr)
+
+    def __setattr__(self, attr, value):
+        setattr(self._port, attr, value)
+
+    def write(self, data):
+        # Stamped once the OS has the bytes, before they are on the wire
+        count = self._port.write(data)
+        self._capture.record(TX, self._link, data)
+        return count
+
+    def read(self, size=1):
+        data = self._port.read(size)
+        if data:
+            self._capture.record(RX, self._link, data)
+        if len(data) < size:
+            self._capture.record(TIMEOUT, self._link, struct.pack("<I", size - len(data)))
+        return data
+
+    def mark(self, note):
+        self._capture.record(MARK, self._link, note.encode())
+
+
+def read_capture(path):
+    """File header fields and the list of (time, kind, link, data)."""
+    with open(path, "rb") as f:
+        content = f.read()
+    magic, version, bits, baud, started = FILE_HEADER.unpack_from(content)
+    if magic != CAPTURE_MAGIC or version != CAPTURE_VERSION:
+        raise ValueError("%s: not a capture of this version" % path)
+    events = []
+    offset = FILE_HEADER.size
+    while offset + RECORD.size <= len(content):
+        when, length, kind, link = RECORD.unpack_from(content, offset)
+        offset += RECORD.size
+        events.append((when / 1e9, kind, link, content[offset:offset + length]))
+        offset += length
+    return bits, baud, started, events
+
+
+class Packet:
+    def __init__(self, link, start, size, command):
+        self.link = link
+        self.start = start
+        self.sent = start
+        self.size = size
+        self.command = command
+        self.response = None
+        self.answered = None
+        self.timeout = False
+        self.resyncs = 0
+        self.session = 0
+
+
+class LinkDecoder:
+    """Cuts the bytes sent on one link into packets and pairs them with the
+    responses that follow."""
+
+    def __init__(self, link):
+        self.link = link
+        self.stream = bytearray()
+        self.chunks = []
+        self.parsed = 0
+        self.packets = []
+        self.waiting = []
+        self.stray_tx = 0
+        self.stray_rx = 0
+        self.draining = False
+
+    def time_at(self, offset):
+        """Time the byte at offset of the stream was written."""
+        for start, when in reversed(self.chunks):
+            if start <= offset:
+                return when
+        return self.chunks[0][1]
+
+    def sent(self, when, data):
+        self.draining = False
+        self.chunks.append((len(self.stream), when))
+        self.stream += data
+        while True:
+            found = self.stream.find(GUARD_BYTES, self.parsed)
+            if found < 0:
+                # RS-485 addresses, or the start of a guard still to come
+                keep = max(self.parsed, len(self.stream) - len(GUARD_BYTES) + 1)
+                self.stray_tx += keep - self.parsed
+                self.parsed = keep
+                return
+            self.stray_tx += found - self.parsed
+            self.parsed = found
+            if len(self.stream) - found < HEADER_SIZE:
+                return
+            _, size, command = HEADER.unpack_from(self.stream, found)
+            end = found + HEADER_SIZE + size
+            if len(self.stream) < end:
+                return
+            packet = Packet(self.link, self.time_at(found), size, command)
+            packet.sent = self.time_at(end - 1)
+            self.packets.append(packet)
+            self.waiting.append(packet)
+            self.parsed = end
+
+    def received(self, when, data):
+        for byte in data:
+            if self.waiting:
+                packet = self.waiting.pop(0)
+                packet.response = byte
+                packet.answered = when
+            else:
+                self.stray_rx += 1
+
+    def timed_out(self, when):
+        # A resync drains the line until a read times out, that is no loss
+        if self.waiting and not self.draining:
+            packet = self.waiting.pop(0)
+            packet.timeout = True
+            packet.answered = when
+
+    def marked(self, note):
+        if note == "resync" and self.packets:
+            self.packets[-1].resyncs += 1
+            self.draining = True
+
+
+def decode(events):
+    """Packets of every link, ordered by their start."""
+    links = {}
+    for when, kind, link, data in events:
+        decoder = links.setdefault(link, LinkDecoder(link))
+        if kind == TX:
+            decoder.sent(when, data)
+        elif kind == RX:
+            decoder.received(when, data)
+        elif kind == TIMEOUT:
+            decoder.timed_out(when)
+        elif kind == MARK:
+            decoder.marked(data.decode(errors="replace"))
+    packets = sorted((p for d in links.values() for p in d.packets), key=lambda p: p.start)
+    return packets, links
+
+
+def attribute(packets, bits, baud):
+    """Wire, device and host time of every packet, and its session."""
+    char = bits / baud
+    previous = {}
+    session = 1
+    for packet in packets:
+        packet.session = session
+        packet.wire_tx = (HEADER_SIZE + packet.size) * char
+        packet.wire_rx = char if packet.response is not None else 0.0
+        packet.device = 0.0
+        packet.waited = 0.0
+        if packet.answered is not None:
+            on_wire = max(packet.sent, packet.start + packet.wire_tx)
+            if packet.timeout:
+                packet.waited = max(0.0, packet.answered - on_wire)
+            else:
+                packet.device = max(0.0, packet.answered - on_wire - packet.wire_rx)
+        last = previous.get(packet.link)
+        packet.host = max(0.0, packet.start - last) if last is not None else 0.0
+        previous[packet.link] = packet.answered if packet.answered is not None else packet.sent
+        if packet.command in SESSION_END:
+            session += 1
+            previous = {}
+
+
+def percent(part, whole):
+    return 100.0 * part / whole if whole else 0.0
+
+
+def summarize(packets, links, out):
+    sessions = {}
+    for packet in packets:
+        sessions.setdefault(packet.session, []).append(packet)
+    for number, members in sorted(sessions.items()):
+        start = members[0].start
+        end = max(p.answered if p.answered is not None else p.sent for p in members)
+        wall = end - start
+        wire = sum(p.wire_tx + p.wire_rx for p in members)
+        device = sum(p.device for p in members)
+        host = sum(p.host for p in members)
+        waited = sum(p.waited for p in members)
+        out.write("session %d: %.3f..%.3f s, %d packets on %d link(s), %d bytes out\n" %
+                  (number, start, end, len(members), len(set(p.link for p in members)),
+                   sum(HEADER_SIZE + p.size for p in members)))
+        out.write("  wall    %9.3f ms\n" % (wall * 1e3))
+        for label, value in (("wire", wire), ("device", device), ("host", host), ("timeout", waited)):
+            out.write("  %-7s %9.3f ms  %5.1f%%\n" % (label, value * 1e3, percent(value, wall)))
+        if len(set(p.link for p in members)) > 1:
+            out.write("  links overlap, the parts add up to more than the wall time\n")
+
+        by_command = {}
+        for packet in members:
+            by_command.setdefault(packet.command, []).append(packet)
+        for command, group in sorted(by_command.items()):
+            worst = max(group, key=lambda p: p.device)
+            out.write("  %-12s %5d  device %9.3f ms, slowest %8.3f ms at %.3f s\n" %
+                      (name(command), len(group), sum(p.device for p in group) * 1e3,
+                       worst.device * 1e3, worst.start))
+
+        answers = {}
+        for packet in members:
+            if packet.response is not None:
+                label = RESPONSES.get(packet.response, "0x%02x" % packet.response)
+                answers[label] = answers.get(label, 0) + 1
+        timeouts = [p for p in members if p.timeout]
+        resyncs = sum(p.resyncs for p in members)
+        out.write("  answers %s\n" % ", ".join("%s %d" % a for a in sorted(answers.items())))
+        if timeouts or resyncs:
+            out.write("  FLAGGED: %d without response, %d resyncs\n" % (len(timeouts), resyncs))
+            for packet in timeouts:
+                out.write("    %s at %.3f s got no response\n" % (name(packet.command), packet.start))
+    for link, decoder in sorted(links.items()):
+        if decoder.stray_tx or decoder.stray_rx or decoder.waiting:
+            out.write("link %d: %d bytes sent and %d received outside of packets, %d packets unanswered\n" %
+                      (link, decoder.stray_tx, decoder.stray_rx, len(decoder.waiting)))
+
+
+def write_csv(packets, path):
+    with open(path, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(("session", "link", "command", "bytes", "start_ms", "sent_ms", "answered_ms",
+                         "wire_ms", "device_ms", "host_ms", "timeout_ms", "response", "no_response", "resyncs"))
+        for p in packets:
+            writer.writerow((p.session, p.link, name(p.command), HEADER_SIZE + p.size,
+                             "%.3f" % (p.start * 1e3), "%.3f" % (p.sent * 1e3),
+                             "" if p.answered is None else "%.3f" % (p.answered * 1e3),
+                             "%.3f" % ((p.wire_tx + p.wire_rx) * 1e3), "%.3f" % (p.device * 1e3),
+                             "%.3f" % (p.host * 1e3), "%.3f" % (p.waited * 1e3),
+                             "" if p.response is None else RESPONSES.get(p.response, "0x%02x" % p.response),
+                             int(p.timeout), p.resyncs))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="capture written by btl_host.py --capture")
+    parser.add_argument("--csv", help="also write a row per packet to this file")
+    parser.add_argument("-b", "--baud", type=int, help="baud rate of the link, instead of the recorded one")
+    args = parser.parse_args()
+
+    bits, baud, started, events = read_capture(args.capture)
+    packets, links = decode(events)
+    attribute(packets, bits, args.baud or baud)
+
+    print("%s: %d events, %d packets at %d baud, captured %s" %
+          (args.capture, len(events), len(packets), args.baud or baud,
+           time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(started))))
+    summarize(packets, links, sys.stdout)
+    if args.csv:
+        write_csv(packets, args.csv)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
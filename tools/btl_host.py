@@ -0,0 +1,999 @@
+#!/usr/bin/env python3
+"""UART bootloader host uploader.
+
+Programs an application binary through the SAME51 UART bootloader.
+
+    btl_host.py -p /dev/ttyUSB0 -i app.bin
+    btl_host.py -p /dev/ttyUSB0 -p /dev/ttyUSB1 -i app.bin -s
+
+With two ports the data blocks are striped across both links: block n goes
+to port n % 2 and every port waits only for the ACKs of its own blocks, so
+both UARTs stream at the same time. The firmware has to be built with
+BTL_DUAL_UART enabled. Unlock, verify and reset always use the first port.
+
+Boards with a host processor wired to the SERCOM1 SPI slave (firmware built
+with BTL_SPI_SLAVE) are programmed through spidev and the ready GPIO:
+
+    btl_host.py --spi /dev/spidev0.0 --ready-gpio 17 -i app.bin
+
+A DATA packet is one 8 KB transaction, so spidev has to be loaded with a
+large enough buffer (spidev.bufsiz=16384).
+
+CAN FD nodes (firmware built with BTL_CAN_FD) are reached through a SocketCAN
+interface. A single node is programmed over ISO-TP. With several nodes the
+host acts as the gateway: every packet is multicast once, then each node is
+polled and only the segments some node missed are sent again.
+
+    btl_host.py --can can0 --node 3 -i app.bin
+    btl_host.py --can can0 --node 1 --node 2 --node 3 -i app.bin
+
+Host builds of the bootloader with bootloader_socketcan.c attach to a vcan
+interface, which gives a simulated bus to run both modes without hardware.
+
+RS-485 nodes (firmware built with BTL_RS485) share one half-duplex pair and
+take 9 bit characters; the adapter sends the ninth bit as mark or space
+parity. A single node is programmed like a UART. With several nodes UNLOCK
+and every DATA block are broadcast once, each node is polled for a bitmap of
+the blocks it programmed and the missing ones are broadcast again. Only
+VERIFY goes to every node on its own. A node takes its address from the
+user page byte at BTL_RS485_ADDRESS_LOCATION, written when the board is
+provisioned.
+
+    btl_host.py --rs485 /dev/ttyUSB0 --node 1 --node 2 --node 3 -i app.bin
+
+With a key (firmware built with BTL_ENCRYPTION) every block is sent as
+ENC_DATA, encrypted with AES-128-GCM under a fresh random nonce and
+authenticated together with its address. This needs the cryptography
+package. A block failing authentication is not programmed and shows up as a
+failed VERIFY.
+
+    btl_host.py -p /dev/ttyUSB0 -k 000102030405060708090a0b0c0d0e0f -i app.bin
+
+An update container built by mkcontainer.py (firmware built with
+BTL_CONTAINER) is recognized by its magic and sent as STREAM packets in
+erase block sized pieces; the region and its CRC come from the manifest, so
+--address does not apply. It goes over the first port only.
+
+    btl_host.py -p /dev/ttyUSB0 -i app.btlc
+
+With a partition table (firmware built with BTL_PARTITIONS, table created by
+mkpartitions.py) --partition sends PARTITION instead of UNLOCK, which scopes
+the session to that partition. --address has to be where the partition
+starts; blocks outside of it are refused by the device.
+
+    btl_host.py -p /dev/ttyUSB0 --partition 2 -a 0x62000 -i calib.bin
+
+On noisy serial and RS-485 links --fec sends every block as FEC_DATA,
+Reed-Solomon codewords with that many parity bytes each (firmware built with
+BTL_FEC, see rsfec.py). The device corrects the block before programming it.
+A block it could not correct, or whose header got hit, is sent again with
+twice the parity up to --fec-max; after a run of clean blocks the parity
+steps back down. RS-485 broadcasts keep the parity they started with.
+
+    btl_host.py -p /dev/ttyUSB0 --fec 8 -i app.bin
+
+--cache takes the padded image, its CRCs and the DATA packets from the
+prepared image cache of btl_cache.py, and fills it on a miss. Stations
+programming the same image share one copy and skip preparing it.
+
+    btl_host.py -p /dev/ttyUSB0 --cache /srv/btl-cache -i app.bin
+
+--timeouts sets the receive timeouts of the device for the session, in
+milliseconds, 0 for none: the gap allowed between two bytes of a packet, the
+time for a whole packet and the idle time after which the device ends the
+session. At high baud rates tight timeouts let a stalled packet be dropped
+and sent again within a few milliseconds; the host then waits only twice
+the shorter packet timeout before resending.
+
+    btl_host.py -p /dev/ttyUSB0 -b 3000000 --timeouts 1,50,10000 -i app.bin
+
+--begin opens the session with BEGIN and the manifest of the image (firmware
+built with BTL_MANIFEST, which refuses to unlock without it): address, size
+and CRC of the binary header, version and hardware ID. Version and hardware
+come from the image information after the binary header, or from --version
+and --hardware. The device answers before anything is erased: when the
+installed application already is the image it is only reset, an image for
+other hardware is refused. A container is described by its region and CRC.
+It is not available for multicast.
+
+    btl_host.py -p /dev/ttyUSB0 --begin -i app.bin
+
+--self-update replaces the bootloader itself (firmware built with
+BTL_SELF_UPDATE). The input is the new bootloader binary, at most one erase
+block. It is staged in the erase block at --address, 0x7A000 by default,
+which has to be free of application code and below 0x80000. The device
+writes it to the inactive bank together with the application, then the
+bank swap starts it. Until the swap the running bootloader is untouched,
+so an update cut short by a power loss is simply sent again. The copy
+takes seconds, --timeout is raised to 30 s for it.
+
+    btl_host.py -p /dev/ttyUSB0 --self-update -i bootloader.bin
+
+--bit-rate switches the serial ports to a faster rate once they are open:
+the device is reached at -b, answers BIT_RATE at that rate and takes the
+new one from the next packet on. A rate the device can not do shows up as
+no response to the next command.
+
+    btl_host.py -p /dev/ttyUSB0 --bit-rate 921600 -i app.bin
+
+--capture records every byte sent and received over the serial ports or the
+RS-485 bus, with timestamps, for btl_capture.py to tell how much of an
+upload is spent on the wire, in the device and in the host.
+
+    btl_host.py -p /dev/ttyUSB0 --capture upload.btlcap -i app.bin
+"""
+
+import argparse
+import errno
+import os
+import select
+import socket
+import struct
+import sys
+import threading
+import time
+
+import serial
+
+import btl_cache
+import btl_capture
+import rsfec
+from btl_protocol import (BL_CMD_BEGIN, BL_CMD_BIT_RATE, BL_CMD_BKSWAP_RESET, BL_CMD_DATA,
+                          BL_CMD_ENC_DATA, BL_CMD_FEC_DATA, BL_CMD_PARTITION, BL_CMD_RESET,
+                          BL_CMD_SELF_UPDATE, BL_CMD_STREAM, BL_CMD_TIMEOUTS, BL_CMD_UNLOCK, BL_CMD_VERIFY,
+                          BL_RESP_CRC_FAIL, BL_RESP_CRC_OK, BL_RESP_INCOMPATIBLE, BL_RESP_INSTALLED,
+                          BL_RESP_OK, BLOCK_SIZE, NONCE_SIZE, RESPONSES, TAG_SIZE, Encoder)
+
+ERASE_BLOCK_SIZE = BLOCK_SIZE
+APP_START_ADDRESS = 0x2000
+FLASH_SIZE = 0x100000
+BANK_SIZE = FLASH_SIZE // 2
+
+BOOTLOADER_SIZE = ERASE_BLOCK_SIZE
+# Below the partition table and the signature cache of the first bank
+SELF_UPDATE_STAGE = 0x7A000
+SELF_UPDATE_TRIES = 3
+# Seconds for the device to copy the application area to the other bank
+SELF_UPDATE_TIMEOUT = 30.0
+
+KEY_SIZE = 16
+
+CONTAINER_MAGIC = 0x434C5442
+CONTAINER_MANIFEST = struct.Struct("<IHHIIIII")
+
+SPI_NO_RESPONSE = 0xFF
+
+CAN_REQUEST_ID = 0x600
+CAN_RESPONSE_ID = 0x680
+CAN_MULTICAST_ID = 0x5FF
+CAN_FD_LENGTHS = (0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64)
+CAN_PADDING = 0xCC
+CAN_SEGMENT_DATA = 56
+CAN_STATUS_ACTIVE = 0x01
+CAN_NO_RESPONSE = 0xFF
+CAN_POLL_TIMEOUT = 0.05
+CANFD_FRAME = struct.Struct("=IBBBB64s")
+CANFD_BRS = 0x01
+
+RS485_BROADCAST = 0xFF
+RS485_POLL = 0x80
+RS485_STATUS_SIZE = 18
+RS485_NO_RESPONSE = 0xFF
+RS485_POLL_TIMEOUT = 0.1
+RS485_ROUNDS = 5
+
+FEC_RETRIES = 8
+FEC_CLEAN_BLOCKS = 16
+# Longer than the device takes to drop a broken packet
+FEC_RESYNC_DELAY = 0.2
+
+# BTL_TIMEOUT_MIN_US of the device
+TIMEOUT_MIN = 0.1
+
+
+class BootloaderError(Exception):
+    pass
+
+
+class FecStrength:
+    """Parity of the next FEC_DATA block on one link."""
+
+    def __init__(self, parity, ceiling):
+        self.floor = parity
+        self.parity = parity
+        self.ceiling = ceiling
+        self.clean = 0
+
+    def failed(self):
+        self.parity = min(self.ceiling, self.parity * 2)
+        self.clean = 0
+
+    def passed(self):
+        self.clean += 1
+        if self.clean >= FEC_CLEAN_BLOCKS and self.parity > self.floor:
+            self.parity = max(self.floor, self.parity // 4 * 2)
+            self.clean = 0
+
+
+def data_packet(encoder, prepared, n, cipher, parity=None):
+    """Command and packet parts of block n, encrypted if a cipher is given
+    or with that much parity per codeword. A plain block goes out as the
+    prepared packet."""
+    address = prepared.address + n * ERASE_BLOCK_SIZE
+    block = prepared.block(n)
+    if parity is not None:
+        codewords = rsfec.encode_codewords(address, block, parity)
+        return BL_CMD_FEC_DATA, encoder.encode(BL_CMD_FEC_DATA, (address,), codewords)
+    if cipher is None:
+        return BL_CMD_DATA, (prepared.packet(n),)
+    nonce = os.urandom(NONCE_SIZE)
+    sealed = memoryview(cipher.encrypt(nonce, block, struct.pack("<I", address)))
+    fields = (address, nonce, bytes(sealed[-TAG_SIZE:]))
+    return BL_CMD_ENC_DATA, encoder.encode(BL_CMD_ENC_DATA, fields, sealed[:-TAG_SIZE])
+
+
+def mark(port, note):
+    """Notes an event in the capture of a port, if it is captured."""
+    if isinstance(port, btl_capture.CapturedPort):
+        port.mark(note)
+
+
+class Link:
+    def __init__(self, port, baud, timeout):
+        self.name = port
+        self.serial = serial.Serial(port, baud, timeout=timeout)
+        self.encoder = Encoder()
+        self.resync_delay = FEC_RESYNC_DELAY
+
+    def request(self, command, fields=(), data=b""):
+        return self.transact(command, self.encoder.encode(command, fields, data))
+
+    def transact(self, command, parts):
+        """Sends a packet given in parts and returns the response."""
+        for part in parts:
+            self.serial.write(part)
+        response = self.serial.read(1)
+        if not response:
+            raise BootloaderError("%s: no response to command 0x%02x" % (self.name, command))
+        return response[0]
+
+    def expect(self, command, fields=(), data=b"", expected=BL_RESP_OK):
+        self.expect_parts(command, self.encoder.encode(command, fields, data), expected)
+
+    def expect_parts(self, command, parts, expected=BL_RESP_OK):
+        response = self.transact(command, parts)
+        if response != expected:
+            raise BootloaderError("%s: command 0x%02x answered %s" %
+                                  (self.name, command, RESPONSES.get(response, hex(response))))
+
+    def set_bit_rate(self, rate):
+        """Moves the device and the port to another bit rate."""
+        self.expect(BL_CMD_BIT_RATE, (rate,))
+        self.serial.baudrate = rate
+
+    def resync(self):
+        """Drops whatever a broken packet left on the link. The device
+        answers every bogus header in what is left of it, so wait for the
+        line to stay quiet."""
+        mark(self.serial, "resync")
+        self.serial.flush()
+        timeout = self.serial.timeout
+        self.serial.timeout = self.resync_delay
+        while self.serial.read(4096):
+            pass
+        self.serial.timeout = timeout
+
+    def close(self):
+        self.serial.close()
+
+
+class ReadyLine:
+    """Ready/busy GPIO of the SPI slave, watched through sysfs so that a short
+    low pulse is never missed."""
+
+    def __init__(self, gpio):
+        path = "/sys/class/gpio/gpio%d" % gpio
+        if not os.path.exists(path):
+            with open("/sys/class/gpio/export", "w") as f:
+                f.write(str(gpio))
+        with open(path + "/direction", "w") as f:
+            f.write("in")
+        with open(path + "/edge", "w") as f:
+            f.write("rising")
+        self.fd = os.open(path + "/value", os.O_RDONLY)
+        self.poller = select.poll()
+        self.poller.register(self.fd, select.POLLPRI | select.POLLERR)
+
+    def value(self):
+        """Reads the level, which also acknowledges a pending edge."""
+        os.lseek(self.fd, 0, os.SEEK_SET)
+        return os.read(self.fd, 1) == b"1"
+
+    def wait_rising(self, timeout):
+        return bool(self.poller.poll(timeout * 1000)) and self.value()
+
+    def close(self):
+        os.close(self.fd)
+
+
+class SpiLink(Link):
+    """SPI master side of the bootloader SPI slave transport.
+
+    Every packet is sent as one transaction. After each transaction the slave
+    pulls the ready line low and raises it again once it can take the next
+    one; the response to a packet is clocked out by a one byte transaction.
+    """
+
+    def __init__(self, device, gpio, speed, timeout):
+        import spidev
+
+        bus, cs = device.rsplit("spidev", 1)[1].split(".")
+        self.name = device
+        self.timeout = timeout
+        self.spi = spidev.SpiDev()
+        self.spi.open(int(bus), int(cs))
+        self.spi.mode = 0
+        self.spi.max_speed_hz = speed
+        self.ready = ReadyLine(gpio)
+        self.encoder = Encoder()
+
+    def transfer(self, data):
+        if not self.ready.value() and not self.ready.wait_rising(self.timeout):
+            raise BootloaderError("%s: slave not ready" % self.name)
+        received = self.spi.xfer3(list(data))
+        if not self.ready.wait_rising(self.timeout):
+            raise BootloaderError("%s: slave busy" % self.name)
+        return received
+
+    def transact(self, command, parts):
+        self.transfer(b"".join(parts))
+        response = self.transfer(b"\x00")[0]
+        if response == SPI_NO_RESPONSE:
+            raise BootloaderError("%s: no response to command 0x%02x" % (self.name, command))
+        return response
+
+    def close(self):
+        self.spi.close()
+        self.ready.close()
+
+
+class CanBus:
+    """Raw CAN FD socket receiving only the given identifiers."""
+
+    def __init__(self, interface, ids):
+        flags = socket.CAN_SFF_MASK | socket.CAN_EFF_FLAG | socket.CAN_RTR_FLAG
+        self.sock = socket.socket(socket.AF_CAN, socket.SOCK_RAW, socket.CAN_RAW)
+        self.sock.setsockopt(socket.SOL_CAN_RAW, socket.CAN_RAW_FD_FRAMES, 1)
+        self.sock.setsockopt(socket.SOL_CAN_RAW, socket.CAN_RAW_FILTER,
+                             b"".join(struct.pack("=II", i, flags) for i in ids))
+        self.sock.bind((interface,))
+
+    def send(self, can_id, data):
+        length = next(n for n in CAN_FD_LENGTHS if n >= len(data))
+        frame = CANFD_FRAME.pack(can_id, length, CANFD_BRS, 0, 0,
+                                 bytes(data).ljust(64, bytes([CAN_PADDING])))
+        while True:
+            try:
+                self.sock.send(frame)
+                return
+            except OSError as e:
+                # Adapter queue full, the frame has not been taken
+                if e.errno != errno.ENOBUFS:
+                    raise
+                time.sleep(0.001)
+
+    def receive(self, timeout):
+        self.sock.settimeout(max(timeout, 0.001))
+        try:
+            frame = self.sock.recv(CANFD_FRAME.size)
+        except socket.timeout:
+            return None
+        can_id, length, _, _, _, data = CANFD_FRAME.unpack(frame.ljust(CANFD_FRAME.size, b"\0"))
+        return can_id & socket.CAN_SFF_MASK, data[:length]
+
+    def close(self):
+        self.sock.close()
+
+
+class CanLink(Link):
+    """ISO-TP unicast to one node. The node sends a flow control frame after
+    every block of consecutive frames, which keeps its Rx FIFO from
+    overflowing while it programs flash."""
+
+    def __init__(self, bus, node, timeout):
+        self.name = "node %d" % node
+        self.bus = bus
+        self.request_id = CAN_REQUEST_ID + node
+        self.response_id = CAN_RESPONSE_ID + node
+        self.timeout = timeout
+        self.encoder = Encoder()
+
+    def receive(self, timeout):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            frame = self.bus.receive(deadline - time.monotonic())
+            if frame and frame[0] == self.response_id and frame[1]:
+                return frame[1]
+        return None
+
+    def flow_control(self):
+        data = self.receive(self.timeout)
+        if data is None or data[0] & 0xF0 != 0x30:
+            raise BootloaderError("%s: no flow control" % self.name)
+        if data[0] != 0x30:
+            raise BootloaderError("%s: message refused" % self.name)
+        return data[1]
+
+    def send_message(self, message):
+        if len(message) <= 7:
+            self.bus.send(self.request_id, bytes([len(message)]) + message)
+            return
+        if len(message) <= 62:
+            self.bus.send(self.request_id, bytes([0, len(message)]) + message)
+            return
+
+        if len(message) > 4095:
+            first = bytes([0x10, 0]) + struct.pack(">I", len(message))
+        else:
+            first = struct.pack(">H", 0x1000 | len(message))
+        offset = 64 - len(first)
+        self.bus.send(self.request_id, first + message[:offset])
+
+        sequence = 1
+        block = self.flow_control()
+        left = block
+        while offset < len(message):
+            self.bus.send(self.request_id, bytes([0x20 | sequence]) + message[offset:offset + 63])
+            offset += 63
+            sequence = (sequence + 1) & 0x0F
+            if block and offset < len(message):
+                left -= 1
+                if left == 0:
+                    block = self.flow_control()
+                    left = block
+
+    def transact(self, command, parts):
+        self.send_message(b"".join(parts))
+        data = self.receive(self.timeout)
+        if data is None or data[0] != 0x01:
+            raise BootloaderError("%s: no response to command 0x%02x" % (self.name, command))
+        return data[1]
+
+    def close(self):
+        self.bus.close()
+
+
+class CanGateway(Link):
+    """Multicasts every packet to all nodes at once.
+
+    A packet goes out as numbered 56 byte segments without flow control.
+    Each node is then polled; its status reply carries the engine response,
+    or a bitmap of the segments it missed while it was busy. The union of
+    those is sent again until every node has answered.
+    """
+
+    def __init__(self, bus, nodes, timeout):
+        self.name = "gateway"
+        self.bus = bus
+        self.nodes = nodes
+        self.timeout = timeout
+        # A node still holding a message of an earlier run ignores segments
+        # with the same sequence number
+        self.sequence = os.urandom(1)[0]
+        self.encoder = Encoder()
+
+    def poll(self, node):
+        # Drop late replies to earlier polls
+        while self.bus.receive(0) is not None:
+            pass
+        self.bus.send(CAN_REQUEST_ID + node, b"\x50")
+        deadline = time.monotonic() + CAN_POLL_TIMEOUT
+        while time.monotonic() < deadline:
+            frame = self.bus.receive(deadline - time.monotonic())
+            if frame and frame[0] == CAN_RESPONSE_ID + node and frame[1][:1] == b"\x50":
+                return frame[1].ljust(64, b"\0")
+        return None
+
+    def expect_parts(self, command, parts, expected=BL_RESP_OK):
+        message = b"".join(parts)
+        count = (len(message) + CAN_SEGMENT_DATA - 1) // CAN_SEGMENT_DATA
+        self.sequence = (self.sequence + 1) & 0xFF
+
+        pending = set(range(count))
+        waiting = set(self.nodes)
+        failed = []
+        deadline = time.monotonic() + self.timeout
+
+        while waiting:
+            if time.monotonic() > deadline:
+                raise BootloaderError("nodes %s: no response to command 0x%02x" %
+                                      (sorted(waiting), command))
+            for index in sorted(pending):
+                offset = index * CAN_SEGMENT_DATA
+                self.bus.send(CAN_MULTICAST_ID,
+                              struct.pack("<BBHI", 0x40, self.sequence, index, len(message)) +
+                              message[offset:offset + CAN_SEGMENT_DATA])
+            pending = set()
+
+            for node in sorted(waiting):
+                status = self.poll(node)
+                if status is None:
+                    # Busy programming flash, ask again next round
+                    continue
+                if status[1] != self.sequence or not status[2] & CAN_STATUS_ACTIVE:
+                    pending.update(range(count))
+                elif status[3] != CAN_NO_RESPONSE:
+                    waiting.discard(node)
+                    if status[3] != expected:
+                        failed.append("%d (%s)" % (node, RESPONSES.get(status[3], hex(status[3]))))
+                else:
+                    bitmap = status[8:]
+                    pending.update(i for i in range(count) if bitmap[i // 8] >> (i % 8) & 1)
+
+        if failed:
+            raise BootloaderError("nodes %s: command 0x%02x failed" % (", ".join(failed), command))
+
+    def close(self):
+        self.bus.close()
+
+
+class Rs485Bus:
+    """Half-duplex pair with 9 bit characters. An address goes out with mark
+    parity, the packet after it with space parity."""
+
+    def __init__(self, port, baud):
+        self.name = port
+        self.serial = serial.Serial(port, baud, parity=serial.PARITY_SPACE)
+
+    def send(self, address, data=b""):
+        self.serial.reset_input_buffer()
+        self.serial.parity = serial.PARITY_MARK
+        self.serial.write(bytes([address]))
+        self.serial.flush()
+        self.serial.parity = serial.PARITY_SPACE
+        self.serial.write(data)
+        self.serial.flush()
+
+    def read(self, size, timeout):
+        self.serial.timeout = timeout
+        return self.serial.read(size)
+
+    def close(self):
+        self.serial.close()
+
+
+class Rs485Link(Link):
+    """Packets addressed to one node, answered like on a plain UART."""
+
+    def __init__(self, bus, node, timeout):
+        self.name = "node %d" % node
+        self.bus = bus
+        self.node = node
+        self.timeout = timeout
+        self.encoder = Encoder()
+        self.resync_delay = FEC_RESYNC_DELAY
+
+    def transact(self, command, parts):
+        self.bus.send(self.node, b"".join(parts))
+        response = self.bus.read(1, self.timeout)
+        if not response:
+            raise BootloaderError("%s: no response to command 0x%02x" % (self.name, command))
+        return response[0]
+
+    def resync(self):
+        mark(self.bus.serial, "resync")
+        time.sleep(self.resync_delay)
+
+    def close(self):
+        self.bus.close()
+
+
+def rs485_blocks(status, count):
+    """Blocks a node has not programmed since its last UNLOCK."""
+    bitmap = status[2:]
+    return set(i for i in range(count) if not bitmap[i // 8] >> (i % 8) & 1)
+
+
+def timeouts_fields(timeouts):
+    return tuple(round(t * 1000) for t in timeouts)
+
+
+def resync_delay(timeouts):
+    """Time the device surely takes to drop a broken packet."""
+    limits = [t for t in timeouts[:2] if t]
+    return 2 * min(limits) / 1000 if limits else FEC_RESYNC_DELAY
+
+
+def set_timeouts(links, timeouts):
+    """Sends the timeouts of the session over the first link, they apply to
+    every link of the device."""
+    links[0].expect(BL_CMD_TIMEOUTS, timeouts_fields(timeouts))
+    for link in links:
+        link.resync_delay = resync_delay(timeouts)
+
+
+def program_rs485(bus, nodes, prepared, swap, timeout, gap, cipher, fec, timeouts=None):
+    """Multicast session: the image crosses the bus about once whatever the
+    number of nodes, plus the blocks some node missed."""
+    count = prepared.count
+    links = dict((node, Rs485Link(bus, node, timeout)) for node in nodes)
+    encoder = Encoder()
+
+    def broadcast_parts(command, parts):
+        bus.send(RS485_BROADCAST, b"".join(parts))
+        time.sleep(gap)
+
+    def broadcast(command, fields=(), data=b""):
+        broadcast_parts(command, encoder.encode(command, fields, data))
+
+    def status(node):
+        bus.send(RS485_POLL | node)
+        data = bus.read(RS485_STATUS_SIZE, RS485_POLL_TIMEOUT)
+        return data if len(data) == RS485_STATUS_SIZE else None
+
+    if timeouts:
+        # A node that missed it keeps its longer defaults
+        broadcast(BL_CMD_TIMEOUTS, timeouts_fields(timeouts))
+        for link in links.values():
+            link.resync_delay = resync_delay(timeouts)
+
+    unlock = (prepared.address, prepared.size)
+    broadcast(BL_CMD_UNLOCK, unlock)
+    for node in nodes:
+        reply = status(node)
+        if reply is None or reply[0] != BL_RESP_OK or reply[1] != count or \
+                len(rs485_blocks(reply, count)) != count:
+            links[node].expect(BL_CMD_UNLOCK, unlock)
+
+    missing = dict((node, set(range(count))) for node in nodes)
+    for _ in range(RS485_ROUNDS):
+        blocks = set().union(*missing.values())
+        if not blocks:
+            break
+        for n in sorted(blocks):
+            broadcast_parts(*data_packet(encoder, prepared, n, cipher, fec and fec[0]))
+        for node in nodes:
+            reply = status(node)
+            if reply is not None:
+                missing[node] = rs485_blocks(reply, count)
+
+    # Whatever still failed goes to its node alone
+    for node in nodes:
+        strength = FecStrength(*fec) if fec else None
+        for n in sorted(missing[node]):
+            send_block(links[node], prepared, n, cipher, strength)
+
+    crc = (prepared.crc,)
+    failed = []
+    for node in nodes:
+        try:
+            links[node].expect(BL_CMD_VERIFY, crc, expected=BL_RESP_CRC_OK)
+        except BootloaderError as e:
+            failed.append(str(e))
+    if failed:
+        raise BootloaderError("; ".join(failed))
+
+    # A node that missed the broadcast is still in the bootloader and answers
+    # its poll
+    command = BL_CMD_BKSWAP_RESET if swap else BL_CMD_RESET
+    broadcast(command, (0,))
+    for node in nodes:
+        if status(node) is not None:
+            links[node].expect(command, (0,))
+
+
+def send_block(link, prepared, n, cipher, strength=None):
+    """Sends block n, as FEC_DATA if a strength is given. Those are sent
+    again until the device could correct one."""
+    if strength is None:
+        link.expect_parts(*data_packet(link.encoder, prepared, n, cipher))
+        return
+
+    for _ in range(FEC_RETRIES):
+        try:
+            response = link.transact(*data_packet(link.encoder, prepared, n, cipher, strength.parity))
+        except BootloaderError:
+            response = None
+        if response == BL_RESP_OK:
+            strength.passed()
+            return
+        strength.failed()
+        link.resync()
+
+    raise BootloaderError("%s: block at 0x%08x not taken after %d tries" %
+                          (link.name, prepared.address + n * ERASE_BLOCK_SIZE, FEC_RETRIES))
+
+
+def send_blocks(link, prepared, blocks, cipher, fec, errors):
+    strength = FecStrength(*fec) if fec else None
+    try:
+        for n in blocks:
+            send_block(link, prepared, n, cipher, strength)
+    except (BootloaderError, serial.SerialException, OSError) as e:
+        errors.append(e)
+
+
+def begin(link, manifest):
+    """Sends the manifest, True when the image has to be programmed and
+    False when the device already runs it."""
+    response = link.request(BL_CMD_BEGIN, manifest)
+    if response == BL_RESP_INSTALLED:
+        return False
+    if response == BL_RESP_INCOMPATIBLE:
+        raise BootloaderError("%s: the image is not for this hardware" % link.name)
+    if response != BL_RESP_OK:
+        raise BootloaderError("%s: command 0x%02x answered %s" %
+                              (link.name, BL_CMD_BEGIN, RESPONSES.get(response, hex(response))))
+    return True
+
+
+def program(links, prepared, swap, cipher, partition=None, fec=None, timeouts=None, manifest=None):
+    """Programs the image, False when BEGIN found it already installed."""
+    primary = links[0]
+
+    if timeouts:
+        set_timeouts(links, timeouts)
+
+    if manifest is not None and not begin(primary, manifest):
+        primary.expect(BL_CMD_RESET, (0,))
+        return False
+
+    if partition is None:
+        primary.expect(BL_CMD_UNLOCK, (prepared.address, prepared.size))
+    else:
+        primary.expect(BL_CMD_PARTITION, (partition, prepared.size))
+
+    errors = []
+    workers = []
+    for i, link in enumerate(links):
+        blocks = range(i, prepared.count, len(links))
+        worker = threading.Thread(target=send_blocks, args=(link, prepared, blocks, cipher, fec, errors))
+        worker.start()
+        workers.append(worker)
+    for worker in workers:
+        worker.join()
+    if errors:
+        raise errors[0]
+
+    primary.expect(BL_CMD_VERIFY, (prepared.crc,), expected=BL_RESP_CRC_OK)
+
+    command = BL_CMD_BKSWAP_RESET if swap else BL_CMD_RESET
+    primary.expect(command, (0,))
+    return True
+
+
+def self_update(link, prepared, cipher, fec=None, timeouts=None, manifest=None):
+    """Stages a bootloader, has the device write it to the inactive bank
+    along with the application and swaps the banks."""
+    if timeouts:
+        set_timeouts([link], timeouts)
+
+    if manifest is not None:
+        begin(link, manifest)
+
+    link.expect(BL_CMD_UNLOCK, (prepared.address, prepared.size))
+
+    errors = []
+    send_blocks(link, prepared, range(prepared.count), cipher, fec, errors)
+    if errors:
+        raise errors[0]
+
+    link.expect(BL_CMD_VERIFY, (prepared.crc,), expected=BL_RESP_CRC_OK)
+
+    for _ in range(SELF_UPDATE_TRIES):
+        response = link.request(BL_CMD_SELF_UPDATE, (prepared.address, prepared.crc))
+        if response == BL_RESP_CRC_OK:
+            break
+        if response != BL_RESP_CRC_FAIL:
+            raise BootloaderError("%s: command 0x%02x answered %s" %
+                                  (link.name, BL_CMD_SELF_UPDATE, RESPONSES.get(response, hex(response))))
+    else:
+        raise BootloaderError("%s: the inactive bank could not be written, the running bootloader is kept"
+                              % link.name)
+
+    link.expect(BL_CMD_BKSWAP_RESET, (0,))
+
+
+def program_container(link, container, swap, timeouts=None, identity=None):
+    """Streams an update container, the device unlocks the region of its
+    manifest and decodes the pieces as they come. With an identity, the
+    version and hardware ID, the region is announced with BEGIN first."""
+    _, _, _, start, end, region_crc, _, _ = CONTAINER_MANIFEST.unpack_from(container)
+
+    if timeouts:
+        set_timeouts([link], timeouts)
+
+    if identity is not None and not begin(link, (start, end - start, region_crc) + identity):
+        link.expect(BL_CMD_RESET, (0,))
+        return None
+
+    pieces = memoryview(container)
+    for offset in range(0, len(container), ERASE_BLOCK_SIZE):
+        link.expect(BL_CMD_STREAM, (offset,), pieces[offset:offset + ERASE_BLOCK_SIZE])
+
+    link.expect(BL_CMD_VERIFY, (region_crc,), expected=BL_RESP_CRC_OK)
+
+    command = BL_CMD_BKSWAP_RESET if swap else BL_CMD_RESET
+    link.expect(command, (0,))
+    return start, end
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-p", "--port", action="append",
+                        help="serial port, give twice to stripe over two UARTs")
+    parser.add_argument("-b", "--baud", type=int, default=115200)
+    parser.add_argument("--bit-rate", type=int, help="serial bit rate to switch to once connected at --baud")
+    parser.add_argument("--spi", help="spidev device wired to the SPI slave")
+    parser.add_argument("--ready-gpio", type=int, help="GPIO number of the ready line")
+    parser.add_argument("--spi-speed", type=int, default=12000000, help="SPI clock in Hz")
+    parser.add_argument("--can", help="SocketCAN interface the nodes are on")
+    parser.add_argument("--node", type=int, action="append",
+                        help="CAN or RS-485 node ID, give several to multicast to all of them")
+    parser.add_argument("--rs485", help="serial port on the RS-485 bus")
+    parser.add_argument("--block-gap", type=float, default=0.1,
+                        help="seconds between RS-485 broadcasts, time to program a block")
+    parser.add_argument("-i", "--input", required=True, help="application binary")
+    parser.add_argument("-a", "--address", type=lambda x: int(x, 0),
+                        help="where the image goes, 0x%x by default" % APP_START_ADDRESS)
+    parser.add_argument("-s", "--swap", action="store_true",
+                        help="swap flash banks instead of a plain reset")
+    parser.add_argument("-t", "--timeout", type=float, default=5.0,
+                        help="seconds to wait for each response")
+    parser.add_argument("-k", "--key", type=bytes.fromhex,
+                        help="AES-128 key in hex, sends the blocks encrypted")
+    parser.add_argument("--partition", type=lambda x: int(x, 0),
+                        help="partition ID to update, --address is where it starts")
+    parser.add_argument("--fec", type=int,
+                        help="parity bytes per codeword, sends the blocks as FEC_DATA")
+    parser.add_argument("--fec-max", type=int, default=32,
+                        help="most parity bytes to go up to, BTL_FEC_PARITY_MAX of the device")
+    parser.add_argument("--timeouts", type=lambda x: [float(t) for t in x.split(",")],
+                        help="BYTE,PACKET,SESSION receive timeouts of the device in ms, 0 for none")
+    parser.add_argument("--cache", nargs="?", const=btl_cache.default_root(),
+                        help="take the prepared image from this cache, $BTL_CACHE or ~/.cache/btl by default")
+    parser.add_argument("--begin", action="store_true",
+                        help="send the manifest of the image with BEGIN before unlocking")
+    parser.add_argument("--version", type=lambda x: int(x, 0),
+                        help="image version for BEGIN, instead of the one in the image")
+    parser.add_argument("--hardware", type=lambda x: int(x, 0),
+                        help="hardware ID for BEGIN, instead of the one in the image")
+    parser.add_argument("--self-update", action="store_true",
+                        help="the input is a bootloader: stage it at --address and replace the running one")
+    parser.add_argument("--capture", help="record the serial traffic to this file for btl_capture.py")
+    args = parser.parse_args()
+
+    if args.address is None:
+        args.address = SELF_UPDATE_STAGE if args.self_update else APP_START_ADDRESS
+
+    if sum(1 for link in (args.port, args.spi, args.can, args.rs485) if link) != 1:
+        parser.error("give either serial ports, an SPI device, a CAN interface or an RS-485 port")
+    if args.port and len(args.port) > 2:
+        parser.error("at most two ports are supported")
+    if args.spi and args.ready_gpio is None:
+        parser.error("--spi needs --ready-gpio")
+    if (args.can or args.rs485) and not args.node:
+        parser.error("--can and --rs485 need --node")
+    if args.bit_rate is not None and not args.port:
+        parser.error("--bit-rate is for serial ports")
+    if args.capture and not (args.port or (args.rs485 and len(args.node) == 1)):
+        parser.error("--capture records serial ports or a single RS-485 node")
+
+    fec = None
+    if args.fec is not None:
+        if not 2 <= args.fec <= args.fec_max <= rsfec.PARITY_MAX or args.fec % 2 or args.fec_max % 2:
+            parser.error("--fec and --fec-max have to be even, 2 <= FEC <= FEC_MAX <= %d" % rsfec.PARITY_MAX)
+        if args.key is not None or args.spi or args.can:
+            parser.error("--fec is for plain blocks over serial and RS-485 links")
+        fec = (args.fec, args.fec_max)
+
+    if args.timeouts is not None:
+        if len(args.timeouts) != 3 or any(t and not TIMEOUT_MIN <= t < 2 ** 32 / 1000 for t in args.timeouts):
+            parser.error("--timeouts takes BYTE,PACKET,SESSION, each 0 or at least %g ms" % TIMEOUT_MIN)
+
+    cipher = None
+    if args.key is not None:
+        if len(args.key) != KEY_SIZE:
+            parser.error("the key has to be %d bytes" % KEY_SIZE)
+        from cryptography.hazmat.primitives.ciphers.aead import AESGCM
+        cipher = AESGCM(args.key)
+
+    with open(args.input, "rb") as f:
+        image = f.read()
+
+    is_container = image[:4] == struct.pack("<I", CONTAINER_MAGIC)
+    if is_container and (cipher is not None or fec or (args.rs485 and len(args.node) > 1)):
+        parser.error("containers are sent plain and to one RS-485 node at a time")
+    if args.partition is not None and (is_container or (args.rs485 and len(args.node) > 1)):
+        parser.error("--partition takes a plain binary and one node at a time")
+    if args.begin and args.node and len(args.node) > 1:
+        parser.error("--begin goes to one node at a time")
+    if args.self_update:
+        if is_container or args.partition is not None or args.swap or (args.node and len(args.node) > 1):
+            parser.error("--self-update takes a plain binary for one node and no --partition or --swap")
+        if len(image) > BOOTLOADER_SIZE:
+            parser.error("a bootloader is at most %d bytes" % BOOTLOADER_SIZE)
+        if args.address % ERASE_BLOCK_SIZE or not APP_START_ADDRESS <= args.address <= BANK_SIZE - BOOTLOADER_SIZE:
+            parser.error("the bootloader has to be staged in an erase block of the application area "
+                         "below 0x%x" % BANK_SIZE)
+        args.timeout = max(args.timeout, SELF_UPDATE_TIMEOUT)
+
+    prepared = None
+    if not is_container:
+        prepared = btl_cache.prepare(image, args.address, args.cache)
+        if not prepared.header_ok():
+            print("warning: the binary header CRC does not match, the bootloader will not start the image",
+                  file=sys.stderr)
+
+    manifest = None
+    if args.begin and args.self_update:
+        manifest = (prepared.address, BOOTLOADER_SIZE, prepared.crc, args.version or 0, args.hardware or 0)
+    elif args.begin and not is_container:
+        header = prepared.header
+        if header is None:
+            parser.error("--begin needs an image with a binary header")
+        version = header["version"] if args.version is None else args.version
+        hardware = header["hardware"] if args.hardware is None else args.hardware
+        manifest = (prepared.address, header["size"], header["crc"], version or 0, hardware or 0)
+
+    if args.spi:
+        links = [SpiLink(args.spi, args.ready_gpio, args.spi_speed, args.timeout)]
+    elif args.can:
+        bus = CanBus(args.can, [CAN_RESPONSE_ID + node for node in args.node])
+        if len(args.node) == 1:
+            links = [CanLink(bus, args.node[0], args.timeout)]
+        else:
+            links = [CanGateway(bus, args.node, args.timeout)]
+    elif args.rs485:
+        bus = Rs485Bus(args.rs485, args.baud)
+        links = [Rs485Link(bus, args.node[0], args.timeout)]
+    else:
+        links = [Link(port, args.baud, args.timeout) for port in args.port]
+    capture = None
+    if args.capture:
+        capture = btl_capture.Capture(args.capture, args.bit_rate or args.baud,
+                                      btl_capture.RS485_BITS if args.rs485 else btl_capture.UART_BITS)
+        if args.rs485:
+            bus.serial = capture.wrap(bus.serial)
+        else:
+            for n, link in enumerate(links):
+                link.serial = capture.wrap(link.serial, n)
+    programmed = True
+    try:
+        if args.bit_rate is not None:
+            for link in links:
+                link.set_bit_rate(args.bit_rate)
+        if is_container:
+            region = program_container(links[0], image, args.swap, args.timeouts,
+                                       (args.version or 0, args.hardware or 0) if args.begin else None)
+            programmed = region is not None
+        elif args.self_update:
+            self_update(links[0], prepared, cipher, fec, args.timeouts, manifest)
+        elif args.rs485 and len(args.node) > 1:
+            program_rs485(bus, args.node, prepared, args.swap, args.timeout, args.block_gap,
+                          cipher, fec, args.timeouts)
+        else:
+            programmed = program(links, prepared, args.swap, cipher, args.partition, fec, args.timeouts,
+                                 manifest)
+    except (BootloaderError, serial.SerialException, OSError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+    finally:
+        for link in links:
+            link.close()
+        if capture is not None:
+            capture.close()
+
+    if not programmed:
+        print("already installed, reset only")
+    elif args.self_update:
+        print("replaced the bootloader with the copy staged at 0x%08x, banks swapped" % args.address)
+    elif is_container:
+        print("programmed 0x%08x..0x%08x from a %d byte container" % (region[0], region[1], len(image)))
+    else:
+        print("programmed %d bytes at 0x%08x" % (len(image), args.address))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
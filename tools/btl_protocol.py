@@ -0,0 +1,155 @@
+"""Bootloader protocol definitions.
+
+Generated by btlgen.py from btl_protocol.json, do not edit.
+
+Every packet is a header followed by the payload of its command. The payload
+is the fixed fields of the command, packed with FIELDS[command], followed by
+its data, if the command has any:
+
+    encoder = Encoder()
+    header, data = encoder.encode(BL_CMD_DATA, (address,), block)
+    port.write(header)
+    port.write(data)
+
+The encoder packs the header and the fields into a buffer it keeps and hands
+back a view of it along with the data untouched, so a block is never copied
+on its way to the port. The view is valid until the next encode().
+"""
+
+import struct
+
+BTL_GUARD = 0x5048434D
+
+HEADER = struct.Struct("<IIB")
+HEADER_SIZE = HEADER.size
+
+BLOCK_SIZE = 8192
+NONCE_SIZE = 12
+TAG_SIZE = 16
+
+BL_CMD_UNLOCK = 0xA0
+BL_CMD_DATA = 0xA1
+BL_CMD_VERIFY = 0xA2
+BL_CMD_RESET = 0xA3
+BL_CMD_BKSWAP_RESET = 0xA4
+BL_CMD_ENC_DATA = 0xA5
+BL_CMD_STREAM = 0xA6
+BL_CMD_PARTITION = 0xA7
+BL_CMD_FEC_DATA = 0xA8
+BL_CMD_TIMEOUTS = 0xA9
+BL_CMD_BEGIN = 0xAA
+BL_CMD_SELF_UPDATE = 0xAB
+BL_CMD_BIT_RATE = 0xAC
+
+BL_RESP_OK = 0x50
+BL_RESP_ERROR = 0x51
+BL_RESP_INVALID = 0x52
+BL_RESP_CRC_OK = 0x53
+BL_RESP_CRC_FAIL = 0x54
+BL_RESP_FEC_FAIL = 0x55
+BL_RESP_INSTALLED = 0x56
+BL_RESP_INCOMPATIBLE = 0x57
+
+COMMANDS = {
+    BL_CMD_UNLOCK: "UNLOCK",
+    BL_CMD_DATA: "DATA",
+    BL_CMD_VERIFY: "VERIFY",
+    BL_CMD_RESET: "RESET",
+    BL_CMD_BKSWAP_RESET: "BKSWAP_RESET",
+    BL_CMD_ENC_DATA: "ENC_DATA",
+    BL_CMD_STREAM: "STREAM",
+    BL_CMD_PARTITION: "PARTITION",
+    BL_CMD_FEC_DATA: "FEC_DATA",
+    BL_CMD_TIMEOUTS: "TIMEOUTS",
+    BL_CMD_BEGIN: "BEGIN",
+    BL_CMD_SELF_UPDATE: "SELF_UPDATE",
+    BL_CMD_BIT_RATE: "BIT_RATE",
+}
+
+RESPONSES = {
+    BL_RESP_OK: "OK",
+    BL_RESP_ERROR: "ERROR",
+    BL_RESP_INVALID: "INVALID",
+    BL_RESP_CRC_OK: "CRC_OK",
+    BL_RESP_CRC_FAIL: "CRC_FAIL",
+    BL_RESP_FEC_FAIL: "FEC_FAIL",
+    BL_RESP_INSTALLED: "INSTALLED",
+    BL_RESP_INCOMPATIBLE: "INCOMPATIBLE",
+}
+
+# Fixed fields of each payload, in front of the data
+FIELDS = {
+    BL_CMD_UNLOCK: struct.Struct("<II"),
+    BL_CMD_DATA: struct.Struct("<I"),
+    BL_CMD_VERIFY: struct.Struct("<I"),
+    BL_CMD_RESET: struct.Struct("<I"),
+    BL_CMD_BKSWAP_RESET: struct.Struct("<I"),
+    BL_CMD_ENC_DATA: struct.Struct("<I12s16s"),
+    BL_CMD_STREAM: struct.Struct("<I"),
+    BL_CMD_PARTITION: struct.Struct("<II"),
+    BL_CMD_FEC_DATA: struct.Struct("<I"),
+    BL_CMD_TIMEOUTS: struct.Struct("<III"),
+    BL_CMD_BEGIN: struct.Struct("<IIIII"),
+    BL_CMD_SELF_UPDATE: struct.Struct("<II"),
+    BL_CMD_BIT_RATE: struct.Struct("<I"),
+}
+
+# Smallest and largest data of each command, None for no limit
+DATA_SIZES = {
+    BL_CMD_UNLOCK: (0, 0),
+    BL_CMD_DATA: (BLOCK_SIZE, BLOCK_SIZE),
+    BL_CMD_VERIFY: (0, 0),
+    BL_CMD_RESET: (0, 0),
+    BL_CMD_BKSWAP_RESET: (0, 0),
+    BL_CMD_ENC_DATA: (BLOCK_SIZE, BLOCK_SIZE),
+    BL_CMD_STREAM: (0, BLOCK_SIZE),
+    BL_CMD_PARTITION: (0, 0),
+    BL_CMD_FEC_DATA: (0, None),
+    BL_CMD_TIMEOUTS: (0, 0),
+    BL_CMD_BEGIN: (0, 0),
+    BL_CMD_SELF_UPDATE: (0, 0),
+    BL_CMD_BIT_RATE: (0, 0),
+}
+
+
+def name(command):
+    return COMMANDS.get(command, "0x%02x" % command)
+
+
+class Encoder:
+    """Assembles packets in a buffer of its own, one per link."""
+
+    def __init__(self):
+        size = HEADER_SIZE + max(s.size for s in FIELDS.values())
+        self.buffer = bytearray(size)
+        self.view = memoryview(self.buffer)
+
+    def encode(self, command, fields=(), data=b""):
+        """Header and fields of the packet as a view of the buffer, and the
+        data as given."""
+        layout = FIELDS[command]
+        low, high = DATA_SIZES[command]
+        size = memoryview(data).nbytes
+        if size < low or (high is not None and size > high):
+            raise ValueError("%s: %d bytes of data" % (name(command), size))
+        HEADER.pack_into(self.buffer, 0, BTL_GUARD, layout.size + size, command)
+        layout.pack_into(self.buffer, HEADER_SIZE, *fields)
+        return self.view[:HEADER_SIZE + layout.size], data
+
+    def packet(self, command, fields=(), data=b""):
+        """The whole packet in one piece, for links that frame it."""
+        head, data = self.encode(command, fields, data)
+        return b"".join((head, data))
+
+
+def decode(packet):
+    """Command, fields and data of a whole packet, the data as a view of
+    it."""
+    guard, size, command = HEADER.unpack_from(packet)
+    if guard != BTL_GUARD or command not in FIELDS:
+        raise ValueError("not a bootloader packet")
+    layout = FIELDS[command]
+    payload = memoryview(packet)[HEADER_SIZE:HEADER_SIZE + size]
+    if len(payload) != size or size < layout.size:
+        raise ValueError("%s: truncated" % name(command))
+    return command, layout.unpack_from(payload), payload[layout.size:]
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Size and startup time report of a bootloader ELF.
+
+Prints the output sections of the linked bootloader, the flash and RAM they
+take and the CPU cycles Reset_Handler spends initialising .data and .bss
+before main():
+
+    btl_size.py bootloader.X/dist/default/production/bootloader.X.production.elf
+
+The cycle count is estimated from the section sizes with the Cortex-M4
+instruction timings at zero wait states for the word loops of
+startup_xc32.c. .no_init buffers cost nothing; what zeroing them would
+cost is printed as the saving. A count measured on the board with
+BTL_STARTUP_CYCLES, read from startup_cycles with the debugger, is printed
+next to them with --measured. --history appends
+one CSV row per run to track the numbers from build to build:
+
+    btl_size.py app.elf --measured 3120 --label v1.4 --history size.csv
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+
+ROM_SIZE = 8192
+RAM_START = 0x20000000
+RAM_SIZE = 0x40000
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+# Cycles per word of the loops: LDR, STR, CMP and a taken branch for the
+# copy, STR, CMP and a taken branch for the fill
+WORD_COPY_CYCLES = 2 + 1 + 1 + 3
+WORD_FILL_CYCLES = 2 + 1 + 3
+
+HISTORY_FIELDS = ["label", "flash", "ram", "data", "bss", "no_init",
+                  "cycles", "no_init_cycles", "measured"]
+
+
+def read_sections(path):
+    """Name, address, size and flags of the allocated sections, in file
+    order."""
+    with open(path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+        raise ValueError("%s: not a little endian ELF32 file" % path)
+    shoff, = struct.unpack_from("<I", elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+    headers = [struct.unpack_from("<IIIIIIIIII", elf, shoff + i * shentsize) for i in range(shnum)]
+    strtab = headers[shstrndx][4]
+
+    def name(offset):
+        end = elf.index(b"\0", strtab + offset)
+        return elf[strtab + offset:end].decode()
+
+    return [(name(h[0]), h[3], h[5], h[1]) for h in headers
+            if h[2] & SHF_ALLOC and h[5]]
+
+
+def report(sections):
+    sizes = {name: size for name, _, size, _ in sections}
+    flash = sum(size for _, _, size, kind in sections if kind != SHT_NOBITS)
+    ram = sum(size for _, addr, size, _ in sections if addr >= RAM_START)
+    data, bss = sizes.get(".data", 0), sizes.get(".bss", 0)
+    no_init = sizes.get(".no_init", 0)
+    return {
+        "flash": flash,
+        "ram": ram,
+        "data": data,
+        "bss": bss,
+        "no_init": no_init,
+        "cycles": data // 4 * WORD_COPY_CYCLES + bss // 4 * WORD_FILL_CYCLES,
+        "no_init_cycles": no_init // 4 * WORD_FILL_CYCLES,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="linked bootloader")
+    parser.add_argument("--measured", type=int, help="startup_cycles read on the board")
+    parser.add_argument("--label", help="name of the build in the history, the ELF name by default")
+    parser.add_argument("--history", help="CSV file to append the numbers to")
+    args = parser.parse_args()
+
+    try:
+        sections = read_sections(args.elf)
+    except (ValueError, OSError, struct.error) as e:
+        parser.error(str(e))
+
+    print("%-12s %10s %8s" % ("section", "address", "size"))
+    for name, addr, size, kind in sections:
+        print("%-12s 0x%08x %8d%s" % (name, addr, size, " NOLOAD" if kind == SHT_NOBITS else ""))
+
+    r = report(sections)
+    print()
+    print("flash %6d of %6d bytes" % (r["flash"], ROM_SIZE))
+    print("ram   %6d of %6d bytes, %d left uninitialised" % (r["ram"], RAM_SIZE, r["no_init"]))
+    print()
+    print("startup to main(), %d bytes copied and %d zeroed:" % (r["data"], r["bss"]))
+    print("  estimated     %8d cycles" % r["cycles"])
+    print("  .no_init      %8d cycles saved, estimated" % r["no_init_cycles"])
+    if args.measured is not None:
+        print("  measured      %8d cycles" % args.measured)
+
+    if args.history:
+        new = not os.path.exists(args.history)
+        with open(args.history, "a", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=HISTORY_FIELDS)
+            if new:
+                writer.writeheader()
+            writer.writerow(dict(r, label=args.label or os.path.basename(args.elf),
+                                 measured="" if args.measured is None else args.measured))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,434 @@
+#!/usr/bin/env python3
+"""Generates the bootloader protocol definitions from btl_protocol.json.
+
+The schema is the one place where packets are defined. From it this script
+writes the C header of the device and the Python module of the host tools:
+
+    bootloader_commands.h   header layout, command and response codes, and
+                            a payload struct per command that the engine
+                            lays over its receive buffer
+    btl_protocol.py         the same codes, a struct.Struct per command and
+                            an Encoder that assembles packets without
+                            copying their data
+
+Both generated files are checked in, so building the firmware does not need
+Python. After editing the schema run
+
+    btlgen.py
+
+and commit the schema together with both outputs. --check only compares
+them with what the schema gives and fails if either is stale.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+SCHEMA = os.path.join(TOOLS, "btl_protocol.json")
+C_HEADER = os.path.join(TOOLS, "..", "firmware", "src", "config", "default",
+                        "bootloader", "bootloader_commands.h")
+PY_MODULE = os.path.join(TOOLS, "btl_protocol.py")
+
+SCALARS = {
+    "u8": ("uint8_t", "B", 1),
+    "u16": ("uint16_t", "H", 2),
+    "u32": ("uint32_t", "I", 4),
+}
+
+C_LICENSE = """\
+// DOM-IGNORE-BEGIN
+/*******************************************************************************
+* Copyright (C) 2019 Microchip Technology Inc. and its subsidiaries.
+*
+* Subject to your compliance with these terms, you may use Microchip software
+* and any derivatives exclusively with Microchip products. It is your
+* responsibility to comply with third party license terms applicable to your
+* use of third party software (including open source software) that may
+* accompany Microchip software.
+*
+* THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+* EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+* WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+* PARTICULAR PURPOSE.
+*
+* IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+* INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+* WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+* BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+* FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+* ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+* THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *******************************************************************************/
+// DOM-IGNORE-END
+"""
+
+
+class SchemaError(Exception):
+    pass
+
+
+class Field:
+    def __init__(self, spec, constants):
+        self.name = spec["name"]
+        self.type = spec["type"]
+        self.doc = spec.get("doc")
+        self.size_name = spec.get("size") or spec.get("max")
+        self.bounded = "max" in spec
+        if self.type in SCALARS:
+            self.size = SCALARS[self.type][2]
+        elif self.type == "bytes":
+            if self.size_name is not None and self.size_name not in constants:
+                raise SchemaError("%s: unknown size %s" % (self.name, self.size_name))
+            self.size = constants.get(self.size_name)
+        else:
+            raise SchemaError("%s: unknown type %s" % (self.name, self.type))
+
+    @property
+    def variable(self):
+        """Length not fixed by the schema: up to a maximum or unbounded."""
+        return self.type == "bytes" and (self.bounded or self.size is None)
+
+
+class Command:
+    def __init__(self, spec, constants):
+        self.name = spec["name"]
+        self.code = int(spec["code"], 0)
+        self.doc = spec.get("doc")
+        self.fields = [Field(f, constants) for f in spec["fields"]]
+        self.layout()
+
+    def layout(self):
+        """Offsets of the fields, each aligned to its own size so that the C
+        struct needs no packing. Only the last field may vary in length."""
+        offset = 0
+        self.offsets = []
+        for i, field in enumerate(self.fields):
+            if field.variable and i != len(self.fields) - 1:
+                raise SchemaError("%s.%s: only the last field can vary in length" %
+                                  (self.name, field.name))
+            if field.type in SCALARS and offset % field.size:
+                raise SchemaError("%s.%s: misaligned %s" % (self.name, field.name, field.type))
+            self.offsets.append(offset)
+            offset += field.size or 0
+
+    @property
+    def head(self):
+        """Fields packed in front of the data, which is the last field if
+        that is a byte string."""
+        return self.fields[:-1] if self.fields[-1].type == "bytes" else self.fields
+
+    @property
+    def data(self):
+        return self.fields[-1] if self.fields[-1].type == "bytes" else None
+
+
+def load(path):
+    with open(path) as f:
+        schema = json.load(f)
+    constants = dict((c["name"], c["value"]) for c in schema["constants"])
+    schema["command_list"] = [Command(c, constants) for c in schema["commands"]]
+
+    header_offset = 0
+    schema["header_offsets"] = {}
+    for spec in schema["header"]:
+        schema["header_offsets"][spec["name"]] = header_offset
+        header_offset += SCALARS[spec["type"]][2]
+    schema["header_size"] = header_offset
+    if [h["name"] for h in schema["header"]] != ["guard", "size", "command"]:
+        raise SchemaError("the header has to be guard, size and command")
+
+    codes = [c.code for c in schema["command_list"]] + [int(r["code"], 0) for r in schema["responses"]]
+    if len(set(codes)) != len(codes):
+        raise SchemaError("command and response codes have to be unique")
+    return schema
+
+
+def wrap(text, prefix, width=78):
+    lines = []
+    line = ""
+    for word in text.split():
+        if line and len(prefix) + len(line) + 1 + len(word) > width:
+            lines.append(line)
+            line = word
+        else:
+            line = (line + " " + word) if line else word
+    if line:
+        lines.append(line)
+    return lines
+
+
+def c_comment(text, indent=""):
+    lines = wrap(text, indent + " * ")
+    if len(lines) == 1 and len(indent) + len(lines[0]) + 6 <= 78:
+        return [indent + "/* " + lines[0] + " */"]
+    out = [indent + "/* " + lines[0]]
+    out += [indent + " * " + l for l in lines[1:]]
+    out[-1] += " */"
+    return out
+
+
+def c_size(command):
+    """Payload size, the largest one for a bounded tail."""
+    terms = []
+    fixed = 0
+    for field in command.fields:
+        if field.type in SCALARS:
+            fixed += field.size
+        elif field.size_name is not None:
+            terms.append("BTL_" + field.size_name)
+    if fixed or not terms:
+        terms.insert(0, "%dU" % fixed)
+    return terms[0] if len(terms) == 1 else "(" + " + ".join(terms) + ")"
+
+
+def c_member(field, offset):
+    if field.type in SCALARS:
+        return "%s %s;" % (SCALARS[field.type][0], field.name)
+    if field.variable:
+        return "uint8_t %s[];" % field.name
+    if offset % 4 == 0 and field.size % 4 == 0:
+        return "uint32_t %s[BTL_%s / 4U];" % (field.name, field.size_name)
+    return "uint8_t %s[BTL_%s];" % (field.name, field.size_name)
+
+
+def generate_c(schema):
+    out = []
+    out.append("""\
+/*******************************************************************************
+  Bootloader Protocol Commands Header File
+
+  File Name:
+    bootloader_commands.h
+
+  Summary:
+    This file contains the packet layouts of the bootloader protocol.
+
+  Description:
+    Generated by tools/btlgen.py from tools/btl_protocol.json, do not edit.
+    Every payload struct is laid over the word aligned receive buffer of a
+    link, so the engine reads the fields in place. Fields are aligned to
+    their size and need no packing; a variable length tail is a flexible
+    array member and sizeof() of its struct is the size of the fields in
+    front of it.
+ *******************************************************************************/
+""")
+    out.append(C_LICENSE)
+    out.append("#ifndef BOOTLOADER_COMMANDS_H")
+    out.append("#define BOOTLOADER_COMMANDS_H")
+    out.append("")
+    out.append("#include <stdint.h>")
+    out.append("")
+    out.append("#define BTL_GUARD               (%sUL)" % schema["guard"])
+    out.append("")
+
+    offsets = schema["header_offsets"]
+    out += c_comment("Header: %s. It is not padded on the wire, so sizeof(struct "
+                     "btl_header) is more than BTL_HEADER_SIZE." %
+                     ", ".join("%s (%d)" % (h["name"], SCALARS[h["type"]][2]) for h in schema["header"]))
+    out.append("#define BTL_HEADER_SIZE         %dU" % schema["header_size"])
+    out.append("#define BTL_GUARD_OFFSET        %dU" % offsets["guard"])
+    out.append("#define BTL_SIZE_OFFSET         %dU" % offsets["size"])
+    out.append("#define BTL_CMD_OFFSET          %dU" % offsets["command"])
+    out.append("")
+    out.append("struct btl_header")
+    out.append("{")
+    for h in schema["header"]:
+        out.append("    %s %s;" % (SCALARS[h["type"]][0], h["name"]))
+    out.append("};")
+    out.append("")
+
+    for c in schema["constants"]:
+        if c.get("doc"):
+            out += c_comment(c["doc"][0].upper() + c["doc"][1:])
+        out.append("#define %-23s %dU" % ("BTL_" + c["name"], c["value"]))
+    out.append("")
+
+    for command in schema["command_list"]:
+        doc = "Payload of %s" % command.name
+        if command.doc:
+            first = command.doc.split()[0]
+            doc += ": " + (command.doc if first[1:] != first[1:].lower() else
+                           command.doc[0].lower() + command.doc[1:])
+        out += c_comment(doc)
+        out.append("struct btl_%s_payload" % command.name.lower())
+        out.append("{")
+        for field, offset in zip(command.fields, command.offsets):
+            out.append("    " + c_member(field, offset))
+        out.append("};")
+        if command.data is None or not command.data.variable or command.data.bounded:
+            out.append("#define %-27s %s" % ("BTL_%s_PAYLOAD_SIZE" % command.name, c_size(command)))
+        out.append("")
+
+    out.append("enum")
+    out.append("{")
+    width = max(len(c.name) for c in schema["command_list"]) + len("BL_CMD_")
+    for command in schema["command_list"]:
+        out.append("    %-*s = 0x%02x," % (width, "BL_CMD_" + command.name, command.code))
+    out.append("};")
+    out.append("")
+    out.append("enum")
+    out.append("{")
+    width = max(len(r["name"]) for r in schema["responses"]) + len("BL_RESP_")
+    for response in schema["responses"]:
+        out.append("    %-*s = 0x%02x," % (width, "BL_RESP_" + response["name"], int(response["code"], 0)))
+    out.append("};")
+    out.append("")
+    out.append("#endif")
+    return "\n".join(out) + "\n"
+
+
+def generate_py(schema):
+    header_format = "<" + "".join(SCALARS[h["type"]][1] for h in schema["header"])
+    out = []
+    out.append('''\
+"""Bootloader protocol definitions.
+
+Generated by btlgen.py from btl_protocol.json, do not edit.
+
+Every packet is a header followed by the payload of its command. The payload
+is the fixed fields of the command, packed with FIELDS[command], followed by
+its data, if the command has any:
+
+    encoder = Encoder()
+    header, data = encoder.encode(BL_CMD_DATA, (address,), block)
+    port.write(header)
+    port.write(data)
+
+The encoder packs the header and the fields into a buffer it keeps and hands
+back a view of it along with the data untouched, so a block is never copied
+on its way to the port. The view is valid until the next encode().
+"""
+
+import struct
+''')
+    out.append("BTL_GUARD = %s" % schema["guard"])
+    out.append("")
+    out.append('HEADER = struct.Struct("%s")' % header_format)
+    out.append("HEADER_SIZE = HEADER.size")
+    out.append("")
+    for c in schema["constants"]:
+        out.append("%s = %d" % (c["name"], c["value"]))
+    out.append("")
+    for command in schema["command_list"]:
+        out.append("BL_CMD_%s = 0x%02X" % (command.name, command.code))
+    out.append("")
+    for response in schema["responses"]:
+        out.append("BL_RESP_%s = 0x%02X" % (response["name"], int(response["code"], 0)))
+    out.append("")
+    out.append("COMMANDS = {")
+    for command in schema["command_list"]:
+        out.append('    BL_CMD_%s: "%s",' % (command.name, command.name))
+    out.append("}")
+    out.append("")
+    out.append("RESPONSES = {")
+    for response in schema["responses"]:
+        out.append('    BL_RESP_%s: "%s",' % (response["name"], response["name"]))
+    out.append("}")
+    out.append("")
+    out.append("# Fixed fields of each payload, in front of the data")
+    out.append("FIELDS = {")
+    for command in schema["command_list"]:
+        fmt = "<"
+        for field in command.head:
+            fmt += SCALARS[field.type][1] if field.type in SCALARS else "%ds" % field.size
+        out.append('    BL_CMD_%s: struct.Struct("%s"),' % (command.name, fmt))
+    out.append("}")
+    out.append("")
+    out.append("# Smallest and largest data of each command, None for no limit")
+    out.append("DATA_SIZES = {")
+    for command in schema["command_list"]:
+        data = command.data
+        if data is None:
+            limits = "(0, 0)"
+        elif data.bounded:
+            limits = "(0, %s)" % data.size_name
+        elif data.size is None:
+            limits = "(0, None)"
+        else:
+            limits = "(%s, %s)" % (data.size_name, data.size_name)
+        out.append("    BL_CMD_%s: %s," % (command.name, limits))
+    out.append("}")
+    out.append("")
+    out.append('''
+def name(command):
+    return COMMANDS.get(command, "0x%02x" % command)
+
+
+class Encoder:
+    """Assembles packets in a buffer of its own, one per link."""
+
+    def __init__(self):
+        size = HEADER_SIZE + max(s.size for s in FIELDS.values())
+        self.buffer = bytearray(size)
+        self.view = memoryview(self.buffer)
+
+    def encode(self, command, fields=(), data=b""):
+        """Header and fields of the packet as a view of the buffer, and the
+        data as given."""
+        layout = FIELDS[command]
+        low, high = DATA_SIZES[command]
+        size = memoryview(data).nbytes
+        if size < low or (high is not None and size > high):
+            raise ValueError("%s: %d bytes of data" % (name(command), size))
+        HEADER.pack_into(self.buffer, 0, BTL_GUARD, layout.size + size, command)
+        layout.pack_into(self.buffer, HEADER_SIZE, *fields)
+        return self.view[:HEADER_SIZE + layout.size], data
+
+    def packet(self, command, fields=(), data=b""):
+        """The whole packet in one piece, for links that frame it."""
+        head, data = self.encode(command, fields, data)
+        return b"".join((head, data))
+
+
+def decode(packet):
+    """Command, fields and data of a whole packet, the data as a view of
+    it."""
+    guard, size, command = HEADER.unpack_from(packet)
+    if guard != BTL_GUARD or command not in FIELDS:
+        raise ValueError("not a bootloader packet")
+    layout = FIELDS[command]
+    payload = memoryview(packet)[HEADER_SIZE:HEADER_SIZE + size]
+    if len(payload) != size or size < layout.size:
+        raise ValueError("%s: truncated" % name(command))
+    return command, layout.unpack_from(payload), payload[layout.size:]''')
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--schema", default=SCHEMA)
+    parser.add_argument("--check", action="store_true", help="fail if the generated files are stale")
+    args = parser.parse_args()
+
+    try:
+        schema = load(args.schema)
+    except (SchemaError, KeyError, ValueError) as e:
+        parser.error("%s: %s" % (args.schema, e))
+
+    stale = []
+    for path, text in ((C_HEADER, generate_c(schema)), (PY_MODULE, generate_py(schema))):
+        path = os.path.normpath(path)
+        try:
+            with open(path) as f:
+                current = f.read()
+        except FileNotFoundError:
+            current = None
+        if current == text:
+            continue
+        if args.check:
+            stale.append(path)
+        else:
+            with open(path, "w") as f:
+                f.write(text)
+            print("wrote %s" % path)
+
+    if stale:
+        print("stale, run btlgen.py: %s" % ", ".join(stale), file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""ECDSA P-256 image signing tool.
+
+Signs applications for a bootloader built with BTL_SIGNATURE, see
+bootloader_signature.c:
+
+    imgsign.py genkey -k key.pem
+    imgsign.py sign -k key.pem -i app.bin -o app_signed.bin
+
+genkey writes a new private key and prints the public key as the
+initializer of BTL_SIGNATURE_PUBLIC_KEY. sign appends the signature of the
+first bin_size bytes of the image, as given by its binary header, on the
+next word boundary; program app_signed.bin instead of app.bin. Keep the
+private key off the build server if you can.
+"""
+
+import argparse
+import struct
+import sys
+
+from cryptography.hazmat.primitives import hashes, serialization
+from cryptography.hazmat.primitives.asymmetric import ec
+from cryptography.hazmat.primitives.asymmetric.utils import decode_dss_signature
+
+SIGNATURE1 = 0xAA55FADE
+SIGNATURE2 = 0x55AAC0DE
+
+ERASE_BLOCK_SIZE = 8192
+
+P256_SIZE = 32
+
+
+def bin_size(app):
+    """bin_size field of the binary header, searched like the bootloader does"""
+    for offset in range(0, min(len(app), ERASE_BLOCK_SIZE) - 15, 4):
+        sig1, sig2, size, _ = struct.unpack_from("<IIII", app, offset)
+        if sig1 == SIGNATURE1 and sig2 == SIGNATURE2:
+            return size
+    return None
+
+
+def public_key_initializer(key):
+    numbers = key.public_key().public_numbers()
+    raw = numbers.x.to_bytes(P256_SIZE, "big") + numbers.y.to_bytes(P256_SIZE, "big")
+    lines = [", ".join("0x%02x" % b for b in raw[i:i + 12]) for i in range(0, len(raw), 12)]
+    return "{ \\\n    " + ", \\\n    ".join(lines) + " }"
+
+
+def sign(key, image, size):
+    der = key.sign(image[:size], ec.ECDSA(hashes.SHA256()))
+    r, s = decode_dss_signature(der)
+    padding = b"\xff" * (-size % 4)
+    return image[:size] + padding + r.to_bytes(P256_SIZE, "big") + s.to_bytes(P256_SIZE, "big")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+    genkey = sub.add_parser("genkey", help="create a private key")
+    genkey.add_argument("-k", "--key", required=True, help="private key to write, PEM")
+    signer = sub.add_parser("sign", help="sign an application binary")
+    signer.add_argument("-k", "--key", required=True, help="private key, PEM")
+    signer.add_argument("-i", "--input", required=True, help="application binary")
+    signer.add_argument("-o", "--output", required=True, help="signed binary to write")
+    args = parser.parse_args()
+
+    if args.command == "genkey":
+        key = ec.generate_private_key(ec.SECP256R1())
+        with open(args.key, "wb") as f:
+            f.write(key.private_bytes(serialization.Encoding.PEM,
+                                      serialization.PrivateFormat.PKCS8,
+                                      serialization.NoEncryption()))
+        print("#define BTL_SIGNATURE_PUBLIC_KEY        " + public_key_initializer(key))
+        return 0
+
+    with open(args.key, "rb") as f:
+        key = serialization.load_pem_private_key(f.read(), password=None)
+    with open(args.input, "rb") as f:
+        image = f.read()
+
+    if not isinstance(key, ec.EllipticCurvePrivateKey) or not isinstance(key.curve, ec.SECP256R1):
+        parser.error("not a P-256 private key")
+
+    size = bin_size(image)
+    if size is None:
+        parser.error("no binary header in the first erase block of the application")
+    if size > len(image):
+        parser.error("bin_size 0x%x is past the end of the file" % size)
+
+    with open(args.output, "wb") as f:
+        f.write(sign(key, image, size))
+
+    print("%d bytes signed" % size)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,267 @@
+#!/usr/bin/env python3
+"""Update container builder.
+
+Packs one or more binaries into the update container a bootloader built
+with BTL_CONTAINER decodes, see bootloader_container.h:
+
+    mkcontainer.py -i app.bin -o app.btlc
+    mkcontainer.py -i app.bin@0x82000 --base old.bin@0x2000 -o app.btlc
+
+The region of the manifest spans all inputs, gaps read as erased flash.
+Uniform erase blocks become FILL segments, everything else is cut into
+segments of --segment-blocks erase blocks, each stored RAW or LZ compressed,
+whichever is smaller. With --base the bytes currently in flash at that
+address are known and DELTA is tried as well; the base has to lie outside
+the region, e.g. the running bank while the other one is written.
+
+btl_host.py recognizes containers and sends them as STREAM packets.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+CONTAINER_MAGIC = 0x434C5442
+CONTAINER_VERSION = 1
+
+RAW = 0
+FILL = 1
+LZ = 2
+DELTA = 3
+
+OP_LITERAL = 0
+OP_MATCH = 1
+OP_BASE = 2
+OP_RUN = 3
+
+LENGTH_MASK = 0x3F
+
+MANIFEST = struct.Struct("<IHHIIIII")
+SEGMENT = struct.Struct("<IIIIIII")
+
+ERASE_BLOCK_SIZE = 8192
+PAGE_SIZE = 512
+FLASH_SIZE = 0x100000
+APP_START_ADDRESS = 0x2000
+
+MIN_MATCH = 4
+CHAIN_DEPTH = 16
+
+ENCODINGS = {RAW: "raw", FILL: "fill", LZ: "lz", DELTA: "delta"}
+
+
+def dsu_crc32(data):
+    """CRC the DSU computes over flash: CRC-32 seeded with 0xFFFFFFFF and no
+    final inversion."""
+    return zlib.crc32(data) ^ 0xFFFFFFFF
+
+
+def leb128(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def token(op, length, argument=b""):
+    n = length - 1
+    if n < LENGTH_MASK:
+        return bytes([op << 6 | n]) + argument
+    return bytes([op << 6 | LENGTH_MASK]) + leb128(n - LENGTH_MASK) + argument
+
+
+def match_length(a, i, b, j, limit):
+    """Common prefix of a[i:] and b[j:], at most limit bytes. a and b may be
+    the same buffer with i < j, overlapping copies are fine for the decoder
+    as long as the source is read byte by byte."""
+    n = 0
+    while n + 32 <= limit and a[i + n:i + n + 32] == b[j + n:j + n + 32]:
+        n += 32
+    while n < limit and a[i + n] == b[j + n]:
+        n += 1
+    return n
+
+
+def encode_tokens(data, base=None):
+    """Greedy LZ77 over the segment, with copies from base if given."""
+    out = bytearray()
+    literals = bytearray()
+    chains = {}
+    base_index = {}
+
+    if base is not None:
+        for p in range(len(base) - MIN_MATCH + 1):
+            positions = base_index.setdefault(bytes(base[p:p + MIN_MATCH]), [])
+            if len(positions) < CHAIN_DEPTH:
+                positions.append(p)
+
+    def insert(p):
+        positions = chains.setdefault(bytes(data[p:p + MIN_MATCH]), [])
+        positions.append(p)
+        if len(positions) > CHAIN_DEPTH:
+            del positions[0]
+
+    def flush():
+        if literals:
+            out.extend(token(OP_LITERAL, len(literals)) + literals)
+            literals.clear()
+
+    i = 0
+    n = len(data)
+    while i < n:
+        limit = n - i
+        best = (0, None, 0)
+
+        run = match_length(data, i, data, i + 1, limit - 1) + 1
+        if run >= MIN_MATCH:
+            best = (run, OP_RUN, data[i])
+
+        if limit >= MIN_MATCH:
+            key = bytes(data[i:i + MIN_MATCH])
+            for p in reversed(chains.get(key, ())):
+                length = match_length(data, p, data, i, limit)
+                if length > best[0]:
+                    best = (length, OP_MATCH, i - p)
+            for p in base_index.get(key, ()):
+                length = match_length(base, p, data, i, min(limit, len(base) - p))
+                if length > best[0]:
+                    best = (length, OP_BASE, p)
+
+        length, op, argument = best
+        if op is None:
+            literals.append(data[i])
+            if limit >= MIN_MATCH:
+                insert(i)
+            i += 1
+            continue
+
+        flush()
+        if op == OP_RUN:
+            out.extend(token(op, length, bytes([argument])))
+        else:
+            out.extend(token(op, length, leb128(argument)))
+        for p in range(i, min(i + length, n - MIN_MATCH + 1)):
+            insert(p)
+        i += length
+
+    flush()
+    return bytes(out)
+
+
+def segment(address, data, encoding, encoded, value=0):
+    words = (address, len(data), len(encoded), encoding, value, zlib.crc32(data))
+    head = struct.pack("<6I", *words)
+    return SEGMENT.pack(*(words + (zlib.crc32(head),))) + encoded
+
+
+def uniform_word(block):
+    word = block[:4]
+    return struct.unpack("<I", word)[0] if block == word * (len(block) // 4) else None
+
+
+def build(region, begin, end, base, base_address, segment_blocks):
+    """Segments covering region, which is the flash content of [begin, end)."""
+    segments = []
+    stats = dict((name, 0) for name in ENCODINGS.values())
+    blocks = [region[o:o + ERASE_BLOCK_SIZE] for o in range(0, len(region), ERASE_BLOCK_SIZE)]
+
+    n = 0
+    while n < len(blocks):
+        address = begin + n * ERASE_BLOCK_SIZE
+        word = uniform_word(blocks[n])
+
+        if word is not None:
+            count = 1
+            while n + count < len(blocks) and blocks[n + count] == blocks[n][:len(blocks[n + count])]:
+                count += 1
+            data = b"".join(blocks[n:n + count])
+            segments.append(segment(address, data, FILL, b"", word))
+            stats["fill"] += 1
+            n += count
+            continue
+
+        count = 1
+        while count < segment_blocks and n + count < len(blocks) and \
+                uniform_word(blocks[n + count]) is None:
+            count += 1
+        data = b"".join(blocks[n:n + count])
+
+        candidates = [(len(data), RAW, data, 0)]
+        lz = encode_tokens(data)
+        candidates.append((len(lz), LZ, lz, 0))
+        if base is not None:
+            delta = encode_tokens(data, base)
+            candidates.append((len(delta), DELTA, delta, base_address))
+        _, encoding, encoded, value = min(candidates, key=lambda c: (c[0], c[1]))
+
+        segments.append(segment(address, data, encoding, encoded, value))
+        stats[ENCODINGS[encoding]] += 1
+        n += count
+
+    return segments, stats
+
+
+def container(region, begin, end, segments):
+    size = MANIFEST.size + sum(len(s) for s in segments)
+    words = (CONTAINER_MAGIC, CONTAINER_VERSION, len(segments), begin, end, dsu_crc32(region), size)
+    head = struct.pack("<IHHIIII", *words)
+    return MANIFEST.pack(*(words + (zlib.crc32(head),))) + b"".join(segments)
+
+
+def file_at(spec, default):
+    name, _, address = spec.partition("@")
+    with open(name, "rb") as f:
+        return f.read(), int(address, 0) if address else default
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-i", "--input", action="append", required=True,
+                        help="binary, FILE[@ADDRESS], address 0x%x by default" % APP_START_ADDRESS)
+    parser.add_argument("--base", help="image now in flash for DELTA segments, FILE@ADDRESS")
+    parser.add_argument("--segment-blocks", type=int, default=8,
+                        help="erase blocks per segment at most")
+    parser.add_argument("-o", "--output", required=True, help="container to write")
+    args = parser.parse_args()
+
+    inputs = [file_at(spec, APP_START_ADDRESS) for spec in args.input]
+    begin = min(address for _, address in inputs) // ERASE_BLOCK_SIZE * ERASE_BLOCK_SIZE
+    end = max(address + len(data) for data, address in inputs)
+    end = (end + PAGE_SIZE - 1) // PAGE_SIZE * PAGE_SIZE
+    if end > FLASH_SIZE:
+        parser.error("inputs end past the flash at 0x%x" % end)
+
+    region = bytearray(b"\xff" * (end - begin))
+    for data, address in sorted(inputs, key=lambda i: i[1]):
+        if region[address - begin:address - begin + len(data)] != b"\xff" * len(data):
+            parser.error("input at 0x%x overlaps another one" % address)
+        region[address - begin:address - begin + len(data)] = data
+
+    base = base_address = None
+    if args.base:
+        if "@" not in args.base:
+            parser.error("--base needs the flash address of the image, FILE@ADDRESS")
+        base, base_address = file_at(args.base, None)
+        if base_address < end and base_address + len(base) > begin:
+            parser.error("the base overlaps the region 0x%x..0x%x it would be read during" % (begin, end))
+
+    segments, stats = build(bytes(region), begin, end, base, base_address, args.segment_blocks)
+    out = container(bytes(region), begin, end, segments)
+
+    with open(args.output, "wb") as f:
+        f.write(out)
+
+    print("0x%08x..0x%08x: %d bytes in %d bytes, %s" %
+          (begin, end, len(region), len(out),
+           ", ".join("%d %s" % (n, name) for name, n in stats.items() if n)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Partition table builder.
+
+Creates the table block of a bootloader built with BTL_PARTITIONS, see
+bootloader_partition.h:
+
+    mkpartitions.py -p 1:app:app:0x2000:0x60000:app.bin \\
+                    -p 2:calib:data:0x62000:0x2000 \\
+                    -p 3:assets:data:0x64000:0x18000 -o table.bin
+
+A partition is ID:NAME:TYPE:OFFSET:SIZE[:FILE], TYPE one of app, code and
+data. With FILE the partition is recorded as holding that file, padded to
+the erase block like btl_host.py sends it; code partitions have to be
+recorded before the bank boots. Program the block with a plain session at
+the table offset of the bank:
+
+    btl_host.py -p /dev/ttyUSB0 -a 0x7c000 -i table.bin
+
+A single partition is then updated on its own:
+
+    btl_host.py -p /dev/ttyUSB0 --partition 2 -a 0x62000 -i calib.bin
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+PARTITION_MAGIC = 0x54525042
+PARTITIONS_MAX = 8
+NAME_SIZE = 8
+RECORD_SIZE = 512
+
+TYPES = {"app": 1, "code": 2, "data": 3}
+
+ERASE_BLOCK_SIZE = 8192
+BANK_SIZE = 0x80000
+BOOTLOADER_SIZE = 0x2000
+TABLE_OFFSET = 0x7C000
+
+ENTRY = struct.Struct("<I8sIIIII")
+
+
+def pad_image(data):
+    rem = len(data) % ERASE_BLOCK_SIZE
+    if rem:
+        data += b"\xff" * (ERASE_BLOCK_SIZE - rem)
+    return data
+
+
+def parse(spec):
+    fields = spec.split(":")
+    if len(fields) not in (5, 6):
+        raise ValueError("expected ID:NAME:TYPE:OFFSET:SIZE[:FILE]")
+    pid, name, kind, offset, size = fields[:5]
+    if kind not in TYPES:
+        raise ValueError("type has to be one of %s" % ", ".join(TYPES))
+    if len(name.encode()) > NAME_SIZE:
+        raise ValueError("name longer than %d bytes" % NAME_SIZE)
+    length, crc = 0, 0
+    if len(fields) == 6:
+        with open(fields[5], "rb") as f:
+            data = pad_image(f.read())
+        length, crc = len(data), zlib.crc32(data)
+    return int(pid, 0), name.encode(), TYPES[kind], int(offset, 0), int(size, 0), length, crc
+
+
+def check(partitions, table_offset):
+    ranges = [(0, BOOTLOADER_SIZE, "the bootloader"),
+              (table_offset, table_offset + ERASE_BLOCK_SIZE, "the table")]
+    ids = set()
+    for pid, name, _, offset, size, length, _ in partitions:
+        label = name.decode()
+        if pid in ids:
+            raise ValueError("%s: ID %d used twice" % (label, pid))
+        ids.add(pid)
+        if offset % ERASE_BLOCK_SIZE or size % ERASE_BLOCK_SIZE or not size:
+            raise ValueError("%s: offset and size have to be erase blocks" % label)
+        if offset + size > BANK_SIZE:
+            raise ValueError("%s: ends past the bank" % label)
+        if length > size:
+            raise ValueError("%s: file does not fit" % label)
+        for begin, end, other in ranges:
+            if offset < end and begin < offset + size:
+                raise ValueError("%s: overlaps %s" % (label, other))
+        ranges.append((offset, offset + size, label))
+
+
+def table_block(partitions):
+    entries = b"".join(ENTRY.pack(*p) for p in partitions)
+    entries += b"\xff" * (ENTRY.size * (PARTITIONS_MAX - len(partitions)))
+    table = struct.pack("<II", PARTITION_MAGIC, len(partitions)) + entries
+    table += struct.pack("<I", zlib.crc32(table))
+    assert len(table) <= RECORD_SIZE
+    return table + b"\xff" * (ERASE_BLOCK_SIZE - len(table))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-p", "--partition", action="append", required=True,
+                        help="ID:NAME:TYPE:OFFSET:SIZE[:FILE]")
+    parser.add_argument("--table-offset", type=lambda x: int(x, 0), default=TABLE_OFFSET,
+                        help="BTL_PARTITION_TABLE_OFFSET")
+    parser.add_argument("-o", "--output", required=True, help="table block to write")
+    args = parser.parse_args()
+
+    if len(args.partition) > PARTITIONS_MAX:
+        parser.error("at most %d partitions" % PARTITIONS_MAX)
+
+    try:
+        partitions = [parse(spec) for spec in args.partition]
+        check(partitions, args.table_offset)
+    except (ValueError, OSError) as e:
+        parser.error(str(e))
+
+    with open(args.output, "wb") as f:
+        f.write(table_block(partitions))
+
+    for pid, name, kind, offset, size, length, _ in partitions:
+        kind = next(k for k, v in TYPES.items() if v == kind)
+        print("%3d %-8s %-4s 0x%05x..0x%05x %s" %
+              (pid, name.decode(), kind, offset, offset + size,
+               "%d bytes recorded" % length if length else "empty"))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+"""Reed-Solomon code of FEC_DATA packets and a noisy link benchmark.
+
+btl_host.py imports the encoder from here, see bootloader_fec.h for the
+packet layout. Run on its own the script simulates sending an image over a
+link with random byte errors, optionally in bursts, and prints the goodput
+of plain DATA packets against FEC_DATA packets of several strengths:
+
+    rsfec.py --rates 1e-5,1e-4,1e-3 --parity 8,16,32
+    rsfec.py --rates 1e-4 --burst 20
+
+A plain block is sent again whenever one of its bytes is hit. An FEC block
+is sent again when a codeword has more errors than half its parity or its
+header is hit. Goodput is image bytes over bytes on the wire, responses
+left out. --check decodes every simulated FEC block for real instead of
+counting errors per codeword, which is slow but exercises the decoder.
+"""
+
+import argparse
+import random
+import struct
+import sys
+
+from btl_protocol import BLOCK_SIZE, HEADER_SIZE
+
+MESSAGE_SIZE = 4 + BLOCK_SIZE
+PARITY_MAX = 64
+
+# A block that takes more tries than this counts as never getting across
+ATTEMPTS_MAX = 1000
+
+EXP = [0] * 512
+LOG = [0] * 256
+_x = 1
+for _i in range(255):
+    EXP[_i] = _x
+    LOG[_x] = _i
+    _x <<= 1
+    if _x & 0x100:
+        _x ^= 0x11D
+for _i in range(255, 512):
+    EXP[_i] = EXP[_i - 255]
+
+
+def mul(a, b):
+    return EXP[LOG[a] + LOG[b]] if a and b else 0
+
+
+def div(a, b):
+    return EXP[LOG[a] + 255 - LOG[b]] if a else 0
+
+
+def generator(parity):
+    """Code polynomial with roots 2^0 .. 2^(parity-1), highest degree first."""
+    g = [1]
+    for i in range(parity):
+        g = [a ^ mul(b, EXP[i]) for a, b in zip(g + [0], [0] + g)]
+    return g
+
+
+_generators = {}
+
+
+def encode_codeword(message, parity):
+    """Message followed by its parity bytes."""
+    g = _generators.setdefault(parity, generator(parity))
+    remainder = [0] * parity
+    for byte in message:
+        factor = byte ^ remainder[0]
+        remainder = remainder[1:] + [0]
+        if factor:
+            for i in range(parity):
+                remainder[i] ^= mul(g[i + 1], factor)
+    return bytes(message) + bytes(remainder)
+
+
+def layout(parity):
+    """Codewords and message bytes per codeword, BTL_FEC_CODEWORDS and
+    BTL_FEC_MESSAGE_BYTES."""
+    codewords = (MESSAGE_SIZE + 254 - parity) // (255 - parity)
+    return codewords, (MESSAGE_SIZE + codewords - 1) // codewords
+
+
+def payload_size(parity):
+    codewords, length = layout(parity)
+    return 4 + codewords * (length + parity)
+
+
+def encode_codewords(address, block, parity):
+    """Interleaved codewords of one erase block, the data of FEC_DATA."""
+    if parity % 2 or not 2 <= parity <= PARITY_MAX:
+        raise ValueError("parity has to be even and between 2 and %d" % PARITY_MAX)
+    codewords, length = layout(parity)
+    message = struct.pack("<I", address) + bytes(block)
+    message += bytes(codewords * length - len(message))
+    coded = [encode_codeword(message[i * length:(i + 1) * length], parity) for i in range(codewords)]
+    return bytes(coded[i][j] for j in range(length + parity) for i in range(codewords))
+
+
+def encode(address, block, parity):
+    """FEC_DATA payload of one erase block."""
+    return struct.pack("<I", address) + encode_codewords(address, block, parity)
+
+
+def decode_codeword(codeword, parity):
+    """Mirror of bootloader_FecDecode, returns the corrected codeword or
+    None."""
+    c = list(codeword)
+    n = len(c)
+    syndromes = []
+    for i in range(parity):
+        s = 0
+        for byte in c:
+            s = mul(s, EXP[i]) ^ byte
+        syndromes.append(s)
+    if not any(syndromes):
+        return bytes(c)
+
+    lam = [1] + [0] * parity
+    prev = [1] + [0] * parity
+    degree, shift, b = 0, 1, 1
+    for k in range(parity):
+        d = syndromes[k]
+        for i in range(1, degree + 1):
+            d ^= mul(lam[i], syndromes[k - i])
+        if d == 0:
+            shift += 1
+            continue
+        coef = div(d, b)
+        last = lam[:]
+        for i in range(parity + 1 - shift):
+            lam[i + shift] ^= mul(coef, prev[i])
+        if 2 * degree <= k:
+            degree, prev, b, shift = k + 1 - degree, last, d, 1
+        else:
+            shift += 1
+    if 2 * degree > parity:
+        return None
+
+    omega = [0] * parity
+    for i in range(parity):
+        for j in range(min(i, degree) + 1):
+            omega[i] ^= mul(syndromes[i - j], lam[j])
+
+    def evaluate(poly, power):
+        value = 0
+        for coefficient in reversed(poly):
+            value = mul(value, EXP[power]) ^ coefficient
+        return value
+
+    found = 0
+    for j in range(n):
+        power = n - 1 - j
+        inverse = (255 - power) % 255
+        if evaluate(lam[:degree + 1], inverse):
+            continue
+        derivative = 0
+        for i in range(1, degree + 1, 2):
+            derivative ^= mul(lam[i], EXP[((i - 1) * inverse) % 255])
+        if derivative == 0:
+            return None
+        c[j] ^= mul(EXP[power], div(evaluate(omega, inverse), derivative))
+        found += 1
+    return bytes(c) if found == degree else None
+
+
+def decode(payload, parity):
+    """Address and block of an FEC_DATA payload, or None."""
+    codewords, length = layout(parity)
+    data = payload[4:]
+    message = b""
+    for i in range(codewords):
+        codeword = decode_codeword(data[i::codewords], parity)
+        if codeword is None:
+            return None
+        message += codeword[:length]
+    if message[:4] != payload[:4] or any(message[MESSAGE_SIZE:]):
+        return None
+    return struct.unpack_from("<I", message)[0], message[4:MESSAGE_SIZE]
+
+
+def error_positions(rng, size, rate, burst):
+    """Positions hit in a packet of size bytes; bursts start at rate / burst
+    so that the byte error rate stays the same."""
+    hits = set()
+    starts = rate / burst
+    position = 0
+    while True:
+        position += int(rng.expovariate(starts)) + 1 if starts > 0 else size
+        if position > size:
+            return hits
+        hits.update(range(position - 1, min(position - 1 + burst, size)))
+
+
+def fec_received(rng, hits, parity, check):
+    codewords, length = layout(parity)
+    if any(h < HEADER_SIZE + 4 for h in hits):
+        return False
+    if not check:
+        per_codeword = [0] * codewords
+        for h in hits:
+            per_codeword[(h - HEADER_SIZE - 4) % codewords] += 1
+        return max(per_codeword) <= parity // 2
+    block = bytes(rng.getrandbits(8) for _ in range(BLOCK_SIZE))
+    payload = bytearray(encode(0x2000, block, parity))
+    for h in hits:
+        payload[h - HEADER_SIZE] ^= rng.randrange(1, 256)
+    return decode(bytes(payload), parity) == (0x2000, block)
+
+
+def simulate(rng, blocks, rate, burst, parity, check):
+    """Bytes on the wire to get blocks erase blocks across, or None."""
+    size = HEADER_SIZE + (payload_size(parity) if parity else 4 + BLOCK_SIZE)
+    sent = 0
+    for _ in range(blocks):
+        for _ in range(ATTEMPTS_MAX):
+            sent += size
+            hits = error_positions(rng, size, rate, burst)
+            if not hits or (parity and fec_received(rng, hits, parity, check)):
+                break
+        else:
+            return None
+    return sent
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--rates", default="1e-6,1e-5,1e-4,3e-4,1e-3",
+                        help="byte error rates, comma separated")
+    parser.add_argument("--parity", default="4,8,16,32",
+                        help="parity bytes per codeword to compare, comma separated")
+    parser.add_argument("--burst", type=int, default=1, help="bytes hit by each error")
+    parser.add_argument("--blocks", type=int, default=64, help="erase blocks per run")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--check", action="store_true", help="decode every FEC block")
+    args = parser.parse_args()
+
+    rates = [float(r) for r in args.rates.split(",")]
+    parities = [int(p) for p in args.parity.split(",")]
+    for parity in parities:
+        if parity % 2 or not 2 <= parity <= PARITY_MAX:
+            parser.error("parity has to be even and between 2 and %d" % PARITY_MAX)
+
+    rng = random.Random(args.seed)
+    columns = ["DATA"] + ["FEC %d" % p for p in parities]
+    print("%-10s" % "rate" + "".join("%10s" % c for c in columns))
+    for rate in rates:
+        row = []
+        for parity in [0] + parities:
+            sent = simulate(rng, args.blocks, rate, args.burst, parity, args.check)
+            row.append("%10.3f" % (args.blocks * BLOCK_SIZE / sent) if sent else "%10s" % "-")
+        print("%-10g" % rate + "".join(row))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())